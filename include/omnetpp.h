@@ -30,6 +30,7 @@
 #include "omnetpp/cabstracthistogram.h"
 #include "omnetpp/carray.h"
 #include "omnetpp/cboolparimpl.h"
+#include "omnetpp/ccalendareventset.h"
 #include "omnetpp/ccanvas.h"
 #include "omnetpp/cchannel.h"
 #include "omnetpp/cclassdescriptor.h"
@@ -68,6 +69,7 @@
 #include "omnetpp/cmatchexpression.h"
 #include "omnetpp/cmersennetwister.h"
 #include "omnetpp/cmessage.h"
+#include "omnetpp/cmessagepool.h"
 #include "omnetpp/cmessageprinter.h"
 #include "omnetpp/cmodelchange.h"
 #include "omnetpp/cmodule.h"
@@ -0,0 +1,213 @@
+//==========================================================================
+//  CCALENDAREVENTSET.H - part of
+//                     OMNeT++/OMNEST
+//            Discrete System Simulation in C++
+//
+//==========================================================================
+
+/*--------------------------------------------------------------*
+  Copyright (C) 1992-2017 Andras Varga
+  Copyright (C) 2006-2017 OpenSim Ltd.
+
+  This file is distributed WITHOUT ANY WARRANTY. See the file
+  `license' for details on this and other legal matters.
+*--------------------------------------------------------------*/
+
+#ifndef __OMNETPP_CCALENDAREVENTSET_H
+#define __OMNETPP_CCALENDAREVENTSET_H
+
+#include <vector>
+#include "cfutureeventset.h"
+
+namespace omnetpp {
+
+/**
+ * @brief Future event set implemented as a calendar queue (R. Brown, 1988),
+ * with amortized O(1) insertion and removal.
+ *
+ * Simulation time is divided into "days" of equal width, and days map to the
+ * buckets of the calendar cyclically, like days of a year. Events are stored
+ * in the bucket of their day, each bucket being a small binary heap ordered
+ * the same way as cEventHeap (arrival time, scheduling priority, insertion
+ * order), so the order of events and thus fingerprints do not depend on which
+ * of the two is used. The next event is found by stepping through the days
+ * starting at the current one.
+ *
+ * The number of buckets follows the number of events (it is doubled or halved
+ * as needed), and the day width is re-estimated from the spacing of the
+ * earliest events whenever the buckets are rebuilt, or when too many empty
+ * days are stepped over or the buckets become crowded. Rebuilding is O(n),
+ * but it is done at most once per O(n) operations.
+ *
+ * The calendar queue outperforms the heap on large event sets where the
+ * timestamps are spread reasonably evenly; see test/misc/fes for a benchmark.
+ * Select it with the <tt>futureeventset-class=omnetpp::cCalendarEventSet</tt>
+ * configuration option.
+ *
+ * @ingroup SimCore
+ */
+class SIM_API cCalendarEventSet : public cFutureEventSet
+{
+  private:
+    typedef std::vector<cEvent *> Bucket;  // binary heap; cEvent::heapIndex is the index in it
+
+    std::vector<Bucket> buckets;
+    int numBuckets = 0;            // always power of 2
+    int64_t dayWidth = 1;          // in raw simtime units
+    int length = 0;                // number of events
+    eventnumber_t insertCount = 0; // counts insertions; needed for keeping the order of events with equal time and priority
+
+    mutable int64_t currentDay = 0;  // no event is on an earlier day
+    mutable int firstBucket = -1;    // bucket of the first event if known, or -1
+
+    // for adapting the day width
+    mutable int64_t numDaysStepped = 0;
+    int64_t numBucketEntries = 0;
+    int numOps = 0;
+    int adaptInterval = 1;         // in units of numBuckets operations
+
+    // for get(k)
+    std::vector<cEvent *> array;
+    bool arrayValid = false;
+
+  private:
+    void copy(const cCalendarEventSet& other);
+
+    int64_t dayOf(const cEvent *event) const;
+    int bucketOf(const cEvent *event) const {return (int)(dayOf(event) & (numBuckets-1));}
+
+    void bucketInsert(Bucket& bucket, cEvent *event);
+    void bucketRemove(Bucket& bucket, int index);
+    void siftUp(Bucket& bucket, int index);
+    void siftDown(Bucket& bucket, int index);
+
+    int findFirst() const;
+    void adapt();
+    void rebuild(int newNumBuckets);
+    void collectEvents(std::vector<cEvent *>& events) const;
+    void redistribute(const std::vector<cEvent *>& events, int newNumBuckets, int64_t newDayWidth);
+    int64_t estimateDayWidth(std::vector<cEvent *>& events) const;
+    void fillArray();
+
+  public:
+    // utility function for checking the sanity of the data structure
+    virtual void checkCalendar();
+
+  public:
+    /** @name Constructors, destructor, assignment */
+    //@{
+
+    /**
+     * Copy constructor.
+     */
+    cCalendarEventSet(const cCalendarEventSet& other);
+
+    /**
+     * Constructor.
+     */
+    cCalendarEventSet(const char *name=nullptr);
+
+    /**
+     * Destructor.
+     */
+    virtual ~cCalendarEventSet();
+
+    /**
+     * Assignment operator. The name member is not copied;
+     * see cOwnedObject's operator=() for more details.
+     */
+    cCalendarEventSet& operator=(const cCalendarEventSet& other);
+    //@}
+
+    /** @name Redefined cObject member functions. */
+    //@{
+
+    /**
+     * Creates and returns an exact copy of this object.
+     * See cObject for more details.
+     */
+    virtual cCalendarEventSet *dup() const override  {return new cCalendarEventSet(*this);}
+
+    /**
+     * Produces a one-line description of the object's contents.
+     * See cObject for more details.
+     */
+    virtual std::string str() const override;
+
+    /**
+     * Calls v->visit(this) for each contained object.
+     * See cObject for more details.
+     */
+    virtual void forEachChild(cVisitor *v) override;
+
+    // no parsimPack() and parsimUnpack()
+    //@}
+
+    /** @name Simulation-related operations. */
+    //@{
+    /**
+     * Insert an event into the FES.
+     */
+    virtual void insert(cEvent *event) override;
+
+    /**
+     * Peek the first event in the FES (the one with the smallest timestamp.)
+     * If the FES is empty, it returns nullptr.
+     */
+    virtual cEvent *peekFirst() const override;
+
+    /**
+     * Removes and return the first event in the FES (the one with the
+     * smallest timestamp.) If the FES is empty, it returns nullptr.
+     */
+    virtual cEvent *removeFirst() override;
+
+    /**
+     * Undo for removeFirst(): it puts back an event to the front of the FES.
+     */
+    virtual void putBackFirst(cEvent *event) override;
+
+    /**
+     * Removes and returns the given event in the FES. If the event is
+     * not in the FES, returns nullptr.
+     */
+    virtual cEvent *remove(cEvent *event) override;
+
+    /**
+     * Returns true if the FES is empty.
+     */
+    virtual bool isEmpty() const override {return length == 0;}
+
+    /**
+     * Deletes all events in the FES.
+     */
+    virtual void clear() override;
+    //@}
+
+    /** @name Random access. */
+    //@{
+
+    /**
+     * Returns the number of events in the FES.
+     */
+    virtual int getLength() const override {return length;}
+
+    /**
+     * Returns the kth event in the FES if 0 <= k < getLength(), and nullptr
+     * otherwise. Note that iteration does not necessarily return events
+     * in increasing timestamp (getArrivalTime()) order unless you called
+     * sort() before.
+     */
+    virtual cEvent *get(int k) override;
+
+    /**
+     * Sorts the contents of the FES. This is only necessary if one wants
+     * to iterate through in the FES in strict timestamp order.
+     */
+    virtual void sort() override;
+};
+
+}  // namespace omnetpp
+
+
+#endif
@@ -113,6 +113,23 @@ class SIM_API cComponent : public cSoftOwner //implies noncopyable
     typedef std::vector<SignalListenerList> SignalTable;
     SignalTable *signalTable; // ordered by signalID so we can do binary search
 
+    // cache for emit(): for the signals emitted by this component, the listener lists of this
+    // component and its ancestors, so that the module tree need not be walked on every emit
+    struct ListenerLevel {
+        cComponent *component;
+        cIListener **listeners;  // same array as in the component's signalTable
+    };
+    struct ListenerCacheEntry {
+        simsignal_t signalID;
+        std::vector<ListenerLevel> levels;  // components that have listeners for the signal, from this one up to the root
+    };
+    struct ListenerCache {
+        uint64_t generation;  // value of listenerCacheGeneration when the entries were computed
+        std::vector<ListenerCacheEntry*> entries;
+    };
+    mutable ListenerCache *listenerCache = nullptr;
+    static OPP_THREAD_LOCAL uint64_t listenerCacheGeneration;  // incremented on subscribe/unsubscribe and module tree changes
+
     std::unordered_set<void**> *selfPointers = nullptr;
 
     // string-to-simsignal_t mapping (ALL THREADS)
@@ -147,6 +164,11 @@ class SIM_API cComponent : public cSoftOwner //implies noncopyable
     void removeListenerList(simsignal_t signalID);
     void checkNotFiring(simsignal_t, cIListener **listenerList);
     template<typename T> void fire(cComponent *src, simsignal_t signalID, T x, cObject *details);
+    template<typename T> void fireCached(const ListenerCacheEntry *entry, simsignal_t signalID, T x, cObject *details);
+    template<typename T> void notifyListeners(cIListener **listeners, cComponent *src, simsignal_t signalID, T x, cObject *details);
+    const ListenerCacheEntry *getListenerCacheEntry(simsignal_t signalID) const;
+    const ListenerCacheEntry *createListenerCacheEntry(simsignal_t signalID) const;
+    void deleteListenerCache() const;
     void fireFinish();
     void releaseLocalListeners();
     const SignalListenerList& getListenerList(int k) const {return (*signalTable)[k];} // for inspectors
@@ -206,10 +228,9 @@ class SIM_API cComponent : public cSoftOwner //implies noncopyable
     // internal: clears signal registrations; to be invoked on exit
     static void clearSignalRegistrations();
 
-    // internal: allocates a signalHasLocalListeners/signalHasAncestorListeners bit index to the
-    // given signal and returns the corresponding mask (1<<index); returns 0 if there are no more
-    // free bit indices. Result is remembered and returned in subsequent calls (until clearSignalState())
-    static uint64_t getSignalMask(simsignal_t signalID);
+    // internal: invalidates the listener lists cached for emit() in all components; to be invoked
+    // when listener lists change or components are moved in the module tree
+    static void invalidateListenerCaches() {listenerCacheGeneration++;}
 
     // internal: controls whether signals should be validated against @signal declarations in NED files
     static void setCheckSignals(bool b) {checkSignals = b;}
@@ -1060,8 +1081,9 @@ class SIM_API cComponent : public cSoftOwner //implies noncopyable
 
     /**
      * Returns true if the given signal has any listeners. In the current
-     * implementation, this involves checking listener lists in ancestor
-     * modules until the first listener is found, or up to the root.
+     * implementation, this involves looking up the signal in the listener
+     * cache of the component, which is (re)built by walking the ancestor
+     * modules after listeners have been added or removed anywhere.
      * This method may be useful if producing the data for an emit()
      * call would be expensive compared to a hasListeners() call.
      *
@@ -21,24 +21,39 @@
 namespace omnetpp {
 
 /**
- * @brief The default, binary heap based implementation of the future event set.
+ * @brief The default, heap based implementation of the future event set.
  *
- * Using binary heap as the underlying data structure provides reliable
+ * Using a heap as the underlying data structure provides reliable
  * performance for most workloads. A worst case for heap is insertion at the
  * front (i.e. for the current simulation time), which is actually quite common,
  * due to the abundance of zero-delay links in models. This case is optimized
  * by employing an additional circular buffer specifically for storing events
  * inserted scheduled for the current simulation time.
  *
+ * The heap is 4-ary, and it stores the sort key of each event (arrival time,
+ * scheduling priority, insertion order) next to the event pointer, so that
+ * comparisons do not need to access the event objects. The array is laid out
+ * so that the four children of a node occupy an aligned 128-byte block
+ * (two cache lines).
+ *
  * @ingroup SimCore
  */
 class SIM_API cEventHeap : public cFutureEventSet
 {
   private:
+    // heap element: the event with its sort key
+    struct Entry {
+        int64_t arrivalTime;       // raw simtime
+        eventnumber_t insertOrder;
+        cEvent *event;
+        short priority;
+    };
+
     // heap data structure
-    cEvent **heap = nullptr;       // heap array  (heap[0] always empty)
+    char *heapBuffer = nullptr;    // allocated memory, heap[] is aligned within it
+    Entry *heap = nullptr;         // heap array (the root is at HEAPROOT, elements before it are unused)
     int heapLength = 0;            // number of elements on the heap
-    int heapCapacity = 0;          // allocated size of the heap[] array
+    int heapCapacity = 0;          // allocated size of the heap[] array, excluding the unused elements
     eventnumber_t insertCount = 0; // counts insertions; needed because heap's insert is not stable (does not keep order)
 
     // circular buffer for events scheduled for the current simtime (quite frequent); acts as FIFO
@@ -51,7 +66,8 @@ class SIM_API cEventHeap : public cFutureEventSet
     void copy(const cEventHeap& other);
 
     // internal: restore heap
-    void shiftup(int from=1);
+    void shiftup(int from);
+    void allocateHeap(int capacity);
 
     int cblength() const  {return (cbtail-cbhead) & (cbsize-1);}
     cEvent *cbget(int k)  {return cb[(cbhead+k) & (cbsize-1)];}
@@ -633,9 +633,28 @@ class SIM_API cMessage : public cEvent
     static uint64_t getLiveMessageCount() {return liveMsgCount;}
 
     /**
-     * Reset counters used by getTotalMessageCount() and getLiveMessageCount().
+     * Returns the number of message objects allocated from the message pools
+     * of pooled message classes (see cPooledMessage) since the last reset.
      */
-    static void resetMessageCounters()  {totalMsgCount=liveMsgCount=0;}
+    static uint64_t getPooledMessageCount();
+
+    /**
+     * Returns the number of allocations counted by getPooledMessageCount()
+     * that reused the storage of a previously deleted message.
+     */
+    static uint64_t getReusedMessageCount();
+
+    /**
+     * Returns the number of deleted messages whose storage is currently
+     * kept in the message pools for reuse.
+     */
+    static uint64_t getFreePooledMessageCount();
+
+    /**
+     * Reset counters used by getTotalMessageCount(), getLiveMessageCount(),
+     * getPooledMessageCount() and getReusedMessageCount().
+     */
+    static void resetMessageCounters();
     //@}
 };
 
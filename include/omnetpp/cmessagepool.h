@@ -0,0 +1,222 @@
+//==========================================================================
+//   CMESSAGEPOOL.H - part of
+//                     OMNeT++/OMNEST
+//            Discrete System Simulation in C++
+//
+//==========================================================================
+
+/*--------------------------------------------------------------*
+  Copyright (C) 1992-2017 Andras Varga
+  Copyright (C) 2006-2017 OpenSim Ltd.
+
+  This file is distributed WITHOUT ANY WARRANTY. See the file
+  `license' for details on this and other legal matters.
+*--------------------------------------------------------------*/
+
+#ifndef __OMNETPP_CMESSAGEPOOL_H
+#define __OMNETPP_CMESSAGEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <typeinfo>
+#include <type_traits>
+#include "simkerneldefs.h"
+
+namespace omnetpp {
+
+class cMessage;
+
+/**
+ * @brief Free list for the storage of message objects of one class.
+ *
+ * When an object of a pooled class is deleted, its storage is kept on the
+ * free list, and reused for the next object of the same class instead of
+ * being returned to the heap allocator. Only objects of the size the pool
+ * was created for are pooled; objects of larger subclasses that do not
+ * have a pool of their own are allocated with the global operator new.
+ *
+ * Pools are per thread, and they are usually not used directly, but via
+ * cPooledMessage. The statistics of all pools of the thread are available
+ * via cMessage::getPooledMessageCount() and related functions.
+ *
+ * @see cPooledMessage
+ * @ingroup SimProgr
+ */
+class SIM_API cMessagePool
+{
+  private:
+    struct FreeObject {
+        FreeObject *next;
+    };
+
+    const std::type_info& type;  // class of the pooled objects
+    const size_t objectSize;     // size of the pooled objects
+    FreeObject *freeList = nullptr;
+    size_t numFree = 0;          // length of the free list
+    uint64_t numAllocated = 0;   // allocations since the last reset
+    uint64_t numReused = 0;      // of which were served from the free list
+
+    cMessagePool *nextPool;      // list of the pools of this thread
+    static OPP_THREAD_LOCAL cMessagePool *firstPool;
+
+  private:
+    void *allocateNew(size_t size);
+
+  public:
+    /**
+     * Constructor. The pool keeps the storage of objects of the given class
+     * and size, and is added to the pools of the current thread.
+     */
+    cMessagePool(const std::type_info& type, size_t objectSize);
+
+    /**
+     * Destructor. Frees the storage on the free list.
+     */
+    ~cMessagePool();
+
+    /**
+     * Returns storage for an object of the given size, reusing the storage
+     * of a deleted object if possible.
+     */
+    void *allocate(size_t size) {
+        if (!freeList || size != objectSize)
+            return allocateNew(size);
+        FreeObject *object = freeList;
+        freeList = object->next;
+        numFree--;
+        numAllocated++;
+        numReused++;
+        return object;
+    }
+
+    /**
+     * Takes back the storage of a deleted object, which was returned by
+     * allocate() with the same size.
+     */
+    void release(void *p, size_t size) {
+        if (size != objectSize) {
+            ::operator delete(p);
+            return;
+        }
+        FreeObject *object = (FreeObject *)p;
+        object->next = freeList;
+        freeList = object;
+        numFree++;
+    }
+
+    /**
+     * Returns the storage on the free list to the heap allocator.
+     */
+    void purge();
+
+    /**
+     * Returns the name of the class of the pooled objects.
+     */
+    const char *getClassName() const;
+
+    /**
+     * Returns the size of the pooled objects.
+     */
+    size_t getObjectSize() const {return objectSize;}
+
+    /**
+     * Returns the number of objects allocated from the pool since the last
+     * reset. Objects of other sizes than getObjectSize() are not counted.
+     */
+    uint64_t getNumAllocated() const {return numAllocated;}
+
+    /**
+     * Returns the number of allocations since the last reset that reused
+     * the storage of a deleted object.
+     */
+    uint64_t getNumReused() const {return numReused;}
+
+    /**
+     * Returns the number of deleted objects whose storage is on the free list.
+     */
+    size_t getNumFree() const {return numFree;}
+
+    /**
+     * Resets the counters returned by getNumAllocated() and getNumReused().
+     */
+    void resetCounters() {numAllocated = numReused = 0;}
+
+    /** @name Pools of the current thread */
+    //@{
+    /**
+     * Returns the first pool of the current thread, or nullptr if there are
+     * no pools. Use getNextPool() to iterate over the others.
+     */
+    static cMessagePool *getFirstPool() {return firstPool;}
+
+    /**
+     * Returns the next pool of the current thread, or nullptr.
+     */
+    cMessagePool *getNextPool() const {return nextPool;}
+
+    /**
+     * Calls purge() on all pools of the current thread.
+     */
+    static void purgeAll();
+    //@}
+};
+
+/**
+ * @brief Mix-in class that makes the objects of a message class allocated
+ * from a per-class free list (cMessagePool) instead of with the global
+ * operator new.
+ *
+ * Messages are created and deleted in large numbers in most simulations,
+ * and pooling their storage reduces the time spent in the heap allocator.
+ * The constructor still runs on the reused storage, so the fields of the
+ * new object are initialized as usual. Object creation via
+ * cObjectFactory (Register_Class()) and dup() also goes through the pool,
+ * because they create the object with <tt>new</tt>.
+ *
+ * Pooling is opt-in per class: add cPooledMessage with the class itself as
+ * template argument to the base classes.
+ *
+ * \code
+ * class Job : public cMessage, public cPooledMessage<Job>
+ * {
+ *     ...
+ * };
+ * \endcode
+ *
+ * For classes generated from message definitions, use the @pooled class
+ * property. Note that a class and its subclass cannot both be pooled, as
+ * their operator new would be ambiguous. Storage kept for reuse is not
+ * freed, so memory checkers cannot detect accesses to deleted objects of
+ * pooled classes.
+ *
+ * @see cMessagePool, cMessage::getPooledMessageCount()
+ * @ingroup SimProgr
+ */
+template <class T>
+class cPooledMessage
+{
+  public:
+    /**
+     * Returns the pool of the class in the current thread.
+     */
+    static cMessagePool& getPool() {
+        static OPP_THREAD_LOCAL cMessagePool pool(typeid(T), sizeof(T));
+        return pool;
+    }
+
+    static void *operator new(size_t size) {
+        static_assert(std::is_base_of<cMessage, T>::value, "cPooledMessage<T>: T must be a message class");
+        return getPool().allocate(size);
+    }
+
+    static void operator delete(void *p, size_t size) {
+        getPool().release(p, size);
+    }
+};
+
+}  // namespace omnetpp
+
+
+#endif
+
@@ -94,6 +94,8 @@ namespace omnetpp {
  *      overriding its handleMessage() or activity() member function.
  *    - cMessage represents events, and also messages sent among modules
  *    - cPacket is a subclass of cMessage that represents network packets
+ *    - cPooledMessage makes a message class allocate its objects from a
+ *      per-class free list (cMessagePool)
  *    - cQueue is a generic FIFO data structure for storing objects
  *    - cPacketQueue is a cQueue subclass specialized for cPacket objects
  *    - cTopology is a utility class for discovering the topology of the model
@@ -110,7 +112,8 @@ namespace omnetpp {
  *    - cEvent represents a simulation event, but it is mostly intended for
  *      internal use (models should use cMessage)
  *    - cFutureEventSet represents the future events set (FES) of the simulation,
- *      and cEventHeap is its default, heap-based implementation
+ *      and cEventHeap is its default, heap-based implementation; cCalendarEventSet
+ *      is an alternative implementation based on a calendar queue
  *    - cScheduler is the interface for simulation event schedulers, and
  *      cSequentialScheduler and cRealTimeScheduler are its two built-in
  *      implementations
@@ -0,0 +1,142 @@
+//
+// Microbenchmark for the controller checkpoint: time to write a checkpoint
+// of N flow rules, and time to warm-restart from it, split into mapping and
+// validating the file and rebuilding the flow table and classifier as the
+// controller does. Every run checks that the restored rules equal the
+// written ones.
+//
+
+#include "FlowClassifier.h"
+#include "StateCheckpoint.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sdn_dashboard;
+
+struct Rule {
+    int flowId;
+    std::string srcIP, dstIP, action;
+    int srcPort, dstPort, protocol, priority, sliceId;
+    double idleTimeout, hardTimeout;
+    int64_t packets, bytes;
+};
+
+static std::string ipString(uint32_t a)
+{
+    return std::to_string(a >> 24) + "." + std::to_string((a >> 16) & 255) + "." + std::to_string((a >> 8) & 255) + "." + std::to_string(a & 255);
+}
+
+static double since(std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+}
+
+static void run(int numRules, const std::string &fileName, std::mt19937 &rng)
+{
+    std::map<int, Rule> rules;
+    for (int i = 1; i <= numRules; i++) {
+        Rule &r = rules[i];
+        r.flowId = i;
+        r.srcIP = ipString(0x0A000000u + rng() % (1 << 24));
+        r.dstIP = rng() % 4 ? "" : ipString(0x0A000000u + rng() % (1 << 24));
+        r.action = rng() % 8 ? "forward" : "drop";
+        r.srcPort = 0;
+        r.dstPort = rng() % 2 ? 1 + rng() % 1024 : 0;
+        r.protocol = r.dstPort ? 6 : 0;
+        r.priority = 1 + rng() % 1000;
+        r.sliceId = rng() % 4;
+        r.idleTimeout = rng() % 2 ? 30 : 0;
+        r.hardTimeout = 0;
+        r.packets = rng();
+        r.bytes = r.packets * 1000;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    CheckpointWriter writer(numRules, 0, -12, numRules + 1, 4);
+    writer.reserveFlows(numRules);
+    for (const auto &entry : rules) {
+        const Rule &r = entry.second;
+        CheckpointFlowRecord record = {};
+        record.id = r.flowId;
+        record.srcPort = r.srcPort;
+        record.dstPort = r.dstPort;
+        record.protocol = r.protocol;
+        record.priority = r.priority;
+        record.sliceId = r.sliceId;
+        record.idleTimeout = r.idleTimeout;
+        record.hardTimeout = r.hardTimeout;
+        record.packetsMatched = r.packets;
+        record.bytesMatched = r.bytes;
+        writer.addFlow(record, r.srcIP, r.dstIP, r.action);
+    }
+    writer.write(fileName);
+    double writeMs = since(t0);
+
+    auto t1 = std::chrono::steady_clock::now();
+    CheckpointReader reader;
+    if (!reader.open(fileName)) {
+        fprintf(stderr, "MISMATCH: checkpoint %s not found\n", fileName.c_str());
+        exit(1);
+    }
+    double mapMs = since(t1);
+
+    auto t2 = std::chrono::steady_clock::now();
+    std::map<int, Rule> restored;
+    FlowClassifier classifier;
+    const CheckpointHeader &header = reader.getHeader();
+    for (uint32_t i = 0; i < header.numFlows; i++) {
+        const CheckpointFlowRecord &record = reader.getFlow(i);
+        Rule r;
+        r.flowId = record.id;
+        r.srcIP = reader.getString(record.srcIP);
+        r.dstIP = reader.getString(record.dstIP);
+        r.action = reader.getString(record.action);
+        r.srcPort = record.srcPort;
+        r.dstPort = record.dstPort;
+        r.protocol = record.protocol;
+        r.priority = record.priority;
+        r.sliceId = record.sliceId;
+        r.idleTimeout = record.idleTimeout;
+        r.hardTimeout = record.hardTimeout;
+        r.packets = record.packetsMatched;
+        r.bytes = record.bytesMatched;
+        FlowMatch match;
+        if (FlowClassifier::makeMatch(r.srcIP, r.dstIP, r.srcPort, r.dstPort, r.protocol, match))
+            classifier.insert(r.flowId, r.priority, match);
+        restored.emplace_hint(restored.end(), r.flowId, std::move(r));
+    }
+    double rebuildMs = since(t2);
+
+    if (restored.size() != rules.size() || header.nextFlowId != numRules + 1) {
+        fprintf(stderr, "MISMATCH: %zu rules restored, %d written\n", restored.size(), numRules);
+        exit(1);
+    }
+    for (const auto &entry : rules) {
+        const Rule &a = entry.second;
+        const Rule &b = restored.at(entry.first);
+        if (a.srcIP != b.srcIP || a.dstIP != b.dstIP || a.action != b.action || a.dstPort != b.dstPort || a.protocol != b.protocol
+            || a.priority != b.priority || a.sliceId != b.sliceId || a.idleTimeout != b.idleTimeout || a.packets != b.packets || a.bytes != b.bytes) {
+            fprintf(stderr, "MISMATCH in restored flow %d\n", a.flowId);
+            exit(1);
+        }
+    }
+
+    printf("%8d rules  %7.1f MB  write %8.1f ms  map+validate %7.2f ms  rebuild %8.1f ms (%4.0f ns/rule)\n",
+           numRules, (sizeof(CheckpointHeader) + numRules * sizeof(CheckpointFlowRecord) + header.stringsSize) / 1e6,
+           writeMs, mapMs, rebuildMs, 1e6 * rebuildMs / numRules);
+}
+
+int main(int argc, char **argv)
+{
+    std::string fileName = argc > 1 ? argv[1] : "out/checkpoint_bench.bin";
+    std::mt19937 rng(42);
+    for (int numRules : {1000, 100000, 1000000})
+        run(numRules, fileName, rng);
+    remove(fileName.c_str());
+    return 0;
+}
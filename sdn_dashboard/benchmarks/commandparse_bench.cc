@@ -0,0 +1,297 @@
+//
+// Microbenchmark for parsing dashboard command batches: the single-pass
+// JsonReader used by SDNControllerApp versus the previous find()-based field
+// extraction (kept here verbatim for comparison). Both parsers must produce
+// the same commands.
+//
+
+#include <common/jsonreader.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using omnetpp::common::JsonReader;
+
+// Heap allocation counter, to compare how allocation-heavy the two parsers are
+static size_t numAllocations = 0;
+
+void *operator new(size_t size)
+{
+    numAllocations++;
+    if (void *p = malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+struct ParsedCommand {
+    std::string type;
+    std::string name;
+    int vlanId = 0;
+    double bandwidth = 0;
+    bool isolated = false;
+    std::vector<std::string> hosts;
+    std::string srcIP, dstIP, action;
+    int priority = 0;
+    int sliceId = 0;
+    int id = -1;
+
+    bool operator==(const ParsedCommand& o) const {
+        return type == o.type && name == o.name && vlanId == o.vlanId && bandwidth == o.bandwidth
+            && isolated == o.isolated && hosts == o.hosts && srcIP == o.srcIP && dstIP == o.dstIP
+            && action == o.action && priority == o.priority && sliceId == o.sliceId && id == o.id;
+    }
+};
+
+// Batch splitting plus per-command string search, as done before JsonReader
+static std::vector<std::string> legacySplit(const std::string &content)
+{
+    size_t arrayStart = content.find('[', content.find("\"commands\""));
+    std::vector<std::string> commands;
+    int depth = 0;
+    bool inString = false;
+    size_t objectStart = 0;
+    for (size_t i = arrayStart + 1; i < content.length(); i++) {
+        char c = content[i];
+        if (inString) {
+            if (c == '\\')
+                i++;
+            else if (c == '"')
+                inString = false;
+        }
+        else if (c == '"')
+            inString = true;
+        else if (c == '{' || c == '[') {
+            if (depth++ == 0)
+                objectStart = i;
+        }
+        else if (c == '}' || c == ']') {
+            if (depth == 0)
+                break;
+            if (--depth == 0)
+                commands.push_back(content.substr(objectStart, i - objectStart + 1));
+        }
+    }
+    return commands;
+}
+
+static ParsedCommand legacyParse(const std::string &cmdJson)
+{
+    ParsedCommand cmd;
+    if (cmdJson.find("CREATE_SLICE") != std::string::npos) {
+        cmd.type = "CREATE_SLICE";
+        size_t namePos = cmdJson.find("\"name\":");
+        if (namePos != std::string::npos) {
+            size_t start = cmdJson.find("\"", namePos + 7) + 1;
+            size_t end = cmdJson.find("\"", start);
+            cmd.name = cmdJson.substr(start, end - start);
+        }
+        size_t vlanPos = cmdJson.find("\"vlanId\":");
+        if (vlanPos != std::string::npos) {
+            size_t start = vlanPos + 9;
+            size_t end = cmdJson.find_first_of(",}", start);
+            cmd.vlanId = std::stoi(cmdJson.substr(start, end - start));
+        }
+        size_t bwPos = cmdJson.find("\"bandwidth\":");
+        if (bwPos != std::string::npos) {
+            size_t start = bwPos + 12;
+            size_t end = cmdJson.find_first_of(",}", start);
+            cmd.bandwidth = std::stod(cmdJson.substr(start, end - start));
+        }
+        cmd.isolated = (cmdJson.find("\"isolated\":true") != std::string::npos) ||
+                       (cmdJson.find("\"isolated\": true") != std::string::npos);
+        size_t hostsPos = cmdJson.find("\"hosts\":[");
+        if (hostsPos != std::string::npos) {
+            size_t start = hostsPos + 9;
+            size_t end = cmdJson.find("]", start);
+            std::string hostsStr = cmdJson.substr(start, end - start);
+            size_t pos = 0;
+            while ((pos = hostsStr.find("\"", pos)) != std::string::npos) {
+                size_t ipStart = pos + 1;
+                size_t ipEnd = hostsStr.find("\"", ipStart);
+                if (ipEnd == std::string::npos)
+                    break;
+                std::string ip = hostsStr.substr(ipStart, ipEnd - ipStart);
+                if (!ip.empty() && ip.find(".") != std::string::npos)
+                    cmd.hosts.push_back(ip);
+                pos = ipEnd + 1;
+            }
+        }
+    }
+    else if (cmdJson.find("DELETE_FLOW") != std::string::npos) {
+        cmd.type = "DELETE_FLOW";
+        size_t idPos = cmdJson.find("\"id\":");
+        if (idPos != std::string::npos) {
+            size_t start = idPos + 5;
+            size_t end = cmdJson.find_first_of(",}", start);
+            cmd.id = std::stoi(cmdJson.substr(start, end - start));
+        }
+    }
+    else if (cmdJson.find("ADD_FLOW") != std::string::npos) {
+        cmd.type = "ADD_FLOW";
+        size_t srcPos = cmdJson.find("\"srcIP\":");
+        if (srcPos != std::string::npos) {
+            size_t start = cmdJson.find("\"", srcPos + 8) + 1;
+            size_t end = cmdJson.find("\"", start);
+            cmd.srcIP = cmdJson.substr(start, end - start);
+        }
+        size_t dstPos = cmdJson.find("\"dstIP\":");
+        if (dstPos != std::string::npos) {
+            size_t start = cmdJson.find("\"", dstPos + 8) + 1;
+            size_t end = cmdJson.find("\"", start);
+            cmd.dstIP = cmdJson.substr(start, end - start);
+        }
+        size_t actionPos = cmdJson.find("\"action\":");
+        if (actionPos != std::string::npos) {
+            size_t start = cmdJson.find("\"", actionPos + 9) + 1;
+            size_t end = cmdJson.find("\"", start);
+            cmd.action = cmdJson.substr(start, end - start);
+        }
+        size_t prioPos = cmdJson.find("\"priority\":");
+        if (prioPos != std::string::npos) {
+            size_t start = prioPos + 11;
+            size_t end = cmdJson.find_first_of(",}", start);
+            cmd.priority = std::stoi(cmdJson.substr(start, end - start));
+        }
+        else
+            cmd.priority = 100;
+        size_t slicePos = cmdJson.find("\"sliceId\":");
+        if (slicePos != std::string::npos) {
+            size_t start = slicePos + 10;
+            size_t end = cmdJson.find_first_of(",}", start);
+            cmd.sliceId = std::stoi(cmdJson.substr(start, end - start));
+        }
+    }
+    return cmd;
+}
+
+static std::vector<ParsedCommand> parseLegacy(const std::string &batch)
+{
+    std::vector<ParsedCommand> result;
+    for (const std::string &cmdJson : legacySplit(batch))
+        result.push_back(legacyParse(cmdJson));
+    return result;
+}
+
+// Same field extraction as SDNControllerApp::parseCommand()
+static std::vector<ParsedCommand> parseWithReader(const std::string &batch)
+{
+    JsonReader reader(batch);
+    JsonReader::Value list = reader.getRoot().get("commands");
+    std::vector<ParsedCommand> result;
+    result.reserve(list.size());
+    for (JsonReader::Value json = list.getFirstChild(); json; json = json.getNextSibling()) {
+        ParsedCommand cmd;
+        JsonReader::Value type = json.get("type");
+        JsonReader::Value data = json.get("data");
+        if (type.equals("CREATE_SLICE")) {
+            cmd.type = "CREATE_SLICE";
+            cmd.name = data.getString("name", "");
+            cmd.vlanId = data.getInt("vlanId", 0);
+            cmd.bandwidth = data.getDouble("bandwidth", 0);
+            cmd.isolated = data.getBool("isolated", false);
+            for (JsonReader::Value host = data.get("hosts").getFirstChild(); host; host = host.getNextSibling())
+                cmd.hosts.push_back(host.asString());
+        }
+        else if (type.equals("DELETE_FLOW")) {
+            cmd.type = "DELETE_FLOW";
+            cmd.id = data.getInt("id", -1);
+        }
+        else if (type.equals("ADD_FLOW")) {
+            cmd.type = "ADD_FLOW";
+            cmd.srcIP = data.getString("srcIP", "");
+            cmd.dstIP = data.getString("dstIP", "");
+            cmd.action = data.getString("action", "");
+            cmd.priority = data.getInt("priority", 100);
+            cmd.sliceId = data.getInt("sliceId", 0);
+        }
+        result.push_back(std::move(cmd));
+    }
+    return result;
+}
+
+// Compact batch as written by the backend's POST /api/batch
+static std::string makeBatch(int numCommands, std::mt19937 &rng)
+{
+    auto ip = [&](int net) { return "10.0." + std::to_string(net) + "." + std::to_string(1 + rng() % 254); };
+    std::string batch = "{\"type\":\"BATCH\",\"commands\":[";
+    for (int i = 0; i < numCommands; i++) {
+        if (i > 0)
+            batch += ",";
+        int kind = rng() % 10;
+        int net = 10 + rng() % 200;
+        if (kind == 0) {
+            batch += "{\"type\":\"CREATE_SLICE\",\"data\":{\"id\":" + std::to_string(i) + ",\"name\":\"Tenant_" + std::to_string(i)
+                   + "\",\"vlanId\":" + std::to_string(net) + ",\"bandwidth\":" + std::to_string(50 + rng() % 500)
+                   + ",\"hosts\":[\"" + ip(net) + "\",\"" + ip(net) + "\",\"" + ip(net) + "\",\"" + ip(net)
+                   + "\"],\"isolated\":true,\"acl\":[]}";
+        }
+        else if (kind == 1) {
+            batch += "{\"type\":\"DELETE_FLOW\",\"data\":{\"id\":" + std::to_string(1 + rng() % 100000) + "}";
+        }
+        else {
+            batch += "{\"type\":\"ADD_FLOW\",\"data\":{\"id\":" + std::to_string(i) + ",\"srcIP\":\"" + ip(net)
+                   + "\",\"dstIP\":\"" + ip(net) + "\",\"action\":\"" + (rng() % 2 ? "forward" : "drop")
+                   + "\",\"priority\":" + std::to_string(1 + rng() % 1000) + ",\"sliceId\":" + std::to_string(1 + rng() % 50)
+                   + ",\"packets\":0,\"bytes\":0}";
+        }
+        batch += ",\"timestamp\":" + std::to_string(1700000000000LL + i) + "}";
+    }
+    batch += "],\"timestamp\":1700000000000}";
+    return batch;
+}
+
+template <typename F>
+static double timeIt(F f, int repeat)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; i++)
+        f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeat;
+}
+
+static void run(int numCommands, std::mt19937 &rng)
+{
+    std::string batch = makeBatch(numCommands, rng);
+
+    std::vector<ParsedCommand> expected = parseLegacy(batch);
+    std::vector<ParsedCommand> actual = parseWithReader(batch);
+    if (expected.size() != (size_t)numCommands || !(expected == actual)) {
+        fprintf(stderr, "MISMATCH between parsers at %d commands\n", numCommands);
+        exit(1);
+    }
+
+    size_t before = numAllocations;
+    parseLegacy(batch);
+    double legacyAllocs = (double)(numAllocations - before) / numCommands;
+    before = numAllocations;
+    parseWithReader(batch);
+    double readerAllocs = (double)(numAllocations - before) / numCommands;
+
+    int repeat = std::max(1, 200000 / numCommands);
+    size_t sink = 0;
+    double legacyTime = timeIt([&]() { sink += parseLegacy(batch).size(); }, repeat);
+    double readerTime = timeIt([&]() { sink += parseWithReader(batch).size(); }, repeat);
+    double mb = batch.size() / 1e6;
+
+    printf("%7d commands %6.2f MB  legacy %6.1f MB/s %8.0f cmd/s %5.1f allocs/cmd  JsonReader %6.1f MB/s %8.0f cmd/s %5.1f allocs/cmd  speedup %.1fx%s\n",
+           numCommands, mb, mb / legacyTime, numCommands / legacyTime, legacyAllocs,
+           mb / readerTime, numCommands / readerTime, readerAllocs, legacyTime / readerTime, sink == 0 ? " " : "");
+}
+
+int main(int argc, char **argv)
+{
+    std::mt19937 rng(42);
+    if (argc > 1)
+        run(atoi(argv[1]), rng);
+    else
+        for (int numCommands : {100, 10000, 100000})
+            run(numCommands, rng);
+    return 0;
+}
@@ -0,0 +1,133 @@
+//
+// Microbenchmark for the controller's command queue (CommandQueue): the
+// latency of small tenants' commands while one tenant pushes a large bulk
+// of flow batches, with a single FIFO queue, with fair queuing between the
+// tenants, and with fair queuing plus a rate limit per tenant, executed by
+// a controller serving a fixed number of commands per second. Also reports
+// the cost of the queue operations. Every tenant's items are checked to
+// come out exactly once and in order.
+//
+
+#include "CommandQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sdn_dashboard;
+
+static const double SERVICE_RATE = 10000;   // commands/s of the controller
+static const int BULK_BATCHES = 400;        // of the bulk tenant, all at once
+static const int BULK_BATCH_SIZE = 500;
+static const int NUM_SMALL_TENANTS = 16;
+static const double SMALL_RATE = 20;        // single commands/s of each small tenant
+static const double DURATION = 30;          // s of small tenant arrivals
+
+struct Arrival {
+    double time;
+    std::string tenant;
+    int cost;
+};
+
+struct Result {
+    std::vector<double> smallLatencies;
+    double bulkDone = 0;
+    double queueSeconds = 0;   // wall-clock time in push() and pop()
+    long numOps = 0;
+};
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(values.size() * p))];
+}
+
+// Executes the arrivals in the order the queue gives out; fair = false puts
+// every command into the queue of one tenant, i.e. a FIFO
+static Result run(const std::vector<Arrival> &arrivals, bool fair, double rate)
+{
+    CommandQueue queue;
+    queue.configure(rate, 1000, 500, 0);
+    Result result;
+    std::map<std::string, long> nextSeq, expectedSeq;
+    size_t next = 0;
+    double now = 0;
+    auto clock = [&]() { return std::chrono::steady_clock::now(); };
+    while (next < arrivals.size() || !queue.isEmpty()) {
+        for (; next < arrivals.size() && arrivals[next].time <= now; next++) {
+            CommandQueue::Item item;
+            item.tenant = fair ? arrivals[next].tenant : "";
+            item.payload = arrivals[next].tenant + "#" + std::to_string(nextSeq[arrivals[next].tenant]++);
+            item.cost = arrivals[next].cost;
+            item.enqueueTime = arrivals[next].time;
+            auto t0 = clock();
+            queue.push(std::move(item));
+            result.queueSeconds += std::chrono::duration<double>(clock() - t0).count();
+            result.numOps++;
+        }
+        CommandQueue::Item item;
+        auto t0 = clock();
+        bool popped = queue.pop(now, item);
+        result.queueSeconds += std::chrono::duration<double>(clock() - t0).count();
+        result.numOps++;
+        if (!popped) {
+            double arrival = next < arrivals.size() ? arrivals[next].time : 1e300;
+            now = std::max(now, std::min(arrival, queue.getNextEligibleTime(now)));
+            continue;
+        }
+        std::string tenant = item.payload.substr(0, item.payload.find('#'));
+        if (item.payload != tenant + "#" + std::to_string(expectedSeq[tenant]++)) {
+            fprintf(stderr, "MISMATCH: got %s out of order\n", item.payload.c_str());
+            exit(1);
+        }
+        now += item.cost / SERVICE_RATE;
+        if (tenant == "bulk")
+            result.bulkDone = now;
+        else
+            result.smallLatencies.push_back(now - item.enqueueTime);
+    }
+    for (const auto &entry : nextSeq) {
+        if (expectedSeq[entry.first] != entry.second) {
+            fprintf(stderr, "MISMATCH: %s lost items\n", entry.first.c_str());
+            exit(1);
+        }
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    std::mt19937 rng(42);
+    std::vector<Arrival> arrivals;
+    for (int i = 0; i < BULK_BATCHES; i++)
+        arrivals.push_back({0, "bulk", BULK_BATCH_SIZE});
+    std::exponential_distribution<double> interarrival(SMALL_RATE);
+    for (int t = 0; t < NUM_SMALL_TENANTS; t++)
+        for (double time = interarrival(rng); time < DURATION; time += interarrival(rng))
+            arrivals.push_back({time, "tenant" + std::to_string(t), 1});
+    std::stable_sort(arrivals.begin(), arrivals.end(), [](const Arrival &a, const Arrival &b) { return a.time < b.time; });
+
+    printf("%d commands/s served; bulk tenant: %d batches of %d at t=0; %d tenants of %.0f single commands/s\n\n",
+           (int)SERVICE_RATE, BULK_BATCHES, BULK_BATCH_SIZE, NUM_SMALL_TENANTS, SMALL_RATE);
+    printf("%-28s %12s %12s %12s %12s\n", "queue", "small mean", "small p99", "bulk done", "ns/op");
+    struct Config {
+        const char *name;
+        bool fair;
+        double rate;
+    };
+    for (Config config : {Config{"FIFO", false, 0}, Config{"fair", true, 0}, Config{"fair, 5000 commands/s", true, 5000}}) {
+        Result result = run(arrivals, config.fair, config.rate);
+        double sum = 0;
+        for (double latency : result.smallLatencies)
+            sum += latency;
+        printf("%-28s %10.1fms %10.1fms %11.2fs %12.0f\n", config.name, 1e3 * sum / result.smallLatencies.size(),
+               1e3 * percentile(result.smallLatencies, 0.99), result.bulkDone, 1e9 * result.queueSeconds / result.numOps);
+    }
+    return 0;
+}
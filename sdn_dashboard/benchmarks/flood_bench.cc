@@ -0,0 +1,164 @@
+//
+// Microbenchmark for the per-slice flood domains of SliceRelayUnit on k-ary
+// fat-trees: frames sent per broadcast and time to compute a domain's tree
+// (RoutingService::computeFloodTree()), for slices of growing size, against
+// flooding to all hosts. Every tree is checked by flooding broadcasts over
+// it from its members: each other member must receive exactly one copy, no
+// other host any, also with a fabric link failed.
+//
+
+#include "RoutingService.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace sdn_dashboard;
+
+typedef std::pair<int, int> Port;  // node, port
+
+struct FatTree {
+    RoutingService routing;
+    std::vector<int> hosts;
+    std::vector<int> fabricLinks;   // switch-to-switch links
+    std::map<Port, Port> peer;      // both ends of every link
+    std::vector<std::pair<Port, Port>> links;
+};
+
+// Same wiring as simulations/networks/FatTreeTopology.ned
+static void buildFatTree(int k, FatTree &tree)
+{
+    int half = k / 2;
+    std::vector<int> core(half * half), agg(k * half), edge(k * half);
+    std::vector<int> nextPort;
+    auto connect = [&](int a, int b) {
+        nextPort.resize(std::max<size_t>(nextPort.size(), std::max(a, b) + 1), 0);
+        Port pa(a, nextPort[a]++), pb(b, nextPort[b]++);
+        tree.peer[pa] = pb;
+        tree.peer[pb] = pa;
+        tree.links.push_back(std::make_pair(pa, pb));
+        return tree.routing.addLink(a, pa.second, b, pb.second);
+    };
+    for (int &n : core) n = tree.routing.addSwitch();
+    for (int &n : agg) n = tree.routing.addSwitch();
+    for (int &n : edge) n = tree.routing.addSwitch();
+    for (int p = 0; p < k; p++)
+        for (int i = 0; i < half; i++)
+            for (int j = 0; j < half; j++) {
+                tree.fabricLinks.push_back(connect(agg[p * half + i], core[i * half + j]));
+                tree.fabricLinks.push_back(connect(edge[p * half + i], agg[p * half + j]));
+            }
+    for (int e = 0; e < k * half; e++)
+        for (int h = 0; h < half; h++) {
+            int host = tree.routing.addHost();
+            tree.hosts.push_back(host);
+            connect(host, edge[e]);
+        }
+    tree.routing.computeAll();
+}
+
+// Floods a broadcast of the host over the domain's ports as the switches
+// would; returns the frames sent, and checks who received it
+static long flood(const FatTree &tree, const std::map<int, std::vector<int>> &floodPorts, int sender, const std::vector<int> &members)
+{
+    static const std::vector<int> none;
+    std::map<int, int> received;
+    std::vector<std::pair<Port, Port>> inFlight;  // sent from, arriving at
+    Port uplink(sender, 0);
+    inFlight.push_back(std::make_pair(uplink, tree.peer.at(uplink)));
+    long frames = 1;
+    while (!inFlight.empty()) {
+        Port at = inFlight.back().second;
+        inFlight.pop_back();
+        if (!tree.routing.isSwitch(at.first)) {
+            received[at.first]++;
+            continue;
+        }
+        auto it = floodPorts.find(at.first);
+        const std::vector<int> &ports = it != floodPorts.end() ? it->second : none;
+        if (std::find(ports.begin(), ports.end(), at.second) == ports.end())
+            continue;  // outside the domain: dropped on ingress
+        for (int port : ports) {
+            if (port == at.second)
+                continue;
+            Port from(at.first, port);
+            inFlight.push_back(std::make_pair(from, tree.peer.at(from)));
+            if (++frames > 10 * (long)tree.links.size()) {
+                fprintf(stderr, "MISMATCH: broadcast of host %d loops\n", sender);
+                exit(1);
+            }
+        }
+    }
+    for (int host : members) {
+        if (host != sender && received[host] != 1) {
+            fprintf(stderr, "MISMATCH: host %d received %d copies of the broadcast of host %d\n", host, received[host], sender);
+            exit(1);
+        }
+        received.erase(host);
+    }
+    if (!received.empty()) {
+        fprintf(stderr, "MISMATCH: broadcast of host %d left its domain\n", sender);
+        exit(1);
+    }
+    return frames;
+}
+
+static double computeDomain(const FatTree &tree, const std::vector<int> &members, std::map<int, std::vector<int>> &floodPorts)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::pair<int, int>> ports;
+    tree.routing.computeFloodTree(members, ports);
+    double us = 1e6 * std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    floodPorts.clear();
+    for (const auto &port : ports)
+        floodPorts[port.first].push_back(port.second);
+    return us;
+}
+
+static void run(int k, std::mt19937 &rng)
+{
+    FatTree tree;
+    buildFatTree(k, tree);
+    std::vector<int> hosts = tree.hosts;
+    std::shuffle(hosts.begin(), hosts.end(), rng);
+
+    std::vector<size_t> sliceSizes;
+    for (size_t sliceSize : {4, 16, 64, 256})
+        if (sliceSize < hosts.size())
+            sliceSizes.push_back(sliceSize);
+    sliceSizes.push_back(hosts.size());  // a single broadcast domain, as without slices
+    for (size_t sliceSize : sliceSizes) {
+        // slices of randomly placed hosts; the last may be smaller
+        double computeUs = 0;
+        long frames = 0, broadcasts = 0;
+        int numSlices = 0;
+        std::map<int, std::vector<int>> floodPorts;
+        for (size_t first = 0; first < hosts.size() && numSlices < 32; first += sliceSize, numSlices++) {
+            std::vector<int> members(hosts.begin() + first, hosts.begin() + std::min(hosts.size(), first + sliceSize));
+            computeUs += computeDomain(tree, members, floodPorts);
+            for (size_t i = 0; i < members.size() && i < 8; i++, broadcasts++)
+                frames += flood(tree, floodPorts, members[i], members);
+
+            // the tree must still reach everyone around a failed link
+            int link = tree.fabricLinks[rng() % tree.fabricLinks.size()];
+            tree.routing.setLinkUp(link, false);
+            computeDomain(tree, members, floodPorts);
+            flood(tree, floodPorts, members[0], members);
+            tree.routing.setLinkUp(link, true);
+        }
+        printf("k=%2d  %5zu hosts  slice %5zu hosts  %6.1f frames/broadcast  %8.1f us/domain  (%d slices)\n",
+               k, hosts.size(), sliceSize, (double)frames / broadcasts, computeUs / numSlices, numSlices);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::mt19937 rng(42);
+    for (int k : {8, 16, 24})
+        run(k, rng);
+    return 0;
+}
@@ -0,0 +1,145 @@
+//
+// Microbenchmark for FlowClassifier: lookups/sec at various flow table sizes.
+// Every run also cross-checks a sample of lookups against a linear scan.
+// A second trace, where packets belong to a limited set of active flows,
+// compares plain lookups with lookups through the MicroflowCache.
+//
+
+#include "FlowClassifier.h"
+#include "MicroflowCache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace sdn_dashboard;
+
+struct Rule {
+    int flowId;
+    int priority;
+    FlowMatch match;
+};
+
+static uint32_t mask(int len) { return len == 0 ? 0 : 0xFFFFFFFFu << (32 - len); }
+
+static bool matches(const FlowMatch &m, const PacketKey &k)
+{
+    return (k.srcIp & mask(m.srcPrefixLen)) == m.srcIp && (k.dstIp & mask(m.dstPrefixLen)) == m.dstIp
+        && (m.srcPort == 0 || m.srcPort == k.srcPort) && (m.dstPort == 0 || m.dstPort == k.dstPort)
+        && (m.protocol == 0 || m.protocol == k.protocol);
+}
+
+static int linearLookup(const std::vector<Rule> &rules, const PacketKey &key)
+{
+    int best = -1, bestPrio = 0;
+    for (const Rule &r : rules)
+        if (matches(r.match, key) && (best == -1 || r.priority > bestPrio || (r.priority == bestPrio && r.flowId < best))) {
+            best = r.flowId;
+            bestPrio = r.priority;
+        }
+    return best;
+}
+
+static void run(int numRules, int numLookups, std::mt19937 &rng)
+{
+    // A handful of match shapes, as produced by slice isolation, ACL and per-service rules
+    static const int shapes[][5] = {
+        // srcLen dstLen srcPort dstPort proto
+        {32, 0, 0, 0, 0}, {24, 24, 0, 0, 0}, {32, 32, 0, 0, 0}, {0, 16, 0, 1, 1},
+        {32, 32, 1, 1, 1}, {16, 0, 0, 0, 1}, {24, 32, 0, 1, 1}, {8, 8, 0, 0, 0},
+    };
+    std::vector<Rule> rules(numRules);
+    FlowClassifier classifier;
+    for (int i = 0; i < numRules; i++) {
+        const int *s = shapes[rng() % 8];
+        Rule &r = rules[i];
+        r.flowId = i + 1;
+        r.priority = 1 + rng() % 1000;
+        r.match.srcPrefixLen = s[0];
+        r.match.dstPrefixLen = s[1];
+        r.match.srcIp = rng() & mask(s[0]);
+        r.match.dstIp = rng() & mask(s[1]);
+        r.match.srcPort = s[2] ? 1024 + rng() % 60000 : 0;
+        r.match.dstPort = s[3] ? 1 + rng() % 1024 : 0;
+        r.match.protocol = s[4] ? (rng() % 2 ? 6 : 17) : 0;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (const Rule &r : rules)
+        classifier.insert(r.flowId, r.priority, r.match);
+    auto t1 = std::chrono::steady_clock::now();
+
+    // Half of the packets are derived from installed rules, the rest are random
+    std::vector<PacketKey> keys(numLookups);
+    for (PacketKey &k : keys) {
+        const Rule &r = rules[rng() % numRules];
+        bool hit = rng() % 2;
+        k.srcIp = hit ? r.match.srcIp | (rng() & ~mask(r.match.srcPrefixLen)) : rng();
+        k.dstIp = hit ? r.match.dstIp | (rng() & ~mask(r.match.dstPrefixLen)) : rng();
+        k.srcPort = hit && r.match.srcPort ? r.match.srcPort : 1024 + rng() % 60000;
+        k.dstPort = hit && r.match.dstPort ? r.match.dstPort : 1 + rng() % 1024;
+        k.protocol = hit && r.match.protocol ? r.match.protocol : (rng() % 2 ? 6 : 17);
+    }
+
+    auto t2 = std::chrono::steady_clock::now();
+    long matched = 0;
+    for (const PacketKey &k : keys)
+        matched += classifier.lookup(k) != -1;
+    auto t3 = std::chrono::steady_clock::now();
+
+    int numChecks = numRules <= 1000 ? 20000 : 200;
+    for (int i = 0; i < numChecks; i++) {
+        if (classifier.lookup(keys[i]) != linearLookup(rules, keys[i])) {
+            fprintf(stderr, "MISMATCH at %d rules, lookup #%d\n", numRules, i);
+            exit(1);
+        }
+    }
+
+    // Packets of 1000 active flows, each packet drawn at random from them
+    std::vector<PacketKey> trace(numLookups);
+    for (PacketKey &k : trace)
+        k = keys[rng() % 1000];
+
+    MicroflowCache cache(4096);
+    auto t4 = std::chrono::steady_clock::now();
+    long plainSum = 0;
+    for (const PacketKey &k : trace)
+        plainSum += classifier.lookup(k);
+    auto t5 = std::chrono::steady_clock::now();
+    long cachedSum = 0, hits = 0;
+    for (const PacketKey &k : trace) {
+        int flowId;
+        if (cache.lookup(k, flowId))
+            hits++;
+        else {
+            flowId = classifier.lookup(k);
+            cache.insert(k, flowId);
+        }
+        cachedSum += flowId;
+    }
+    auto t6 = std::chrono::steady_clock::now();
+    if (plainSum != cachedSum) {
+        fprintf(stderr, "MISMATCH between cached and plain lookups at %d rules\n", numRules);
+        exit(1);
+    }
+
+    double insertSec = std::chrono::duration<double>(t1 - t0).count();
+    double lookupSec = std::chrono::duration<double>(t3 - t2).count();
+    double plainSec = std::chrono::duration<double>(t5 - t4).count();
+    double cachedSec = std::chrono::duration<double>(t6 - t5).count();
+    printf("%9d rules  %4zu tuples  insert %8.0f ns/rule  lookup %10.0f lookups/s  (%.0f%% matched, %d verified)\n",
+           numRules, classifier.getNumTuples(), 1e9 * insertSec / numRules, numLookups / lookupSec,
+           100.0 * matched / numLookups, numChecks);
+    printf("%9s 1000 active flows: uncached %10.0f lookups/s  cached %10.0f lookups/s  (%.1f%% cache hits)\n",
+           "", numLookups / plainSec, numLookups / cachedSec, 100.0 * hits / numLookups);
+}
+
+int main(int argc, char **argv)
+{
+    int numLookups = argc > 1 ? atoi(argv[1]) : 2000000;
+    std::mt19937 rng(42);
+    for (int numRules : {1000, 100000, 1000000})
+        run(numRules, numLookups, rng);
+    return 0;
+}
@@ -0,0 +1,210 @@
+//
+// Microbenchmark for the flow rule conflict and shadowing analysis of the
+// controller (FlowConflictIndex): time per inserted and removed rule, and
+// rules compared per insert, on tables of up to 200k rules, against
+// comparing each new rule with every rule in the table. The anomalies found
+// are checked against the pairwise comparison on a smaller table.
+//
+
+#include "FlowConflictIndex.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+using namespace sdn_dashboard;
+
+struct TestRule {
+    int flowId;
+    int priority;
+    uint64_t action;
+    FlowMatch match;
+};
+
+static FlowMatch makeMatch(uint32_t src, int srcLen, uint32_t dst, int dstLen, int dstPort, int protocol)
+{
+    FlowMatch match;
+    match.srcIp = srcLen == 0 ? 0 : src & (0xFFFFFFFFu << (32 - srcLen));
+    match.srcPrefixLen = srcLen;
+    match.dstIp = dstLen == 0 ? 0 : dst & (0xFFFFFFFFu << (32 - dstLen));
+    match.dstPrefixLen = dstLen;
+    match.dstPort = dstPort;
+    match.protocol = protocol;
+    return match;
+}
+
+// A table like the controller's: per host a slice rule and host-to-host
+// rules on a port (as ControllerLoadGenerator creates them), plus a fixed
+// number of wide operator rules (subnet and service rules), and some copies
+// of rules with another action or a lower priority
+static std::vector<TestRule> makeRules(int n, std::mt19937 &rng)
+{
+    int numHosts = std::max(16, n / 10);
+    // spread over 10.0.0.0/8 (40503 is odd, so the addresses are distinct)
+    auto host = [&]() { return 0x0A000000u | (((uint32_t)(rng() % numHosts) * 40503u) & 0xFFFFFFu); };
+    std::vector<TestRule> rules;
+    for (int i = 0; i < n; i++) {
+        TestRule rule;
+        rule.flowId = i + 1;
+        rule.action = 1;  // forward
+        int kind = rng() % 100;
+        if (i < 64) {
+            rule.priority = 250;
+            rule.action = 2;  // drop
+            rule.match = makeMatch(host(), 24, host(), 24, 0, 0);
+        }
+        else if (i < 128) {
+            rule.priority = 300;
+            rule.match = makeMatch(0, 0, host(), 32, 80, 6);
+        }
+        else if (kind < 85) {
+            rule.priority = 200;
+            rule.match = makeMatch(host(), 32, host(), 32, 1024 + rng() % 64000, 17);
+        }
+        else if (kind < 95) {
+            rule.priority = 100;
+            rule.match = makeMatch(host(), 32, 0, 0, 0, 0);
+        }
+        else {
+            rule = rules[rng() % rules.size()];
+            rule.flowId = i + 1;
+            if (rng() % 2) {
+                // drop the subnet at the same priority: conflicts
+                rule.action = 2;
+                rule.match.dstPrefixLen = std::min<int>(rule.match.dstPrefixLen, 24);
+                rule.match.dstIp &= rule.match.dstPrefixLen == 0 ? 0 : 0xFFFFFFFFu << (32 - rule.match.dstPrefixLen);
+            }
+            else
+                rule.priority -= 10;  // shadowed
+        }
+        rules.push_back(rule);
+    }
+    return rules;
+}
+
+static bool overlaps(const FlowMatch &a, const FlowMatch &b)
+{
+    auto mask = [](int len) { return len == 0 ? 0u : 0xFFFFFFFFu << (32 - len); };
+    return ((a.srcIp ^ b.srcIp) & mask(std::min(a.srcPrefixLen, b.srcPrefixLen))) == 0
+        && ((a.dstIp ^ b.dstIp) & mask(std::min(a.dstPrefixLen, b.dstPrefixLen))) == 0
+        && (a.srcPort == 0 || b.srcPort == 0 || a.srcPort == b.srcPort)
+        && (a.dstPort == 0 || b.dstPort == 0 || a.dstPort == b.dstPort)
+        && (a.protocol == 0 || b.protocol == 0 || a.protocol == b.protocol);
+}
+
+static bool covers(const FlowMatch &a, const FlowMatch &b)
+{
+    auto mask = [](int len) { return len == 0 ? 0u : 0xFFFFFFFFu << (32 - len); };
+    return a.srcPrefixLen <= b.srcPrefixLen && ((a.srcIp ^ b.srcIp) & mask(a.srcPrefixLen)) == 0
+        && a.dstPrefixLen <= b.dstPrefixLen && ((a.dstIp ^ b.dstIp) & mask(a.dstPrefixLen)) == 0
+        && (a.srcPort == 0 || a.srcPort == b.srcPort)
+        && (a.dstPort == 0 || a.dstPort == b.dstPort)
+        && (a.protocol == 0 || a.protocol == b.protocol);
+}
+
+typedef std::set<std::tuple<int, int, int>> AnomalySet;  // flowId, other flowId, kind
+
+// Each new rule against every earlier one; the rules are inserted by
+// increasing flow ID, so the earlier one wins ties
+static AnomalySet pairwise(const std::vector<TestRule> &rules, size_t &numOverlapping)
+{
+    AnomalySet anomalies;
+    numOverlapping = 0;
+    for (size_t i = 0; i < rules.size(); i++) {
+        const TestRule &r = rules[i];
+        for (size_t j = 0; j < i; j++) {
+            const TestRule &e = rules[j];
+            if (!overlaps(r.match, e.match))
+                continue;
+            numOverlapping++;
+            bool wins = r.priority > e.priority;
+            if (!wins && covers(e.match, r.match))
+                anomalies.insert(std::make_tuple(r.flowId, e.flowId, (int)FlowConflictIndex::SHADOWED_BY));
+            else if (wins && covers(r.match, e.match))
+                anomalies.insert(std::make_tuple(e.flowId, r.flowId, (int)FlowConflictIndex::SHADOWED_BY));
+            else if (r.priority == e.priority && r.action != e.action) {
+                anomalies.insert(std::make_tuple(r.flowId, e.flowId, (int)FlowConflictIndex::CONFLICTS_WITH));
+                anomalies.insert(std::make_tuple(e.flowId, r.flowId, (int)FlowConflictIndex::CONFLICTS_WITH));
+            }
+        }
+    }
+    return anomalies;
+}
+
+static void crossCheck(std::mt19937 &rng)
+{
+    std::vector<TestRule> rules = makeRules(5000, rng);
+    FlowConflictIndex index;
+    for (const TestRule &rule : rules)
+        index.insert(rule.flowId, rule.priority, rule.action, rule.match);
+    AnomalySet found;
+    for (const TestRule &rule : rules)
+        for (const FlowConflictIndex::Anomaly &anomaly : index.getAnomalies(rule.flowId))
+            if (anomaly.kind != FlowConflictIndex::SHADOWS)
+                found.insert(std::make_tuple(rule.flowId, anomaly.otherFlowId, (int)anomaly.kind));
+    size_t numOverlapping;
+    if (found != pairwise(rules, numOverlapping)) {
+        fprintf(stderr, "MISMATCH: the index found other anomalies than the pairwise comparison\n");
+        exit(1);
+    }
+
+    // removing a rule removes its anomalies
+    for (size_t i = 0; i < rules.size(); i += 2)
+        index.remove(rules[i].flowId);
+    for (size_t i = 0; i < rules.size(); i += 2)
+        for (const TestRule &rule : rules)
+            for (const FlowConflictIndex::Anomaly &anomaly : index.getAnomalies(rule.flowId))
+                if (anomaly.otherFlowId == rules[i].flowId || rule.flowId == rules[i].flowId) {
+                    fprintf(stderr, "MISMATCH: anomaly of removed flow %d left\n", rules[i].flowId);
+                    exit(1);
+                }
+    printf("cross-check on %zu rules: %zu anomalies, %zu overlapping pairs: OK\n\n", rules.size(), found.size(), numOverlapping);
+}
+
+static void run(int n, std::mt19937 &rng)
+{
+    std::vector<TestRule> rules = makeRules(n, rng);
+    FlowConflictIndex index;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const TestRule &rule : rules)
+        index.insert(rule.flowId, rule.priority, rule.action, rule.match);
+    double insertUs = 1e6 * std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / n;
+    size_t shadowed = index.getNumShadowedRules(), conflicts = index.getNumConflicts();
+    double compared = (double)index.getNumComparisons() / n;
+
+    char pairwiseText[32] = "-";
+    if (n <= 20000) {
+        size_t numOverlapping;
+        t0 = std::chrono::steady_clock::now();
+        pairwise(rules, numOverlapping);
+        snprintf(pairwiseText, sizeof(pairwiseText), "%.1f", 1e6 * std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / n);
+    }
+
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++)
+        order[i] = rules[i].flowId;
+    std::shuffle(order.begin(), order.end(), rng);
+    t0 = std::chrono::steady_clock::now();
+    for (int flowId : order)
+        index.remove(flowId);
+    double removeUs = 1e6 * std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / n;
+    if (index.size() != 0 || index.getNumShadowedRules() != 0 || index.getNumConflicts() != 0) {
+        fprintf(stderr, "MISMATCH: rules or anomalies left after removing all\n");
+        exit(1);
+    }
+    printf("%8d %12.2f %12s %12.2f %12.1f %10zu %10zu\n", n, insertUs, pairwiseText, removeUs, compared, shadowed, conflicts);
+}
+
+int main(int argc, char **argv)
+{
+    std::mt19937 rng(42);
+    crossCheck(rng);
+    printf("%8s %12s %12s %12s %12s %10s %10s\n", "rules", "us/insert", "pairwise us", "us/remove", "compared", "shadowed", "conflicts");
+    for (int n : {1000, 10000, 20000, 100000, 200000})
+        run(n, rng);
+    return 0;
+}
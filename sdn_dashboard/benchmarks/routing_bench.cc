@@ -0,0 +1,161 @@
+//
+// Microbenchmark for RoutingService on k-ary fat-trees: latency of the full
+// all-pairs computation versus the incremental updates after a link or
+// switch fails or recovers. Updates are cross-checked against a full
+// recomputation of the same failure state.
+//
+
+#include "RoutingService.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace sdn_dashboard;
+
+struct FatTree {
+    RoutingService routing;
+    std::vector<int> switches;
+    std::vector<int> hosts;
+    std::vector<int> fabricLinks;   // switch-to-switch links
+};
+
+// Same wiring as simulations/networks/FatTreeTopology.ned
+static void buildFatTree(int k, FatTree &tree)
+{
+    int half = k / 2;
+    std::vector<int> core(half * half), agg(k * half), edge(k * half);
+    std::vector<int> nextPort;
+    auto addSwitch = [&](int &node) {
+        node = tree.routing.addSwitch();
+        tree.switches.push_back(node);
+        nextPort.resize(node + 1, 0);
+    };
+    auto connect = [&](int a, int b) {
+        nextPort.resize(std::max<size_t>(nextPort.size(), std::max(a, b) + 1), 0);
+        return tree.routing.addLink(a, nextPort[a]++, b, nextPort[b]++);
+    };
+    for (int &n : core) addSwitch(n);
+    for (int &n : agg) addSwitch(n);
+    for (int &n : edge) addSwitch(n);
+    for (int p = 0; p < k; p++)
+        for (int i = 0; i < half; i++)
+            for (int j = 0; j < half; j++) {
+                tree.fabricLinks.push_back(connect(agg[p * half + i], core[i * half + j]));
+                tree.fabricLinks.push_back(connect(edge[p * half + i], agg[p * half + j]));
+            }
+    for (int e = 0; e < k * half; e++)
+        for (int h = 0; h < half; h++) {
+            int host = tree.routing.addHost();
+            tree.hosts.push_back(host);
+            connect(host, edge[e]);
+        }
+}
+
+static void verify(const FatTree &tree, int k, const char *what)
+{
+    RoutingService reference = tree.routing;
+    reference.computeAll();
+    for (int from : tree.switches) {
+        for (int to : tree.switches) {
+            if (tree.routing.getDistance(from, to) != reference.getDistance(from, to)) {
+                fprintf(stderr, "MISMATCH at k=%d after %s\n", k, what);
+                exit(1);
+            }
+        }
+    }
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point t0)
+{
+    return 1e6 * std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void run(int k, int numEvents, std::mt19937 &rng)
+{
+    FatTree tree;
+    buildFatTree(k, tree);
+
+    auto t0 = std::chrono::steady_clock::now();
+    tree.routing.computeAll();
+    double fullUs = elapsedUs(t0);
+
+    // Independent failures, each repaired before the next one, plus a
+    // stretch of accumulated failures so that later ones hit a degraded fabric
+    int numVerified = 0;
+    int verifyEvery = k <= 16 ? 1 : numEvents / 4;
+    double linkDownUs = 0, linkUpUs = 0, switchDownUs = 0, switchUpUs = 0;
+    size_t linkDownDestinations = 0, switchDownDestinations = 0;
+    for (int i = 0; i < numEvents; i++) {
+        int link = tree.fabricLinks[rng() % tree.fabricLinks.size()];
+        t0 = std::chrono::steady_clock::now();
+        tree.routing.setLinkUp(link, false);
+        linkDownUs += elapsedUs(t0);
+        linkDownDestinations += tree.routing.getLastUpdateStats().destinationsUpdated;
+        if (i % verifyEvery == 0) {
+            verify(tree, k, "link failure");
+            numVerified++;
+        }
+        t0 = std::chrono::steady_clock::now();
+        tree.routing.setLinkUp(link, true);
+        linkUpUs += elapsedUs(t0);
+
+        int sw = tree.switches[rng() % tree.switches.size()];
+        t0 = std::chrono::steady_clock::now();
+        tree.routing.setSwitchUp(sw, false);
+        switchDownUs += elapsedUs(t0);
+        switchDownDestinations += tree.routing.getLastUpdateStats().destinationsUpdated;
+        if (i % verifyEvery == 0) {
+            verify(tree, k, "switch failure");
+            numVerified++;
+        }
+        t0 = std::chrono::steady_clock::now();
+        tree.routing.setSwitchUp(sw, true);
+        switchUpUs += elapsedUs(t0);
+        if (i % verifyEvery == 0) {
+            verify(tree, k, "switch recovery");
+            numVerified++;
+        }
+    }
+
+    std::vector<int> failed;
+    double accumulatedUs = 0;
+    for (int i = 0; i < numEvents; i++) {
+        int link = tree.fabricLinks[rng() % tree.fabricLinks.size()];
+        t0 = std::chrono::steady_clock::now();
+        tree.routing.setLinkUp(link, false);
+        accumulatedUs += elapsedUs(t0);
+        failed.push_back(link);
+    }
+    verify(tree, k, "accumulated link failures");
+    for (int link : failed)
+        tree.routing.setLinkUp(link, true);
+    verify(tree, k, "accumulated link recoveries");
+    numVerified += 2;
+
+    // ECMP lookups, as done per PACKET_IN
+    t0 = std::chrono::steady_clock::now();
+    long portSum = 0;
+    int numLookups = 1000000;
+    for (int i = 0; i < numLookups; i++)
+        portSum += tree.routing.selectPort(tree.switches[rng() % tree.switches.size()], tree.hosts[rng() % tree.hosts.size()], rng());
+    double lookupUs = elapsedUs(t0);
+
+    printf("k=%2d  %5zu switches %6zu links  full %9.2f ms  link down %8.1f us (%5.0f dsts)  link up %8.1f us"
+           "  switch down %8.1f us (%5.0f dsts)  switch up %8.1f us  accumulated down %8.1f us  (%d verified)\n",
+           k, tree.switches.size(), tree.routing.getNumLinks(), fullUs / 1000,
+           linkDownUs / numEvents, (double)linkDownDestinations / numEvents, linkUpUs / numEvents,
+           switchDownUs / numEvents, (double)switchDownDestinations / numEvents, switchUpUs / numEvents,
+           accumulatedUs / numEvents, numVerified);
+    printf("%5s ECMP port selection %10.0f lookups/s  (checksum %ld)\n", "", numLookups / (lookupUs / 1e6), portSum);
+}
+
+int main(int argc, char **argv)
+{
+    int numEvents = argc > 1 ? atoi(argv[1]) : 40;
+    std::mt19937 rng(42);
+    for (int k : {8, 16, 34, 48})
+        run(k, numEvents, rng);
+    return 0;
+}
@@ -0,0 +1,55 @@
+#!/bin/bash
+
+# Builds and runs the standalone controller microbenchmarks.
+# Usage: ./run-benchmarks.sh [benchmark-name...]   (default: all)
+#
+# Benchmarks that use OMNeT++ utility classes link against liboppcommon
+# of the configured and built OMNeT++ tree in $OMNETPP_ROOT.
+
+cd "$(dirname "$0")"
+
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:-"-O2 -std=c++17 -DNDEBUG"}
+CONTROLLER_DIR=../src/controller
+OMNETPP_ROOT=${OMNETPP_ROOT:-$(cd ../.. && pwd)}
+BUILD_DIR=out
+
+mkdir -p $BUILD_DIR
+
+# benchmark name -> controller sources it needs
+declare -A SOURCES=(
+    [flowclassifier_bench]="FlowClassifier.cc"
+    [commandparse_bench]=""
+    [routing_bench]="RoutingService.cc"
+    [telemetry_bench]="TelemetryServer.cc"
+    [flowcounter_bench]="FlowClassifier.cc"
+    [checkpoint_bench]="StateCheckpoint.cc FlowClassifier.cc"
+    [flood_bench]="RoutingService.cc"
+    [shardmap_bench]="ShardMap.cc"
+    [commandqueue_bench]="CommandQueue.cc"
+    [flowconflict_bench]="FlowConflictIndex.cc"
+)
+
+# benchmark name -> OMNeT++ libraries it needs
+declare -A OMNETPP_LIBS=(
+    [commandparse_bench]="-loppcommon"
+)
+
+BENCHMARKS=${*:-${!SOURCES[@]}}
+
+for bench in $BENCHMARKS; do
+    srcs="$bench.cc"
+    for s in ${SOURCES[$bench]}; do
+        srcs="$srcs $CONTROLLER_DIR/$s"
+    done
+    libs=""
+    if [ -n "${OMNETPP_LIBS[$bench]}" ]; then
+        libs="-I$OMNETPP_ROOT/src -I$OMNETPP_ROOT/include -L$OMNETPP_ROOT/lib -Wl,-rpath,$OMNETPP_ROOT/lib ${OMNETPP_LIBS[$bench]}"
+    fi
+    echo "==================================================================="
+    echo "$bench"
+    echo "==================================================================="
+    $CXX $CXXFLAGS -I$CONTROLLER_DIR -o $BUILD_DIR/$bench $srcs $libs -pthread || exit 1
+    ./$BUILD_DIR/$bench || exit 1
+    echo ""
+done
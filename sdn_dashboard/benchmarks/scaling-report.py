@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Scaling report of the controller benchmarks (simulations/scaling.ini and
+simulations/sharding.ini).
+
+Reads the scalar files of the runs, averages the repetitions of each
+parameter combination, and prints the measurements per combination and how
+each measurement grows with each parameter (the median exponent b of
+measurement ~ parameter^b, the other parameters held fixed).
+
+With --save-baseline, the measurements are also saved as JSON; with
+--baseline, they are compared against such a file, and the script exits
+with status 1 if a measurement got worse by more than --tolerance.
+
+Usage: scaling-report.py [--baseline FILE] [--save-baseline FILE]
+                         [--tolerance FRACTION] SCA_FILE_OR_DIR...
+"""
+
+import argparse
+import glob
+import json
+import math
+import os
+import sys
+from collections import defaultdict
+from statistics import mean, median
+
+# scalar name -> (column title, scale, format, higher is better)
+METRICS = {
+    'eventsPerSecond': ('events/s', 1, '%10.0f', True),
+    'handlerTime': ('handler ms', 1e3, '%10.1f', False),
+    'handlerTimePerEvent': ('us/event', 1e6, '%8.2f', False),
+    'stateExportBytes': ('export MB', 1e-6, '%9.2f', False),
+    'peakRss': ('RSS MB', 1e-6, '%8.1f', False),
+    'commandThroughput': ('cmds/s', 1, '%8.0f', True),
+    'commandLatency': ('cmd ms', 1e3, '%8.2f', False),
+    'packetInThroughput': ('pkt-in/s', 1, '%8.0f', True),
+    'packetInLatency': ('pkt-in ms', 1e3, '%8.2f', False),
+}
+
+
+# recorded by the controller (recordPerformance) and the load generator
+SCALARS = {'eventsPerSecond', 'handlerTime', 'handledEvents', 'stateExportBytes', 'peakRss', 'flowTableSize',
+           'commandsSubmitted', 'commandThroughput', 'commandLatency', 'packetInThroughput', 'packetInLatency'}
+
+
+def read_runs(paths):
+    """Returns a list of (itervars, scalars) per run, with the scalars of
+    SCALARS by name."""
+    files = []
+    for path in paths:
+        files += sorted(glob.glob(os.path.join(path, '*.sca'))) if os.path.isdir(path) else [path]
+    runs = []
+    for file in files:
+        itervars, scalars = None, None
+        with open(file) as f:
+            for line in f:
+                fields = line.split()
+                if not fields:
+                    continue
+                if fields[0] == 'run':
+                    itervars, scalars = {}, {}
+                    runs.append((itervars, scalars))
+                elif fields[0] == 'itervar' and itervars is not None and fields[1] != 'repetition':
+                    itervars[fields[1]] = float(fields[2].strip('"').rstrip('Hz'))
+                elif fields[0] == 'scalar' and scalars is not None and len(fields) >= 4 and fields[2] in SCALARS:
+                    scalars[fields[2]] = float(fields[3])
+    return [(v, s) for v, s in runs if 'handlerTime' in s or 'commandThroughput' in s]
+
+
+def summarize(runs):
+    """Returns {combination: {metric: mean}}, with combinations as tuples of
+    (itervar, value) pairs."""
+    groups = defaultdict(list)
+    for itervars, scalars in runs:
+        groups[tuple(sorted(itervars.items()))].append(scalars)
+    results = {}
+    for key, group in groups.items():
+        result = {}
+        for scalars in group:
+            events = scalars.get('handledEvents', 0) + scalars.get('commandsSubmitted', 0)
+            if 'handlerTime' in scalars:
+                scalars['handlerTimePerEvent'] = scalars['handlerTime'] / events if events else 0
+        for metric in list(METRICS) + ['flowTableSize']:
+            values = [s[metric] for s in group if metric in s]
+            if values:
+                result[metric] = mean(values)
+        results[key] = result
+    return results
+
+
+def print_table(results):
+    names = [name for name, _ in next(iter(results))]
+    print(' '.join('%13s' % n for n in names) + ' %9s ' % 'flows'
+          + ' '.join('%10s' % METRICS[m][0] for m in METRICS))
+    for key in sorted(results):
+        result = results[key]
+        line = ' '.join('%13g' % value for _, value in key) + ' %9.0f ' % result.get('flowTableSize', 0)
+        for metric, (_, scale, fmt, _) in METRICS.items():
+            line += ' ' + ('%10s' % '-' if metric not in result else '%10s' % (fmt % (result[metric] * scale)).strip())
+        print(line)
+
+
+def print_exponents(results):
+    names = [name for name, _ in next(iter(results))]
+    print('\nGrowth exponent b of measurement ~ parameter^b (median over the other parameters):')
+    print('%15s' % '' + ' '.join('%13s' % n for n in names))
+    for metric in METRICS:
+        line = '%15s' % METRICS[metric][0]
+        for i, name in enumerate(names):
+            # pairs of runs that differ in this parameter only
+            slopes = []
+            for key, result in results.items():
+                for other, otherResult in results.items():
+                    if other[i][1] <= key[i][1] or any(other[j] != key[j] for j in range(len(key)) if j != i):
+                        continue
+                    a, b = result.get(metric, 0), otherResult.get(metric, 0)
+                    if a > 0 and b > 0:
+                        slopes.append(math.log(b / a) / math.log(other[i][1] / key[i][1]))
+            line += ' %13s' % ('%.2f' % median(slopes) if slopes else '-')
+        print(line)
+
+
+def key_to_string(key):
+    return ','.join('%s=%g' % item for item in key)
+
+
+def compare(results, baseline, tolerance):
+    regressions = 0
+    for key in sorted(results):
+        base = baseline.get(key_to_string(key))
+        if base is None:
+            continue
+        for metric, (title, _, _, higherIsBetter) in METRICS.items():
+            if metric not in results[key] or not base.get(metric):
+                continue
+            ratio = results[key][metric] / base[metric]
+            worse = ratio < 1 - tolerance if higherIsBetter else ratio > 1 + tolerance
+            if worse:
+                print('REGRESSION %s: %s %.3g -> %.3g (%+.0f%%)' % (key_to_string(key), title, base[metric],
+                                                                  results[key][metric], (ratio - 1) * 100))
+                regressions += 1
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Scaling report of the controller benchmarks (simulations/scaling.ini, sharding.ini)')
+    parser.add_argument('inputs', nargs='+', help='scalar files, or directories of them')
+    parser.add_argument('--baseline', help='compare against measurements saved with --save-baseline')
+    parser.add_argument('--save-baseline', help='save the measurements to this file')
+    parser.add_argument('--tolerance', type=float, default=0.25,
+                        help='relative change of a measurement reported as regression (default: 0.25)')
+    args = parser.parse_args()
+
+    results = summarize(read_runs(args.inputs))
+    if not results:
+        sys.exit('No controller measurements found; was recordPerformance enabled?')
+
+    print_table(results)
+    if len(results) > 1:
+        print_exponents(results)
+
+    if args.save_baseline:
+        with open(args.save_baseline, 'w') as f:
+            json.dump({key_to_string(k): v for k, v in results.items()}, f, indent=1, sort_keys=True)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        print()
+        regressions = compare(results, baseline, args.tolerance)
+        print('%d regression(s) against %s' % (regressions, args.baseline))
+        if regressions:
+            sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,75 @@
+//
+// Microbenchmark for the consistent hashing of the controller shards
+// (ShardMap): how evenly slice names spread over the shards, for several
+// numbers of virtual nodes, what fraction of them moves when a shard is
+// added, against hashing modulo the number of shards, and the lookup rate.
+// Every key that moves on adding a shard is checked to move to the new one.
+//
+
+#include "ShardMap.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace sdn_dashboard;
+
+static const int NUM_KEYS = 100000;
+
+// max shard load relative to the mean
+static double imbalance(const std::vector<int> &shardOfKey, int numShards)
+{
+    std::vector<int> load(numShards, 0);
+    for (int shard : shardOfKey)
+        load[shard]++;
+    return *std::max_element(load.begin(), load.end()) / ((double)shardOfKey.size() / numShards);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<uint64_t> hashes;
+    for (int i = 0; i < NUM_KEYS; i++)
+        hashes.push_back(ShardMap::hashKey("Slice_" + std::to_string(i)));
+
+    printf("%d slice names\n\n", NUM_KEYS);
+    printf("shards  max/mean load by virtual nodes per shard          moved on adding a shard      lookups\n");
+    printf("          %8d %8d %8d %8d    %9s %9s %9s\n", 1, 16, 128, 1024, "ring", "ideal", "modulo");
+    for (int numShards : {2, 4, 8, 16, 32}) {
+        printf("%6d    ", numShards);
+        for (int virtualNodes : {1, 16, 128, 1024}) {
+            ShardMap map(numShards, virtualNodes);
+            std::vector<int> shardOfKey;
+            for (uint64_t hash : hashes)
+                shardOfKey.push_back(map.getShard(hash));
+            printf(" %8.2f", imbalance(shardOfKey, numShards));
+        }
+
+        // with the default number of virtual nodes
+        ShardMap before(numShards, 128), after(numShards + 1, 128);
+        long moved = 0, movedModulo = 0;
+        for (uint64_t hash : hashes) {
+            int from = before.getShard(hash), to = after.getShard(hash);
+            if (from != to) {
+                if (to != numShards) {
+                    fprintf(stderr, "MISMATCH: key moved from shard %d to shard %d instead of the new one\n", from, to);
+                    exit(1);
+                }
+                moved++;
+            }
+            if (hash % numShards != hash % (numShards + 1))
+                movedModulo++;
+        }
+
+        long sum = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < 10; repeat++)
+            for (uint64_t hash : hashes)
+                sum += before.getShard(hash);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        printf("    %8.1f%% %8.1f%% %8.1f%%  %6.1f M/s  (checksum %ld)\n", 100.0 * moved / NUM_KEYS, 100.0 / (numShards + 1),
+               100.0 * movedModulo / NUM_KEYS, 10.0 * NUM_KEYS / seconds / 1e6, sum);
+    }
+    return 0;
+}
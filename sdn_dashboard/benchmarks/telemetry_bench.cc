@@ -0,0 +1,192 @@
+//
+// Loopback load test for TelemetryServer: sustained state updates per second
+// published by the controller side and received by subscribed clients over
+// the UNIX-domain socket. Each client rebuilds the state from the snapshot
+// and deltas it receives, and must end up with exactly the published state.
+// One client of every run subscribes late, so it starts from a snapshot.
+//
+
+#include "TelemetryServer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace sdn_dashboard;
+
+typedef std::map<uint64_t, std::string> State;  // (kind << 32 | id) -> record
+
+struct ClientResult {
+    State state;
+    uint64_t seq = 0;
+    long deltas = 0;
+    long snapshots = 0;
+    bool gap = false;
+    std::chrono::steady_clock::time_point endTime;
+};
+
+static const char *SOCKET_PATH = "out/telemetry_bench.sock";
+
+static std::string flowRecord(int id, std::mt19937 &rng)
+{
+    // same encoding as SDNControllerApp::flowToBinary()
+    std::string r;
+    TelemetryServer::putI32(r, id);
+    TelemetryServer::putString(r, "10.0." + std::to_string(rng() % 256) + "." + std::to_string(rng() % 256));
+    TelemetryServer::putString(r, "10.1.0.0/16");
+    TelemetryServer::putString(r, "forward");
+    TelemetryServer::putI32(r, 100);
+    TelemetryServer::putI32(r, 1 + rng() % 8);
+    TelemetryServer::putF64(r, 30);
+    TelemetryServer::putF64(r, 0);
+    TelemetryServer::putI64(r, rng() % 100000);
+    TelemetryServer::putI64(r, rng() % 100000000);
+    return r;
+}
+
+static void applyFrame(uint8_t type, const char *p, ClientResult &result)
+{
+    if (type == TelemetryServer::SNAPSHOT) {
+        result.state.clear();
+        result.seq = TelemetryServer::getU64(p);
+        uint32_t count = TelemetryServer::getU32(p + 8);
+        p += 12;
+        for (uint32_t i = 0; i < count; i++) {
+            uint64_t key = (uint64_t)(uint8_t)p[0] << 32 | TelemetryServer::getU32(p + 1);
+            uint32_t len = TelemetryServer::getU32(p + 5);
+            result.state[key].assign(p + 9, len);
+            p += 9 + len;
+        }
+        result.snapshots++;
+    }
+    else if (type == TelemetryServer::DELTA) {
+        uint64_t seq = TelemetryServer::getU64(p);
+        if (seq != result.seq + 1)
+            result.gap = true;
+        result.seq = seq;
+        uint64_t key = (uint64_t)(uint8_t)p[16] << 32 | TelemetryServer::getU32(p + 17);
+        uint32_t len = TelemetryServer::getU32(p + 21);
+        if (len == 0)
+            result.state.erase(key);
+        else
+            result.state[key].assign(p + 25, len);
+        result.deltas++;
+    }
+}
+
+static void runClient(uint64_t sinceSeq, const std::atomic<uint64_t> &finalSeq, ClientResult &result)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, SOCKET_PATH);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+
+    std::string request;
+    TelemetryServer::putU32(request, 9);
+    TelemetryServer::putU8(request, TelemetryServer::SUBSCRIBE);
+    TelemetryServer::putU64(request, sinceSeq);
+    if (write(fd, request.data(), request.size()) != (ssize_t)request.size()) {
+        perror("write");
+        exit(1);
+    }
+
+    // read in large chunks and decode all complete frames in each
+    result.seq = sinceSeq;
+    std::string buffer;
+    size_t pos = 0;
+    char chunk[65536];
+    while (finalSeq == 0 || result.seq < finalSeq) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0)
+            break;
+        buffer.append(chunk, n);
+        while (buffer.size() - pos >= 5) {
+            uint32_t length = TelemetryServer::getU32(buffer.data() + pos);
+            if (buffer.size() - pos - 4 < length)
+                break;
+            applyFrame(buffer[pos + 4], buffer.data() + pos + 5, result);
+            pos += 4 + length;
+        }
+        buffer.erase(0, pos);
+        pos = 0;
+    }
+    result.endTime = std::chrono::steady_clock::now();
+    close(fd);
+}
+
+static void run(int numClients, int numDeltas, std::mt19937 &rng)
+{
+    TelemetryServer server;
+    server.start(SOCKET_PATH);
+    State expected;
+    std::atomic<uint64_t> finalSeq(0);
+
+    // on-time clients subscribe before the first delta, the last one halfway
+    std::vector<ClientResult> results(numClients);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < numClients - 1; i++)
+        clients.emplace_back(runClient, 0, std::cref(finalSeq), std::ref(results[i]));
+    while (server.getStats().numClients < (size_t)numClients - 1)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // flows churn over a table of 100k entries, a tenth of the updates are removals
+    const int tableSize = 100000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 1; i <= numDeltas; i++) {
+        int id = 1 + rng() % tableSize;
+        uint64_t key = (uint64_t)2 << 32 | id;
+        std::string record = rng() % 10 == 0 ? std::string() : flowRecord(id, rng);
+        if (record.empty())
+            expected.erase(key);
+        else
+            expected[key] = record;
+        server.publish(i, i * 1e-3, 2, id, record);
+        if (i == numDeltas / 2)
+            clients.emplace_back(runClient, 0, std::cref(finalSeq), std::ref(results[numClients - 1]));
+    }
+    double publishSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    finalSeq = numDeltas;
+    for (std::thread &t : clients)
+        t.join();
+    TelemetryServer::Stats stats = server.getStats();
+    server.stop();
+
+    double slowest = 0;
+    for (int i = 0; i < numClients; i++) {
+        const ClientResult &r = results[i];
+        if (r.seq != (uint64_t)numDeltas || r.gap || r.state != expected) {
+            fprintf(stderr, "MISMATCH: client %d of %d ends at seq %lu%s, %zu entries (expected %zu)\n",
+                    i, numClients, (unsigned long)r.seq, r.gap ? " with gaps" : "", r.state.size(), expected.size());
+            exit(1);
+        }
+        slowest = std::max(slowest, std::chrono::duration<double>(r.endTime - t0).count());
+    }
+    printf("%3d clients  %8d updates  publish %10.0f updates/s  delivered to all %10.0f updates/s per client"
+           "  (%.1f MB sent, %lu snapshots, state verified)\n",
+           numClients, numDeltas, numDeltas / publishSec, numDeltas / slowest,
+           stats.bytesSent / 1e6, (unsigned long)stats.snapshotsSent);
+}
+
+int main(int argc, char **argv)
+{
+    int numDeltas = argc > 1 ? atoi(argv[1]) : 1000000;
+    std::mt19937 rng(42);
+    for (int numClients : {1, 4, 16})
+        run(numClients, numDeltas, rng);
+    unlink(SOCKET_PATH);
+    return 0;
+}
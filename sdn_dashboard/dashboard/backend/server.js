@@ -4,7 +4,9 @@ const bodyParser = require('body-parser');
 const fs = require('fs');
 const WebSocket = require('ws');
 const path = require('path');
+const net = require('net');
 const MetricsCollector = require('./metricsCollector');
+const TelemetryClient = require('./telemetryClient');
 
 const app = express();
 const PORT = process.env.PORT || 3001;
@@ -16,15 +18,36 @@ app.use(bodyParser.json());
 // Path to OMNeT++ simulation results
 const RESULTS_DIR = path.join(__dirname, '../../simulations/results');
 const STATE_FILE = path.join(RESULTS_DIR, 'controller_state.json');
+const JOURNAL_FILE = path.join(RESULTS_DIR, 'controller_journal.jsonl');
+const COMMAND_FILE = path.join(RESULTS_DIR, 'commands.json');
+const COMMAND_SOCKET = path.join(RESULTS_DIR, 'controller.sock');
+const COMMAND_RESULTS_FILE = path.join(RESULTS_DIR, 'command_results.json');
+const BATCH_COMMAND_TYPES = ['CREATE_SLICE', 'UPDATE_SLICE', 'DELETE_SLICE', 'ADD_FLOW', 'DELETE_FLOW'];
 const TOPOLOGY_FILE = path.join(RESULTS_DIR, 'topology.json');
+const TELEMETRY_SOCKET = path.join(RESULTS_DIR, 'telemetry.sock');
+const TELEMETRY_RETRY_MS = 2000;
 
 // In-memory cache
 let currentState = {
     slices: [],
     flows: [],
-    timestamp: 0
+    timestamp: 0,
+    seq: 0
 };
 
+// Journal tailing state: byte offset of the next unapplied line, and the
+// inode and first (SNAPSHOT) line of the journal it refers to
+let journalOffset = 0;
+let journalIno = null;
+let journalHeader = null;
+let journalBadOffset = -1;  // of a line that did not parse on the last read
+const MAX_RECENT_DELTAS = 1000;
+let recentDeltas = [];
+
+// While subscribed to the controller's telemetry socket, changes are pushed
+// from there and the journal is not read
+let telemetryConnected = false;
+
 let topology = {
     nodes: [],
     links: []
@@ -56,7 +79,8 @@ function loadState() {
         if (fs.existsSync(STATE_FILE)) {
             const data = fs.readFileSync(STATE_FILE, 'utf8');
             currentState = JSON.parse(data);
-            console.log('Loaded state:', currentState.slices.length, 'slices,', currentState.flows.length, 'flows');
+            currentState.seq = currentState.seq || 0;
+            console.log('Loaded state:', currentState.slices.length, 'slices,', currentState.flows.length, 'flows, seq', currentState.seq);
         } else {
             console.warn('State file not found:', STATE_FILE);
         }
@@ -65,6 +89,140 @@ function loadState() {
     }
 }
 
+function upsertById(list, item) {
+    const index = list.findIndex(x => x.id === item.id);
+    if (index === -1) {
+        list.push(item);
+    } else {
+        list[index] = item;
+    }
+}
+
+function removeById(list, id) {
+    const index = list.findIndex(x => x.id === id);
+    if (index !== -1) {
+        list.splice(index, 1);
+    }
+}
+
+function applyDelta(delta) {
+    switch (delta.op) {
+        case 'ADD_FLOW':
+            upsertById(currentState.flows, delta.flow);
+            break;
+        case 'DELETE_FLOW':
+            removeById(currentState.flows, delta.id);
+            break;
+        case 'FLOW_STATS': {
+            const flow = currentState.flows.find(x => x.id === delta.id);
+            if (flow) {
+                flow.packets = delta.packets;
+                flow.bytes = delta.bytes;
+            }
+            break;
+        }
+        case 'CREATE_SLICE':
+        case 'UPDATE_SLICE':
+            upsertById(currentState.slices, delta.slice);
+            break;
+        case 'DELETE_SLICE':
+            removeById(currentState.slices, delta.id);
+            break;
+        default:
+            console.warn('Unknown journal op:', delta.op);
+            return;
+    }
+    currentState.seq = delta.seq;
+    currentState.timestamp = delta.timestamp;
+
+    recentDeltas.push(delta);
+    if (recentDeltas.length > MAX_RECENT_DELTAS) {
+        recentDeltas.shift();
+    }
+}
+
+// First line of the journal, or null if it is not complete yet
+function readJournalHeader(fd) {
+    const buffer = Buffer.alloc(128);
+    const bytesRead = fs.readSync(fd, buffer, 0, buffer.length, 0);
+    const end = buffer.indexOf(0x0a);
+    return end === -1 || end >= bytesRead ? null : buffer.toString('utf8', 0, end);
+}
+
+// Read only the journal lines appended since the last call. The controller
+// rewrites the journal from a SNAPSHOT marker line after each snapshot and
+// restart, and the new journal may have grown past our offset by the time we
+// look, so a rewrite is detected by the inode and the marker line changing,
+// not only by the file shrinking. The offset moves past a line only once it
+// has been applied (or was older than our state), so a line that cannot be
+// read now is read again on the next call.
+function tailJournal() {
+    let applied = 0;
+    let fd;
+    try {
+        if (!fs.existsSync(JOURNAL_FILE)) {
+            return 0;
+        }
+        fd = fs.openSync(JOURNAL_FILE, 'r');
+        const stat = fs.fstatSync(fd);
+        const header = readJournalHeader(fd);
+        if (header === null) {
+            return 0;
+        }
+        if (stat.ino !== journalIno || header !== journalHeader || stat.size < journalOffset) {
+            journalIno = stat.ino;
+            journalHeader = header;
+            journalOffset = 0;
+            journalBadOffset = -1;
+        }
+        if (stat.size === journalOffset) {
+            return 0;
+        }
+
+        const buffer = Buffer.alloc(stat.size - journalOffset);
+        const bytesRead = fs.readSync(fd, buffer, 0, buffer.length, journalOffset);
+
+        // An incomplete trailing line is left for the next read
+        let start = 0;
+        for (let end = buffer.indexOf(0x0a); end !== -1 && end < bytesRead; start = end + 1, end = buffer.indexOf(0x0a, start)) {
+            const line = buffer.toString('utf8', start, end);
+            if (line.trim()) {
+                try {
+                    const entry = JSON.parse(line);
+                    if (entry.op === 'SNAPSHOT') {
+                        // Deltas we have not seen were folded into the snapshot
+                        if (entry.seq > currentState.seq) {
+                            loadState();
+                            recentDeltas = [];
+                            applied++;
+                        }
+                    } else if (entry.seq > currentState.seq) {
+                        applyDelta(entry);
+                        applied++;
+                    }
+                } catch (err) {
+                    // Read again once, in case the journal was being rewritten
+                    // under us; the next call sees the new marker line then
+                    if (journalBadOffset !== journalOffset) {
+                        console.warn('Unreadable journal line at offset', journalOffset + ', retrying:', err.message);
+                        journalBadOffset = journalOffset;
+                        break;
+                    }
+                    console.error('Skipping unreadable journal line at offset', journalOffset + ':', err.message);
+                }
+            }
+            journalOffset += end + 1 - start;
+        }
+    } catch (err) {
+        console.error('Error reading journal:', err);
+    } finally {
+        if (fd !== undefined) {
+            fs.closeSync(fd);
+        }
+    }
+    return applied;
+}
+
 function loadTopology() {
     try {
         if (fs.existsSync(TOPOLOGY_FILE)) {
@@ -79,13 +237,87 @@ function loadTopology() {
     }
 }
 
+// Send a command or batch to the controller. When the simulation runs with
+// event-driven command ingestion, it listens on COMMAND_SOCKET and applies the
+// command on arrival; otherwise (or if the socket is stale) the command file is
+// written for the controller to pick up.
+function sendCommand(command) {
+    const payload = JSON.stringify(command);
+    // One command per line, appended: the controller takes the whole file
+    // and queues each of them, so none is lost between two checks
+    const writeCommandFile = () => fs.appendFileSync(COMMAND_FILE, payload + '\n');
+
+    if (!fs.existsSync(COMMAND_SOCKET)) {
+        writeCommandFile();
+        return;
+    }
+    const client = net.createConnection(COMMAND_SOCKET, () => {
+        client.end(payload + '\n');
+    });
+    client.on('error', (err) => {
+        console.warn('Controller socket unavailable, writing command file instead:', err.message);
+        writeCommandFile();
+    });
+}
+
+// Subscribe to the state changes on the telemetry socket of a running
+// simulation; without one, the journal is tailed instead. Only the changes
+// after the last seq we know are requested, so a reconnect within the
+// buffered history of the controller costs no snapshot.
+function connectTelemetry() {
+    if (!fs.existsSync(TELEMETRY_SOCKET)) {
+        setTimeout(connectTelemetry, TELEMETRY_RETRY_MS);
+        return;
+    }
+    const client = new TelemetryClient(TELEMETRY_SOCKET);
+    let changed = false;
+    client.on('snapshot', (snapshot) => {
+        currentState.slices = snapshot.slices;
+        currentState.flows = snapshot.flows;
+        currentState.seq = snapshot.seq;
+        recentDeltas = [];
+        changed = true;
+    });
+    client.on('delta', (delta) => {
+        if (delta.seq > currentState.seq) {
+            applyDelta(delta);
+            changed = true;
+        }
+    });
+    // One broadcast for all the changes that arrived together
+    client.on('batch', () => {
+        if (!telemetryConnected) {
+            console.log('Subscribed to controller telemetry at seq', currentState.seq);
+            telemetryConnected = true;
+        }
+        if (changed) {
+            changed = false;
+            broadcastUpdate();
+        }
+    });
+    client.on('error', (err) => {
+        console.warn('Telemetry socket unavailable:', err.message);
+    });
+    client.on('close', () => {
+        if (telemetryConnected) {
+            console.log('Telemetry connection closed, reading the journal until reconnected');
+            telemetryConnected = false;
+            if (tailJournal() > 0) {
+                broadcastUpdate();
+            }
+        }
+        setTimeout(connectTelemetry, TELEMETRY_RETRY_MS);
+    });
+    client.connect(currentState.seq);
+}
+
 // Watch for file changes
 if (fs.existsSync(RESULTS_DIR)) {
     fs.watch(RESULTS_DIR, (eventType, filename) => {
-        if (filename === 'controller_state.json') {
-            console.log('State file changed, reloading...');
-            setTimeout(loadState, 100);  // Small delay to ensure write is complete
-            broadcastUpdate();
+        if (filename === 'controller_journal.jsonl' && !telemetryConnected) {
+            if (tailJournal() > 0) {
+                broadcastUpdate();
+            }
         }
     });
     console.log('Watching directory:', RESULTS_DIR);
@@ -151,10 +383,7 @@ app.post('/api/slices', (req, res) => {
         timestamp: Date.now()
     };
 
-    fs.writeFileSync(
-        path.join(RESULTS_DIR, 'commands.json'),
-        JSON.stringify(command, null, 2)
-    );
+    sendCommand(command);
 
     const duration = Date.now() - start;
     metricsCollector.recordSliceOperation('create', newSlice.id, duration, true);
@@ -186,10 +415,7 @@ app.put('/api/slices/:id', (req, res) => {
         timestamp: Date.now()
     };
 
-    fs.writeFileSync(
-        path.join(RESULTS_DIR, 'commands.json'),
-        JSON.stringify(command, null, 2)
-    );
+    sendCommand(command);
 
     broadcastUpdate();
     res.json(currentState.slices[sliceIndex]);
@@ -210,17 +436,15 @@ app.delete('/api/slices/:id', (req, res) => {
     // Remove slice
     const deletedSlice = currentState.slices.splice(sliceIndex, 1)[0];
 
-    // Send delete command to OMNeT++
+    // Send delete command to OMNeT++; ?urgent=true puts it ahead of queued commands
     const command = {
         type: 'DELETE_SLICE',
+        urgent: req.query.urgent === 'true' || undefined,
         data: { id: sliceId },
         timestamp: Date.now()
     };
 
-    fs.writeFileSync(
-        path.join(RESULTS_DIR, 'commands.json'),
-        JSON.stringify(command, null, 2)
-    );
+    sendCommand(command);
 
     const duration = Date.now() - start;
     metricsCollector.recordSliceOperation('delete', sliceId, duration, true);
@@ -257,7 +481,7 @@ app.get('/api/flows/:id', (req, res) => {
 // Create new flow
 app.post('/api/flows', (req, res) => {
     const start = Date.now();
-    const { srcIP, dstIP, action, priority, sliceId } = req.body;
+    const { srcIP, dstIP, action, priority, sliceId, idleTimeout, hardTimeout } = req.body;
 
     if (!srcIP || !dstIP || !action) {
         const duration = Date.now() - start;
@@ -275,6 +499,13 @@ app.post('/api/flows', (req, res) => {
         packets: 0,
         bytes: 0
     };
+    // Without them, the controller's flowIdleTimeout/flowHardTimeout apply
+    if (idleTimeout !== undefined) {
+        newFlow.idleTimeout = idleTimeout;
+    }
+    if (hardTimeout !== undefined) {
+        newFlow.hardTimeout = hardTimeout;
+    }
 
     currentState.flows.push(newFlow);
 
@@ -285,10 +516,7 @@ app.post('/api/flows', (req, res) => {
         timestamp: Date.now()
     };
 
-    fs.writeFileSync(
-        path.join(RESULTS_DIR, 'commands.json'),
-        JSON.stringify(command, null, 2)
-    );
+    sendCommand(command);
 
     const duration = Date.now() - start;
     metricsCollector.recordFlowOperation('add', newFlow.id, duration, true);
@@ -318,10 +546,7 @@ app.delete('/api/flows/:id', (req, res) => {
         timestamp: Date.now()
     };
 
-    fs.writeFileSync(
-        path.join(RESULTS_DIR, 'commands.json'),
-        JSON.stringify(command, null, 2)
-    );
+    sendCommand(command);
 
     const duration = Date.now() - start;
     metricsCollector.recordFlowOperation('delete', flowId, duration, true);
@@ -330,6 +555,63 @@ app.delete('/api/flows/:id', (req, res) => {
     res.json(deletedFlow);
 });
 
+// Submit a batch of commands; the controller applies all of them or none
+app.post('/api/batch', (req, res) => {
+    const commands = Array.isArray(req.body) ? req.body : req.body.commands;
+
+    if (!Array.isArray(commands) || commands.length === 0) {
+        return res.status(400).json({ error: 'Expected a non-empty array of commands' });
+    }
+    const invalid = commands.findIndex(c => !c || !BATCH_COMMAND_TYPES.includes(c.type));
+    if (invalid !== -1) {
+        return res.status(400).json({ error: 'Unsupported command type', index: invalid });
+    }
+
+    // Send the whole batch as one command for OMNeT++ to pick up; the
+    // controller queues it fairly among the tenants' commands
+    const { tenant, urgent } = Array.isArray(req.body) ? {} : req.body;
+    const batch = {
+        type: 'BATCH',
+        tenant,
+        urgent: urgent === true || undefined,
+        commands: commands.map(c => ({ type: c.type, data: c.data || {} })),
+        timestamp: Date.now()
+    };
+
+    sendCommand(batch);
+
+    res.status(202).json({ accepted: commands.length });
+});
+
+// Get per-command results of the last command or batch applied by the controller
+app.get('/api/batch/results', (req, res) => {
+    try {
+        if (!fs.existsSync(COMMAND_RESULTS_FILE)) {
+            return res.status(404).json({ error: 'No command results yet' });
+        }
+        res.json(JSON.parse(fs.readFileSync(COMMAND_RESULTS_FILE, 'utf8')));
+    } catch (err) {
+        res.status(500).json({ error: 'Error reading command results' });
+    }
+});
+
+// Get state changes since a journal sequence number
+app.get('/api/state/deltas', (req, res) => {
+    if (!telemetryConnected) {
+        tailJournal();
+    }
+    const since = parseInt(req.query.since) || 0;
+    const oldest = recentDeltas.length > 0 ? recentDeltas[0].seq : currentState.seq + 1;
+    if (since + 1 < oldest) {
+        // Too far behind: the client has to refetch the full state
+        return res.status(410).json({ error: 'Deltas no longer available', seq: currentState.seq });
+    }
+    res.json({
+        seq: currentState.seq,
+        deltas: recentDeltas.filter(d => d.seq > since)
+    });
+});
+
 // Get statistics
 app.get('/api/statistics', (req, res) => {
     const stats = {
@@ -500,7 +782,9 @@ const server = app.listen(PORT, () => {
     console.log('-'.repeat(60));
     console.log('Loading simulation data...');
     loadState();
+    tailJournal();
     loadTopology();
+    connectTelemetry();
     console.log('='.repeat(60));
     console.log('\nAvailable endpoints:');
     console.log('  GET  /api/health');
@@ -515,7 +799,10 @@ const server = app.listen(PORT, () => {
     console.log('  GET  /api/flows/:id');
     console.log('  POST /api/flows');
     console.log('  DELETE /api/flows/:id');
+    console.log('  POST /api/batch');
+    console.log('  GET  /api/batch/results');
     console.log('  GET  /api/statistics');
+    console.log('  GET  /api/state/deltas?since=<seq>');
     console.log('='.repeat(60));
 });
 
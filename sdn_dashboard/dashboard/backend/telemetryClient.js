@@ -0,0 +1,166 @@
+const net = require('net');
+const EventEmitter = require('events');
+
+// Message types and record kinds of the controller's telemetry socket
+// (see src/controller/TelemetryServer.h and SDNControllerApp::flowToBinary())
+const SUBSCRIBE = 1;
+const SNAPSHOT = 2;
+const DELTA = 3;
+const KIND_SLICE = 1;
+const KIND_FLOW = 2;
+
+class RecordReader {
+  constructor(buffer) {
+    this.buffer = buffer;
+    this.pos = 0;
+  }
+
+  u8() { return this.buffer.readUInt8(this.pos++); }
+  u16() { const v = this.buffer.readUInt16LE(this.pos); this.pos += 2; return v; }
+  i32() { const v = this.buffer.readInt32LE(this.pos); this.pos += 4; return v; }
+  i64() { const v = this.buffer.readBigInt64LE(this.pos); this.pos += 8; return Number(v); }
+  f64() { const v = this.buffer.readDoubleLE(this.pos); this.pos += 8; return v; }
+
+  str() {
+    const length = this.u16();
+    const s = this.buffer.toString('utf8', this.pos, this.pos + length);
+    this.pos += length;
+    return s;
+  }
+}
+
+// Records decode to the objects of the state file and journal
+function decodeFlow(buffer) {
+  const r = new RecordReader(buffer);
+  return {
+    id: r.i32(),
+    srcIP: r.str(),
+    dstIP: r.str(),
+    action: r.str(),
+    priority: r.i32(),
+    sliceId: r.i32(),
+    idleTimeout: r.f64(),
+    hardTimeout: r.f64(),
+    packets: r.i64(),
+    bytes: r.i64()
+  };
+}
+
+function decodeSlice(buffer) {
+  const r = new RecordReader(buffer);
+  const slice = {
+    id: r.i32(),
+    name: r.str(),
+    vlanId: r.i32(),
+    bandwidth: r.f64(),
+    isolated: r.u8() !== 0
+  };
+  const numHosts = r.u16();
+  slice.hosts = [];
+  for (let i = 0; i < numHosts; i++) {
+    slice.hosts.push(r.str());
+  }
+  return slice;
+}
+
+/**
+ * Subscribes to the controller's telemetry socket and emits:
+ *   'snapshot' ({ seq, slices, flows }): the full state, replacing all earlier ones
+ *   'delta' (entry): one change, in the form of a journal entry
+ *   'batch' (): after all messages that arrived together, to coalesce updates
+ *   'close' (): the connection was closed or could not be made
+ */
+class TelemetryClient extends EventEmitter {
+  constructor(socketPath) {
+    super();
+    this.socketPath = socketPath;
+    this.socket = null;
+    this.pending = Buffer.alloc(0);
+  }
+
+  // sinceSeq: the last state seq already known, or 0 to start from a snapshot
+  connect(sinceSeq) {
+    this.pending = Buffer.alloc(0);
+    this.socket = net.createConnection(this.socketPath, () => {
+      const request = Buffer.alloc(13);
+      request.writeUInt32LE(9, 0);
+      request.writeUInt8(SUBSCRIBE, 4);
+      request.writeBigUInt64LE(BigInt(sinceSeq || 0), 5);
+      this.socket.write(request);
+    });
+    this.socket.on('data', (chunk) => this.onData(chunk));
+    this.socket.on('error', (err) => this.emit('error', err));
+    this.socket.on('close', () => {
+      this.socket = null;
+      this.emit('close');
+    });
+  }
+
+  close() {
+    if (this.socket) {
+      this.socket.destroy();
+    }
+  }
+
+  onData(chunk) {
+    this.pending = this.pending.length > 0 ? Buffer.concat([this.pending, chunk]) : chunk;
+    let pos = 0;
+    while (this.pending.length - pos >= 5) {
+      const length = this.pending.readUInt32LE(pos);
+      if (this.pending.length - pos - 4 < length) {
+        break;
+      }
+      this.onMessage(this.pending.readUInt8(pos + 4), this.pending.subarray(pos + 5, pos + 4 + length));
+      pos += 4 + length;
+    }
+    this.pending = this.pending.subarray(pos);
+    if (pos > 0) {
+      this.emit('batch');
+    }
+  }
+
+  onMessage(type, body) {
+    if (type === SNAPSHOT) {
+      const snapshot = { seq: Number(body.readBigUInt64LE(0)), slices: [], flows: [] };
+      const count = body.readUInt32LE(8);
+      let pos = 12;
+      for (let i = 0; i < count; i++) {
+        const kind = body.readUInt8(pos);
+        const length = body.readUInt32LE(pos + 5);
+        const record = body.subarray(pos + 9, pos + 9 + length);
+        if (kind === KIND_SLICE) {
+          snapshot.slices.push(decodeSlice(record));
+        } else if (kind === KIND_FLOW) {
+          snapshot.flows.push(decodeFlow(record));
+        }
+        pos += 9 + length;
+      }
+      this.emit('snapshot', snapshot);
+    } else if (type === DELTA) {
+      const entry = { seq: Number(body.readBigUInt64LE(0)), timestamp: body.readDoubleLE(8) };
+      const kind = body.readUInt8(16);
+      const id = body.readInt32LE(17);
+      const length = body.readUInt32LE(21);
+      const record = body.subarray(25, 25 + length);
+      if (kind === KIND_FLOW) {
+        if (length === 0) {
+          Object.assign(entry, { op: 'DELETE_FLOW', id });
+        } else {
+          Object.assign(entry, { op: 'ADD_FLOW', flow: decodeFlow(record) });
+        }
+      } else if (kind === KIND_SLICE) {
+        if (length === 0) {
+          Object.assign(entry, { op: 'DELETE_SLICE', id });
+        } else {
+          // creation and update are applied alike
+          Object.assign(entry, { op: 'UPDATE_SLICE', slice: decodeSlice(record) });
+        }
+      } else {
+        return;
+      }
+      this.emit('delta', entry);
+    }
+  }
+}
+
+module.exports = TelemetryClient;
@@ -80,6 +80,20 @@ function TopologyView({ topology, slices, selectedSlice }) {
       positions['edgeSwitch0'] = { x: width / 4, y: edgeY };
       positions['edgeSwitch1'] = { x: width / 2, y: edgeY };
       positions['edgeSwitch2'] = { x: (3 * width) / 4, y: edgeY };
+
+      // Other switches (e.g. of a fat-tree): one row per name prefix
+      const layers = {};
+      switches.filter(node => !positions[node.id]).forEach(node => {
+        const layer = node.id.replace(/[0-9]+$/, '');
+        (layers[layer] = layers[layer] || []).push(node);
+      });
+      const layerNames = Object.keys(layers);
+      layerNames.forEach((layer, row) => {
+        const y = coreY + (row * (edgeY - coreY)) / Math.max(layerNames.length - 1, 1);
+        layers[layer].forEach((node, i) => {
+          positions[node.id] = { x: (width * (i + 1)) / (layers[layer].length + 1), y };
+        });
+      });
     }
 
     // Hosts at bottom, grouped by slice
@@ -152,30 +166,34 @@ function TopologyView({ topology, slices, selectedSlice }) {
     // Draw links (create default topology links if not provided)
     const links = [];
 
-    // Controller to core switches
-    if (positions['controller'] && positions['coreSwitch1']) {
-      links.push({ source: 'controller', target: 'coreSwitch1' });
-      links.push({ source: 'controller', target: 'coreSwitch2' });
-    }
-
-    // Core switches to aggregation switches
-    ['aggSwitch0', 'aggSwitch1', 'aggSwitch2'].forEach(agg => {
-      if (positions[agg]) {
-        links.push({ source: 'coreSwitch1', target: agg });
-        links.push({ source: 'coreSwitch2', target: agg });
+    if (topology.links && topology.links.length > 0) {
+      topology.links.forEach(link => links.push({ source: link.source, target: link.target }));
+    } else {
+      // Controller to core switches
+      if (positions['controller'] && positions['coreSwitch1']) {
+        links.push({ source: 'controller', target: 'coreSwitch1' });
+        links.push({ source: 'controller', target: 'coreSwitch2' });
       }
-    });
 
-    // Aggregation to edge switches
-    links.push({ source: 'aggSwitch0', target: 'edgeSwitch0' });
-    links.push({ source: 'aggSwitch1', target: 'edgeSwitch1' });
-    links.push({ source: 'aggSwitch2', target: 'edgeSwitch2' });
+      // Core switches to aggregation switches
+      ['aggSwitch0', 'aggSwitch1', 'aggSwitch2'].forEach(agg => {
+        if (positions[agg]) {
+          links.push({ source: 'coreSwitch1', target: agg });
+          links.push({ source: 'coreSwitch2', target: agg });
+        }
+      });
 
-    // Edge switches to hosts
-    nodesByType.host && nodesByType.host.forEach((node, i) => {
-      const sliceId = node.slice !== undefined ? node.slice : 0;
-      links.push({ source: `edgeSwitch${sliceId}`, target: node.id });
-    });
+      // Aggregation to edge switches
+      links.push({ source: 'aggSwitch0', target: 'edgeSwitch0' });
+      links.push({ source: 'aggSwitch1', target: 'edgeSwitch1' });
+      links.push({ source: 'aggSwitch2', target: 'edgeSwitch2' });
+
+      // Edge switches to hosts
+      nodesByType.host && nodesByType.host.forEach((node, i) => {
+        const sliceId = node.slice !== undefined ? node.slice : 0;
+        links.push({ source: `edgeSwitch${sliceId}`, target: node.id });
+      });
+    }
 
     // Filter links to only show connections between visible nodes
     const visibleNodeIds = new Set(visibleNodes.map(n => n.id));
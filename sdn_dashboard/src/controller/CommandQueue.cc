@@ -0,0 +1,159 @@
+#include "CommandQueue.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace sdn_dashboard {
+
+void CommandQueue::configure(double rate, double burst, long quantum, size_t maxQueuedPerTenant)
+{
+    if (rate < 0 || burst < 1 || quantum < 1)
+        throw std::runtime_error("CommandQueue: rate must not be negative, burst and quantum must be at least 1");
+    this->rate = rate;
+    this->burst = burst;
+    this->quantum = quantum;
+    this->maxQueuedPerTenant = maxQueuedPerTenant;
+}
+
+void CommandQueue::refill(Tenant &tenant, double now) const
+{
+    if (now > tenant.lastRefill) {
+        tenant.tokens = std::min(burst, tenant.tokens + rate * (now - tenant.lastRefill));
+        tenant.lastRefill = now;
+    }
+}
+
+bool CommandQueue::hasTokens(const Tenant &tenant) const
+{
+    // with some slack for the rounding of the refill times
+    return rate == 0 || tenant.tokens + 1e-9 >= std::min<double>(tenant.items.front().cost, burst);
+}
+
+bool CommandQueue::isForgettable(Tenant &tenant, double now) const
+{
+    if (tenant.active)
+        return false;
+    refill(tenant, now);
+    return rate == 0 || tenant.tokens >= burst;
+}
+
+void CommandQueue::sweepIdleTenants(double now)
+{
+    for (auto it = tenants.begin(); it != tenants.end(); ) {
+        if (isForgettable(it->second, now))
+            it = tenants.erase(it);
+        else
+            ++it;
+    }
+    sweepThreshold = std::max<size_t>(64, 2 * tenants.size());
+}
+
+bool CommandQueue::push(Item &&item)
+{
+    if (item.urgent) {
+        numQueuedCommands += item.cost;
+        urgentItems.push_back(std::move(item));
+        return true;
+    }
+    auto it = tenants.find(item.tenant);
+    if (it == tenants.end()) {
+        if (tenants.size() >= sweepThreshold)
+            sweepIdleTenants(item.enqueueTime);
+        // a new tenant starts with a full bucket
+        it = tenants.emplace(item.tenant, Tenant()).first;
+        it->second.tokens = burst;
+        it->second.lastRefill = item.enqueueTime;
+    }
+    Tenant &tenant = it->second;
+    // an item larger than the limit is accepted into an empty queue, or it
+    // could never be
+    if (maxQueuedPerTenant > 0 && tenant.queuedCommands > 0 && tenant.queuedCommands + item.cost > maxQueuedPerTenant)
+        return false;
+    tenant.queuedCommands += item.cost;
+    numQueuedCommands += item.cost;
+    tenant.items.push_back(std::move(item));
+    if (!tenant.active) {
+        tenant.active = true;
+        tenant.deficit = 0;
+        activeTenants.push_back(&tenant);
+    }
+    return true;
+}
+
+bool CommandQueue::pop(double now, Item &item)
+{
+    if (!urgentItems.empty()) {
+        item = std::move(urgentItems.front());
+        urgentItems.pop_front();
+        numQueuedCommands -= item.cost;
+        return true;
+    }
+
+    // Deficit round robin over the tenants with tokens; the loop ends when
+    // every tenant was skipped for lack of tokens since the last change
+    size_t skipped = 0;
+    while (skipped < activeTenants.size()) {
+        Tenant &tenant = *activeTenants.front();
+        refill(tenant, now);
+        if (!hasTokens(tenant)) {
+            activeTenants.push_back(activeTenants.front());
+            activeTenants.pop_front();
+            skipped++;
+            continue;
+        }
+        skipped = 0;
+        int cost = tenant.items.front().cost;
+        if (tenant.deficit < cost) {
+            // start of a turn
+            tenant.deficit += quantum;
+            if (tenant.deficit < cost) {
+                activeTenants.push_back(activeTenants.front());
+                activeTenants.pop_front();
+                continue;
+            }
+        }
+        item = std::move(tenant.items.front());
+        tenant.items.pop_front();
+        tenant.deficit -= cost;
+        tenant.tokens -= cost;  // may go into debt, see hasTokens()
+        tenant.queuedCommands -= cost;
+        numQueuedCommands -= cost;
+        if (tenant.items.empty()) {
+            tenant.active = false;
+            activeTenants.pop_front();
+        }
+        else if (tenant.deficit < tenant.items.front().cost) {
+            // end of the turn
+            activeTenants.push_back(activeTenants.front());
+            activeTenants.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+double CommandQueue::getNextEligibleTime(double now) const
+{
+    if (!urgentItems.empty())
+        return now;
+    double next = std::numeric_limits<double>::infinity();
+    for (const Tenant *tenant : activeTenants) {
+        if (rate == 0)
+            return now;
+        double tokens = std::min(burst, tenant->tokens + rate * std::max(0.0, now - tenant->lastRefill));
+        double needed = std::min<double>(tenant->items.front().cost, burst) - tokens;
+        next = std::min(next, needed <= 0 ? now : now + needed / rate);
+    }
+    return next;
+}
+
+void CommandQueue::clear()
+{
+    urgentItems.clear();
+    tenants.clear();
+    activeTenants.clear();
+    numQueuedCommands = 0;
+    sweepThreshold = 64;
+}
+
+} // namespace sdn_dashboard
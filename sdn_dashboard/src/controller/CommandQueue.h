@@ -0,0 +1,96 @@
+#ifndef __SDN_DASHBOARD_COMMANDQUEUE_H
+#define __SDN_DASHBOARD_COMMANDQUEUE_H
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+
+namespace sdn_dashboard {
+
+/**
+ * Queue of dashboard commands waiting to be executed by the controller,
+ * fair between tenants.
+ *
+ * Each tenant has a FIFO of its own. The tenants with queued commands take
+ * turns by deficit round robin: a turn allows up to quantum commands (a
+ * batch counts as its number of commands), so a tenant pushing large
+ * batches gets no more throughput than one sending single commands. A
+ * token bucket per tenant (rate commands/s, up to burst) additionally
+ * limits each tenant's long-term rate; a tenant out of tokens is skipped
+ * until the bucket refills. An item larger than the burst is let through
+ * with a full bucket and leaves it in debt. Urgent items (operator
+ * commands) bypass both, and are served first, in arrival order.
+ *
+ * An idle tenant with a full bucket is the same as a new one, so those are
+ * forgotten: when a new tenant would double the number of tenants since
+ * the last sweep, the idle ones with full buckets are removed. This keeps
+ * the table within twice the tenants that are queued or refilling, while
+ * tenants coming back soon keep their entry.
+ *
+ * Times are in seconds of the caller's clock.
+ */
+class CommandQueue
+{
+  public:
+    struct Item {
+        std::string tenant;
+        std::string payload;     // command or batch, as received
+        int cost = 1;            // number of commands
+        bool urgent = false;
+        double enqueueTime = 0;
+    };
+
+  protected:
+    struct Tenant {
+        std::deque<Item> items;
+        size_t queuedCommands = 0;
+        double tokens = 0;
+        double lastRefill = 0;
+        long deficit = 0;
+        bool active = false;     // in activeTenants
+    };
+
+    // config
+    double rate = 0;             // commands/s per tenant, 0 = unlimited
+    double burst = 100;
+    long quantum = 100;
+    size_t maxQueuedPerTenant = 0;  // commands, 0 = unlimited
+
+    // state
+    std::deque<Item> urgentItems;
+    std::map<std::string, Tenant> tenants;
+    std::deque<Tenant *> activeTenants;  // the front one has the turn
+    size_t numQueuedCommands = 0;
+    size_t sweepThreshold = 64;  // number of tenants for the next sweepIdleTenants()
+
+  protected:
+    void refill(Tenant &tenant, double now) const;
+    bool hasTokens(const Tenant &tenant) const;
+    bool isForgettable(Tenant &tenant, double now) const;
+    void sweepIdleTenants(double now);
+
+  public:
+    CommandQueue() {}
+
+    void configure(double rate, double burst, long quantum, size_t maxQueuedPerTenant);
+
+    // Returns false (and drops the item) if the tenant already has
+    // maxQueuedPerTenant commands queued; urgent items are always accepted
+    bool push(Item &&item);
+
+    // Takes the next item eligible at now; false if every queued item
+    // waits for tokens, or none is queued
+    bool pop(double now, Item &item);
+
+    // Earliest time at or after now when pop() can succeed; infinity if empty
+    double getNextEligibleTime(double now) const;
+
+    bool isEmpty() const { return numQueuedCommands == 0; }
+    size_t getNumQueuedCommands() const { return numQueuedCommands; }
+    void clear();
+};
+
+} // namespace sdn_dashboard
+
+#endif
@@ -0,0 +1,303 @@
+#include "CommandRTScheduler.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iterator>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace sdn_dashboard {
+
+Register_Class(CommandRTScheduler);
+
+Register_GlobalConfigOption(CFGID_COMMANDRTSCHEDULER_SOCKET, "commandrtscheduler-socket", CFG_FILENAME, "results/controller.sock", "When sdn_dashboard::CommandRTScheduler is selected as scheduler class: path of the UNIX-domain socket on which dashboard commands are accepted, one JSON command or batch per line. Empty means no socket.");
+
+CommandRTScheduler::~CommandRTScheduler()
+{
+    endRun();
+}
+
+std::string CommandRTScheduler::str() const
+{
+    return "command-driven " + cRealTimeScheduler::str();
+}
+
+void CommandRTScheduler::configure(cSimulation *simulation, cConfiguration *cfg)
+{
+    cRealTimeScheduler::configure(simulation, cfg);
+    socketPath = cfg->getAsFilename(CFGID_COMMANDRTSCHEDULER_SOCKET);
+}
+
+void CommandRTScheduler::startRun()
+{
+    cRealTimeScheduler::startRun();
+
+    module = nullptr;
+    notificationMsg = nullptr;
+    pendingCommands.clear();
+    fileChanged = false;
+
+    if (!socketPath.empty())
+        setupListener();
+}
+
+void CommandRTScheduler::endRun()
+{
+    while (!connections.empty())
+        closeConnection(connections.size() - 1);
+    if (listenFd >= 0) {
+        close(listenFd);
+        listenFd = -1;
+        unlink(socketPath.c_str());
+    }
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+}
+
+void CommandRTScheduler::setupListener()
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path))
+        throw cRuntimeError("CommandRTScheduler: socket path '%s' is too long", socketPath.c_str());
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+        throw cRuntimeError("CommandRTScheduler: cannot create socket: %s", strerror(errno));
+
+    // a socket file left behind by a previous run would make bind() fail
+    unlink(socketPath.c_str());
+    if (bind(listenFd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+        int err = errno;
+        close(listenFd);
+        listenFd = -1;
+        throw cRuntimeError("CommandRTScheduler: cannot listen on '%s': %s", socketPath.c_str(), strerror(err));
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+}
+
+void CommandRTScheduler::setupFileWatch(const char *commandFile)
+{
+#ifdef __linux__
+    // Watch the directory rather than the file itself: the file may not exist
+    // yet, and writers that replace it by renaming would detach a file watch
+    std::string path = commandFile;
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    watchedFileName = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+        throw cRuntimeError("CommandRTScheduler: inotify_init1() failed: %s", strerror(errno));
+    if (inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        // leave it to the module to check the file (see isWatchingFile())
+        EV_WARN << "CommandRTScheduler: cannot watch directory '" << dir << "': " << strerror(errno) << endl;
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+}
+
+void CommandRTScheduler::setInterfaceModule(cModule *mod, cMessage *notifMsg, const char *commandFile)
+{
+    if (module)
+        throw cRuntimeError("CommandRTScheduler: setInterfaceModule() already called");
+    if (!mod || !notifMsg)
+        throw cRuntimeError("CommandRTScheduler: setInterfaceModule(): arguments must be non-nullptr");
+
+    module = mod;
+    notificationMsg = notifMsg;
+    if (commandFile && *commandFile)
+        setupFileWatch(commandFile);
+
+    // commands may have been queued up before the module registered
+    if (!pendingCommands.empty())
+        notifyModule();
+}
+
+std::vector<std::string> CommandRTScheduler::takeCommands()
+{
+    std::vector<std::string> commands(std::make_move_iterator(pendingCommands.begin()), std::make_move_iterator(pendingCommands.end()));
+    pendingCommands.clear();
+    return commands;
+}
+
+bool CommandRTScheduler::takeFileChanged()
+{
+    bool changed = fileChanged;
+    fileChanged = false;
+    return changed;
+}
+
+void CommandRTScheduler::closeConnection(size_t index)
+{
+    Connection& conn = connections[index];
+    // a client may send its last command without a newline and then close
+    if (conn.buffer.find_first_not_of(" \t\r\n") != std::string::npos)
+        pendingCommands.push_back(std::move(conn.buffer));
+    close(conn.fd);
+    connections.erase(connections.begin() + index);
+}
+
+void CommandRTScheduler::readConnection(size_t index)
+{
+    char buf[4096];
+    ssize_t n = read(connections[index].fd, buf, sizeof(buf));
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        closeConnection(index);
+        return;
+    }
+
+    std::string& buffer = connections[index].buffer;
+    size_t scanFrom = buffer.size();
+    buffer.append(buf, n);
+    size_t lineStart = 0;
+    for (size_t eol; (eol = buffer.find('\n', scanFrom)) != std::string::npos; scanFrom = lineStart = eol + 1)
+        if (buffer.find_first_not_of(" \t\r", lineStart) < eol)
+            pendingCommands.push_back(buffer.substr(lineStart, eol - lineStart));
+    buffer.erase(0, lineStart);
+}
+
+void CommandRTScheduler::readFileEvents()
+{
+#ifdef __linux__
+    alignas(inotify_event) char buf[4096];
+    ssize_t n;
+    while ((n = read(inotifyFd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            const inotify_event *event = (const inotify_event *)p;
+            if (event->len > 0 && watchedFileName == event->name)
+                fileChanged = true;
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+#endif
+}
+
+bool CommandRTScheduler::receiveWithTimeout(long usec)
+{
+    std::vector<pollfd> fds;
+    fds.reserve(connections.size() + 2);
+    if (listenFd >= 0)
+        fds.push_back({listenFd, POLLIN, 0});
+    if (inotifyFd >= 0)
+        fds.push_back({inotifyFd, POLLIN, 0});
+    for (const Connection& conn : connections)
+        fds.push_back({conn.fd, POLLIN, 0});
+
+    int timeoutMs = usec <= 0 ? 0 : (int)std::min((usec + 999) / 1000, (long)INT_MAX);
+    if (fds.empty()) {
+        // nothing to wait on; behave like cRealTimeScheduler
+        if (timeoutMs > 0)
+            usleep(usec);
+        return false;
+    }
+    if (poll(fds.data(), fds.size(), timeoutMs) <= 0)
+        return false;
+
+    // connections first, in reverse so closing one does not shift the rest
+    size_t numFixed = fds.size() - connections.size();
+    for (size_t i = connections.size(); i-- > 0; )
+        if (fds[numFixed + i].revents != 0)
+            readConnection(i);
+    for (size_t i = 0; i < numFixed; i++) {
+        if (fds[i].revents == 0)
+            continue;
+        if (fds[i].fd == inotifyFd)
+            readFileEvents();
+        else {
+            int fd;
+            while ((fd = accept(listenFd, nullptr, nullptr)) >= 0) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                connections.push_back(Connection{fd, std::string()});
+            }
+        }
+    }
+
+    if (pendingCommands.empty() && !fileChanged)
+        return false;
+    notifyModule();
+    return true;
+}
+
+int CommandRTScheduler::receiveUntil(int64_t targetTime, bool hasTarget)
+{
+    // if there's more than 200ms to wait, wait in 100ms chunks
+    // in order to keep UI responsiveness by invoking getEnvir()->idle()
+    int64_t currentTime = opp_get_monotonic_clock_usecs();
+    while (!hasTarget || targetTime - currentTime >= 200000) {
+        if (receiveWithTimeout(100000))  // 100ms
+            return 1;
+        if (getEnvir()->idle())
+            return -1;
+        currentTime = opp_get_monotonic_clock_usecs();
+    }
+
+    // difference is now at most 200ms, do it at once
+    int64_t remaining = targetTime - currentTime;
+    if (remaining > 0 && receiveWithTimeout(remaining))
+        return 1;
+    return 0;
+}
+
+simtime_t CommandRTScheduler::fromUsecs(int64_t usecs)
+{
+    return usecs / (doScaling ? factor * 1000000 : 1000000.0);
+}
+
+void CommandRTScheduler::notifyModule()
+{
+    if (!module || notificationMsg->isScheduled())
+        return;
+    simtime_t eventTime = std::max(fromUsecs(opp_get_monotonic_clock_usecs() - baseTime), sim->getSimTime());
+    notificationMsg->setArrival(module->getId(), -1, eventTime);
+    sim->getFES()->insert(notificationMsg);
+}
+
+cEvent *CommandRTScheduler::guessNextEvent()
+{
+    return sim->getFES()->peekFirst();
+}
+
+cEvent *CommandRTScheduler::takeNextEvent()
+{
+    // with no events left, wait for input instead of ending the simulation
+    cEvent *event = sim->getFES()->peekFirst();
+    int64_t targetTime = event ? baseTime + toUsecs(event->getArrivalTime()) : 0;
+
+    if (!event || targetTime > opp_get_monotonic_clock_usecs()) {
+        int status = receiveUntil(targetTime, event != nullptr);
+        if (status == -1)
+            return nullptr;  // user break
+        if (status == 1)
+            event = sim->getFES()->peekFirst();  // notification inserted
+    }
+    else if (receiveWithTimeout(0)) {
+        // we're behind; still pick up input so it is not starved by a backlog of events
+        event = sim->getFES()->peekFirst();
+    }
+
+    cEvent *tmp = sim->getFES()->removeFirst();
+    ASSERT(tmp == event);
+    return event;
+}
+
+void CommandRTScheduler::putBackEvent(cEvent *event)
+{
+    sim->getFES()->putBackFirst(event);
+}
+
+} // namespace sdn_dashboard
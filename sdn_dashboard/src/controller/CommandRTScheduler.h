@@ -0,0 +1,111 @@
+#ifndef __SDN_DASHBOARD_COMMANDRTSCHEDULER_H
+#define __SDN_DASHBOARD_COMMANDRTSCHEDULER_H
+
+#include <omnetpp.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace omnetpp;
+
+namespace sdn_dashboard {
+
+/**
+ * Real-time scheduler that delivers dashboard commands to the controller
+ * as soon as they arrive, instead of the controller polling the command
+ * file on a timer.
+ *
+ * Commands arrive on two channels:
+ *  - a local UNIX-domain stream socket (commandrtscheduler-socket), carrying
+ *    newline-delimited JSON commands or batches; a connection may also be
+ *    closed right after the last command without a trailing newline;
+ *  - the controller's command file, whose directory is watched with inotify
+ *    (Linux only; see isWatchingFile()).
+ *
+ * While waiting for the next event, the scheduler blocks in poll() on these
+ * descriptors rather than sleeping, so an idle simulation does no work until
+ * input arrives. On arrival, the notification message of the interface module
+ * is inserted into the FES at the current (wall-clock derived) simulation
+ * time, unless it is already pending. The module then collects the input with
+ * takeCommands() and takeFileChanged().
+ *
+ * Usage:
+ * \code
+ * scheduler-class = "sdn_dashboard::CommandRTScheduler"
+ * **.controller.app[0].commandIngestion = "event"
+ * \endcode
+ */
+class CommandRTScheduler : public cRealTimeScheduler
+{
+  protected:
+    struct Connection {
+        int fd;
+        std::string buffer;  // received bytes of the incomplete last line
+    };
+
+    // config
+    std::string socketPath;
+
+    // interface module
+    cModule *module = nullptr;
+    cMessage *notificationMsg = nullptr;
+    std::string watchedFileName;  // file name of the command file within its directory
+
+    // state
+    int listenFd = -1;
+    std::vector<Connection> connections;
+    int inotifyFd = -1;
+    std::deque<std::string> pendingCommands;
+    bool fileChanged = false;
+
+  protected:
+    virtual void startRun() override;
+    virtual void endRun() override;
+    virtual void setupListener();
+    virtual void setupFileWatch(const char *commandFile);
+    virtual void closeConnection(size_t index);
+    virtual void readConnection(size_t index);
+    virtual void readFileEvents();
+    virtual bool receiveWithTimeout(long usec);
+    virtual int receiveUntil(int64_t targetTime, bool hasTarget);
+    virtual void notifyModule();
+    simtime_t fromUsecs(int64_t usecs);
+
+  public:
+    CommandRTScheduler() {}
+    virtual ~CommandRTScheduler();
+
+    virtual std::string str() const override;
+    virtual void configure(cSimulation *simulation, cConfiguration *cfg) override;
+
+    /**
+     * To be called from the controller's initialize(). notificationMsg is
+     * scheduled to the module whenever input arrives; commandFile is the
+     * file to watch for changes (may be nullptr).
+     */
+    virtual void setInterfaceModule(cModule *module, cMessage *notificationMsg, const char *commandFile);
+
+    /**
+     * True if changes of the command file are reported by the scheduler;
+     * otherwise the module has to keep checking the file itself.
+     */
+    bool isWatchingFile() const { return inotifyFd >= 0; }
+
+    /**
+     * Returns the commands received on the socket since the last call.
+     */
+    std::vector<std::string> takeCommands();
+
+    /**
+     * Returns whether the command file was written since the last call.
+     */
+    bool takeFileChanged();
+
+    virtual cEvent *guessNextEvent() override;
+    virtual cEvent *takeNextEvent() override;
+    virtual void putBackEvent(cEvent *event) override;
+};
+
+} // namespace sdn_dashboard
+
+#endif
@@ -0,0 +1,225 @@
+#include "ControllerLoadGenerator.h"
+#include <inet/common/ModuleAccess.h>
+#include <inet/networklayer/common/L3AddressResolver.h>
+#include "SDNController.h"
+#include "StateJournal.h"
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+namespace sdn_dashboard {
+
+Define_Module(ControllerLoadGenerator);
+
+ControllerLoadGenerator::~ControllerLoadGenerator()
+{
+    cancelAndDelete(timer);
+    cancelAndDelete(packetInTimer);
+}
+
+void ControllerLoadGenerator::initialize()
+{
+    controller = getModuleFromPar<SDNControllerApp>(par("controllerModule"), this);
+    numSlices = par("numSlices");
+    hostsPerSlice = par("hostsPerSlice");
+    flowsPerHost = par("flowsPerHost");
+    if (numSlices < 0 || hostsPerSlice <= 0 || flowsPerHost < 0)
+        throw cRuntimeError("numSlices and flowsPerHost must not be negative, hostsPerSlice must be positive");
+    double commandRate = par("commandRate");
+    if (commandRate < 0)
+        throw cRuntimeError("commandRate must not be negative");
+    commandInterval = commandRate > 0 ? SimTime(1 / commandRate) : SIMTIME_ZERO;
+    double packetInRate = par("packetInRate");
+    if (packetInRate < 0)
+        throw cRuntimeError("packetInRate must not be negative");
+    packetInInterval = packetInRate > 0 ? SimTime(1 / packetInRate) : SIMTIME_ZERO;
+    packetInLength = par("packetInLength");
+    packetInTimer = new cMessage("packetIn");
+
+    // Host addresses are assigned during initialization, so the slices are
+    // created by the first event
+    timer = new cMessage("start");
+    scheduleAt(par("startTime"), timer);
+}
+
+void ControllerLoadGenerator::handleMessage(cMessage *msg)
+{
+    if (msg == packetInTimer) {
+        submitNextPacketIn();
+        scheduleAfter(packetInInterval, packetInTimer);
+        return;
+    }
+    if (hostAddresses.empty()) {
+        if (numSlices == 0)
+            return;
+        createSlicesAndFlows();
+        timer->setName("command");
+        measurementStartTime = simTime();
+        if (packetInInterval > SIMTIME_ZERO && !switchNodes.empty())
+            scheduleAfter(packetInInterval, packetInTimer);
+    }
+    else
+        submitNextCommand();
+    if (commandInterval > SIMTIME_ZERO)
+        scheduleAfter(commandInterval, timer);
+}
+
+void ControllerLoadGenerator::createSlicesAndFlows()
+{
+    cModule *parent = getParentModule();
+    const char *hostModule = par("hostModule");
+    for (int i = 0; i < numSlices * hostsPerSlice; i++) {
+        cModule *host = parent->getSubmodule(hostModule, i);
+        L3Address address;
+        if (host == nullptr || !L3AddressResolver().tryResolve(host->getFullPath().c_str(), address, L3AddressResolver::ADDR_IPv4))
+            throw cRuntimeError("Cannot find the IPv4 address of %s[%d]", hostModule, i);
+        hostAddresses.push_back(address.str());
+        hostIpv4Addresses.push_back(address.toIpv4().getInt());
+    }
+    for (cModule::SubmoduleIterator it(parent); !it.end(); ++it)
+        if ((*it)->getSubmodule("macTable") != nullptr)
+            switchNodes.push_back(*it);
+
+    std::ostringstream os;
+    os << "[";
+    for (int s = 0; s < numSlices; s++) {
+        if (s > 0) os << ",";
+        os << "\n{\"type\":\"CREATE_SLICE\",\"data\":{\"name\":\"Slice_" << s << "\",\"vlanId\":" << 100 + s
+           << ",\"bandwidth\":" << par("sliceBandwidth").doubleValue() / 1e6 << ",\"isolated\":true,\"hosts\":[";
+        for (int h = 0; h < hostsPerSlice; h++)
+            os << (h > 0 ? "," : "") << StateJournal::quote(hostAddresses[s * hostsPerSlice + h]);
+        os << "]}}";
+    }
+    os << "]";
+    submit(os.str());
+
+    // The slices are on the shards of their names; a name may already have
+    // been used by the configuration, ours is the last
+    std::map<std::string, int> sliceIdOfName;
+    for (int i = 0; i < controller->getNumShards(); i++) {
+        for (const auto &entry : controller->getShard(i)->getSlices()) {
+            int &sliceId = sliceIdOfName[entry.second.name];
+            sliceId = std::max(sliceId, entry.first);
+        }
+    }
+    for (int s = 0; s < numSlices; s++) {
+        auto it = sliceIdOfName.find("Slice_" + std::to_string(s));
+        if (it == sliceIdOfName.end())
+            throw cRuntimeError("Slices of the load were not created, see the command results");
+        sliceIdOfHost.insert(sliceIdOfHost.end(), hostsPerSlice, it->second);
+    }
+
+    if (flowsPerHost > 0) {
+        os.str("");
+        os << "[";
+        for (int i = 0; i < (int)hostAddresses.size(); i++)
+            for (int j = 0; j < flowsPerHost; j++)
+                os << (i > 0 || j > 0 ? ",\n" : "\n") << makeAddFlowCommand(i);
+        os << "]";
+        submit(os.str());
+    }
+    size_t numFlows = 0;
+    for (int i = 0; i < controller->getNumShards(); i++)
+        numFlows += controller->getShard(i)->getFlowTable().size();
+    EV << "Load created: " << numSlices << " slices of " << hostsPerSlice << " hosts, "
+       << numFlows << " flow rules in total on " << controller->getNumShards() << " shard(s)" << endl;
+}
+
+std::string ControllerLoadGenerator::makeAddFlowCommand(int host)
+{
+    // Towards the other hosts of the slice in turn, on a new UDP port each
+    int first = host - host % hostsPerSlice;
+    int offset = hostsPerSlice > 1 ? 1 + nextDstPort % (hostsPerSlice - 1) : 0;
+    int dst = first + (host - first + offset) % hostsPerSlice;
+    int dstPort = 1024 + nextDstPort++ % 64000;
+    std::ostringstream os;
+    os << "{\"type\":\"ADD_FLOW\",\"data\":{\"srcIP\":" << StateJournal::quote(hostAddresses[host])
+       << ",\"dstIP\":" << StateJournal::quote(hostAddresses[dst]) << ",\"protocol\":17,\"dstPort\":" << dstPort
+       << ",\"action\":\"forward\",\"priority\":200,\"sliceId\":" << sliceIdOfHost[host] << "}}";
+    return os.str();
+}
+
+void ControllerLoadGenerator::submitNextCommand()
+{
+    if (addNext || addedFlowIds.empty()) {
+        // the flow goes to the shard of its slice, which allocates increasing IDs
+        int host = intuniform(0, hostAddresses.size() - 1);
+        const auto &flowTable = controller->getShard(controller->getShardOfId(sliceIdOfHost[host]))->getFlowTable();
+        int lastFlowId = flowTable.empty() ? 0 : flowTable.rbegin()->first;
+        submit(makeAddFlowCommand(host), true);
+        if (!flowTable.empty() && flowTable.rbegin()->first > lastFlowId)
+            addedFlowIds.push_back(flowTable.rbegin()->first);
+    }
+    else {
+        submit("{\"type\":\"DELETE_FLOW\",\"data\":{\"id\":" + std::to_string(addedFlowIds.front()) + "}}", true);
+        addedFlowIds.pop_front();
+    }
+    addNext = !addNext;
+}
+
+void ControllerLoadGenerator::submitNextPacketIn()
+{
+    // A packet between two hosts of a slice, missed by the flow table of a
+    // switch, which asks its shard of the controller
+    int host = intuniform(0, hostAddresses.size() - 1);
+    int first = host - host % hostsPerSlice;
+    PacketKey key;
+    key.srcIp = hostIpv4Addresses[host];
+    key.dstIp = hostIpv4Addresses[first + intuniform(0, hostsPerSlice - 1)];
+    key.protocol = 17;  // UDP
+    key.srcPort = intuniform(1024, 65535);
+    key.dstPort = 5000;
+    cModule *switchNode = switchNodes[intuniform(0, switchNodes.size() - 1)];
+    SDNControllerApp *shard = controller->getShard(controller->getShardOfSwitch(switchNode));
+    simtime_t completionTime;
+    if (!shard->submitPacketIn(switchNode->getId(), key, packetInLength, &completionTime))
+        EV_WARN << "Controller is down, PACKET_IN dropped" << endl;
+    else {
+        packetInCompletionTimes.push_back(completionTime);
+        packetInLatencies.push_back((completionTime - simTime()).dbl());
+    }
+    numPacketIns++;
+}
+
+void ControllerLoadGenerator::submit(const std::string &cmdJson, bool measure)
+{
+    // Commands enter the controller at each shard in turn
+    SDNControllerApp *shard = controller->getShard(numCommands % controller->getNumShards());
+    simtime_t completionTime;
+    if (!shard->submitCommand(cmdJson, &completionTime))
+        EV_WARN << "Controller is down, command dropped" << endl;
+    else if (measure) {
+        commandCompletionTimes.push_back(completionTime);
+        commandLatencies.push_back((completionTime - simTime()).dbl());
+    }
+    numCommands++;
+}
+
+void ControllerLoadGenerator::recordCompletions(const char *name, const std::vector<simtime_t> &completionTimes, std::vector<double> &latencies)
+{
+    // Served by the end of the run, per second since the initial batches
+    long completed = std::count_if(completionTimes.begin(), completionTimes.end(), [](simtime_t t) { return t <= simTime(); });
+    simtime_t duration = simTime() - measurementStartTime;
+    std::string prefix = name;
+    recordScalar((prefix + "sCompleted").c_str(), completed);
+    recordScalar((prefix + "Throughput").c_str(), duration > SIMTIME_ZERO ? completed / duration.dbl() : 0, "1/s");
+    if (latencies.empty())
+        return;
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double latency : latencies)
+        sum += latency;
+    recordScalar((prefix + "Latency").c_str(), sum / latencies.size(), "s");
+    recordScalar((prefix + "LatencyP99").c_str(), latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)], "s");
+}
+
+void ControllerLoadGenerator::finish()
+{
+    recordScalar("commandsSubmitted", numCommands);
+    recordScalar("packetInsSubmitted", numPacketIns);
+    recordCompletions("command", commandCompletionTimes, commandLatencies);
+    if (packetInInterval > SIMTIME_ZERO)
+        recordCompletions("packetIn", packetInCompletionTimes, packetInLatencies);
+}
+
+} // namespace sdn_dashboard
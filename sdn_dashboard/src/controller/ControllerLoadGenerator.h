@@ -0,0 +1,71 @@
+#ifndef __SDN_DASHBOARD_CONTROLLERLOADGENERATOR_H
+#define __SDN_DASHBOARD_CONTROLLERLOADGENERATOR_H
+
+#include <omnetpp.h>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace omnetpp;
+
+namespace sdn_dashboard {
+
+class SDNControllerApp;
+
+/**
+ * Creates slices and flow rules on the controller and keeps submitting
+ * commands and PACKET_INs at fixed rates, for measuring how the controller
+ * scales, also across shards. See ControllerLoadGenerator.ned.
+ */
+class ControllerLoadGenerator : public cSimpleModule
+{
+  protected:
+    // config
+    SDNControllerApp *controller = nullptr;
+    int numSlices = 0;
+    int hostsPerSlice = 0;
+    int flowsPerHost = 0;
+    simtime_t commandInterval;  // zero if no commands after the initial batches
+    simtime_t packetInInterval;  // zero if no PACKET_INs
+    int packetInLength = 0;
+
+    // state
+    std::vector<std::string> hostAddresses;
+    std::vector<uint32_t> hostIpv4Addresses;
+    std::vector<int> sliceIdOfHost;
+    std::vector<cModule *> switchNodes;
+    std::deque<int> addedFlowIds;  // by the periodic commands, oldest first
+    bool addNext = true;
+    int nextDstPort = 0;
+    long numCommands = 0;
+    long numPacketIns = 0;
+    cMessage *timer = nullptr;
+    cMessage *packetInTimer = nullptr;
+
+    // statistics of the periodic commands and the PACKET_INs
+    simtime_t measurementStartTime;
+    std::vector<simtime_t> commandCompletionTimes;
+    std::vector<simtime_t> packetInCompletionTimes;
+    std::vector<double> commandLatencies;
+    std::vector<double> packetInLatencies;
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+    virtual void createSlicesAndFlows();
+    virtual void submitNextCommand();
+    virtual void submitNextPacketIn();
+    std::string makeAddFlowCommand(int host);
+    void submit(const std::string &cmdJson, bool measure = false);
+    void recordCompletions(const char *name, const std::vector<simtime_t> &completionTimes, std::vector<double> &latencies);
+
+  public:
+    virtual ~ControllerLoadGenerator();
+};
+
+} // namespace sdn_dashboard
+
+#endif
@@ -0,0 +1,302 @@
+#include "FlowClassifier.h"
+#include <algorithm>
+
+namespace sdn_dashboard {
+
+void FlowClassifier::KeyTable::rehash(size_t capacity)
+{
+    std::vector<Slot> old;
+    old.swap(slots);
+    slots.resize(capacity);
+    count = used = 0;
+    for (const Slot &slot : old)
+        if (slot.head >= 0)
+            insert(slot.key, slot.head);
+}
+
+int *FlowClassifier::KeyTable::find(const PacketKey &key)
+{
+    if (slots.empty())
+        return nullptr;
+    size_t mask = slots.size() - 1;
+    for (size_t i = PacketKeyHash()(key) & mask; ; i = (i + 1) & mask) {
+        Slot &slot = slots[i];
+        if (slot.head == EMPTY)
+            return nullptr;
+        if (slot.head >= 0 && slot.key == key)
+            return &slot.head;
+    }
+}
+
+void FlowClassifier::KeyTable::insert(const PacketKey &key, int head)
+{
+    if (int *existing = find(key)) {
+        *existing = head;
+        return;
+    }
+    // Keep the table at most half full (counting tombstones) so probe runs stay short
+    if (2 * (used + 1) > slots.size()) {
+        size_t capacity = 16;
+        while (capacity < 4 * (count + 1))
+            capacity *= 2;
+        rehash(capacity);
+    }
+    size_t mask = slots.size() - 1;
+    size_t i = PacketKeyHash()(key) & mask;
+    while (slots[i].head >= 0)
+        i = (i + 1) & mask;
+    if (slots[i].head == EMPTY)
+        used++;
+    slots[i].key = key;
+    slots[i].head = head;
+    count++;
+}
+
+void FlowClassifier::KeyTable::erase(const PacketKey &key)
+{
+    if (int *head = find(key)) {
+        *head = DELETED;
+        count--;
+    }
+}
+
+uint32_t FlowClassifier::shapeId(const FlowMatch &match)
+{
+    return match.srcPrefixLen | (match.dstPrefixLen << 6)
+         | ((match.srcPort != 0) << 12) | ((match.dstPort != 0) << 13) | ((match.protocol != 0) << 14);
+}
+
+PacketKey FlowClassifier::applyMask(const PacketKey &key, const PacketKey &mask)
+{
+    PacketKey masked;
+    masked.srcIp = key.srcIp & mask.srcIp;
+    masked.dstIp = key.dstIp & mask.dstIp;
+    masked.srcPort = key.srcPort & mask.srcPort;
+    masked.dstPort = key.dstPort & mask.dstPort;
+    masked.protocol = key.protocol & mask.protocol;
+    return masked;
+}
+
+int FlowClassifier::findOrCreateTuple(const FlowMatch &match)
+{
+    uint32_t id = shapeId(match);
+    auto it = tupleByShape.find(id);
+    if (it != tupleByShape.end())
+        return it->second;
+
+    Tuple tuple;
+    tuple.shape = match;
+    tuple.mask.srcIp = prefixMask(match.srcPrefixLen);
+    tuple.mask.dstIp = prefixMask(match.dstPrefixLen);
+    tuple.mask.srcPort = match.srcPort != 0 ? 0xFFFF : 0;
+    tuple.mask.dstPort = match.dstPort != 0 ? 0xFFFF : 0;
+    tuple.mask.protocol = match.protocol != 0 ? 0xFF : 0;
+    tuples.push_back(std::move(tuple));
+
+    int index = tuples.size() - 1;
+    tupleByShape[id] = index;
+    tupleOrder.push_back(index);
+    return index;
+}
+
+void FlowClassifier::sortTuples()
+{
+    // Few tuples exist even for very large tables, so a full sort is cheap
+    std::stable_sort(tupleOrder.begin(), tupleOrder.end(), [this](int a, int b) {
+        return tuples[a].maxPriority > tuples[b].maxPriority;
+    });
+}
+
+void FlowClassifier::insert(int flowId, int priority, const FlowMatch &match)
+{
+    if (locations.count(flowId))
+        remove(flowId);
+
+    int tupleIndex = findOrCreateTuple(match);
+    Tuple &tuple = tuples[tupleIndex];
+
+    PacketKey key;
+    key.srcIp = match.srcIp;
+    key.dstIp = match.dstIp;
+    key.srcPort = match.srcPort;
+    key.dstPort = match.dstPort;
+    key.protocol = match.protocol;
+    PacketKey maskedKey = applyMask(key, tuple.mask);
+
+    int entryIndex;
+    if (!freeEntries.empty()) {
+        entryIndex = freeEntries.back();
+        freeEntries.pop_back();
+    }
+    else {
+        entryIndex = entries.size();
+        entries.push_back(Entry());
+    }
+    entries[entryIndex].flowId = flowId;
+    entries[entryIndex].priority = priority;
+
+    // Keep each chain ordered so its head is always the winning rule
+    int *head = tuple.heads.find(maskedKey);
+    if (!head) {
+        entries[entryIndex].next = -1;
+        tuple.heads.insert(maskedKey, entryIndex);
+    }
+    else if (better(priority, flowId, entries[*head].priority, entries[*head].flowId)) {
+        entries[entryIndex].next = *head;
+        *head = entryIndex;
+    }
+    else {
+        int prev = *head;
+        while (entries[prev].next != -1 && !better(priority, flowId, entries[entries[prev].next].priority, entries[entries[prev].next].flowId))
+            prev = entries[prev].next;
+        entries[entryIndex].next = entries[prev].next;
+        entries[prev].next = entryIndex;
+    }
+
+    int oldMax = tuple.maxPriority;
+    tuple.priorityCounts[priority]++;
+    tuple.updateMaxPriority();
+    if (tuple.maxPriority != oldMax)
+        sortTuples();
+
+    locations[flowId] = Location{tupleIndex, maskedKey};
+}
+
+bool FlowClassifier::remove(int flowId)
+{
+    auto locIt = locations.find(flowId);
+    if (locIt == locations.end())
+        return false;
+
+    Tuple &tuple = tuples[locIt->second.tupleIndex];
+    int *head = tuple.heads.find(locIt->second.maskedKey);
+    int prev = -1;
+    int cur = *head;
+    while (entries[cur].flowId != flowId) {
+        prev = cur;
+        cur = entries[cur].next;
+    }
+    int priority = entries[cur].priority;
+    if (prev == -1) {
+        if (entries[cur].next == -1)
+            tuple.heads.erase(locIt->second.maskedKey);
+        else
+            *head = entries[cur].next;
+    }
+    else
+        entries[prev].next = entries[cur].next;
+    freeEntries.push_back(cur);
+
+    int oldMax = tuple.maxPriority;
+    auto countIt = tuple.priorityCounts.find(priority);
+    if (--countIt->second == 0)
+        tuple.priorityCounts.erase(countIt);
+    tuple.updateMaxPriority();
+    if (tuple.maxPriority != oldMax)
+        sortTuples();
+
+    locations.erase(locIt);
+    return true;
+}
+
+void FlowClassifier::clear()
+{
+    entries.clear();
+    freeEntries.clear();
+    tuples.clear();
+    tupleOrder.clear();
+    tupleByShape.clear();
+    locations.clear();
+}
+
+int FlowClassifier::lookup(const PacketKey &key) const
+{
+    int bestFlowId = -1;
+    int bestPriority = INT32_MIN;
+    for (int index : tupleOrder) {
+        const Tuple &tuple = tuples[index];
+        if (tuple.heads.empty())
+            continue;
+        // Tuples are sorted by their best rule, so nothing later can win
+        if (bestFlowId != -1 && tuple.maxPriority < bestPriority)
+            break;
+        const int *headIndex = tuple.heads.find(applyMask(key, tuple.mask));
+        if (!headIndex)
+            continue;
+        const Entry &head = entries[*headIndex];
+        if (bestFlowId == -1 || better(head.priority, head.flowId, bestPriority, bestFlowId)) {
+            bestFlowId = head.flowId;
+            bestPriority = head.priority;
+        }
+    }
+    return bestFlowId;
+}
+
+// Parses the decimal number at s, of digits only (no sign or spaces,
+// unlike strtol), up to maxValue; advances s past it
+static bool parseDecimal(const char *&s, int maxValue, int &value)
+{
+    const char *start = s;
+    value = 0;
+    for (; *s >= '0' && *s <= '9'; s++) {
+        value = value * 10 + (*s - '0');
+        if (value > maxValue)
+            return false;
+    }
+    return s != start;
+}
+
+bool FlowClassifier::parseIpv4(const std::string &text, uint32_t &addr)
+{
+    uint32_t result = 0;
+    const char *s = text.c_str();
+    for (int i = 0; i < 4; i++) {
+        int octet;
+        if (!parseDecimal(s, 255, octet))
+            return false;
+        result = (result << 8) | (uint32_t)octet;
+        if (*s != (i < 3 ? '.' : '\0'))
+            return false;
+        s++;
+    }
+    addr = result;
+    return true;
+}
+
+bool FlowClassifier::parsePrefix(const std::string &text, uint32_t &addr, uint8_t &prefixLen)
+{
+    // "" and "*" are wildcards; "a.b.c.d" is a host route; "a.b.c.d/n" a prefix
+    if (text.empty() || text == "*" || text == "any") {
+        addr = 0;
+        prefixLen = 0;
+        return true;
+    }
+    size_t slash = text.find('/');
+    int len = 32;
+    if (slash != std::string::npos) {
+        // "a.b.c.d/" is an error, not a /0
+        const char *s = text.c_str() + slash + 1;
+        if (!parseDecimal(s, 32, len) || *s != '\0')
+            return false;
+    }
+    if (!parseIpv4(text.substr(0, slash), addr))
+        return false;
+    prefixLen = len;
+    addr &= prefixMask(len);
+    return true;
+}
+
+bool FlowClassifier::makeMatch(const std::string &srcIP, const std::string &dstIP,
+                               int srcPort, int dstPort, int protocol, FlowMatch &match)
+{
+    if (!parsePrefix(srcIP, match.srcIp, match.srcPrefixLen) || !parsePrefix(dstIP, match.dstIp, match.dstPrefixLen))
+        return false;
+    if (srcPort < 0 || srcPort > 0xFFFF || dstPort < 0 || dstPort > 0xFFFF || protocol < 0 || protocol > 0xFF)
+        return false;
+    match.srcPort = srcPort;
+    match.dstPort = dstPort;
+    match.protocol = protocol;
+    return true;
+}
+
+} // namespace sdn_dashboard
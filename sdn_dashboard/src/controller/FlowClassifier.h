@@ -0,0 +1,145 @@
+#ifndef __SDN_DASHBOARD_FLOWCLASSIFIER_H
+#define __SDN_DASHBOARD_FLOWCLASSIFIER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sdn_dashboard {
+
+// Packed 5-tuple of a packet header, all fields in host byte order
+struct PacketKey {
+    uint32_t srcIp = 0;
+    uint32_t dstIp = 0;
+    uint16_t srcPort = 0;
+    uint16_t dstPort = 0;
+    uint8_t protocol = 0;
+
+    bool operator==(const PacketKey &other) const {
+        return srcIp == other.srcIp && dstIp == other.dstIp && srcPort == other.srcPort
+            && dstPort == other.dstPort && protocol == other.protocol;
+    }
+};
+
+struct PacketKeyHash {
+    size_t operator()(const PacketKey &key) const {
+        // murmur3 finalizer over both halves of the packed key
+        uint64_t h = (((uint64_t)key.srcIp << 32) | key.dstIp)
+                   ^ ((((uint64_t)key.srcPort << 24) | ((uint64_t)key.dstPort << 8) | key.protocol) * 0x9E3779B97F4A7C15ULL);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return (size_t)h;
+    }
+};
+
+// Match part of a flow rule: IP prefixes plus exact-or-wildcard ports/protocol
+struct FlowMatch {
+    uint32_t srcIp = 0;
+    uint32_t dstIp = 0;
+    uint8_t srcPrefixLen = 0;   // 0 = any source
+    uint8_t dstPrefixLen = 0;   // 0 = any destination
+    uint16_t srcPort = 0;       // 0 = any port
+    uint16_t dstPort = 0;       // 0 = any port
+    uint8_t protocol = 0;       // 0 = any protocol
+};
+
+/**
+ * Multi-field packet classifier for the controller's flow table.
+ *
+ * Uses tuple space search: rules are grouped by the shape of their match
+ * (prefix lengths and which of port/protocol fields are wildcarded), and
+ * each group is an exact-match hash table over the masked 5-tuple. A lookup
+ * probes the groups in decreasing order of their highest rule priority and
+ * stops as soon as no remaining group can beat the best match found so far.
+ * Ties between equal-priority rules go to the lowest flow ID.
+ */
+class FlowClassifier
+{
+  private:
+    struct Entry {
+        int flowId;
+        int priority;
+        int next;           // next entry with the same masked key, or -1
+    };
+
+    // Open-addressing hash table from masked key to the head of its entry chain;
+    // keeps the probe sequence within a few cache lines on the lookup path
+    class KeyTable {
+      private:
+        enum { EMPTY = -1, DELETED = -2 };
+        struct Slot {
+            PacketKey key;
+            int head = EMPTY;
+        };
+        std::vector<Slot> slots;
+        size_t count = 0;
+        size_t used = 0;   // live + deleted slots
+        void rehash(size_t capacity);
+      public:
+        bool empty() const { return count == 0; }
+        size_t size() const { return count; }
+        int *find(const PacketKey &key);
+        const int *find(const PacketKey &key) const { return const_cast<KeyTable *>(this)->find(key); }
+        void insert(const PacketKey &key, int head);
+        void erase(const PacketKey &key);
+    };
+
+    struct Tuple {
+        FlowMatch shape;    // only the prefix lengths and wildcard flags are used
+        PacketKey mask;
+        KeyTable heads;     // masked key -> first entry
+        std::map<int, int> priorityCounts;  // priority -> number of rules
+        int maxPriority = INT32_MIN;        // cached from priorityCounts for the lookup path
+        void updateMaxPriority() { maxPriority = priorityCounts.empty() ? INT32_MIN : priorityCounts.rbegin()->first; }
+    };
+
+    struct Location {
+        int tupleIndex;
+        PacketKey maskedKey;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<int> freeEntries;
+    std::vector<Tuple> tuples;
+    std::vector<int> tupleOrder;  // tuple indices by decreasing maxPriority
+    std::unordered_map<uint32_t, int> tupleByShape;
+    std::unordered_map<int, Location> locations;  // flowId -> where it is stored
+
+  protected:
+    static uint32_t prefixMask(int len) { return len == 0 ? 0 : 0xFFFFFFFFu << (32 - len); }
+    static uint32_t shapeId(const FlowMatch &match);
+    static PacketKey applyMask(const PacketKey &key, const PacketKey &mask);
+    int findOrCreateTuple(const FlowMatch &match);
+    void sortTuples();
+    static bool better(int priority, int flowId, int bestPriority, int bestFlowId) {
+        return priority > bestPriority || (priority == bestPriority && flowId < bestFlowId);
+    }
+
+  public:
+    FlowClassifier() {}
+
+    void insert(int flowId, int priority, const FlowMatch &match);
+    bool remove(int flowId);
+    void clear();
+
+    // Returns the flow ID of the highest-priority matching rule, or -1
+    int lookup(const PacketKey &key) const;
+
+    size_t size() const { return locations.size(); }
+    size_t getNumTuples() const { return tupleOrder.size(); }
+
+    // Helpers for converting the string-based FlowRule fields
+    static bool parseIpv4(const std::string &text, uint32_t &addr);
+    static bool parsePrefix(const std::string &text, uint32_t &addr, uint8_t &prefixLen);
+    static bool makeMatch(const std::string &srcIP, const std::string &dstIP,
+                          int srcPort, int dstPort, int protocol, FlowMatch &match);
+};
+
+} // namespace sdn_dashboard
+
+#endif
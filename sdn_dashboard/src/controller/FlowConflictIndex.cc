@@ -0,0 +1,277 @@
+#include "FlowConflictIndex.h"
+#include <algorithm>
+
+namespace sdn_dashboard {
+
+static inline uint32_t prefixMask(int len)
+{
+    return len == 0 ? 0 : 0xFFFFFFFFu << (32 - len);
+}
+
+static inline int prefixBit(uint32_t addr, int depth)
+{
+    return (addr >> (31 - depth)) & 1;
+}
+
+void FlowConflictIndex::link(int r, int index, List &list)
+{
+    rules[r].prev[index] = -1;
+    rules[r].next[index] = list.head;
+    if (list.head >= 0)
+        rules[list.head].prev[index] = r;
+    list.head = r;
+    list.count++;
+}
+
+void FlowConflictIndex::unlink(int r, int index, List &list)
+{
+    Rule &rule = rules[r];
+    if (rule.prev[index] >= 0)
+        rules[rule.prev[index]].next[index] = rule.next[index];
+    else
+        list.head = rule.next[index];
+    if (rule.next[index] >= 0)
+        rules[rule.next[index]].prev[index] = rule.prev[index];
+    list.count--;
+}
+
+int FlowConflictIndex::insertPrefix(int trie, uint32_t addr, int len)
+{
+    std::vector<TrieNode> &nodes = tries[trie];
+    int n = 0;
+    nodes[n].subtreeCount++;
+    for (int depth = 0; depth < len; depth++) {
+        int bit = prefixBit(addr, depth);
+        if (nodes[n].child[bit] < 0) {
+            nodes[n].child[bit] = nodes.size();
+            nodes.emplace_back();
+        }
+        n = nodes[n].child[bit];
+        nodes[n].subtreeCount++;
+    }
+    return n;
+}
+
+void FlowConflictIndex::removePrefix(int trie, uint32_t addr, int len)
+{
+    // The nodes stay when they become empty, to be reused by later rules
+    std::vector<TrieNode> &nodes = tries[trie];
+    int n = 0;
+    nodes[n].subtreeCount--;
+    for (int depth = 0; depth < len; depth++) {
+        n = nodes[n].child[prefixBit(addr, depth)];
+        nodes[n].subtreeCount--;
+    }
+}
+
+int FlowConflictIndex::countOverlapping(int trie, uint32_t addr, int len) const
+{
+    // The rules of the shorter prefixes on the path, plus all below the prefix
+    const std::vector<TrieNode> &nodes = tries[trie];
+    int count = 0;
+    int n = 0;
+    for (int depth = 0; depth < len; depth++) {
+        count += nodes[n].rules.count;
+        n = nodes[n].child[prefixBit(addr, depth)];
+        if (n < 0)
+            return count;
+    }
+    return count + nodes[n].subtreeCount;
+}
+
+void FlowConflictIndex::collectOverlapping(int trie, uint32_t addr, int len)
+{
+    const std::vector<TrieNode> &nodes = tries[trie];
+    int index = trie;  // SRC or DST
+    int n = 0;
+    for (int depth = 0; depth < len; depth++) {
+        collectList(nodes[n].rules, index);
+        n = nodes[n].child[prefixBit(addr, depth)];
+        if (n < 0)
+            return;
+    }
+    std::vector<int> stack(1, n);
+    while (!stack.empty()) {
+        const TrieNode &node = nodes[stack.back()];
+        stack.pop_back();
+        collectList(node.rules, index);
+        for (int child : node.child)
+            if (child >= 0 && nodes[child].subtreeCount > 0)
+                stack.push_back(child);
+    }
+}
+
+void FlowConflictIndex::collectList(const List &list, int index)
+{
+    for (int r = list.head; r >= 0; r = rules[r].next[index])
+        candidates.push_back(r);
+}
+
+void FlowConflictIndex::addAnomaly(int flowId, int otherFlowId, AnomalyKind kind)
+{
+    anomalies[flowId].push_back(Anomaly{otherFlowId, kind});
+}
+
+bool FlowConflictIndex::overlaps(const FlowMatch &a, const FlowMatch &b)
+{
+    return ((a.srcIp ^ b.srcIp) & prefixMask(std::min(a.srcPrefixLen, b.srcPrefixLen))) == 0
+        && ((a.dstIp ^ b.dstIp) & prefixMask(std::min(a.dstPrefixLen, b.dstPrefixLen))) == 0
+        && (a.srcPort == 0 || b.srcPort == 0 || a.srcPort == b.srcPort)
+        && (a.dstPort == 0 || b.dstPort == 0 || a.dstPort == b.dstPort)
+        && (a.protocol == 0 || b.protocol == 0 || a.protocol == b.protocol);
+}
+
+bool FlowConflictIndex::covers(const FlowMatch &a, const FlowMatch &b)
+{
+    return a.srcPrefixLen <= b.srcPrefixLen && ((a.srcIp ^ b.srcIp) & prefixMask(a.srcPrefixLen)) == 0
+        && a.dstPrefixLen <= b.dstPrefixLen && ((a.dstIp ^ b.dstIp) & prefixMask(a.dstPrefixLen)) == 0
+        && (a.srcPort == 0 || a.srcPort == b.srcPort)
+        && (a.dstPort == 0 || a.dstPort == b.dstPort)
+        && (a.protocol == 0 || a.protocol == b.protocol);
+}
+
+int FlowConflictIndex::insert(int flowId, int priority, uint64_t action, const FlowMatch &match)
+{
+    remove(flowId);
+    FlowMatch m = match;
+    m.srcIp &= prefixMask(m.srcPrefixLen);
+    m.dstIp &= prefixMask(m.dstPrefixLen);
+
+    // Candidates from the index that yields the fewest
+    int srcCount = countOverlapping(SRC, m.srcIp, m.srcPrefixLen);
+    int dstCount = countOverlapping(DST, m.dstIp, m.dstPrefixLen);
+    auto wildcardPorts = portBuckets.find(0);
+    auto samePort = m.dstPort != 0 ? portBuckets.find(m.dstPort) : portBuckets.end();
+    int portCount = m.dstPort == 0 ? (int)size()
+            : (wildcardPorts != portBuckets.end() ? wildcardPorts->second.count : 0) + (samePort != portBuckets.end() ? samePort->second.count : 0);
+    candidates.clear();
+    if (srcCount <= dstCount && srcCount <= portCount)
+        collectOverlapping(SRC, m.srcIp, m.srcPrefixLen);
+    else if (dstCount <= portCount)
+        collectOverlapping(DST, m.dstIp, m.dstPrefixLen);
+    else {
+        if (wildcardPorts != portBuckets.end())
+            collectList(wildcardPorts->second, PORT);
+        if (samePort != portBuckets.end())
+            collectList(samePort->second, PORT);
+    }
+
+    int found = 0;
+    for (int c : candidates) {
+        const Rule &other = rules[c];
+        numComparisons++;
+        if (!overlaps(m, other.match))
+            continue;
+        bool wins = priority > other.priority || (priority == other.priority && flowId < other.flowId);
+        if (!wins && covers(other.match, m)) {
+            addAnomaly(flowId, other.flowId, SHADOWED_BY);
+            addAnomaly(other.flowId, flowId, SHADOWS);
+        }
+        else if (wins && covers(m, other.match)) {
+            addAnomaly(other.flowId, flowId, SHADOWED_BY);
+            addAnomaly(flowId, other.flowId, SHADOWS);
+        }
+        else if (priority == other.priority && action != other.action) {
+            addAnomaly(flowId, other.flowId, CONFLICTS_WITH);
+            addAnomaly(other.flowId, flowId, CONFLICTS_WITH);
+        }
+        else
+            continue;
+        found++;
+    }
+
+    int r;
+    if (!freeRules.empty()) {
+        r = freeRules.back();
+        freeRules.pop_back();
+    }
+    else {
+        r = rules.size();
+        rules.emplace_back();
+    }
+    Rule &rule = rules[r];
+    rule.flowId = flowId;
+    rule.priority = priority;
+    rule.action = action;
+    rule.match = m;
+    rule.node[SRC] = insertPrefix(SRC, m.srcIp, m.srcPrefixLen);
+    rule.node[DST] = insertPrefix(DST, m.dstIp, m.dstPrefixLen);
+    link(r, SRC, tries[SRC][rule.node[SRC]].rules);
+    link(r, DST, tries[DST][rule.node[DST]].rules);
+    link(r, PORT, portBuckets[m.dstPort]);
+    ruleOfFlow[flowId] = r;
+    return found;
+}
+
+bool FlowConflictIndex::remove(int flowId)
+{
+    auto it = ruleOfFlow.find(flowId);
+    if (it == ruleOfFlow.end())
+        return false;
+    int r = it->second;
+    Rule &rule = rules[r];
+    unlink(r, SRC, tries[SRC][rule.node[SRC]].rules);
+    unlink(r, DST, tries[DST][rule.node[DST]].rules);
+    removePrefix(SRC, rule.match.srcIp, rule.match.srcPrefixLen);
+    removePrefix(DST, rule.match.dstIp, rule.match.dstPrefixLen);
+    auto bucket = portBuckets.find(rule.match.dstPort);
+    unlink(r, PORT, bucket->second);
+    if (bucket->second.count == 0)
+        portBuckets.erase(bucket);
+    rule.flowId = -1;
+    freeRules.push_back(r);
+    ruleOfFlow.erase(it);
+
+    auto own = anomalies.find(flowId);
+    if (own != anomalies.end()) {
+        for (const Anomaly &anomaly : own->second) {
+            auto other = anomalies.find(anomaly.otherFlowId);
+            if (other == anomalies.end())
+                continue;
+            std::vector<Anomaly> &list = other->second;
+            list.erase(std::remove_if(list.begin(), list.end(), [flowId](const Anomaly &a) { return a.otherFlowId == flowId; }), list.end());
+            if (list.empty())
+                anomalies.erase(other);
+        }
+        anomalies.erase(own);
+    }
+    return true;
+}
+
+void FlowConflictIndex::clear()
+{
+    rules.clear();
+    freeRules.clear();
+    ruleOfFlow.clear();
+    for (std::vector<TrieNode> &nodes : tries)
+        nodes.assign(1, TrieNode());
+    portBuckets.clear();
+    anomalies.clear();
+    numComparisons = 0;
+}
+
+const std::vector<FlowConflictIndex::Anomaly>& FlowConflictIndex::getAnomalies(int flowId) const
+{
+    static const std::vector<Anomaly> none;
+    auto it = anomalies.find(flowId);
+    return it != anomalies.end() ? it->second : none;
+}
+
+size_t FlowConflictIndex::getNumShadowedRules() const
+{
+    size_t count = 0;
+    for (const auto &entry : anomalies)
+        if (std::any_of(entry.second.begin(), entry.second.end(), [](const Anomaly &a) { return a.kind == SHADOWED_BY; }))
+            count++;
+    return count;
+}
+
+size_t FlowConflictIndex::getNumConflicts() const
+{
+    size_t count = 0;
+    for (const auto &entry : anomalies)
+        count += std::count_if(entry.second.begin(), entry.second.end(), [](const Anomaly &a) { return a.kind == CONFLICTS_WITH; });
+    return count / 2;
+}
+
+} // namespace sdn_dashboard
@@ -0,0 +1,115 @@
+#ifndef __SDN_DASHBOARD_FLOWCONFLICTINDEX_H
+#define __SDN_DASHBOARD_FLOWCONFLICTINDEX_H
+
+#include "FlowClassifier.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace sdn_dashboard {
+
+/**
+ * Conflict and shadowing analysis of a flow table, done incrementally as
+ * rules are inserted.
+ *
+ * Two rules overlap if some packet matches both. Of two overlapping rules,
+ * the one that wins the lookup (higher priority, then lower flow ID, as in
+ * FlowClassifier) shadows the other if its match covers the other's
+ * completely: the other rule never matches. Overlapping rules of the same
+ * priority with different actions conflict: which one applies depends only
+ * on the order of their flow IDs. Partial overlaps between priorities are
+ * how priorities are meant to be used, and are not reported. A rule covered
+ * only by several rules together is not detected as shadowed.
+ *
+ * A new rule is compared only with the rules that can overlap it, found
+ * through one of three indexes: binary prefix tries over the source and
+ * destination prefixes (the rules at the ancestors of the new prefix plus
+ * those in its subtree), and buckets by destination port (the rules with
+ * that port plus the wildcards; ports are exact values or wildcards, i.e.
+ * one-point or full intervals). Each trie node counts the rules below it,
+ * so the index with the fewest candidates is chosen before visiting any.
+ */
+class FlowConflictIndex
+{
+  public:
+    enum AnomalyKind {
+        SHADOWED_BY = 1,     // the other rule covers this one and wins: this one never matches
+        SHADOWS = 2,         // the reverse
+        CONFLICTS_WITH = 3   // same priority, overlapping, different actions
+    };
+
+    struct Anomaly {
+        int otherFlowId;
+        AnomalyKind kind;
+    };
+
+  private:
+    enum { SRC = 0, DST = 1, PORT = 2, NUM_INDEXES = 3 };
+
+    struct Rule {
+        int flowId = -1;     // -1 if free
+        int priority;
+        uint64_t action;
+        FlowMatch match;
+        int node[2];         // of the source and destination tries
+        int prev[NUM_INDEXES];
+        int next[NUM_INDEXES];
+    };
+
+    struct List {
+        int head = -1;
+        int count = 0;
+    };
+
+    struct TrieNode {
+        int child[2] = {-1, -1};
+        int subtreeCount = 0;   // rules at this node and below
+        List rules;             // rules with exactly this prefix
+    };
+
+    std::vector<Rule> rules;     // pool, linked into the lists of the indexes
+    std::vector<int> freeRules;
+    std::unordered_map<int, int> ruleOfFlow;
+    std::vector<TrieNode> tries[2];     // root is node 0
+    std::unordered_map<int, List> portBuckets;   // dstPort -> rules, 0: wildcards
+    std::unordered_map<int, std::vector<Anomaly>> anomalies;   // flowId -> its anomalies
+    std::vector<int> candidates;
+    size_t numComparisons = 0;
+
+  protected:
+    void link(int r, int index, List &list);
+    void unlink(int r, int index, List &list);
+    int insertPrefix(int trie, uint32_t addr, int len);
+    void removePrefix(int trie, uint32_t addr, int len);
+    int countOverlapping(int trie, uint32_t addr, int len) const;
+    void collectOverlapping(int trie, uint32_t addr, int len);
+    void collectList(const List &list, int index);
+    void addAnomaly(int flowId, int otherFlowId, AnomalyKind kind);
+    static bool overlaps(const FlowMatch &a, const FlowMatch &b);
+    static bool covers(const FlowMatch &a, const FlowMatch &b);
+
+  public:
+    FlowConflictIndex() { clear(); }
+
+    // Adds the rule and returns the number of anomalies found with the
+    // rules already present (see getAnomalies()). action identifies what
+    // the rule does; rules with equal action values do not conflict.
+    int insert(int flowId, int priority, uint64_t action, const FlowMatch &match);
+
+    // Removes the rule and the anomalies it was part of
+    bool remove(int flowId);
+    void clear();
+
+    size_t size() const { return ruleOfFlow.size(); }
+    const std::vector<Anomaly>& getAnomalies(int flowId) const;
+    size_t getNumShadowedRules() const;
+    size_t getNumConflicts() const;    // pairs of conflicting rules
+
+    // Rules compared with a new one so far, for benchmarking
+    size_t getNumComparisons() const { return numComparisons; }
+};
+
+} // namespace sdn_dashboard
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef __SDN_DASHBOARD_FLOWCOUNTERS_H
+#define __SDN_DASHBOARD_FLOWCOUNTERS_H
+
+#include <cstdint>
+#include <vector>
+
+namespace sdn_dashboard {
+
+/**
+ * Packet and byte counters of flow rules, as kept by the ports of one switch
+ * for the packets they matched since the controller last collected them.
+ *
+ * Rules are identified by a counter slot that the controller assigns to
+ * each installed rule; slots are small and reused, so the counters are two
+ * dense arrays indexed by slot rather than a map. Counting a packet costs
+ * two array increments, plus remembering the slot the first time it is hit
+ * after a collection, so that collecting visits only the slots that
+ * actually counted something.
+ *
+ * A packet is counted once, however many ports send it: the copies of a
+ * flooded packet share the tree ID of the original (cMessage::getTreeId()),
+ * and each slot remembers the tree ID of the last packet it counted, so a
+ * copy sent at another port of the switch is not counted again.
+ *
+ * Each table is written only by the ports of its switch and read only by
+ * the controller's periodic collection, all in the simulation's single
+ * thread, so no synchronization is involved.
+ */
+class FlowCounterTable
+{
+  private:
+    std::vector<uint64_t> packets;   // by slot
+    std::vector<uint64_t> bytes;     // by slot
+    std::vector<int64_t> lastTreeIds;  // by slot, of the packet counted last; -1 if none
+    std::vector<int> dirtySlots;     // slots counted since the last collect()
+    int switchId;                    // module ID of the switch node
+
+  public:
+    explicit FlowCounterTable(int switchId) : switchId(switchId) {}
+
+    int getSwitchId() const { return switchId; }
+    size_t getNumDirtySlots() const { return dirtySlots.size(); }
+
+    // Counts the packet with the given tree ID, unless it was the last one
+    // counted in the slot
+    void count(int slot, int64_t treeId, uint64_t numBytes) {
+        if ((size_t)slot >= packets.size()) {
+            packets.resize(slot + 1, 0);
+            bytes.resize(slot + 1, 0);
+            lastTreeIds.resize(slot + 1, -1);
+        }
+        if (lastTreeIds[slot] == treeId)
+            return;
+        lastTreeIds[slot] = treeId;
+        if (packets[slot]++ == 0)
+            dirtySlots.push_back(slot);
+        bytes[slot] += numBytes;
+    }
+
+    // Calls visit(slot, packets, bytes) for every slot counted since the
+    // last call, and resets their counters
+    template <typename Visitor>
+    void collect(Visitor visit) {
+        for (int slot : dirtySlots) {
+            // a slot may be listed twice if it was discarded and counted again
+            if (packets[slot] == 0)
+                continue;
+            visit(slot, packets[slot], bytes[slot]);
+            packets[slot] = bytes[slot] = 0;
+        }
+        dirtySlots.clear();
+    }
+
+    // Drops the counts of a slot whose rule was removed, before it is reused
+    void discard(int slot) {
+        if ((size_t)slot < packets.size()) {
+            packets[slot] = bytes[slot] = 0;
+            lastTreeIds[slot] = -1;
+        }
+    }
+};
+
+} // namespace sdn_dashboard
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __SDN_DASHBOARD_MICROFLOWCACHE_H
+#define __SDN_DASHBOARD_MICROFLOWCACHE_H
+
+#include <cstdint>
+#include <vector>
+#include "FlowClassifier.h"
+
+namespace sdn_dashboard {
+
+/**
+ * Exact-match cache of classification results, consulted before the
+ * wildcard classifier so that packets of an already-seen 5-tuple skip the
+ * tuple space search.
+ *
+ * The cache is direct-mapped: each key has a single slot, and a new key
+ * simply evicts whatever was there. Entries are tagged with the generation
+ * in which they were stored; invalidate() starts a new generation, which
+ * drops all entries at once. It must be called whenever the flow table
+ * changes, as any rule insertion or removal may change the result for
+ * cached keys. Negative results (no matching rule) are cached as well.
+ */
+class MicroflowCache
+{
+  private:
+    struct Slot {
+        PacketKey key;
+        int flowId = -1;
+        uint32_t generation = 0;  // 0 = never filled
+    };
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    uint32_t generation = 1;
+
+  public:
+    explicit MicroflowCache(size_t capacity = 0) { setCapacity(capacity); }
+
+    // Rounds capacity up to a power of two; 0 disables the cache
+    void setCapacity(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity)
+            n <<= 1;
+        slots.assign(capacity == 0 ? 0 : n, Slot());
+        mask = slots.empty() ? 0 : n - 1;
+        generation = 1;
+    }
+    size_t getCapacity() const { return slots.size(); }
+
+    // Stores the cached flow ID (possibly -1) in flowId and returns true on a hit
+    bool lookup(const PacketKey &key, int &flowId) const {
+        if (slots.empty())
+            return false;
+        const Slot &slot = slots[PacketKeyHash()(key) & mask];
+        if (slot.generation != generation || !(slot.key == key))
+            return false;
+        flowId = slot.flowId;
+        return true;
+    }
+
+    void insert(const PacketKey &key, int flowId) {
+        if (slots.empty())
+            return;
+        Slot &slot = slots[PacketKeyHash()(key) & mask];
+        slot.key = key;
+        slot.flowId = flowId;
+        slot.generation = generation;
+    }
+
+    void invalidate() {
+        if (++generation == 0) {
+            // wrapped around: old entries could look current again
+            for (Slot &slot : slots)
+                slot.generation = 0;
+            generation = 1;
+        }
+    }
+};
+
+} // namespace sdn_dashboard
+
+#endif
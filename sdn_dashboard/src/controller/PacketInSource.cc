@@ -0,0 +1,125 @@
+#include "PacketInSource.h"
+#include <inet/common/packet/chunk/ByteCountChunk.h>
+#include <inet/networklayer/common/L3AddressResolver.h>
+#include <inet/networklayer/ipv4/Ipv4Header_m.h>
+#include <inet/transportlayer/udp/UdpHeader_m.h>
+#include "OpenFlowMessages_m.h"
+#include <algorithm>
+
+namespace sdn_dashboard {
+
+Define_Module(PacketInSource);
+
+PacketInSource::~PacketInSource()
+{
+    cancelAndDelete(timer);
+}
+
+void PacketInSource::initialize(int stage)
+{
+    ApplicationBase::initialize(stage);
+
+    if (stage == INITSTAGE_LOCAL) {
+        numPacketIns = par("numPacketIns");
+        sendInterval = par("sendInterval");
+        if (numPacketIns < 0 || sendInterval <= SIMTIME_ZERO)
+            throw cRuntimeError("numPacketIns must not be negative, sendInterval must be positive");
+        timer = new cMessage("send");
+    }
+}
+
+void PacketInSource::handleStartOperation(LifecycleOperation *operation)
+{
+    socket.setOutputGate(gate("socketOut"));
+    socket.bind(-1);
+    simtime_t startTime = par("startTime");
+    scheduleAt(std::max(simTime(), startTime), timer);
+}
+
+void PacketInSource::handleStopOperation(LifecycleOperation *operation)
+{
+    cancelEvent(timer);
+    socket.close();
+}
+
+void PacketInSource::handleCrashOperation(LifecycleOperation *operation)
+{
+    cancelEvent(timer);
+    socket.destroy();
+}
+
+void PacketInSource::handleMessageWhenUp(cMessage *msg)
+{
+    if (msg == timer) {
+        sendNext();
+        if (numSent < numPacketIns + 2)
+            scheduleAfter(sendInterval, timer);
+    }
+    else if (socket.belongsToSocket(msg)) {
+        Packet *packet = dynamic_cast<Packet *>(msg);
+        if (packet != nullptr && dynamicPtrCast<const FlowModMessage>(packet->peekAtFront(b(-1))) != nullptr)
+            numFlowModsReceived++;
+        delete msg;
+    }
+    else
+        delete msg;
+}
+
+void PacketInSource::sendNext()
+{
+    // Host addresses are assigned during initialization, so they are
+    // resolved by the first send
+    if (controllerAddress.isUnspecified())
+        controllerAddress = L3AddressResolver().resolve(par("destAddress"));
+
+    Packet *packet;
+    if (numSent == 0)
+        packet = new Packet("NotAPacketIn", makeShared<ByteCountChunk>(B(64)));
+    else if (numSent == 1)
+        packet = createPacketIn(true);
+    else {
+        packet = createPacketIn(false);
+        numPacketInsSent++;
+    }
+    socket.sendTo(packet, controllerAddress, par("destPort"));
+    numSent++;
+}
+
+Packet *PacketInSource::createPacketIn(bool truncated)
+{
+    cModule *switchNode = getModuleByPath(par("switchModule"));
+    if (switchNode == nullptr)
+        throw cRuntimeError("Switch module '%s' not found", par("switchModule").stringValue());
+
+    const auto& packetIn = makeShared<PacketInHeader>();
+    packetIn->setSwitchId(switchNode->getId());
+    packetIn->setInPort(0);
+    Packet *packet = new Packet(truncated ? "TruncatedPacketIn" : "PacketIn", packetIn);
+    if (truncated)
+        return packet;
+
+    // a different flow each time, so that the controller's flow cache does not answer
+    B payloadLength = B(par("packetLength").intValue());
+    const auto& ipv4Header = makeShared<Ipv4Header>();
+    ipv4Header->setSrcAddress(L3AddressResolver().resolve(par("srcHost")).toIpv4());
+    ipv4Header->setDestAddress(L3AddressResolver().resolve(par("dstHost")).toIpv4());
+    ipv4Header->setProtocolId(IP_PROT_UDP);
+    ipv4Header->setTotalLengthField(IPv4_MIN_HEADER_LENGTH + UDP_HEADER_LENGTH + payloadLength);
+    packet->insertAtBack(ipv4Header);
+    const auto& udpHeader = makeShared<UdpHeader>();
+    udpHeader->setSrcPort(1024 + numPacketInsSent);
+    udpHeader->setDestPort(5000);
+    udpHeader->setTotalLengthField(UDP_HEADER_LENGTH + payloadLength);
+    packet->insertAtBack(udpHeader);
+    if (payloadLength > B(0))
+        packet->insertAtBack(makeShared<ByteCountChunk>(payloadLength));
+    return packet;
+}
+
+void PacketInSource::finish()
+{
+    recordScalar("packetInsSent", numPacketInsSent);
+    recordScalar("flowModsReceived", numFlowModsReceived);
+}
+
+} // namespace sdn_dashboard
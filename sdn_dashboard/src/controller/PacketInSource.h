@@ -0,0 +1,57 @@
+#ifndef __SDN_DASHBOARD_PACKETINSOURCE_H
+#define __SDN_DASHBOARD_PACKETINSOURCE_H
+
+#include <omnetpp.h>
+#include <inet/common/INETDefs.h>
+#include <inet/applications/base/ApplicationBase.h>
+#include <inet/networklayer/common/L3Address.h>
+#include <inet/transportlayer/contract/udp/UdpSocket.h>
+
+using namespace omnetpp;
+using namespace inet;
+
+namespace sdn_dashboard {
+
+/**
+ * Sends PACKET_INs to the controller as a switch would, for testing the
+ * packet-in path of SDNControllerApp (see simulations/packetin.ini). First
+ * sends a datagram that is not a PACKET_IN and a PACKET_IN cut short after
+ * its header, both of which the controller must drop, then PACKET_INs for
+ * UDP packets between two hosts, and counts the FLOW_MODs answering them.
+ * See PacketInSource.ned.
+ */
+class PacketInSource : public ApplicationBase
+{
+  protected:
+    // config
+    int numPacketIns = 0;
+    simtime_t sendInterval;
+
+    // state
+    UdpSocket socket;
+    L3Address controllerAddress;
+    cMessage *timer = nullptr;
+    int numSent = 0;            // datagrams of any kind
+    long numPacketInsSent = 0;
+    long numFlowModsReceived = 0;
+
+  protected:
+    virtual int numInitStages() const override { return NUM_INIT_STAGES; }
+    virtual void initialize(int stage) override;
+    virtual void handleMessageWhenUp(cMessage *msg) override;
+    virtual void finish() override;
+
+    virtual void handleStartOperation(LifecycleOperation *operation) override;
+    virtual void handleStopOperation(LifecycleOperation *operation) override;
+    virtual void handleCrashOperation(LifecycleOperation *operation) override;
+
+    virtual void sendNext();
+    virtual Packet *createPacketIn(bool truncated);
+
+  public:
+    virtual ~PacketInSource();
+};
+
+} // namespace sdn_dashboard
+
+#endif
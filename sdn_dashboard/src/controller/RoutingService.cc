@@ -0,0 +1,418 @@
+#include "RoutingService.h"
+#include <algorithm>
+
+namespace sdn_dashboard {
+
+int RoutingService::addSwitch()
+{
+    int node = switchIndexOfNode.size();
+    switchIndexOfNode.push_back(nodeOfSwitch.size());
+    hostIndexOfNode.push_back(-1);
+    nodeOfSwitch.push_back(node);
+    switchUp.push_back(true);
+    adjacency.emplace_back();
+    return node;
+}
+
+int RoutingService::addHost()
+{
+    int node = switchIndexOfNode.size();
+    switchIndexOfNode.push_back(-1);
+    hostIndexOfNode.push_back(hostAttachments.size());
+    hostAttachments.emplace_back();
+    return node;
+}
+
+int RoutingService::addLink(int nodeA, int portA, int nodeB, int portB)
+{
+    int linkId = links.size();
+    Link link;
+    link.nodeA = nodeA;
+    link.portA = portA;
+    link.nodeB = nodeB;
+    link.portB = portB;
+    links.push_back(link);
+
+    int a = switchIndexOfNode[nodeA];
+    int b = switchIndexOfNode[nodeB];
+    if (a != -1 && b != -1) {
+        adjacency[a].push_back(Adjacency{b, portA, linkId});
+        adjacency[b].push_back(Adjacency{a, portB, linkId});
+    }
+    else if (a != -1)
+        hostAttachments[hostIndexOfNode[nodeB]].push_back(Attachment{a, portA, linkId});
+    else if (b != -1)
+        hostAttachments[hostIndexOfNode[nodeA]].push_back(Attachment{b, portB, linkId});
+    // links between two hosts carry no routed traffic
+    return linkId;
+}
+
+void RoutingService::clear()
+{
+    switchIndexOfNode.clear();
+    hostIndexOfNode.clear();
+    nodeOfSwitch.clear();
+    switchUp.clear();
+    adjacency.clear();
+    hostAttachments.clear();
+    links.clear();
+    distances.clear();
+    affectedMark.clear();
+    affectedEpoch = 0;
+    lastUpdate = UpdateStats();
+}
+
+void RoutingService::computeAll()
+{
+    distances.assign(numSwitches() * numSwitches(), UNREACHABLE);
+    affectedMark.assign(numSwitches(), 0);
+    affectedEpoch = 0;
+    lastUpdate = UpdateStats();
+    for (size_t dst = 0; dst < numSwitches(); dst++)
+        computeDestination(dst);
+}
+
+void RoutingService::computeDestination(int dst)
+{
+    // breadth-first search from the destination, the graph being undirected
+    uint16_t *d = row(dst);
+    std::fill(d, d + numSwitches(), (uint16_t)UNREACHABLE);
+    lastUpdate.destinationsUpdated++;
+    if (!switchUp[dst])
+        return;
+
+    std::vector<int> &queue = affected;
+    queue.clear();
+    queue.push_back(dst);
+    d[dst] = 0;
+    for (size_t i = 0; i < queue.size(); i++) {
+        int x = queue[i];
+        for (const Adjacency &adj : adjacency[x]) {
+            if (isUsable(adj, x) && d[adj.neighbor] == UNREACHABLE) {
+                d[adj.neighbor] = d[x] + 1;
+                queue.push_back(adj.neighbor);
+            }
+        }
+    }
+    lastUpdate.distancesChanged += queue.size();
+}
+
+void RoutingService::repairAfterFailure(int dst, MinQueue &seeds)
+{
+    // Phase 1: starting from the seeds, find the switches left without a
+    // neighbor one hop closer that is not itself affected. Processing in
+    // increasing distance guarantees the neighbors closer to dst have been
+    // decided before a switch is checked.
+    if (++affectedEpoch == 0) {
+        std::fill(affectedMark.begin(), affectedMark.end(), 0);
+        affectedEpoch = 1;
+    }
+    affected.clear();
+    uint16_t *d = row(dst);
+    while (!seeds.empty()) {
+        int x = seeds.top().second;
+        seeds.pop();
+        if (isAffected(x))
+            continue;
+        bool supported = switchUp[x] && x == dst;
+        if (!supported && switchUp[x]) {
+            for (const Adjacency &adj : adjacency[x]) {
+                if (isUsable(adj, x) && !isAffected(adj.neighbor) && d[adj.neighbor] + 1 == d[x]) {
+                    supported = true;
+                    break;
+                }
+            }
+        }
+        if (supported)
+            continue;
+        affectedMark[x] = affectedEpoch;
+        affected.push_back(x);
+        // x may itself be down, so only the far end decides what is a child
+        for (const Adjacency &adj : adjacency[x]) {
+            int y = adj.neighbor;
+            if (links[adj.linkId].up && switchUp[y] && !isAffected(y) && d[y] == d[x] + 1)
+                seeds.push(QueueEntry(d[y], y));
+        }
+    }
+    if (affected.empty())
+        return;
+
+    // Phase 2: Dijkstra over the affected switches, starting from the best
+    // distance each one gets through an unaffected neighbor
+    for (int x : affected)
+        d[x] = UNREACHABLE;
+    for (int x : affected) {
+        if (!switchUp[x])
+            continue;
+        int best = UNREACHABLE;
+        for (const Adjacency &adj : adjacency[x])
+            if (isUsable(adj, x) && !isAffected(adj.neighbor) && d[adj.neighbor] != UNREACHABLE)
+                best = std::min(best, d[adj.neighbor] + 1);
+        if (best != UNREACHABLE) {
+            d[x] = best;
+            seeds.push(QueueEntry(best, x));
+        }
+    }
+    while (!seeds.empty()) {
+        QueueEntry entry = seeds.top();
+        seeds.pop();
+        int x = entry.second;
+        if (entry.first != d[x])
+            continue;
+        for (const Adjacency &adj : adjacency[x]) {
+            int y = adj.neighbor;
+            if (isUsable(adj, x) && isAffected(y) && d[y] > d[x] + 1) {
+                d[y] = d[x] + 1;
+                seeds.push(QueueEntry(d[y], y));
+            }
+        }
+    }
+    lastUpdate.destinationsUpdated++;
+    lastUpdate.distancesChanged += affected.size();
+}
+
+void RoutingService::propagateImprovements(int dst, MinQueue &seeds)
+{
+    uint16_t *d = row(dst);
+    size_t changed = 0;
+    while (!seeds.empty()) {
+        QueueEntry entry = seeds.top();
+        seeds.pop();
+        int x = entry.second;
+        if (entry.first != d[x])
+            continue;
+        changed++;
+        for (const Adjacency &adj : adjacency[x]) {
+            int y = adj.neighbor;
+            if (isUsable(adj, x) && d[y] > d[x] + 1) {
+                d[y] = d[x] + 1;
+                seeds.push(QueueEntry(d[y], y));
+            }
+        }
+    }
+    if (changed > 0) {
+        lastUpdate.destinationsUpdated++;
+        lastUpdate.distancesChanged += changed;
+    }
+}
+
+void RoutingService::setLinkUp(int linkId, bool up)
+{
+    Link &link = links[linkId];
+    if (link.up == up)
+        return;
+    link.up = up;
+    lastUpdate = UpdateStats();
+
+    // host links are checked at lookup time; links at a down switch change nothing yet
+    int a = switchIndexOfNode[link.nodeA];
+    int b = switchIndexOfNode[link.nodeB];
+    if (a == -1 || b == -1 || !switchUp[a] || !switchUp[b])
+        return;
+
+    MinQueue seeds;
+    for (size_t dst = 0; dst < numSwitches(); dst++) {
+        uint16_t *d = row(dst);
+        if (!up) {
+            // only destinations with a shortest path over the link are affected,
+            // and of their switches only those behind it
+            if (d[a] != UNREACHABLE && d[a] == d[b] + 1)
+                seeds.push(QueueEntry(d[a], a));
+            else if (d[b] != UNREACHABLE && d[b] == d[a] + 1)
+                seeds.push(QueueEntry(d[b], b));
+            else
+                continue;
+            repairAfterFailure(dst, seeds);
+        }
+        else {
+            if (d[a] != UNREACHABLE && d[a] + 1 < d[b]) {
+                d[b] = d[a] + 1;
+                seeds.push(QueueEntry(d[b], b));
+            }
+            else if (d[b] != UNREACHABLE && d[b] + 1 < d[a]) {
+                d[a] = d[b] + 1;
+                seeds.push(QueueEntry(d[a], a));
+            }
+            else
+                continue;
+            propagateImprovements(dst, seeds);
+        }
+    }
+}
+
+void RoutingService::setSwitchUp(int node, bool up)
+{
+    int s = switchIndexOfNode[node];
+    if (switchUp[s] == up)
+        return;
+    switchUp[s] = up;
+    lastUpdate = UpdateStats();
+
+    MinQueue seeds;
+    for (size_t dst = 0; dst < numSwitches(); dst++) {
+        uint16_t *d = row(dst);
+        if ((int)dst == s) {
+            // paths to the switch itself: none, or all new
+            computeDestination(dst);
+        }
+        else if (!up) {
+            if (d[s] == UNREACHABLE)
+                continue;
+            seeds.push(QueueEntry(d[s], s));
+            repairAfterFailure(dst, seeds);
+        }
+        else {
+            int best = UNREACHABLE;
+            for (const Adjacency &adj : adjacency[s])
+                if (isUsable(adj, s) && d[adj.neighbor] != UNREACHABLE)
+                    best = std::min(best, d[adj.neighbor] + 1);
+            if (best == UNREACHABLE)
+                continue;
+            d[s] = best;
+            seeds.push(QueueEntry(d[s], s));
+            propagateImprovements(dst, seeds);
+        }
+    }
+}
+
+bool RoutingService::isAttached(int hostNode, int switchNode) const
+{
+    int h = hostIndexOfNode[hostNode];
+    int s = switchIndexOfNode[switchNode];
+    if (h == -1 || s == -1)
+        return false;
+    for (const Attachment &att : hostAttachments[h])
+        if (att.switchIndex == s)
+            return true;
+    return false;
+}
+
+int RoutingService::getDistance(int fromNode, int toNode) const
+{
+    int s = switchIndexOfNode[fromNode];
+    if (s == -1)
+        return UNREACHABLE;
+    int t = switchIndexOfNode[toNode];
+    if (t != -1)
+        return row(t)[s];
+
+    int best = UNREACHABLE;
+    for (const Attachment &att : hostAttachments[hostIndexOfNode[toNode]])
+        if (links[att.linkId].up && row(att.switchIndex)[s] != UNREACHABLE)
+            best = std::min(best, row(att.switchIndex)[s] + 1);
+    return best;
+}
+
+void RoutingService::addNextHops(int s, int dst, std::vector<int> &ports) const
+{
+    const uint16_t *d = row(dst);
+    if (d[s] == UNREACHABLE)
+        return;
+    for (const Adjacency &adj : adjacency[s])
+        if (isUsable(adj, s) && d[adj.neighbor] + 1 == d[s]
+                && std::find(ports.begin(), ports.end(), adj.port) == ports.end())
+            ports.push_back(adj.port);
+}
+
+void RoutingService::getNextHopPorts(int fromNode, int toNode, std::vector<int> &ports) const
+{
+    ports.clear();
+    int s = switchIndexOfNode[fromNode];
+    if (s == -1 || !switchUp[s])
+        return;
+
+    int t = switchIndexOfNode[toNode];
+    if (t != -1) {
+        if (t != s)
+            addNextHops(s, t, ports);
+        return;
+    }
+
+    // a host attached here is delivered to directly
+    const std::vector<Attachment> &attachments = hostAttachments[hostIndexOfNode[toNode]];
+    for (const Attachment &att : attachments)
+        if (att.switchIndex == s && links[att.linkId].up)
+            ports.push_back(att.port);
+    if (!ports.empty())
+        return;
+
+    // otherwise towards the nearest switches it is attached to
+    int best = UNREACHABLE;
+    for (const Attachment &att : attachments)
+        if (links[att.linkId].up)
+            best = std::min(best, (int)row(att.switchIndex)[s]);
+    if (best == UNREACHABLE)
+        return;
+    for (const Attachment &att : attachments)
+        if (links[att.linkId].up && row(att.switchIndex)[s] == best)
+            addNextHops(s, att.switchIndex, ports);
+}
+
+int RoutingService::selectPort(int fromNode, int toNode, size_t flowHash) const
+{
+    std::vector<int> ports;
+    getNextHopPorts(fromNode, toNode, ports);
+    return ports.empty() ? -1 : ports[flowHash % ports.size()];
+}
+
+void RoutingService::computeFloodTree(const std::vector<int> &hostNodes, std::vector<std::pair<int, int>> &ports) const
+{
+    ports.clear();
+    std::vector<const Attachment *> members;
+    for (int node : hostNodes) {
+        int h = hostIndexOfNode[node];
+        if (h == -1)
+            continue;
+        for (const Attachment &att : hostAttachments[h]) {
+            if (links[att.linkId].up && switchUp[att.switchIndex]) {
+                members.push_back(&att);
+                break;
+            }
+        }
+    }
+    if (members.empty())
+        return;
+
+    // breadth-first search from the first member's switch; for each switch
+    // reached, its parent and the ports of the link to the parent
+    struct TreeLink {
+        int parent = -1;
+        int parentPort = -1;  // port of the parent towards the switch
+        int port = -1;        // port of the switch towards the parent
+        bool reached = false;
+        bool needed = false;
+    };
+    std::vector<TreeLink> tree(numSwitches());
+    std::vector<int> queue;
+    int root = members[0]->switchIndex;
+    tree[root].reached = true;
+    queue.push_back(root);
+    for (size_t i = 0; i < queue.size(); i++) {
+        int x = queue[i];
+        for (const Adjacency &adj : adjacency[x]) {
+            TreeLink &t = tree[adj.neighbor];
+            if (!t.reached && isUsable(adj, x)) {
+                const Link &link = links[adj.linkId];
+                t.reached = true;
+                t.parent = x;
+                t.parentPort = adj.port;
+                t.port = link.nodeA == nodeOfSwitch[adj.neighbor] ? link.portA : link.portB;
+                queue.push_back(adj.neighbor);
+            }
+        }
+    }
+
+    // keep the paths from the members up to the root
+    for (const Attachment *att : members) {
+        if (!tree[att->switchIndex].reached)
+            continue;
+        ports.push_back(std::make_pair(nodeOfSwitch[att->switchIndex], att->port));
+        for (int s = att->switchIndex; s != root && !tree[s].needed; s = tree[s].parent) {
+            tree[s].needed = true;
+            ports.push_back(std::make_pair(nodeOfSwitch[s], tree[s].port));
+            ports.push_back(std::make_pair(nodeOfSwitch[tree[s].parent], tree[s].parentPort));
+        }
+    }
+}
+
+} // namespace sdn_dashboard
@@ -0,0 +1,139 @@
+#ifndef __SDN_DASHBOARD_ROUTINGSERVICE_H
+#define __SDN_DASHBOARD_ROUTINGSERVICE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace sdn_dashboard {
+
+/**
+ * Shortest-path routing over the switch fabric, with equal-cost multipath.
+ *
+ * Keeps the hop-count distance from every switch to every other switch (all
+ * pairs, 2 bytes each). The ECMP next hops of a switch towards a destination
+ * follow from these: the links to neighbors one hop closer. Hosts hang off
+ * switches and never forward; traffic to a host is routed towards the
+ * switches it is attached to.
+ *
+ * Failures and recoveries of links and switches update the distances
+ * incrementally. A failed link only matters for the destinations whose
+ * shortest paths it was on, and for each of those only the switches that
+ * lost their last shortest path are recomputed, by a Dijkstra limited to
+ * them. A recovery can only shorten paths, and is propagated outwards from
+ * the recovered link until distances stop improving.
+ */
+class RoutingService
+{
+  public:
+    enum { UNREACHABLE = 0xFFFF };
+
+    // Work done by the last full or incremental computation
+    struct UpdateStats {
+        size_t destinationsUpdated = 0;
+        size_t distancesChanged = 0;
+    };
+
+  private:
+    struct Adjacency {
+        int neighbor;       // switch index
+        int port;           // local port towards the neighbor
+        int linkId;
+    };
+
+    struct Attachment {
+        int switchIndex;
+        int port;           // port of the switch towards the host
+        int linkId;
+    };
+
+    struct Link {
+        int nodeA, portA;
+        int nodeB, portB;
+        bool up = true;
+    };
+
+    typedef std::pair<uint16_t, int> QueueEntry;  // distance, switch index
+    typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> MinQueue;
+
+    // Nodes: switches and hosts, by node ID
+    std::vector<int> switchIndexOfNode;   // -1 for hosts
+    std::vector<int> hostIndexOfNode;     // -1 for switches
+    std::vector<int> nodeOfSwitch;
+    std::vector<bool> switchUp;
+    std::vector<std::vector<Adjacency>> adjacency;         // by switch index
+    std::vector<std::vector<Attachment>> hostAttachments;  // by host index
+    std::vector<Link> links;
+
+    // distances[dst * numSwitches + src]: hops from switch src to switch dst
+    std::vector<uint16_t> distances;
+    UpdateStats lastUpdate;
+
+    // Scratch space of the incremental updates
+    std::vector<uint32_t> affectedMark;
+    uint32_t affectedEpoch = 0;
+    std::vector<int> affected;
+
+  protected:
+    size_t numSwitches() const { return nodeOfSwitch.size(); }
+    uint16_t *row(int dst) { return distances.data() + (size_t)dst * numSwitches(); }
+    const uint16_t *row(int dst) const { return distances.data() + (size_t)dst * numSwitches(); }
+    bool isUsable(const Adjacency &adj, int from) const { return links[adj.linkId].up && switchUp[from] && switchUp[adj.neighbor]; }
+    bool isAffected(int s) const { return affectedMark[s] == affectedEpoch; }
+
+    void computeDestination(int dst);
+    void repairAfterFailure(int dst, MinQueue &seeds);
+    void propagateImprovements(int dst, MinQueue &seeds);
+    void addNextHops(int s, int dst, std::vector<int> &ports) const;
+
+  public:
+    RoutingService() {}
+
+    // Building the graph; node and link IDs are assigned consecutively from 0
+    int addSwitch();
+    int addHost();
+    int addLink(int nodeA, int portA, int nodeB, int portB);
+    void clear();
+
+    // Full recomputation of all distances
+    void computeAll();
+
+    // Incremental updates; no-ops when the state does not change
+    void setLinkUp(int linkId, bool up);
+    void setSwitchUp(int node, bool up);
+    bool isLinkUp(int linkId) const { return links[linkId].up; }
+    bool isSwitchUp(int node) const { return switchUp[switchIndexOfNode[node]]; }
+
+    // Whether the host has a link to the switch, up or down
+    bool isAttached(int hostNode, int switchNode) const;
+
+    // Hops from a switch to another node (switch or host), or UNREACHABLE
+    int getDistance(int fromNode, int toNode) const;
+
+    // Ports of the switch on its shortest paths to the node, in adjacency
+    // order; empty if unreachable or if fromNode is the destination itself
+    void getNextHopPorts(int fromNode, int toNode, std::vector<int> &ports) const;
+
+    // One of getNextHopPorts(), picked by flow hash so that the packets of a
+    // flow stay on one path; -1 if there is none
+    int selectPort(int fromNode, int toNode, size_t flowHash) const;
+
+    // Broadcast tree connecting the hosts: a shortest-path tree of the fabric
+    // from the switch of the first host, pruned to the branches that lead to
+    // the others. Returns the (switch node, port) pairs to flood to: both
+    // ends of the tree links and the ports towards the hosts, each host by
+    // its first working attachment. Hosts that cannot be reached are left out.
+    void computeFloodTree(const std::vector<int> &hostNodes, std::vector<std::pair<int, int>> &ports) const;
+
+    size_t getNumNodes() const { return switchIndexOfNode.size(); }
+    size_t getNumSwitches() const { return numSwitches(); }
+    size_t getNumLinks() const { return links.size(); }
+    bool isSwitch(int node) const { return switchIndexOfNode[node] != -1; }
+    const UpdateStats& getLastUpdateStats() const { return lastUpdate; }
+};
+
+} // namespace sdn_dashboard
+
+#endif
@@ -1,9 +1,24 @@
 #include "SDNController.h"
 #include <inet/common/ModuleAccess.h>
+#include <inet/common/lifecycle/NodeStatus.h>
 #include <inet/common/packet/Packet.h>
+#include <inet/common/packet/chunk/SliceChunk.h>
+#include <inet/networklayer/common/IpProtocolId_m.h>
+#include <inet/networklayer/common/L3AddressResolver.h>
+#include <inet/networklayer/common/L3AddressTag_m.h>
 #include <inet/networklayer/ipv4/Ipv4Header_m.h>
+#include <inet/transportlayer/common/L4PortTag_m.h>
+#include <inet/transportlayer/tcp_common/TcpHeader_m.h>
+#include <inet/transportlayer/udp/UdpHeader_m.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <sstream>
 
 namespace sdn_dashboard {
 
@@ -20,19 +35,60 @@ SDNControllerApp::SDNControllerApp()
 {
     nextFlowId = 1;
     nextSliceId = 1;
-    stateFile = nullptr;
     checkCommandTimer = nullptr;
+    commandScheduler = nullptr;
+    commandArrivedMsg = nullptr;
+    maxCommandsPerEvent = 0;
+    dispatchTimer = nullptr;
+    snapshotTimer = nullptr;
+    checkpointSeq = 0;
+    checkpointTimer = nullptr;
+    flowExpiryTimer = nullptr;
+    numIdleExpiries = 0;
+    numHardExpiries = 0;
+    flowCounterVersion = 0;
+    floodPortsVersion = UINT64_MAX;
+    floodDomainVersion = 0;
+    flowStatsTimer = nullptr;
+    analyzeFlowConflicts = false;
+    numShards = 1;
+    shardIndex = 0;
+    processingDelay = nullptr;
+    flowModTimer = nullptr;
+    handlerTime = 0;
+    numHandledEvents = 0;
+    snapshotBytes = 0;
+    runStartEventNumber = 0;
 }
 
 SDNControllerApp::~SDNControllerApp()
 {
-    if (stateFile) {
-        stateFile->close();
-        delete stateFile;
-    }
     if (checkCommandTimer) {
         cancelAndDelete(checkCommandTimer);
     }
+    if (commandArrivedMsg) {
+        cancelAndDelete(commandArrivedMsg);
+    }
+    if (dispatchTimer) {
+        cancelAndDelete(dispatchTimer);
+    }
+    if (snapshotTimer) {
+        cancelAndDelete(snapshotTimer);
+    }
+    if (checkpointTimer) {
+        cancelAndDelete(checkpointTimer);
+    }
+    if (flowExpiryTimer) {
+        cancelAndDelete(flowExpiryTimer);
+    }
+    if (flowStatsTimer) {
+        cancelAndDelete(flowStatsTimer);
+    }
+    if (flowModTimer) {
+        cancelAndDelete(flowModTimer);
+    }
+    for (const auto &pending : pendingFlowMods)
+        delete pending.packet;
 }
 
 void SDNControllerApp::initialize(int stage)
@@ -41,13 +97,63 @@ void SDNControllerApp::initialize(int stage)
 
     if (stage == INITSTAGE_LOCAL) {
         localPort = par("localPort");
+        numShards = par("numShards");
+        shardIndex = par("shardIndex");
+        if (numShards < 1 || shardIndex < 0 || shardIndex >= numShards)
+            throw cRuntimeError("Invalid shardIndex %d for numShards %d", shardIndex, numShards);
+        if (par("shardVirtualNodes").intValue() < 1)
+            throw cRuntimeError("shardVirtualNodes must be positive");
+        shardMap.build(numShards, par("shardVirtualNodes").intValue());
+        resolveShards();
+        nextFlowId = nextOwnedId(1);
+        nextSliceId = nextOwnedId(1);
         sliceConfigFile = par("sliceConfigFile").stdstringValue();
         flowConfigFile = par("flowConfigFile").stdstringValue();
+        stateFileName = getShardFileName(par("stateFile").stdstringValue());
+        journalFileName = getShardFileName(par("journalFile").stdstringValue());
+        telemetrySocketPath = getShardFileName(par("telemetrySocket").stdstringValue());
+        snapshotInterval = par("snapshotInterval");
+        snapshotMinJournalEntries = par("snapshotMinJournalEntries");
+        checkpointFileName = getShardFileName(par("checkpointFile").stdstringValue());
+        checkpointInterval = par("checkpointInterval");
+        flowCache.setCapacity(par("flowCacheSize").intValue());
+        analyzeFlowConflicts = par("analyzeFlowConflicts");
+        defaultIdleTimeout = par("flowIdleTimeout");
+        defaultHardTimeout = par("flowHardTimeout");
+        flowExpiryTick = par("flowExpiryTick");
+        if (flowExpiryTick <= SIMTIME_ZERO)
+            throw cRuntimeError("flowExpiryTick must be positive");
+        flowExpiryTimer = new cMessage("flowExpiry");
+        flowStatsInterval = par("flowStatsInterval");
+        processingDelay = &par("processingDelay");
+        flowModTimer = new cMessage("flowMod");
+        if (par("maxQueuedCommandsPerTenant").intValue() < 0 || par("maxCommandsPerEvent").intValue() < 0)
+            throw cRuntimeError("maxQueuedCommandsPerTenant and maxCommandsPerEvent must not be negative");
+        try {
+            commandQueue.configure(par("tenantCommandRate").doubleValue(), par("tenantCommandBurst").intValue(),
+                    par("fairQueueQuantum").intValue(), par("maxQueuedCommandsPerTenant").intValue());
+        }
+        catch (const std::exception& e) {
+            throw cRuntimeError("%s", e.what());
+        }
+        maxCommandsPerEvent = par("maxCommandsPerEvent");
+        dispatchTimer = new cMessage("dispatchCommands");
 
         // Register signals
         flowInstalledSignal = registerSignal("flowInstalled");
         sliceCreatedSignal = registerSignal("sliceCreated");
+        sliceChangedSignal = registerSignal("sliceChanged");
         flowRemovedSignal = registerSignal("flowRemoved");
+        flowCacheHitSignal = registerSignal("flowCacheHit");
+        flowCacheMissSignal = registerSignal("flowCacheMiss");
+        flowIdleExpiredSignal = registerSignal("flowIdleExpired");
+        flowHardExpiredSignal = registerSignal("flowHardExpired");
+        packetInLatencySignal = registerSignal("packetInLatency");
+        commandLatencySignal = registerSignal("commandLatency");
+        commandQueueLengthSignal = registerSignal("commandQueueLength");
+        flowShadowedSignal = registerSignal("flowShadowed");
+        flowConflictSignal = registerSignal("flowConflict");
+        commandWaitTimeSignal = registerSignal("commandWaitTime");
 
         EV << "SDN Controller initializing on port " << localPort << endl;
     }
@@ -55,36 +161,129 @@ void SDNControllerApp::initialize(int stage)
         socket.setOutputGate(gate("socketOut"));
         socket.bind(localPort);
 
-        // Load initial configuration
-        loadConfiguration();
+        // Load initial configuration, unless continuing from an earlier run
+        if (!par("restoreCheckpoint").boolValue() || !restoreCheckpoint())
+            loadConfiguration();
 
-        // Open state file for external communication
-        std::string stateFilePath = "results/controller_state.json";
-        stateFile = new std::ofstream(stateFilePath);
+        // Open the change journal for external communication
+        journal.open(journalFileName);
 
         // Setup command file path
-        commandFile = "results/commands.json";
+        commandFile = getShardFileName("results/commands.json");
+        commandResultFile = getShardFileName("results/command_results.json");
         lastCommandCheck = simTime();
 
-        // Schedule periodic command checking
+        // Commands are either delivered by the scheduler as they arrive, or
+        // picked up by checking the command file every second; the scheduler
+        // serves a single module, the first shard
+        std::string commandIngestion = par("commandIngestion").stdstringValue();
+        if (commandIngestion == "event" && shardIndex == 0) {
+            commandScheduler = dynamic_cast<CommandRTScheduler *>(getSimulation()->getScheduler());
+            if (!commandScheduler)
+                throw cRuntimeError("commandIngestion=\"event\" requires scheduler-class = \"sdn_dashboard::CommandRTScheduler\"");
+            commandArrivedMsg = new cMessage("commandArrived");
+            commandScheduler->setInterfaceModule(this, commandArrivedMsg, commandFile.c_str());
+        }
+        else if (commandIngestion != "poll" && commandIngestion != "event")
+            throw cRuntimeError("Unknown commandIngestion \"%s\", must be \"poll\" or \"event\"", commandIngestion.c_str());
+
+        // Without a file watch, the command file is still checked periodically
+        // (a command left in the file before startup is picked up by the first check)
         checkCommandTimer = new cMessage("checkCommands");
-        scheduleAt(simTime() + 1.0, checkCommandTimer);
+        if (!commandScheduler || !commandScheduler->isWatchingFile())
+            scheduleAt(simTime() + 1.0, checkCommandTimer);
+        else
+            scheduleAt(simTime(), checkCommandTimer);
 
         // Export initial state
         saveState();
-        exportTopology();
+        if (shardIndex == 0)
+            exportTopology();
+        if (!telemetrySocketPath.empty())
+            startTelemetry(telemetrySocketPath);
+
+        // Routes follow failures: channels disabled or disconnected, switches
+        // deleted or shut down (all signals propagate up to the network)
+        buildRoutingService();
+        cModule *network = getSimulation()->getSystemModule();
+        network->subscribe(PRE_MODEL_CHANGE, this);
+        network->subscribe(POST_MODEL_CHANGE, this);
+        network->subscribe(NodeStatus::nodeStatusChangedSignal, this);
+
+        // Switch ports have created their counter tables by now
+        if (!flowCounterTables.empty()) {
+            flowStatsTimer = new cMessage("flowStats");
+            scheduleAt(simTime() + flowStatsInterval, flowStatsTimer);
+        }
+
+        // Schedule periodic snapshot compaction of the journal
+        snapshotTimer = new cMessage("snapshot");
+        scheduleAt(simTime() + snapshotInterval, snapshotTimer);
 
-        EV << "Command processing enabled. Checking " << commandFile << " every 1 second." << endl;
+        if (!checkpointFileName.empty() && checkpointInterval > SIMTIME_ZERO) {
+            checkpointTimer = new cMessage("checkpoint");
+            scheduleAt(simTime() + checkpointInterval, checkpointTimer);
+        }
+
+        if (!commandScheduler)
+            EV << "Command processing enabled. Checking " << commandFile << " every 1 second." << endl;
+        else
+            EV << "Command processing enabled. Commands are processed on arrival via " << commandScheduler->str() << "." << endl;
+
+        runStartTime = std::chrono::steady_clock::now();
+        runStartEventNumber = getSimulation()->getEventNumber();
     }
 }
 
+void SDNControllerApp::handleMessage(cMessage *msg)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    ApplicationBase::handleMessage(msg);
+    handlerTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    numHandledEvents++;
+}
+
 void SDNControllerApp::handleMessageWhenUp(cMessage *msg)
 {
     if (msg == checkCommandTimer) {
         // Periodic command processing
         processCommands();
-        // Schedule next check
-        scheduleAt(simTime() + 1.0, checkCommandTimer);
+        // Schedule next check, unless the scheduler reports file changes
+        if (!commandScheduler || !commandScheduler->isWatchingFile())
+            scheduleAt(simTime() + 1.0, checkCommandTimer);
+        return;
+    }
+    else if (msg == commandArrivedMsg) {
+        processArrivedCommands();
+        return;
+    }
+    else if (msg == dispatchTimer) {
+        dispatchCommands();
+        return;
+    }
+    else if (msg == flowExpiryTimer) {
+        expireFlows();
+        return;
+    }
+    else if (msg == flowModTimer) {
+        sendPendingFlowMods();
+        return;
+    }
+    else if (msg == flowStatsTimer) {
+        collectFlowCounters();
+        scheduleAt(simTime() + flowStatsInterval, flowStatsTimer);
+        return;
+    }
+    else if (msg == snapshotTimer) {
+        if (journal.getEntriesSinceSnapshot() > 0)
+            saveState();
+        scheduleAt(simTime() + snapshotInterval, snapshotTimer);
+        return;
+    }
+    else if (msg == checkpointTimer) {
+        if (journal.getSeq() != checkpointSeq)
+            writeCheckpoint();
+        scheduleAt(simTime() + checkpointInterval, checkpointTimer);
         return;
     }
     else if (socket.belongsToSocket(msg)) {
@@ -98,93 +297,514 @@ void SDNControllerApp::handleMessageWhenUp(cMessage *msg)
 
 void SDNControllerApp::processPacket(Packet *packet)
 {
-    // Process incoming packets from switches
-    EV << "Controller received packet" << endl;
+    // Packets from switches are PACKET_INs: the switch's header, followed by
+    // the packet that missed in the switch's flow table
+    L3Address switchAddress = packet->getTag<L3AddressInd>()->getSrcAddress();
+    int switchPort = packet->getTag<L4PortInd>()->getSrcPort();
+    if (!isPacketIn(packet)) {
+        EV_WARN << "Non-PACKET_IN datagram " << packet->getName() << " (" << packet->getByteLength() << " B) from "
+                << switchAddress << ":" << switchPort << ", dropped" << endl;
+        delete packet;
+        return;
+    }
+    const auto& packetIn = packet->popAtFront<PacketInHeader>();
+    const auto& ipv4Header = packet->peekAtFront<Ipv4Header>();
+
+    PacketKey key;
+    key.srcIp = ipv4Header->getSrcAddress().getInt();
+    key.dstIp = ipv4Header->getDestAddress().getInt();
+    key.protocol = ipv4Header->getProtocolId();
+    if (key.protocol == IP_PROT_UDP) {
+        const auto& udpHeader = packet->peekDataAt<UdpHeader>(ipv4Header->getChunkLength());
+        key.srcPort = udpHeader->getSrcPort();
+        key.dstPort = udpHeader->getDestPort();
+    }
+    else if (key.protocol == IP_PROT_TCP) {
+        const auto& tcpHeader = packet->peekDataAt<tcp::TcpHeader>(ipv4Header->getChunkLength());
+        key.srcPort = tcpHeader->getSrcPort();
+        key.dstPort = tcpHeader->getDestPort();
+    }
+
+    simtime_t completionTime = serve(1);
+    emit(packetInLatencySignal, completionTime - simTime());
+
+    const FlowRule *matchedRule = matchPacketIn(key, packet->getByteLength());
+    if (matchedRule == nullptr) {
+        EV << "PACKET_IN from switch " << packetIn->getSwitchId() << " port " << packetIn->getInPort()
+           << ": no flow rule for " << ipv4Header->getSrcAddress() << " -> " << ipv4Header->getDestAddress()
+           << ", packet dropped" << endl;
+        delete packet;
+        return;
+    }
 
-    // TODO: Implement OpenFlow message handling
-    // For now, just log and delete
+    const FlowRule &rule = *matchedRule;
+    int outputPort = getOutputPort(rule, key, packetIn->getSwitchId());
+    if (outputPort == FlowRule::ROUTED_PORT) {
+        EV << "PACKET_IN from switch " << packetIn->getSwitchId() << " port " << packetIn->getInPort()
+           << " matched flow rule " << rule.flowId << ", but there is no route to "
+           << ipv4Header->getDestAddress() << ", packet dropped" << endl;
+        delete packet;
+        return;
+    }
 
+    EV << "PACKET_IN from switch " << packetIn->getSwitchId() << " port " << packetIn->getInPort()
+       << " matched flow rule " << rule.flowId << ", output port " << outputPort << endl;
+    sendFlowMod(rule, outputPort, *packetIn, switchAddress, switchPort, completionTime);
     delete packet;
 }
 
+bool SDNControllerApp::isPacketIn(const Packet *packet)
+{
+    // The untyped peeks return the chunks as they are, where typed ones
+    // would try to deserialize other chunks, and throw. Each peek covers
+    // exactly one header: a longer one would return the sequence of all
+    // chunks in it. The packet that missed must follow, starting with its
+    // IPv4 header; one with options comes back as a slice of it.
+    static const b packetInLength = PacketInHeader().getChunkLength();
+    if (packet->getDataLength() < packetInLength + IPv4_MIN_HEADER_LENGTH)
+        return false;
+    if (dynamicPtrCast<const PacketInHeader>(packet->peekAtFront(packetInLength)) == nullptr)
+        return false;
+    const auto& ipv4Chunk = packet->peekDataAt(packetInLength, IPv4_MIN_HEADER_LENGTH);
+    if (const auto& slice = dynamicPtrCast<const SliceChunk>(ipv4Chunk))
+        return slice->getOffset() == b(0) && dynamicPtrCast<const Ipv4Header>(slice->getChunk()) != nullptr;
+    return dynamicPtrCast<const Ipv4Header>(ipv4Chunk) != nullptr;
+}
+
+int SDNControllerApp::classifyPacket(const PacketKey &key)
+{
+    int flowId;
+    if (flowCache.lookup(key, flowId)) {
+        emit(flowCacheHitSignal, (long)flowId);
+        return flowId;
+    }
+    flowId = classifier.lookup(key);
+    flowCache.insert(key, flowId);
+    emit(flowCacheMissSignal, (long)flowId);
+    return flowId;
+}
+
+const FlowRule *SDNControllerApp::matchPacketIn(const PacketKey &key, int64_t bytes)
+{
+    auto it = flowTable.find(classifyPacket(key));
+    int ownerShard;
+    const FlowRule *rule = selectShardRule(key, it != flowTable.end() ? &it->second : nullptr, ownerShard);
+    if (rule != nullptr)
+        shards[ownerShard]->countPacketIn(rule->flowId, bytes);
+    return rule;
+}
+
+const FlowRule *SDNControllerApp::selectShardRule(const PacketKey &key, const FlowRule *localMatch, int &ownerShard) const
+{
+    // The rules are divided among the shards; of the matches of all of them,
+    // the one FlowClassifier would pick if it held them all wins: highest
+    // priority first, then lowest flow ID. So does the same rule whichever
+    // shard receives the packet.
+    const FlowRule *rule = localMatch;
+    ownerShard = shardIndex;
+    for (const SDNControllerApp *shard : shards) {
+        if (shard == this)
+            continue;
+        const FlowRule *match = shard->lookupFlow(key);
+        if (match != nullptr && (rule == nullptr || match->priority > rule->priority
+                || (match->priority == rule->priority && match->flowId < rule->flowId))) {
+            rule = match;
+            ownerShard = shard->shardIndex;
+        }
+    }
+    return rule;
+}
+
+void SDNControllerApp::countPacketIn(int flowId, int64_t bytes)
+{
+    Enter_Method_Silent();
+    auto it = flowTable.find(flowId);
+    if (it == flowTable.end())
+        return;
+    FlowRule &rule = it->second;
+    rule.packetsMatched++;
+    rule.bytesMatched += bytes;
+    rule.lastMatchedTime = simTime();  // checked only when the rule's expiry timer runs out
+}
+
+int SDNControllerApp::getOutputPort(const FlowRule &rule, const PacketKey &key, int switchId) const
+{
+    if (rule.outputPort != FlowRule::ROUTED_PORT)
+        return rule.outputPort;
+
+    // The switch drops the packets of a "drop" rule whatever the port; install
+    // it with port 0 like before routing. "modify" rules are routed like "forward".
+    if (rule.action == "drop")
+        return 0;
+
+    // One of the switch's shortest paths to the destination host, by flow
+    // hash, so that a flow's packets are not reordered across paths
+    auto switchIt = routingNodeOfModule.find(switchId);
+    auto hostIt = routingNodeOfHost.find(key.dstIp);
+    if (switchIt == routingNodeOfModule.end() || !routing.isSwitch(switchIt->second) || hostIt == routingNodeOfHost.end())
+        return FlowRule::ROUTED_PORT;
+    return routing.selectPort(switchIt->second, hostIt->second, PacketKeyHash()(key));
+}
+
+void SDNControllerApp::sendFlowMod(const FlowRule &rule, int outputPort, const PacketInHeader &packetIn, const L3Address &switchAddress, int switchPort, simtime_t sendTime)
+{
+    const auto& flowMod = makeShared<FlowModMessage>();
+    flowMod->setBufferId(packetIn.getBufferId());
+    flowMod->setInPort(packetIn.getInPort());
+    flowMod->setFlowId(rule.flowId);
+    flowMod->setSrcIP(rule.srcIP.c_str());
+    flowMod->setDstIP(rule.dstIP.c_str());
+    flowMod->setSrcPort(rule.srcPort);
+    flowMod->setDstPort(rule.dstPort);
+    flowMod->setProtocol(rule.protocol);
+    flowMod->setAction(rule.action.c_str());
+    flowMod->setOutputPort(outputPort);
+    flowMod->setPriority(rule.priority);
+    flowMod->setSliceId(rule.sliceId);
+    flowMod->setIdleTimeout(rule.idleTimeout);
+    flowMod->setHardTimeout(rule.hardTimeout);
+
+    Packet *reply = new Packet("FlowMod", flowMod);
+    if (sendTime <= simTime() && pendingFlowMods.empty()) {
+        socket.sendTo(reply, switchAddress, switchPort);
+        return;
+    }
+    pendingFlowMods.push_back({sendTime, reply, switchAddress, switchPort});
+    if (!flowModTimer->isScheduled())
+        scheduleAt(pendingFlowMods.front().sendTime, flowModTimer);
+}
+
+void SDNControllerApp::sendPendingFlowMods()
+{
+    while (!pendingFlowMods.empty() && pendingFlowMods.front().sendTime <= simTime()) {
+        PendingFlowMod &pending = pendingFlowMods.front();
+        socket.sendTo(pending.packet, pending.switchAddress, pending.switchPort);
+        pendingFlowMods.pop_front();
+    }
+    if (!pendingFlowMods.empty())
+        scheduleAt(pendingFlowMods.front().sendTime, flowModTimer);
+}
+
+simtime_t SDNControllerApp::serve(int numItems)
+{
+    // Returns when the items arriving now are served, after those before them
+    simtime_t serviceTime;
+    for (int i = 0; i < numItems; i++)
+        serviceTime += processingDelay->doubleValue();
+    busyUntil = std::max(busyUntil, simTime()) + serviceTime;
+    return busyUntil;
+}
+
+bool SDNControllerApp::insertFlowRule(FlowRule &&rule)
+{
+    FlowMatch match;
+    if (!FlowClassifier::makeMatch(rule.srcIP, rule.dstIP, rule.srcPort, rule.dstPort, rule.protocol, match))
+        return false;
+    rule.counterSlot = allocateCounterSlot(rule.flowId);
+    classifier.insert(rule.flowId, rule.priority, match);
+    if (analyzeFlowConflicts) {
+        // rules forwarding to different ports do different things
+        uint64_t action = std::hash<std::string>()(rule.action) ^ ((uint64_t)(uint32_t)rule.outputPort << 32);
+        if (conflictIndex.insert(rule.flowId, rule.priority, action, match) > 0) {
+            for (const FlowConflictIndex::Anomaly &anomaly : conflictIndex.getAnomalies(rule.flowId)) {
+                if (anomaly.kind == FlowConflictIndex::CONFLICTS_WITH)
+                    emit(flowConflictSignal, (long)rule.flowId);
+                else
+                    emit(flowShadowedSignal, (long)(anomaly.kind == FlowConflictIndex::SHADOWED_BY ? rule.flowId : anomaly.otherFlowId));
+            }
+            EV_WARN << "Flow rule " << rule.flowId << " " << describeFlowAnomalies(rule.flowId) << endl;
+        }
+    }
+    auto sliceIt = slices.find(rule.sliceId);
+    if (sliceIt != slices.end())
+        sliceIt->second.flowRuleIds.push_back(rule.flowId);
+    // flow IDs mostly grow, so the new rule usually goes at the end
+    auto it = flowTable.emplace_hint(flowTable.end(), rule.flowId, std::move(rule));
+    scheduleFlowExpiry(it->second);
+    return true;
+}
+
+std::string SDNControllerApp::describeFlowAnomalies(int flowId) const
+{
+    static const char *kindNames[] = {"", "is shadowed by", "shadows", "conflicts with"};
+    std::string text;
+    for (const FlowConflictIndex::Anomaly &anomaly : conflictIndex.getAnomalies(flowId))
+        text += std::string(text.empty() ? "" : ", ") + kindNames[anomaly.kind] + " flow rule " + std::to_string(anomaly.otherFlowId);
+    return text;
+}
+
 void SDNControllerApp::installFlowRule(const FlowRule &rule)
 {
     FlowRule newRule = rule;
-    newRule.flowId = nextFlowId++;
+    newRule.flowId = nextFlowId;
     newRule.installedTime = simTime();
+    newRule.lastMatchedTime = newRule.installedTime;
     newRule.packetsMatched = 0;
     newRule.bytesMatched = 0;
+    if (!insertFlowRule(std::move(newRule))) {
+        EV << "ERROR: Invalid match in flow rule " << rule.srcIP << " -> " << rule.dstIP << ", not installed" << endl;
+        return;
+    }
+    const FlowRule &installedRule = flowTable.at(nextFlowId);
+    nextFlowId = nextOwnedId(nextFlowId + 1);
+    flowCache.invalidate();
 
-    flowTable[newRule.flowId] = newRule;
-
-    emit(flowInstalledSignal, (long)newRule.flowId);
+    emit(flowInstalledSignal, (long)installedRule.flowId);
 
-    EV << "Installed flow rule " << newRule.flowId
-       << " from " << newRule.srcIP << " to " << newRule.dstIP << endl;
+    EV << "Installed flow rule " << installedRule.flowId
+       << " from " << installedRule.srcIP << " to " << installedRule.dstIP << endl;
 
-    saveState();
+    journalChange("ADD_FLOW", "\"flow\":" + flowToJson(installedRule));
+    publishChange(TELEMETRY_FLOW, installedRule.flowId, flowToBinary(installedRule));
 }
 
-void SDNControllerApp::removeFlowRule(int flowId)
+void SDNControllerApp::removeFlowRule(int flowId, const char *reason)
 {
     auto it = flowTable.find(flowId);
     if (it != flowTable.end()) {
+        auto sliceIt = slices.find(it->second.sliceId);
+        if (sliceIt != slices.end()) {
+            std::vector<int> &ids = sliceIt->second.flowRuleIds;
+            auto pos = std::find(ids.begin(), ids.end(), flowId);
+            if (pos != ids.end())
+                ids.erase(pos);
+        }
+        releaseCounterSlot(it->second.counterSlot);
         flowTable.erase(it);
+        classifier.remove(flowId);
+        conflictIndex.remove(flowId);
+        flowCache.invalidate();
+        flowExpiryWheel.cancel(flowId);
         emit(flowRemovedSignal, (long)flowId);
-        EV << "Removed flow rule " << flowId << endl;
-        saveState();
+        std::string body = "\"id\":" + std::to_string(flowId);
+        if (reason) {
+            EV << "Removed flow rule " << flowId << " (" << reason << ")" << endl;
+            body += ",\"reason\":" + StateJournal::quote(reason);
+        }
+        else
+            EV << "Removed flow rule " << flowId << endl;
+        journalChange("DELETE_FLOW", body);
+        publishChange(TELEMETRY_FLOW, flowId, std::string());
+    }
+}
+
+simtime_t SDNControllerApp::getExpiryDeadline(const FlowRule &rule) const
+{
+    simtime_t deadline = SIMTIME_MAX;
+    if (rule.hardTimeout > 0)
+        deadline = rule.installedTime + rule.hardTimeout;
+    if (rule.idleTimeout > 0)
+        deadline = std::min(deadline, rule.lastMatchedTime + rule.idleTimeout);
+    return deadline;
+}
+
+uint64_t SDNControllerApp::getExpiryTick(simtime_t t) const
+{
+    // the first tick at or after t
+    int64_t tick = t.raw() / flowExpiryTick.raw();
+    if (tick * flowExpiryTick.raw() < t.raw())
+        tick++;
+    return tick;
+}
+
+void SDNControllerApp::scheduleFlowExpiry(const FlowRule &rule)
+{
+    simtime_t deadline = getExpiryDeadline(rule);
+    if (deadline == SIMTIME_MAX)
+        return;
+
+    // The timer only runs while some flow has a timeout; the wheel's clock
+    // catches up when it is restarted
+    if (!flowExpiryTimer->isScheduled()) {
+        uint64_t currentTick = simTime().raw() / flowExpiryTick.raw();
+        flowExpiryWheel.advance(currentTick, expiredFlowIds);
+        scheduleAt(flowExpiryTick * (int64_t)(currentTick + 1), flowExpiryTimer);
+    }
+    flowExpiryWheel.schedule(rule.flowId, getExpiryTick(deadline));
+}
+
+void SDNControllerApp::expireFlows()
+{
+    // idle timeouts go by the latest data plane counts
+    if (!flowCounterTables.empty())
+        collectFlowCounters();
+
+    expiredFlowIds.clear();
+    flowExpiryWheel.advance(simTime().raw() / flowExpiryTick.raw(), expiredFlowIds);
+
+    // All rules expiring in this tick are removed with one journal flush
+    int numExpired = 0;
+    journal.beginBatch();
+    for (int flowId : expiredFlowIds) {
+        auto it = flowTable.find(flowId);
+        if (it == flowTable.end())
+            continue;
+        const FlowRule &rule = it->second;
+        simtime_t deadline = getExpiryDeadline(rule);
+        if (deadline > simTime()) {
+            // matched since the timer was set
+            flowExpiryWheel.schedule(flowId, getExpiryTick(deadline));
+            continue;
+        }
+        bool hard = rule.hardTimeout > 0 && rule.installedTime + rule.hardTimeout <= simTime();
+        if (hard) {
+            numHardExpiries++;
+            emit(flowHardExpiredSignal, (long)flowId);
+        }
+        else {
+            numIdleExpiries++;
+            emit(flowIdleExpiredSignal, (long)flowId);
+        }
+        removeFlowRule(flowId, hard ? "HARD_TIMEOUT" : "IDLE_TIMEOUT");
+        numExpired++;
+    }
+    journal.endBatch();
+
+    if (numExpired > 0)
+        EV << "Expired " << numExpired << " flow rules, " << flowExpiryWheel.size() << " timers pending" << endl;
+    if (!flowExpiryWheel.empty())
+        scheduleAt(simTime() + flowExpiryTick, flowExpiryTimer);
+}
+
+int SDNControllerApp::allocateCounterSlot(int flowId)
+{
+    int slot;
+    if (!freeCounterSlots.empty()) {
+        slot = freeCounterSlots.back();
+        freeCounterSlots.pop_back();
     }
+    else {
+        slot = flowOfCounterSlot.size();
+        flowOfCounterSlot.push_back(-1);
+    }
+    flowOfCounterSlot[slot] = flowId;
+    invalidateCounterSlots();
+    return slot;
+}
+
+void SDNControllerApp::releaseCounterSlot(int slot)
+{
+    // counts not collected yet belong to the removed rule, not to the slot's next one
+    for (auto &table : flowCounterTables)
+        table->discard(slot);
+    flowOfCounterSlot[slot] = -1;
+    freeCounterSlots.push_back(slot);
+    invalidateCounterSlots();
+}
+
+void SDNControllerApp::invalidateCounterSlots()
+{
+    // the switch ports resolve counter slots across all shards, see getCounterSlot()
+    flowCounterVersion++;
+    for (SDNControllerApp *shard : shards)
+        if (shard != nullptr && shard != this)
+            shard->flowCounterVersion++;
+}
+
+FlowCounterTable *SDNControllerApp::createFlowCounterTable(cModule *switchNode)
+{
+    Enter_Method("createFlowCounterTable");
+    if (flowStatsInterval <= SIMTIME_ZERO)
+        return nullptr;
+    // one for all ports of the switch, which counts each packet once
+    for (auto &table : flowCounterTables)
+        if (table->getSwitchId() == switchNode->getId())
+            return table.get();
+    flowCounterTables.push_back(std::make_unique<FlowCounterTable>(switchNode->getId()));
+    return flowCounterTables.back().get();
+}
+
+int SDNControllerApp::getCounterSlot(const PacketKey &key, int switchId, int &ownerShard) const
+{
+    auto switchIt = routingNodeOfModule.find(switchId);
+    auto hostIt = routingNodeOfHost.find(key.srcIp);
+    if (switchIt == routingNodeOfModule.end() || hostIt == routingNodeOfHost.end() || !routing.isAttached(hostIt->second, switchIt->second))
+        return -1;
+
+    // The rule matchPacketIn() picks (see selectShardRule()). Its slot is in
+    // the counter tables of the shard that owns it, which collects them.
+    const FlowRule *rule = selectShardRule(key, lookupFlow(key), ownerShard);
+    return rule != nullptr ? rule->counterSlot : -1;
+}
+
+void SDNControllerApp::collectFlowCounters()
+{
+    countedFlowIds.clear();
+    for (auto &table : flowCounterTables) {
+        table->collect([&](int slot, uint64_t packets, uint64_t bytes) {
+            FlowRule &rule = flowTable.at(flowOfCounterSlot[slot]);
+            rule.packetsMatched += packets;
+            rule.bytesMatched += bytes;
+            // as of the collection: a rule used until then is not idle
+            rule.lastMatchedTime = simTime();
+            countedFlowIds.push_back(rule.flowId);
+        });
+    }
+    if (countedFlowIds.empty())
+        return;
+
+    // the rules counted by several ports are exported once
+    std::sort(countedFlowIds.begin(), countedFlowIds.end());
+    countedFlowIds.erase(std::unique(countedFlowIds.begin(), countedFlowIds.end()), countedFlowIds.end());
+    journal.beginBatch();
+    for (int flowId : countedFlowIds) {
+        const FlowRule &rule = flowTable.at(flowId);
+        journalChange("FLOW_STATS", "\"id\":" + std::to_string(flowId) + ",\"packets\":" + std::to_string(rule.packetsMatched)
+                      + ",\"bytes\":" + std::to_string(rule.bytesMatched));
+        publishChange(TELEMETRY_FLOW, flowId, flowToBinary(rule));
+    }
+    journal.endBatch();
 }
 
 void SDNControllerApp::createSlice(const NetworkSlice &slice)
 {
     NetworkSlice newSlice = slice;
-    newSlice.sliceId = nextSliceId++;
+    newSlice.sliceId = nextSliceId;
+    nextSliceId = nextOwnedId(nextSliceId + 1);
     newSlice.createdTime = simTime();
+    newSlice.flowRuleIds.clear();
 
     slices[newSlice.sliceId] = newSlice;
+    indexSlice(newSlice);
 
     emit(sliceCreatedSignal, (long)newSlice.sliceId);
+    emit(sliceChangedSignal, (long)newSlice.sliceId);
 
     EV << "Created network slice " << newSlice.sliceId
        << " (" << newSlice.name << ")" << endl;
 
+    journal.beginBatch();
+    journalChange("CREATE_SLICE", "\"slice\":" + sliceToJson(newSlice));
+    publishChange(TELEMETRY_SLICE, newSlice.sliceId, sliceToBinary(newSlice));
+
     // Install default flows for slice isolation
-    for (const auto &hostIP : newSlice.hostIPs) {
-        FlowRule rule;
-        rule.srcIP = hostIP;
-        rule.dstIP = "";  // Any destination within slice
-        rule.srcPort = 0;
-        rule.dstPort = 0;
-        rule.action = "forward";
-        rule.outputPort = 0;
-        rule.priority = 100;
-        rule.sliceId = newSlice.sliceId;
-        installFlowRule(rule);
-    }
+    for (const auto &hostIP : newSlice.hostIPs)
+        installFlowRule(makeSliceFlowRule(hostIP, newSlice.sliceId));
 
-    saveState();
+    journal.endBatch();
 }
 
 void SDNControllerApp::deleteSlice(int sliceId)
 {
     auto it = slices.find(sliceId);
     if (it != slices.end()) {
-        // Remove all flows associated with this slice
-        std::vector<int> flowsToRemove;
-        for (const auto &flow : flowTable) {
-            if (flow.second.sliceId == sliceId) {
-                flowsToRemove.push_back(flow.first);
-            }
-        }
+        journal.beginBatch();
 
+        // Remove all flows associated with this slice; taking the list first
+        // spares removeFlowRule() the search in it
+        std::vector<int> flowsToRemove;
+        flowsToRemove.swap(it->second.flowRuleIds);
         for (int flowId : flowsToRemove) {
             removeFlowRule(flowId);
         }
 
+        unindexSlice(it->second);
         slices.erase(it);
+        emit(sliceChangedSignal, (long)sliceId);
         EV << "Deleted network slice " << sliceId << endl;
-        saveState();
+        journalChange("DELETE_SLICE", "\"id\":" + std::to_string(sliceId));
+        publishChange(TELEMETRY_SLICE, sliceId, std::string());
+        journal.endBatch();
     }
 }
 
@@ -192,162 +812,1083 @@ void SDNControllerApp::updateSlice(const NetworkSlice &slice)
 {
     auto it = slices.find(slice.sliceId);
     if (it != slices.end()) {
+        unindexSlice(it->second);
+        std::vector<int> flowRuleIds;
+        flowRuleIds.swap(it->second.flowRuleIds);
         it->second = slice;
+        it->second.flowRuleIds.swap(flowRuleIds);
+        indexSlice(it->second);
+        emit(sliceChangedSignal, (long)slice.sliceId);
         EV << "Updated slice " << slice.sliceId << endl;
-        saveState();
+        journalChange("UPDATE_SLICE", "\"slice\":" + sliceToJson(slice));
+        publishChange(TELEMETRY_SLICE, slice.sliceId, sliceToBinary(slice));
     }
 }
 
+void SDNControllerApp::indexSlice(const NetworkSlice &slice)
+{
+    for (const auto &hostIP : slice.hostIPs)
+        slicesByHost[hostIP].push_back(slice.sliceId);
+    slicesByVlan[slice.vlanId].push_back(slice.sliceId);
+    invalidateFloodDomains();
+}
+
+void SDNControllerApp::unindexSlice(const NetworkSlice &slice)
+{
+    auto removeFrom = [&](auto &index, const auto &key) {
+        auto it = index.find(key);
+        if (it == index.end())
+            return;
+        std::vector<int> &ids = it->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), slice.sliceId), ids.end());
+        if (ids.empty())
+            index.erase(it);
+    };
+    for (const auto &hostIP : slice.hostIPs)
+        removeFrom(slicesByHost, hostIP);
+    removeFrom(slicesByVlan, slice.vlanId);
+    invalidateFloodDomains();
+}
+
+void SDNControllerApp::invalidateFloodDomains()
+{
+    floodDomainVersion++;
+    floodPortsByVlan.clear();
+}
+
+FlowRule SDNControllerApp::makeSliceFlowRule(const std::string &hostIP, int sliceId)
+{
+    FlowRule rule;
+    rule.srcIP = hostIP;
+    rule.dstIP = "";  // Any destination within slice
+    rule.srcPort = 0;
+    rule.dstPort = 0;
+    rule.protocol = 0;
+    rule.action = "forward";
+    rule.outputPort = FlowRule::ROUTED_PORT;
+    rule.priority = 100;
+    rule.sliceId = sliceId;
+    return rule;
+}
+
 void SDNControllerApp::loadConfiguration()
 {
-    // Load slices from config file
-    // For now, create default slices
-
-    NetworkSlice slice1;
-    slice1.name = "Tenant_A";
-    slice1.vlanId = 10;
-    slice1.bandwidthMbps = 100;
-    slice1.isolated = true;
-    slice1.hostIPs = {"10.0.10.1", "10.0.10.2", "10.0.10.3", "10.0.10.4"};
-    createSlice(slice1);
-
-    NetworkSlice slice2;
-    slice2.name = "Tenant_B";
-    slice2.vlanId = 20;
-    slice2.bandwidthMbps = 200;
-    slice2.isolated = true;
-    slice2.hostIPs = {"10.0.20.1", "10.0.20.2", "10.0.20.3", "10.0.20.4"};
-    createSlice(slice2);
-
-    NetworkSlice slice3;
-    slice3.name = "Tenant_C";
-    slice3.vlanId = 30;
-    slice3.bandwidthMbps = 150;
-    slice3.isolated = true;
-    slice3.hostIPs = {"10.0.30.1", "10.0.30.2", "10.0.30.3", "10.0.30.4"};
-    createSlice(slice3);
+    // The tables are built in one pass, without the per-change journaling
+    // and telemetry of createSlice() and installFlowRule(); the caller
+    // exports the resulting state once. Every shard checks the whole
+    // configuration, and loads the entries it would have been sent as
+    // commands: slices by ID or else by name, flows by slice, ID or source
+    auto startTime = std::chrono::steady_clock::now();
+    std::string sliceText, flowText;  // referenced by the readers
+    JsonReader sliceReader, flowReader;
+    bool haveSliceConfig = readConfigFile(sliceConfigFile, sliceText, sliceReader);
+    bool haveFlowConfig = readConfigFile(flowConfigFile, flowText, flowReader);
+
+    if (haveSliceConfig) {
+        int i = 0;
+        for (JsonReader::Value data = getConfigList(sliceReader.getRoot(), "slices").getFirstChild(); data; data = data.getNextSibling(), i++) {
+            NetworkSlice slice;
+            std::string error;
+            int shard = shardIndex;
+            try {
+                parseSlice(data, slice);
+                if (data.has("id")) {
+                    slice.sliceId = data.get("id").asInt();
+                    shard = getShardOfId(slice.sliceId);
+                }
+                else {
+                    slice.sliceId = nextSliceId;
+                    shard = getShardOfKey(slice.name);
+                }
+            }
+            catch (const std::exception& e) {
+                error = e.what();
+            }
+            if (error.empty() && checkSlice(slice, error) && slices.count(slice.sliceId))
+                error = "duplicate slice id " + std::to_string(slice.sliceId);
+            if (!error.empty())
+                throw cRuntimeError("%s: slice #%d: %s", sliceConfigFile.c_str(), i, error.c_str());
+            if (shard == shardIndex)
+                loadSlice(std::move(slice));
+        }
+    }
+    else {
+        EV << "No slice configuration " << sliceConfigFile << ", creating example tenants" << endl;
+        static const struct { const char *name; int vlanId; double bandwidthMbps; } tenants[] = {
+            {"Tenant_A", 10, 100}, {"Tenant_B", 20, 200}, {"Tenant_C", 30, 150}
+        };
+        for (const auto &tenant : tenants) {
+            if (getShardOfKey(tenant.name) != shardIndex)
+                continue;
+            NetworkSlice slice;
+            slice.sliceId = nextSliceId;
+            slice.name = tenant.name;
+            slice.vlanId = tenant.vlanId;
+            slice.bandwidthMbps = tenant.bandwidthMbps;
+            slice.isolated = true;
+            for (int host = 1; host <= 4; host++)
+                slice.hostIPs.push_back("10.0." + std::to_string(tenant.vlanId) + "." + std::to_string(host));
+            loadSlice(std::move(slice));
+        }
+    }
+
+    if (haveFlowConfig) {
+        int i = 0;
+        for (JsonReader::Value data = getConfigList(flowReader.getRoot(), "flows").getFirstChild(); data; data = data.getNextSibling(), i++) {
+            FlowRule rule;
+            std::string error;
+            int shard = shardIndex;
+            try {
+                parseFlow(data, rule);
+                rule.flowId = data.has("id") ? data.get("id").asInt() : nextFlowId;
+                if (rule.sliceId != 0)
+                    shard = getShardOfId(rule.sliceId);
+                else
+                    shard = data.has("id") ? getShardOfId(rule.flowId) : getShardOfKey(rule.srcIP);
+            }
+            catch (const std::exception& e) {
+                error = e.what();
+            }
+            if (shard != shardIndex && error.empty())
+                continue;
+            if (error.empty() && checkFlow(rule, error)) {
+                if (getShardOfId(rule.flowId) != shardIndex)
+                    error = "flow id " + std::to_string(rule.flowId) + " is in the ID range of another shard than slice " + std::to_string(rule.sliceId);
+                else if (flowTable.count(rule.flowId))
+                    error = "duplicate flow id " + std::to_string(rule.flowId);
+                else if (rule.sliceId != 0 && !slices.count(rule.sliceId))
+                    error = "no slice with id " + std::to_string(rule.sliceId);
+            }
+            if (!error.empty())
+                throw cRuntimeError("%s: flow #%d: %s", flowConfigFile.c_str(), i, error.c_str());
+            loadFlowRule(std::move(rule));
+        }
+    }
+    flowCache.invalidate();
+
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    EV << "Loaded " << slices.size() << " slices and " << flowTable.size() << " flow rules in " << elapsedMs << " ms" << endl;
 }
 
-void SDNControllerApp::saveState()
+bool SDNControllerApp::readConfigFile(const std::string &fileName, std::string &text, JsonReader &reader)
+{
+    if (fileName.empty())
+        return false;
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    if (file.bad())
+        throw cRuntimeError("Cannot read %s", fileName.c_str());
+    text = contents.str();
+    try {
+        reader.parse(text);
+    }
+    catch (const std::exception& e) {
+        throw cRuntimeError("Cannot parse %s: %s", fileName.c_str(), e.what());
+    }
+    return true;
+}
+
+JsonReader::Value SDNControllerApp::getConfigList(const JsonReader::Value &root, const char *key)
+{
+    // Either a bare array, or an object with the array under key (as in
+    // the state file, which can thus be loaded as configuration)
+    if (root.isArray())
+        return root;
+    JsonReader::Value list = root.get(key);
+    if (!list.isArray())
+        throw cRuntimeError("Configuration must be a JSON array, or an object with a \"%s\" array", key);
+    return list;
+}
+
+void SDNControllerApp::loadSlice(NetworkSlice &&slice)
+{
+    slice.createdTime = simTime();
+    nextSliceId = std::max(nextSliceId, nextOwnedId(slice.sliceId + 1));
+    indexSlice(slice);
+    int sliceId = slice.sliceId;
+    auto it = slices.emplace_hint(slices.end(), sliceId, std::move(slice));
+    emit(sliceCreatedSignal, (long)sliceId);
+    emit(sliceChangedSignal, (long)sliceId);
+
+    // Default flows for slice isolation, as by createSlice()
+    for (const auto &hostIP : it->second.hostIPs) {
+        FlowRule rule = makeSliceFlowRule(hostIP, sliceId);
+        rule.flowId = nextFlowId;
+        loadFlowRule(std::move(rule));
+    }
+}
+
+void SDNControllerApp::loadFlowRule(FlowRule &&rule)
+{
+    int flowId = rule.flowId;
+    rule.installedTime = simTime();
+    rule.lastMatchedTime = rule.installedTime;
+    rule.packetsMatched = 0;
+    rule.bytesMatched = 0;
+    nextFlowId = std::max(nextFlowId, nextOwnedId(flowId + 1));
+    if (insertFlowRule(std::move(rule)))  // the match was checked before
+        emit(flowInstalledSignal, (long)flowId);
+}
+
+std::string SDNControllerApp::flowToJson(const FlowRule &flow)
+{
+    std::ostringstream os;
+    os << "{\"id\":" << flow.flowId
+       << ",\"srcIP\":" << StateJournal::quote(flow.srcIP)
+       << ",\"dstIP\":" << StateJournal::quote(flow.dstIP)
+       << ",\"action\":" << StateJournal::quote(flow.action)
+       << ",\"priority\":" << flow.priority
+       << ",\"sliceId\":" << flow.sliceId
+       << ",\"idleTimeout\":" << flow.idleTimeout
+       << ",\"hardTimeout\":" << flow.hardTimeout
+       << ",\"packets\":" << flow.packetsMatched
+       << ",\"bytes\":" << flow.bytesMatched << "}";
+    return os.str();
+}
+
+std::string SDNControllerApp::sliceToJson(const NetworkSlice &slice)
+{
+    std::ostringstream os;
+    os << "{\"id\":" << slice.sliceId
+       << ",\"name\":" << StateJournal::quote(slice.name)
+       << ",\"vlanId\":" << slice.vlanId
+       << ",\"bandwidth\":" << slice.bandwidthMbps
+       << ",\"isolated\":" << (slice.isolated ? "true" : "false")
+       << ",\"hosts\":[";
+    for (size_t i = 0; i < slice.hostIPs.size(); i++) {
+        if (i > 0) os << ",";
+        os << StateJournal::quote(slice.hostIPs[i]);
+    }
+    os << "]}";
+    return os.str();
+}
+
+void SDNControllerApp::journalChange(const char *op, const std::string &body)
+{
+    journal.append(simTime().dbl(), op, body);
+}
+
+// Record encodings of the telemetry socket, in the order of the JSON fields:
+//   flow:  i32 id | str srcIP | str dstIP | str action | i32 priority | i32 sliceId
+//          | f64 idleTimeout | f64 hardTimeout | i64 packets | i64 bytes
+//   slice: i32 id | str name | i32 vlanId | f64 bandwidth | u8 isolated | u16 numHosts | numHosts * str host
+// where str is a u16 length followed by the bytes (see TelemetryServer)
+std::string SDNControllerApp::flowToBinary(const FlowRule &flow)
+{
+    std::string record;
+    TelemetryServer::putI32(record, flow.flowId);
+    TelemetryServer::putString(record, flow.srcIP);
+    TelemetryServer::putString(record, flow.dstIP);
+    TelemetryServer::putString(record, flow.action);
+    TelemetryServer::putI32(record, flow.priority);
+    TelemetryServer::putI32(record, flow.sliceId);
+    TelemetryServer::putF64(record, flow.idleTimeout);
+    TelemetryServer::putF64(record, flow.hardTimeout);
+    TelemetryServer::putI64(record, flow.packetsMatched);
+    TelemetryServer::putI64(record, flow.bytesMatched);
+    return record;
+}
+
+std::string SDNControllerApp::sliceToBinary(const NetworkSlice &slice)
+{
+    std::string record;
+    TelemetryServer::putI32(record, slice.sliceId);
+    TelemetryServer::putString(record, slice.name);
+    TelemetryServer::putI32(record, slice.vlanId);
+    TelemetryServer::putF64(record, slice.bandwidthMbps);
+    TelemetryServer::putU8(record, slice.isolated ? 1 : 0);
+    TelemetryServer::putU16(record, slice.hostIPs.size());
+    for (const auto &hostIP : slice.hostIPs)
+        TelemetryServer::putString(record, hostIP);
+    return record;
+}
+
+void SDNControllerApp::startTelemetry(const std::string &socketPath)
+{
+    // Subscribers joining later get this state as their snapshot
+    for (const auto &entry : slices)
+        telemetry.putRecord(TELEMETRY_SLICE, entry.first, sliceToBinary(entry.second));
+    for (const auto &entry : flowTable)
+        telemetry.putRecord(TELEMETRY_FLOW, entry.first, flowToBinary(entry.second));
+    try {
+        telemetry.start(socketPath, journal.getSeq());
+    }
+    catch (const std::exception& e) {
+        throw cRuntimeError("%s", e.what());
+    }
+    EV << "Serving controller state on telemetry socket " << socketPath << endl;
+}
+
+void SDNControllerApp::publishChange(TelemetryRecordKind kind, int id, const std::string &record)
 {
-    if (!stateFile || !stateFile->is_open()) return;
+    // Deltas carry the sequence number of the journal entry of the same change
+    if (telemetry.isRunning())
+        telemetry.publish(journal.getSeq(), simTime().dbl(), kind, id, record);
+}
 
-    // Clear file
-    stateFile->close();
-    stateFile->open("results/controller_state.json", std::ios::trunc);
+void SDNControllerApp::saveState()
+{
+    if (!journal.isOpen()) return;
+
+    // Write the compacted snapshot to a temporary file and rename it into place,
+    // so readers never observe a partially written state file
+    std::string tmpFileName = stateFileName + ".tmp";
+    std::ofstream stateFile(tmpFileName, std::ios::trunc);
+    if (!stateFile.is_open()) {
+        EV << "ERROR: Cannot write state snapshot " << tmpFileName << endl;
+        return;
+    }
 
-    *stateFile << "{" << std::endl;
-    *stateFile << "  \"timestamp\": " << simTime().dbl() << "," << std::endl;
-    *stateFile << "  \"slices\": [" << std::endl;
+    stateFile << "{\n";
+    stateFile << "  \"timestamp\": " << simTime().dbl() << ",\n";
+    stateFile << "  \"seq\": " << journal.getSeq() << ",\n";
+    stateFile << "  \"slices\": [\n";
 
     bool firstSlice = true;
     for (const auto &entry : slices) {
-        if (!firstSlice) *stateFile << "," << std::endl;
+        if (!firstSlice) stateFile << ",\n";
         firstSlice = false;
 
         const auto &slice = entry.second;
-        *stateFile << "    {" << std::endl;
-        *stateFile << "      \"id\": " << slice.sliceId << "," << std::endl;
-        *stateFile << "      \"name\": \"" << slice.name << "\"," << std::endl;
-        *stateFile << "      \"vlanId\": " << slice.vlanId << "," << std::endl;
-        *stateFile << "      \"bandwidth\": " << slice.bandwidthMbps << "," << std::endl;
-        *stateFile << "      \"isolated\": " << (slice.isolated ? "true" : "false") << "," << std::endl;
-        *stateFile << "      \"hosts\": [";
+        stateFile << "    {\n";
+        stateFile << "      \"id\": " << slice.sliceId << ",\n";
+        stateFile << "      \"name\": " << StateJournal::quote(slice.name) << ",\n";
+        stateFile << "      \"vlanId\": " << slice.vlanId << ",\n";
+        stateFile << "      \"bandwidth\": " << slice.bandwidthMbps << ",\n";
+        stateFile << "      \"isolated\": " << (slice.isolated ? "true" : "false") << ",\n";
+        stateFile << "      \"hosts\": [";
         for (size_t i = 0; i < slice.hostIPs.size(); i++) {
-            if (i > 0) *stateFile << ", ";
-            *stateFile << "\"" << slice.hostIPs[i] << "\"";
+            if (i > 0) stateFile << ", ";
+            stateFile << StateJournal::quote(slice.hostIPs[i]);
         }
-        *stateFile << "]" << std::endl;
-        *stateFile << "    }";
+        stateFile << "]\n";
+        stateFile << "    }";
     }
 
-    *stateFile << std::endl << "  ]," << std::endl;
-    *stateFile << "  \"flows\": [" << std::endl;
+    stateFile << "\n  ],\n";
+    if (analyzeFlowConflicts) {
+        stateFile << "  \"flowAnomalies\": {\"shadowed\": " << conflictIndex.getNumShadowedRules()
+                  << ", \"conflicts\": " << conflictIndex.getNumConflicts() << "},\n";
+    }
+    stateFile << "  \"flows\": [\n";
 
     bool firstFlow = true;
     for (const auto &entry : flowTable) {
-        if (!firstFlow) *stateFile << "," << std::endl;
+        if (!firstFlow) stateFile << ",\n";
         firstFlow = false;
 
         const auto &flow = entry.second;
-        *stateFile << "    {" << std::endl;
-        *stateFile << "      \"id\": " << flow.flowId << "," << std::endl;
-        *stateFile << "      \"srcIP\": \"" << flow.srcIP << "\"," << std::endl;
-        *stateFile << "      \"dstIP\": \"" << flow.dstIP << "\"," << std::endl;
-        *stateFile << "      \"action\": \"" << flow.action << "\"," << std::endl;
-        *stateFile << "      \"priority\": " << flow.priority << "," << std::endl;
-        *stateFile << "      \"sliceId\": " << flow.sliceId << "," << std::endl;
-        *stateFile << "      \"packets\": " << flow.packetsMatched << "," << std::endl;
-        *stateFile << "      \"bytes\": " << flow.bytesMatched << std::endl;
-        *stateFile << "    }";
+        stateFile << "    {\n";
+        stateFile << "      \"id\": " << flow.flowId << ",\n";
+        stateFile << "      \"srcIP\": " << StateJournal::quote(flow.srcIP) << ",\n";
+        stateFile << "      \"dstIP\": " << StateJournal::quote(flow.dstIP) << ",\n";
+        stateFile << "      \"action\": " << StateJournal::quote(flow.action) << ",\n";
+        stateFile << "      \"priority\": " << flow.priority << ",\n";
+        stateFile << "      \"sliceId\": " << flow.sliceId << ",\n";
+        stateFile << "      \"idleTimeout\": " << flow.idleTimeout << ",\n";
+        stateFile << "      \"hardTimeout\": " << flow.hardTimeout << ",\n";
+        stateFile << "      \"packets\": " << flow.packetsMatched << ",\n";
+        const std::vector<FlowConflictIndex::Anomaly> &anomalies = conflictIndex.getAnomalies(flow.flowId);
+        for (int kind = FlowConflictIndex::SHADOWED_BY; !anomalies.empty() && kind <= FlowConflictIndex::CONFLICTS_WITH; kind++) {
+            static const char *anomalyKeys[] = {"", "shadowedBy", "shadows", "conflictsWith"};
+            std::string ids;
+            for (const FlowConflictIndex::Anomaly &anomaly : anomalies)
+                if (anomaly.kind == kind)
+                    ids += (ids.empty() ? "" : ", ") + std::to_string(anomaly.otherFlowId);
+            if (!ids.empty())
+                stateFile << "      \"" << anomalyKeys[kind] << "\": [" << ids << "],\n";
+        }
+        stateFile << "      \"bytes\": " << flow.bytesMatched << "\n";
+        stateFile << "    }";
     }
 
-    *stateFile << std::endl << "  ]" << std::endl;
-    *stateFile << "}" << std::endl;
+    stateFile << "\n  ]\n";
+    stateFile << "}\n";
+    snapshotBytes += std::max<std::streamoff>(stateFile.tellp(), 0);
+    stateFile.close();
 
-    stateFile->flush();
+    if (stateFile.fail() || std::rename(tmpFileName.c_str(), stateFileName.c_str()) != 0) {
+        EV << "ERROR: Cannot write state snapshot " << stateFileName << endl;
+        return;
+    }
+
+    // Everything up to the current seq is now in the snapshot
+    journal.restart();
+}
+
+void SDNControllerApp::writeCheckpoint()
+{
+    if (checkpointFileName.empty())
+        return;
+
+    CheckpointWriter writer(journal.getSeq(), simTime().raw(), SimTime::getScaleExp(), nextFlowId, nextSliceId);
+    for (const auto &entry : slices) {
+        const NetworkSlice &slice = entry.second;
+        CheckpointSliceRecord record = {};
+        record.id = slice.sliceId;
+        record.vlanId = slice.vlanId;
+        record.bandwidthMbps = slice.bandwidthMbps;
+        record.createdTimeRaw = slice.createdTime.raw();
+        record.isolated = slice.isolated;
+        writer.addSlice(record, slice.name, slice.hostIPs);
+    }
+    writer.reserveFlows(flowTable.size());
+    for (const auto &entry : flowTable) {
+        const FlowRule &rule = entry.second;
+        CheckpointFlowRecord record = {};
+        record.id = rule.flowId;
+        record.srcPort = rule.srcPort;
+        record.dstPort = rule.dstPort;
+        record.protocol = rule.protocol;
+        record.outputPort = rule.outputPort;
+        record.priority = rule.priority;
+        record.sliceId = rule.sliceId;
+        record.installedTimeRaw = rule.installedTime.raw();
+        record.lastMatchedTimeRaw = rule.lastMatchedTime.raw();
+        record.idleTimeout = rule.idleTimeout;
+        record.hardTimeout = rule.hardTimeout;
+        record.packetsMatched = rule.packetsMatched;
+        record.bytesMatched = rule.bytesMatched;
+        writer.addFlow(record, rule.srcIP, rule.dstIP, rule.action);
+    }
+
+    try {
+        writer.write(checkpointFileName);
+    }
+    catch (const std::exception& e) {
+        EV << "ERROR: " << e.what() << endl;
+        return;
+    }
+    checkpointSeq = journal.getSeq();
+}
+
+bool SDNControllerApp::restoreCheckpoint()
+{
+    if (checkpointFileName.empty())
+        return false;
+
+    auto startTime = std::chrono::steady_clock::now();
+    CheckpointReader reader;
+    try {
+        if (!reader.open(checkpointFileName))
+            return false;
+    }
+    catch (const std::exception& e) {
+        EV << "ERROR: " << e.what() << ", not restored" << endl;
+        return false;
+    }
+
+    // Times of an earlier run may lie ahead of the current one; those
+    // restart now (e.g. the timeouts of the rules installed then)
+    const CheckpointHeader &header = reader.getHeader();
+    simtime_t now = simTime();
+    auto toSimTime = [&](int64_t raw) {
+        simtime_t t = header.simtimeScale == SimTime::getScaleExp() ? SimTime::fromRaw(raw) : SimTime(raw, (SimTimeUnit)header.simtimeScale);
+        return std::min(t, now);
+    };
+
+    clearState();
+    nextFlowId = nextOwnedId(header.nextFlowId);
+    nextSliceId = nextOwnedId(header.nextSliceId);
+
+    for (uint32_t i = 0; i < header.numSlices; i++) {
+        const CheckpointSliceRecord &record = reader.getSlice(i);
+        NetworkSlice slice;
+        slice.sliceId = record.id;
+        slice.name = reader.getString(record.name);
+        slice.vlanId = record.vlanId;
+        slice.bandwidthMbps = record.bandwidthMbps;
+        slice.isolated = record.isolated != 0;
+        slice.createdTime = toSimTime(record.createdTimeRaw);
+        slice.hostIPs.reserve(record.numHosts);
+        for (uint32_t j = 0; j < record.numHosts; j++)
+            slice.hostIPs.push_back(reader.getString(reader.getHost(record, j)));
+        indexSlice(slice);
+        // records are in ID order, so every insertion is at the end
+        slices.emplace_hint(slices.end(), slice.sliceId, std::move(slice));
+    }
+
+    for (uint32_t i = 0; i < header.numFlows; i++) {
+        const CheckpointFlowRecord &record = reader.getFlow(i);
+        FlowRule rule;
+        rule.flowId = record.id;
+        rule.srcIP = reader.getString(record.srcIP);
+        rule.dstIP = reader.getString(record.dstIP);
+        rule.srcPort = record.srcPort;
+        rule.dstPort = record.dstPort;
+        rule.protocol = record.protocol;
+        rule.action = reader.getString(record.action);
+        rule.outputPort = record.outputPort;
+        rule.priority = record.priority;
+        rule.sliceId = record.sliceId;
+        rule.installedTime = toSimTime(record.installedTimeRaw);
+        rule.lastMatchedTime = toSimTime(record.lastMatchedTimeRaw);
+        rule.idleTimeout = record.idleTimeout;
+        rule.hardTimeout = record.hardTimeout;
+        rule.packetsMatched = record.packetsMatched;
+        rule.bytesMatched = record.bytesMatched;
+
+        if (!insertFlowRule(std::move(rule)))
+            EV << "ERROR: Invalid match in flow rule " << record.id << " of the checkpoint, not restored" << endl;
+    }
+    flowCache.invalidate();
+    checkpointSeq = journal.getSeq();
+
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    EV << "Restored " << slices.size() << " slices and " << flowTable.size() << " flow rules from checkpoint "
+       << checkpointFileName << " (version " << header.version << ", t=" << SimTime::fromRaw(header.timeRaw)
+       << ") in " << elapsedMs << " ms" << endl;
+    return true;
+}
+
+void SDNControllerApp::clearState()
+{
+    // Counts the switches have not reported yet are lost with the rules
+    for (auto &table : flowCounterTables)
+        table->collect([](int, uint64_t, uint64_t) {});
+    flowOfCounterSlot.clear();
+    freeCounterSlots.clear();
+    invalidateCounterSlots();
+
+    cancelEvent(flowExpiryTimer);
+    flowExpiryWheel.clear();
+    flowTable.clear();
+    slices.clear();
+    slicesByHost.clear();
+    slicesByVlan.clear();
+    classifier.clear();
+    conflictIndex.clear();
+    flowCache.invalidate();
+    nextFlowId = nextOwnedId(1);
+    nextSliceId = nextOwnedId(1);
+}
+
+void SDNControllerApp::compactStateIfNeeded()
+{
+    // Compact once the journal is as long as the state itself, which keeps
+    // the amortized export cost per mutation constant
+    uint64_t threshold = std::max((uint64_t)snapshotMinJournalEntries, (uint64_t)(flowTable.size() + slices.size()));
+    if (journal.getEntriesSinceSnapshot() >= threshold)
+        saveState();
 }
 
 void SDNControllerApp::exportTopology()
 {
+    // Walk the actual network: all INET network nodes, and the links between
+    // them with the parameters of their channels
+    cTopology topo("topology");
+    topo.extractByProperty("networkNode");
+    cModule *controllerNode = getContainingNode(this);
+
+    // module full name without brackets, e.g. "aggSwitch2"
+    auto nodeId = [](cModule *module) {
+        std::string id;
+        for (const char *p = module->getFullName(); *p; p++)
+            if (*p != '[' && *p != ']')
+                id += *p;
+        return StateJournal::quote(id);
+    };
+
+    // Written as the network is walked, one node or link per line, so that
+    // neither the export nor a line-by-line reader has to hold the whole
+    // document for large (e.g. fat-tree) networks
     std::ofstream topoFile("results/topology.json");
+    topoFile << "{\"nodes\":[\n";
+    for (int i = 0; i < topo.getNumNodes(); i++) {
+        cModule *node = topo.getNode(i)->getModule();
+        topoFile << (i == 0 ? "" : ",\n") << "{\"id\":" << nodeId(node);
+        if (node == controllerNode)
+            topoFile << ",\"type\":\"controller\"";
+        else if (isSwitchNode(node))
+            topoFile << ",\"type\":\"switch\"";
+        else {
+            topoFile << ",\"type\":\"host\"";
+            L3Address address;
+            if (L3AddressResolver().tryResolve(node->getFullPath().c_str(), address, L3AddressResolver::ADDR_IPv4)) {
+                std::string hostIP = address.str();
+                topoFile << ",\"ip\":" << StateJournal::quote(hostIP);
+                // the dashboard numbers slices from 0, slice IDs start at 1
+                const std::vector<int>& hostSlices = getSlicesOfHost(hostIP);
+                if (!hostSlices.empty())
+                    topoFile << ",\"slice\":" << hostSlices.front() - 1;
+            }
+        }
+        topoFile << "}";
+    }
+
+    topoFile << "\n],\"links\":[\n";
+    bool first = true;
+    for (int i = 0; i < topo.getNumNodes(); i++) {
+        cTopology::Node *node = topo.getNode(i);
+        for (int j = 0; j < node->getNumOutLinks(); j++) {
+            cTopology::LinkOut *link = node->getLinkOut(j);
+            // a duplex connection is a link in each direction; export it once
+            if (node->getModule()->getId() > link->getRemoteNode()->getModule()->getId())
+                continue;
+            cGate *localGate = link->getLocalGate();
+            cGate *remoteGate = link->getRemoteGate();
+            topoFile << (first ? "" : ",\n")
+                     << "{\"source\":" << nodeId(node->getModule())
+                     << ",\"target\":" << nodeId(link->getRemoteNode()->getModule())
+                     << ",\"sourcePort\":" << (localGate->isVector() ? localGate->getIndex() : 0)
+                     << ",\"targetPort\":" << (remoteGate->isVector() ? remoteGate->getIndex() : 0);
+            if (auto channel = dynamic_cast<cDatarateChannel *>(localGate->getChannel()))
+                topoFile << ",\"datarate\":" << channel->getDatarate()
+                         << ",\"delay\":" << channel->getDelay().dbl();
+            topoFile << "}";
+            first = false;
+        }
+    }
+    topoFile << "\n]}\n";
 
-    topoFile << "{" << std::endl;
-    topoFile << "  \"nodes\": [" << std::endl;
-    topoFile << "    {\"id\": \"controller\", \"type\": \"controller\"}," << std::endl;
-    topoFile << "    {\"id\": \"coreSwitch1\", \"type\": \"switch\"}," << std::endl;
-    topoFile << "    {\"id\": \"coreSwitch2\", \"type\": \"switch\"}," << std::endl;
+    topoFile.close();
+    EV << "Exported topology: " << topo.getNumNodes() << " nodes" << endl;
+}
 
-    for (int i = 0; i < 3; i++) {
-        topoFile << "    {\"id\": \"aggSwitch" << i << "\", \"type\": \"switch\"}," << std::endl;
+void SDNControllerApp::buildRoutingService()
+{
+    // The same network as in exportTopology(), with ports numbered alike
+    cTopology topo("routing");
+    topo.extractByProperty("networkNode");
+
+    routing.clear();
+    routingNodeOfModule.clear();
+    routingNodeOfHost.clear();
+    routingLinkOfGate.clear();
+    for (int i = 0; i < topo.getNumNodes(); i++) {
+        cModule *node = topo.getNode(i)->getModule();
+        if (isSwitchNode(node))
+            routingNodeOfModule[node->getId()] = routing.addSwitch();
+        else {
+            int routingNode = routing.addHost();
+            routingNodeOfModule[node->getId()] = routingNode;
+            L3Address address;
+            if (L3AddressResolver().tryResolve(node->getFullPath().c_str(), address, L3AddressResolver::ADDR_IPv4))
+                routingNodeOfHost[address.toIpv4().getInt()] = routingNode;
+        }
     }
 
-    for (int i = 0; i < 3; i++) {
-        topoFile << "    {\"id\": \"edgeSwitch" << i << "\", \"type\": \"switch\"}," << std::endl;
+    std::vector<int> linksDown;
+    for (int i = 0; i < topo.getNumNodes(); i++) {
+        cTopology::Node *node = topo.getNode(i);
+        for (int j = 0; j < node->getNumOutLinks(); j++) {
+            cTopology::LinkOut *link = node->getLinkOut(j);
+            cModule *remoteNode = link->getRemoteNode()->getModule();
+            if (node->getModule()->getId() > remoteNode->getId())
+                continue;
+            cGate *localGate = link->getLocalGate();
+            cGate *remoteGate = link->getRemoteGate();
+            int linkId = routing.addLink(routingNodeOfModule[node->getModule()->getId()], localGate->isVector() ? localGate->getIndex() : 0,
+                                         routingNodeOfModule[remoteNode->getId()], remoteGate->isVector() ? remoteGate->getIndex() : 0);
+            // the link in the other direction leaves from the other half of the remote inout gate
+            routingLinkOfGate[localGate] = linkId;
+            if (cGate *remoteOutGate = remoteGate->getOtherHalf())
+                routingLinkOfGate[remoteOutGate] = linkId;
+            if (!isLinkEnabled(localGate))
+                linksDown.push_back(linkId);
+        }
     }
 
-    for (int i = 0; i < 12; i++) {
-        topoFile << "    {\"id\": \"host" << i << "\", \"type\": \"host\", \"slice\": " << (i/4) << "}";
-        if (i < 11) topoFile << ",";
-        topoFile << std::endl;
+    invalidateCounterSlots();  // hosts may be attached to other switches
+    invalidateFloodDomains();
+    routing.computeAll();
+    for (int linkId : linksDown)
+        routing.setLinkUp(linkId, false);
+    EV << "Routing: " << routing.getNumSwitches() << " switches, " << routing.getNumLinks() << " links, "
+       << routingNodeOfHost.size() << " addressable hosts" << endl;
+}
+
+void SDNControllerApp::computeFloodDomain(int vlanId) const
+{
+    // Members: the hosts of the VLAN's slices and the shared hosts, over
+    // the slices of all shards
+    std::vector<int> hostNodes;
+    for (const auto &entry : routingNodeOfHost) {
+        std::string address = Ipv4Address(entry.first).str();
+        bool inSlice = false, member = vlanId == 0;
+        for (const SDNControllerApp *shard : shards) {
+            auto it = shard->slicesByHost.find(address);
+            if (it == shard->slicesByHost.end())
+                continue;
+            inSlice = true;
+            for (int sliceId : it->second)
+                if (shard->slices.at(sliceId).vlanId == vlanId)
+                    member = true;
+        }
+        if (member || !inSlice)
+            hostNodes.push_back(entry.second);
     }
+    std::sort(hostNodes.begin(), hostNodes.end());  // the first is the root of the tree
+
+    std::vector<std::pair<int, int>> ports;
+    routing.computeFloodTree(hostNodes, ports);
+    std::unordered_map<int, std::vector<int>> &floodPorts = floodPortsByVlan[vlanId];
+    for (const auto &port : ports)
+        floodPorts[port.first].push_back(port.second);
+    EV << "Flood domain of VLAN " << vlanId << ": " << hostNodes.size() << " hosts, "
+       << floodPorts.size() << " switches, " << ports.size() << " ports" << endl;
+}
 
-    topoFile << "  ]," << std::endl;
-    topoFile << "  \"links\": [" << std::endl;
-    // Add links here
-    topoFile << "  ]" << std::endl;
-    topoFile << "}" << std::endl;
+uint64_t SDNControllerApp::getFloodDomainVersion() const
+{
+    uint64_t version = 0;
+    for (const SDNControllerApp *shard : shards)
+        version += shard->floodDomainVersion;
+    return version;
+}
 
-    topoFile.close();
+const std::vector<int>& SDNControllerApp::getFloodPorts(cModule *switchNode, int vlanId) const
+{
+    static const std::vector<int> none;
+    auto nodeIt = routingNodeOfModule.find(switchNode->getId());
+    if (nodeIt == routingNodeOfModule.end())
+        return none;
+    uint64_t version = getFloodDomainVersion();
+    if (version != floodPortsVersion) {
+        floodPortsByVlan.clear();  // a slice of another shard changed
+        floodPortsVersion = version;
+    }
+    if (floodPortsByVlan.find(vlanId) == floodPortsByVlan.end())
+        computeFloodDomain(vlanId);
+    const std::unordered_map<int, std::vector<int>> &floodPorts = floodPortsByVlan.at(vlanId);
+    auto it = floodPorts.find(nodeIt->second);
+    return it != floodPorts.end() ? it->second : none;
+}
+
+bool SDNControllerApp::isLinkEnabled(cGate *outputGate)
+{
+    // both directions connected, and neither channel disabled
+    cGate *inputGate = outputGate->getNextGate();
+    cGate *returnGate = inputGate != nullptr ? inputGate->getOtherHalf() : nullptr;
+    if (returnGate == nullptr || returnGate->getNextGate() == nullptr)
+        return false;
+    for (cGate *gate : {outputGate, returnGate})
+        if (gate->getChannel() != nullptr && gate->getChannel()->isDisabled())
+            return false;
+    return true;
+}
+
+void SDNControllerApp::updateRoutingLink(int linkId, bool up)
+{
+    if (routing.isLinkUp(linkId) == up)
+        return;
+    routing.setLinkUp(linkId, up);
+    invalidateFloodDomains();
+    const RoutingService::UpdateStats& stats = routing.getLastUpdateStats();
+    EV << "Routing: link " << linkId << (up ? " up" : " down") << ", routes to " << stats.destinationsUpdated
+       << " switches changed (" << stats.distancesChanged << " distances)" << endl;
+}
+
+void SDNControllerApp::updateRoutingSwitch(cModule *node, bool up)
+{
+    auto it = routingNodeOfModule.find(node->getId());
+    if (it == routingNodeOfModule.end() || !routing.isSwitch(it->second) || routing.isSwitchUp(it->second) == up)
+        return;
+    routing.setSwitchUp(it->second, up);
+    invalidateFloodDomains();
+    const RoutingService::UpdateStats& stats = routing.getLastUpdateStats();
+    EV << "Routing: switch " << node->getFullPath() << (up ? " up" : " down") << ", routes to " << stats.destinationsUpdated
+       << " switches changed (" << stats.distancesChanged << " distances)" << endl;
+}
+
+void SDNControllerApp::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details)
+{
+    Enter_Method_Silent();
+
+    // nothing to follow while the network is being torn down
+    if (getSimulation()->getStage() != cSimulation::STAGE_EVENT)
+        return;
+
+    if (signalID == NodeStatus::nodeStatusChangedSignal) {
+        NodeStatus *nodeStatus = check_and_cast<NodeStatus *>(obj);
+        updateRoutingSwitch(getContainingNode(nodeStatus), nodeStatus->getState() == NodeStatus::UP);
+    }
+    else if (auto notification = dynamic_cast<cPreModuleDeleteNotification *>(obj)) {
+        if (routingNodeOfModule.count(notification->module->getId())) {
+            updateRoutingSwitch(notification->module, false);
+            // its gates go away with it
+            for (auto it = routingLinkOfGate.begin(); it != routingLinkOfGate.end(); )
+                it = it->first->getOwnerModule() == notification->module ? routingLinkOfGate.erase(it) : std::next(it);
+        }
+    }
+    else if (auto notification = dynamic_cast<cPreGateDisconnectNotification *>(obj)) {
+        auto it = routingLinkOfGate.find(notification->gate);
+        if (it != routingLinkOfGate.end())
+            updateRoutingLink(it->second, false);
+    }
+    else if (auto notification = dynamic_cast<cPostGateConnectNotification *>(obj)) {
+        auto it = routingLinkOfGate.find(notification->gate);
+        if (it != routingLinkOfGate.end())
+            updateRoutingLink(it->second, isLinkEnabled(notification->gate));
+    }
+    else if (auto notification = dynamic_cast<cPostParameterChangeNotification *>(obj)) {
+        cChannel *channel = dynamic_cast<cChannel *>(notification->par->getOwner());
+        if (channel != nullptr && strcmp(notification->par->getName(), "disabled") == 0) {
+            auto it = routingLinkOfGate.find(channel->getSourceGate());
+            if (it != routingLinkOfGate.end())
+                updateRoutingLink(it->second, isLinkEnabled(channel->getSourceGate()));
+        }
+    }
+}
+
+void SDNControllerApp::handleMessageWhenDown(cMessage *msg)
+{
+    // Commands that arrive while down are taken after the restart
+    if (msg == commandArrivedMsg)
+        return;
+    ApplicationBase::handleMessageWhenDown(msg);
 }
 
 void SDNControllerApp::handleStartOperation(LifecycleOperation *operation)
 {
     socket.bind(localPort);
+
+    // The initial start is completed by initialize()
+    if (operation == nullptr)
+        return;
+
+    // A restart recovers the state from the checkpoint, and starts from the
+    // configuration only without one. Either way the state is older than what
+    // was exported before, so it goes out under a new seq: snapshot readers
+    // and telemetry subscribers reload it instead of keeping their newer state.
+    journal.skip();
+    if (!restoreCheckpoint())
+        loadConfiguration();
+    saveState();
+    if (!telemetrySocketPath.empty()) {
+        telemetry.clearRecords();
+        startTelemetry(telemetrySocketPath);
+    }
+
+    if (!commandScheduler || !commandScheduler->isWatchingFile())
+        scheduleAt(simTime() + 1.0, checkCommandTimer);
+    else
+        scheduleAt(simTime(), checkCommandTimer);
+    // the scheduler may have already inserted it on input that arrived while down
+    if (commandScheduler && !commandArrivedMsg->isScheduled())
+        scheduleAt(simTime(), commandArrivedMsg);
+    scheduleAt(simTime() + snapshotInterval, snapshotTimer);
+    if (checkpointTimer)
+        scheduleAt(simTime() + checkpointInterval, checkpointTimer);
+    if (flowStatsTimer)
+        scheduleAt(simTime() + flowStatsInterval, flowStatsTimer);
 }
 
 void SDNControllerApp::handleStopOperation(LifecycleOperation *operation)
 {
+    if (!flowCounterTables.empty())
+        collectFlowCounters();
+    writeCheckpoint();
+    for (cMessage *timer : {checkCommandTimer, commandArrivedMsg, dispatchTimer, snapshotTimer, checkpointTimer, flowStatsTimer, flowModTimer})
+        if (timer)
+            cancelEvent(timer);
+    for (const auto &pending : pendingFlowMods)
+        delete pending.packet;
+    pendingFlowMods.clear();
+    if (!commandQueue.isEmpty())
+        EV_WARN << "Dropping " << commandQueue.getNumQueuedCommands() << " queued command(s)" << endl;
+    commandQueue.clear();
+    clearState();
+    telemetry.stop();
     socket.close();
 }
 
 void SDNControllerApp::handleCrashOperation(LifecycleOperation *operation)
 {
+    // Everything since the last checkpoint is lost
+    for (cMessage *timer : {checkCommandTimer, commandArrivedMsg, dispatchTimer, snapshotTimer, checkpointTimer, flowStatsTimer, flowModTimer})
+        if (timer)
+            cancelEvent(timer);
+    for (const auto &pending : pendingFlowMods)
+        delete pending.packet;
+    pendingFlowMods.clear();
+    if (!commandQueue.isEmpty())
+        EV_WARN << "Dropping " << commandQueue.getNumQueuedCommands() << " queued command(s)" << endl;
+    commandQueue.clear();
+    clearState();
+    telemetry.stop();
     socket.destroy();
 }
 
 void SDNControllerApp::finish()
 {
+    collectFlowCounters();
     saveState();
+    if (isUp())
+        writeCheckpoint();
+    telemetry.stop();
+    if (par("recordPerformance"))
+        recordPerformance();
     ApplicationBase::finish();
 }
 
+void SDNControllerApp::recordPerformance()
+{
+    // Wall-clock results differ from run to run, hence not recorded by default
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStartTime).count();
+    eventnumber_t numEvents = getSimulation()->getEventNumber() - runStartEventNumber;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    recordScalar("eventsPerSecond", elapsed > 0 ? numEvents / elapsed : 0);
+    recordScalar("handlerTime", handlerTime, "s");
+    recordScalar("handledEvents", numHandledEvents);
+    recordScalar("stateExportBytes", snapshotBytes + journal.getBytesWritten() + telemetry.getStats().bytesSent, "B");
+    recordScalar("peakRss", usage.ru_maxrss * 1024.0, "B");  // ru_maxrss is in KiB on Linux
+    recordScalar("flowTableSize", flowTable.size());
+    recordScalar("sliceTableSize", slices.size());
+}
+
+bool SDNControllerApp::submitCommand(const std::string &cmdJson, simtime_t *completionTime)
+{
+    Enter_Method("submitCommand");
+    if (!isUp())
+        return false;
+    auto startTime = std::chrono::steady_clock::now();
+    simtime_t servedTime = parseAndExecuteCommand(cmdJson);
+    compactStateIfNeeded();
+    handlerTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    if (completionTime)
+        *completionTime = servedTime;
+    return true;
+}
+
+bool SDNControllerApp::submitPacketIn(int switchId, const PacketKey &key, int64_t bytes, simtime_t *completionTime)
+{
+    Enter_Method("submitPacketIn");
+    if (!isUp())
+        return false;
+    auto startTime = std::chrono::steady_clock::now();
+    simtime_t servedTime = serve(1);
+    emit(packetInLatencySignal, servedTime - simTime());
+    const FlowRule *rule = matchPacketIn(key, bytes);
+    if (rule != nullptr && getOutputPort(*rule, key, switchId) == FlowRule::ROUTED_PORT)
+        EV_DETAIL << "PACKET_IN from switch " << switchId << " matched flow rule " << rule->flowId << ", but there is no route" << endl;
+    handlerTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    numHandledEvents++;
+    if (completionTime)
+        *completionTime = servedTime;
+    return true;
+}
+
 int SDNControllerApp::addFlow(const FlowRule &rule)
 {
     installFlowRule(rule);
     return rule.flowId;
 }
 
+const FlowRule *SDNControllerApp::lookupFlow(const PacketKey &key) const
+{
+    int flowId = classifier.lookup(key);
+    if (flowId == -1)
+        return nullptr;
+    auto it = flowTable.find(flowId);
+    return it != flowTable.end() ? &it->second : nullptr;
+}
+
+const std::vector<int>& SDNControllerApp::getSlicesOfHost(const std::string &hostIP) const
+{
+    static const std::vector<int> none;
+    auto it = slicesByHost.find(hostIP);
+    return it != slicesByHost.end() ? it->second : none;
+}
+
+const std::vector<int>& SDNControllerApp::getSlicesOfVlan(int vlanId) const
+{
+    static const std::vector<int> none;
+    auto it = slicesByVlan.find(vlanId);
+    return it != slicesByVlan.end() ? it->second : none;
+}
+
+bool SDNControllerApp::isHostInSlice(const std::string &hostIP, int sliceId) const
+{
+    const std::vector<int> &ids = getSlicesOfHost(hostIP);
+    return std::find(ids.begin(), ids.end(), sliceId) != ids.end();
+}
+
+const NetworkSlice *SDNControllerApp::findSlice(int sliceId) const
+{
+    const std::map<int, NetworkSlice> &shardSlices = shards[getShardOfId(sliceId)]->slices;
+    auto it = shardSlices.find(sliceId);
+    return it != shardSlices.end() ? &it->second : nullptr;
+}
+
+bool SDNControllerApp::isSliceVlan(int vlanId) const
+{
+    for (const SDNControllerApp *shard : shards)
+        if (shard->slicesByVlan.count(vlanId))
+            return true;
+    return false;
+}
+
+void SDNControllerApp::resolveShards()
+{
+    shards.assign(numShards, nullptr);
+    for (int i = 0; i < numShards; i++) {
+        if (i == shardIndex) {
+            shards[i] = this;
+            continue;
+        }
+        std::string path = opp_stringf(par("shardModule").stringValue(), i);
+        SDNControllerApp *shard = dynamic_cast<SDNControllerApp *>(findModuleByPath(path.c_str()));
+        if (shard == nullptr)
+            throw cRuntimeError("Shard %d: no SDNControllerApp at %s (see shardModule)", i, path.c_str());
+        if (shard->par("numShards").intValue() != numShards || shard->par("shardIndex").intValue() != i)
+            throw cRuntimeError("Shard %d at %s is configured as shard %d of %d, expected %d of %d", i, path.c_str(),
+                    (int)shard->par("shardIndex").intValue(), (int)shard->par("numShards").intValue(), i, numShards);
+        shards[i] = shard;
+    }
+}
+
+int SDNControllerApp::nextOwnedId(int id) const
+{
+    int offset = (id - 1 - shardIndex) % numShards;
+    if (offset < 0)
+        offset += numShards;
+    return offset == 0 ? id : id + numShards - offset;
+}
+
+std::string SDNControllerApp::getShardFileName(const std::string &fileName) const
+{
+    // The first shard keeps the names the dashboard reads; the others insert
+    // their index before the extension, e.g. results/commands-shard2.json
+    if (shardIndex == 0 || fileName.empty())
+        return fileName;
+    size_t slash = fileName.find_last_of('/');
+    size_t dot = fileName.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = fileName.size();
+    return fileName.substr(0, dot) + "-shard" + std::to_string(shardIndex) + fileName.substr(dot);
+}
+
+int SDNControllerApp::getCommandShard(const JsonReader::Value &json) const
+{
+    // Where each command would have created its slice or flow; malformed
+    // commands are reported by this shard
+    try {
+        if (!json.isObject())
+            return shardIndex;
+        std::string type = json.getString("type", "");
+        JsonReader::Value data = json.get("data");
+        if (!data.isObject())
+            data = json;
+        if (type == "CREATE_SLICE")
+            return getShardOfKey(data.getString("name", ""));
+        else if (type == "ADD_FLOW") {
+            int sliceId = data.getInt("sliceId", 0);
+            return sliceId != 0 ? getShardOfId(sliceId) : getShardOfKey(data.getString("srcIP", ""));
+        }
+        else if (data.has("id"))
+            return getShardOfId(data.get("id").asInt());
+    }
+    catch (const std::exception&) {
+    }
+    return shardIndex;
+}
+
 bool SDNControllerApp::removeFlow(int flowId)
 {
     removeFlowRule(flowId);
@@ -368,230 +1909,505 @@ bool SDNControllerApp::removeSlice(int sliceId)
 
 void SDNControllerApp::processCommands()
 {
-    // Check if command file exists
-    std::ifstream cmdFile(commandFile);
-    if (!cmdFile.good()) {
+    // Take the command file by renaming it, so that commands appended to it
+    // meanwhile go to a new file instead of being lost
+    std::string takenFile = commandFile + ".taken";
+    if (std::rename(commandFile.c_str(), takenFile.c_str()) != 0) {
         return; // No command file, nothing to process
     }
 
     // Read entire file
+    std::ifstream cmdFile(takenFile);
     std::string content((std::istreambuf_iterator<char>(cmdFile)),
                         std::istreambuf_iterator<char>());
     cmdFile.close();
+    std::remove(takenFile.c_str());
 
-    if (content.empty() || content.length() < 10) {
-        return; // Empty or invalid file
+    if (content.find_first_not_of(" \t\r\n") == std::string::npos) {
+        return; // Empty file
     }
 
-    EV << "Processing command from file: " << commandFile << endl;
+    EV << "Processing commands from file: " << commandFile << endl;
     EV << "Command content: " << content.substr(0, 100) << "..." << endl;
 
-    // Parse and execute command
-    parseAndExecuteCommand(content);
+    enqueueCommands(content);
+}
 
-    // Clear command file after processing
-    std::ofstream clearFile(commandFile, std::ios::trunc);
-    clearFile.close();
+void SDNControllerApp::processArrivedCommands()
+{
+    for (const std::string &command : commandScheduler->takeCommands()) {
+        EV << "Processing command from socket: " << command.substr(0, 100) << endl;
+        enqueueCommand(command);
+    }
 
-    EV << "Command processed and file cleared." << endl;
+    if (commandScheduler->takeFileChanged())
+        processCommands();
 }
 
-void SDNControllerApp::parseAndExecuteCommand(const std::string &cmdJson)
+void SDNControllerApp::enqueueCommands(const std::string &content)
 {
-    // Simple string-based parsing (in production, use a proper JSON library)
-    // This implementation looks for key patterns in the JSON
+    // The file holds a single command or batch, possibly over several
+    // lines, or several of them appended one per line
+    try {
+        JsonReader reader;
+        reader.parse(content);
+        enqueueCommand(content);
+        return;
+    }
+    catch (const std::exception&) {
+    }
+    std::istringstream lines(content);
+    std::string line;
+    while (std::getline(lines, line))
+        if (line.find_first_not_of(" \t\r") != std::string::npos)
+            enqueueCommand(line);
+}
 
+void SDNControllerApp::enqueueCommand(const std::string &cmdJson)
+{
+    // The tenant and urgency are top-level members of the command or BATCH
+    // object; malformed commands are queued too, and reported when executed
+    CommandQueue::Item item;
+    std::vector<std::string> types;
     try {
-        if (cmdJson.find("CREATE_SLICE") != std::string::npos) {
-            EV << "Executing CREATE_SLICE command" << endl;
-
-            // Extract slice data from JSON
-            NetworkSlice newSlice;
-
-            // Parse name
-            size_t namePos = cmdJson.find("\"name\":");
-            if (namePos != std::string::npos) {
-                size_t start = cmdJson.find("\"", namePos + 7) + 1;
-                size_t end = cmdJson.find("\"", start);
-                newSlice.name = cmdJson.substr(start, end - start);
-            }
+        JsonReader reader;
+        reader.parse(cmdJson);
+        JsonReader::Value root = reader.getRoot();
+        if (root.isObject()) {
+            item.tenant = root.getString("tenant", "");
+            item.urgent = root.getBool("urgent", false);
+        }
+        for (const JsonReader::Value &command : getBatchCommands(root))
+            types.push_back(command.isObject() ? command.getString("type", "") : "");
+        item.cost = std::max<int>(1, types.size());
+    }
+    catch (const std::exception&) {
+    }
+    std::string tenant = item.tenant;
+    item.payload = cmdJson;
+    item.enqueueTime = simTime().dbl();
+    if (!commandQueue.push(std::move(item))) {
+        EV << "ERROR: Command queue of tenant \"" << tenant << "\" is full, command rejected" << endl;
+        std::vector<CommandResult> results(std::max<size_t>(1, types.size()));
+        for (size_t i = 0; i < results.size(); i++) {
+            results[i].type = i < types.size() ? types[i] : "";
+            results[i].code = CMD_REJECTED;
+            results[i].message = "command queue of tenant \"" + tenant + "\" is full";
+        }
+        writeCommandResults(results);
+        return;
+    }
+    emit(commandQueueLengthSignal, (long)commandQueue.getNumQueuedCommands());
+    scheduleDispatch();
+}
 
-            // Parse vlanId
-            size_t vlanPos = cmdJson.find("\"vlanId\":");
-            if (vlanPos != std::string::npos) {
-                size_t start = vlanPos + 9;
-                size_t end = cmdJson.find_first_of(",}", start);
-                newSlice.vlanId = std::stoi(cmdJson.substr(start, end - start));
-            }
+void SDNControllerApp::dispatchCommands()
+{
+    // Bounded work per event, so that PACKET_INs are not held up behind a
+    // long queue: items until maxCommandsPerEvent commands were executed
+    // (a batch is never split); the rest follows in further events
+    int numExecuted = 0;
+    CommandQueue::Item item;
+    while (commandQueue.pop(simTime().dbl(), item)) {
+        emit(commandWaitTimeSignal, simTime() - SimTime(item.enqueueTime));
+        parseAndExecuteCommand(item.payload);
+        numExecuted += item.cost;
+        if (maxCommandsPerEvent > 0 && numExecuted >= maxCommandsPerEvent)
+            break;
+    }
+    emit(commandQueueLengthSignal, (long)commandQueue.getNumQueuedCommands());
+    compactStateIfNeeded();
+    scheduleDispatch();
+}
 
-            // Parse bandwidth
-            size_t bwPos = cmdJson.find("\"bandwidth\":");
-            if (bwPos != std::string::npos) {
-                size_t start = bwPos + 12;
-                size_t end = cmdJson.find_first_of(",}", start);
-                newSlice.bandwidthMbps = std::stod(cmdJson.substr(start, end - start));
-            }
+void SDNControllerApp::scheduleDispatch()
+{
+    // At the time the next queued item gets the tokens for it
+    double now = simTime().dbl();
+    double next = commandQueue.getNextEligibleTime(now);
+    if (next == std::numeric_limits<double>::infinity())
+        cancelEvent(dispatchTimer);
+    else {
+        simtime_t t = next <= now ? simTime() : std::max(simTime(), SimTime(next));
+        if (!dispatchTimer->isScheduled() || dispatchTimer->getArrivalTime() > t)
+            rescheduleAt(t, dispatchTimer);
+    }
+}
 
-            // Parse isolated
-            newSlice.isolated = (cmdJson.find("\"isolated\":true") != std::string::npos) ||
-                               (cmdJson.find("\"isolated\": true") != std::string::npos);
-
-            // Parse hosts array
-            size_t hostsPos = cmdJson.find("\"hosts\":[");
-            if (hostsPos != std::string::npos) {
-                size_t start = hostsPos + 9;
-                size_t end = cmdJson.find("]", start);
-                std::string hostsStr = cmdJson.substr(start, end - start);
-
-                // Extract individual IP addresses
-                size_t pos = 0;
-                while ((pos = hostsStr.find("\"", pos)) != std::string::npos) {
-                    size_t ipStart = pos + 1;
-                    size_t ipEnd = hostsStr.find("\"", ipStart);
-                    if (ipEnd != std::string::npos) {
-                        std::string ip = hostsStr.substr(ipStart, ipEnd - ipStart);
-                        if (!ip.empty() && ip.find(".") != std::string::npos) {
-                            newSlice.hostIPs.push_back(ip);
-                        }
-                        pos = ipEnd + 1;
-                    } else {
-                        break;
-                    }
-                }
-            }
+std::vector<JsonReader::Value> SDNControllerApp::getBatchCommands(const JsonReader::Value &root)
+{
+    // A batch is either a top-level array of commands or a BATCH command with
+    // a "commands" array; anything else is a single command
+    JsonReader::Value list = root;
+    if (root.isObject() && root.get("commands").isArray())
+        list = root.get("commands");
+    if (!list.isArray())
+        return {root};
+
+    std::vector<JsonReader::Value> commands;
+    commands.reserve(list.size());
+    for (JsonReader::Value command = list.getFirstChild(); command; command = command.getNextSibling())
+        commands.push_back(command);
+    return commands;
+}
 
-            // Create the slice if we have valid data
-            if (!newSlice.name.empty() && newSlice.vlanId > 0 && !newSlice.hostIPs.empty()) {
-                createSlice(newSlice);
-                EV << "Created slice: " << newSlice.name << " with " << newSlice.hostIPs.size() << " hosts" << endl;
-            } else {
-                EV << "ERROR: Invalid slice data in command" << endl;
+std::vector<SDNControllerApp::CommandResult> SDNControllerApp::routeCommandBatch(const std::vector<JsonReader::Value> &commands, simtime_t &completionTime)
+{
+    // Each shard validates its part of the batch against its own state, and
+    // the parts are applied only if all of them are valid and all their
+    // shards are up, so that either the whole batch is applied or none of
+    // it. The results are reported in the order of the batch.
+    std::vector<std::vector<size_t>> commandsOfShard(numShards);
+    for (size_t i = 0; i < commands.size(); i++)
+        commandsOfShard[numShards == 1 ? 0 : getCommandShard(commands[i])].push_back(i);
+
+    std::vector<std::vector<Command>> parsedOfShard(numShards);
+    std::vector<std::vector<CommandResult>> resultsOfShard(numShards);
+    bool valid = true;
+    completionTime = simTime();
+    for (int shard = 0; shard < numShards; shard++) {
+        const std::vector<size_t> &indices = commandsOfShard[shard];
+        if (indices.empty())
+            continue;
+        std::vector<CommandResult> &partResults = resultsOfShard[shard];
+        partResults.resize(indices.size());
+        if (!shards[shard]->isUp()) {
+            for (auto& result : partResults) {
+                result.code = CMD_ABORTED;
+                result.message = "not applied because controller shard " + std::to_string(shard) + " is down";
             }
+            valid = false;
+            continue;
         }
-        else if (cmdJson.find("DELETE_SLICE") != std::string::npos) {
-            EV << "Executing DELETE_SLICE command" << endl;
-
-            // Extract slice ID
-            size_t idPos = cmdJson.find("\"id\":");
-            if (idPos != std::string::npos) {
-                size_t start = idPos + 5;
-                size_t end = cmdJson.find_first_of(",}", start);
-                int sliceId = std::stoi(cmdJson.substr(start, end - start));
+        std::vector<JsonReader::Value> part;
+        part.reserve(indices.size());
+        for (size_t i : indices)
+            part.push_back(commands[i]);
+        if (!shards[shard]->validateShardBatch(part, parsedOfShard[shard], partResults))
+            valid = false;
+        completionTime = std::max(completionTime, shards[shard]->serveShardBatch((int)indices.size()));
+    }
 
-                deleteSlice(sliceId);
-                EV << "Deleted slice ID: " << sliceId << endl;
-            }
-        }
-        else if (cmdJson.find("UPDATE_SLICE") != std::string::npos) {
-            EV << "Executing UPDATE_SLICE command" << endl;
-
-            // Extract slice ID and updated data
-            size_t idPos = cmdJson.find("\"id\":");
-            if (idPos != std::string::npos) {
-                size_t start = idPos + 5;
-                size_t end = cmdJson.find_first_of(",}", start);
-                int sliceId = std::stoi(cmdJson.substr(start, end - start));
-
-                // Find existing slice and update it
-                auto it = slices.find(sliceId);
-                if (it != slices.end()) {
-                    NetworkSlice updatedSlice = it->second;
-
-                    // Update bandwidth if present
-                    size_t bwPos = cmdJson.find("\"bandwidth\":");
-                    if (bwPos != std::string::npos) {
-                        size_t bwStart = bwPos + 12;
-                        size_t bwEnd = cmdJson.find_first_of(",}", bwStart);
-                        updatedSlice.bandwidthMbps = std::stod(cmdJson.substr(bwStart, bwEnd - bwStart));
-                    }
-
-                    updateSlice(updatedSlice);
-                    EV << "Updated slice ID: " << sliceId << endl;
-                }
+    if (valid) {
+        for (int shard = 0; shard < numShards; shard++)
+            if (!parsedOfShard[shard].empty())
+                shards[shard]->applyShardBatch(parsedOfShard[shard], resultsOfShard[shard]);
+        EV << "Applied command batch of " << commands.size() << " command(s)" << endl;
+    }
+    else
+        EV << "ERROR: Command batch of " << commands.size() << " rejected, nothing applied" << endl;
+
+    std::vector<CommandResult> results(commands.size());
+    for (int shard = 0; shard < numShards; shard++) {
+        const std::vector<size_t> &indices = commandsOfShard[shard];
+        for (size_t j = 0; j < indices.size(); j++) {
+            CommandResult &result = resultsOfShard[shard][j];
+            if (!valid && result.code == CMD_OK) {
+                result.code = CMD_ABORTED;
+                result.message = "not applied because another command in the batch failed";
             }
+            results[indices[j]] = std::move(result);
         }
-        else if (cmdJson.find("ADD_FLOW") != std::string::npos) {
-            EV << "Executing ADD_FLOW command" << endl;
+    }
+    return results;
+}
 
-            FlowRule newFlow;
+bool SDNControllerApp::validateShardBatch(const std::vector<JsonReader::Value> &commands, std::vector<Command> &parsed, std::vector<CommandResult> &results)
+{
+    Enter_Method("validateShardBatch");
+
+    // Validate the part against the state it would see when applied in
+    // order, so that either all its commands apply or it is reported invalid
+    parsed.assign(commands.size(), Command());
+    BatchContext context;
+    context.nextFlowId = nextFlowId;
+    context.nextSliceId = nextSliceId;
+    bool valid = true;
+    for (size_t i = 0; i < commands.size(); i++) {
+        CommandResult& result = results[i];
+        if (!parseCommand(commands[i], parsed[i], result.message))
+            result.code = CMD_INVALID;
+        else
+            result.code = validateCommand(parsed[i], context, result.message);
+        result.type = parsed[i].type;
+        if (result.code != CMD_OK)
+            valid = false;
+    }
+    return valid;
+}
 
-            // Parse srcIP
-            size_t srcPos = cmdJson.find("\"srcIP\":");
-            if (srcPos != std::string::npos) {
-                size_t start = cmdJson.find("\"", srcPos + 8) + 1;
-                size_t end = cmdJson.find("\"", start);
-                newFlow.srcIP = cmdJson.substr(start, end - start);
-            }
+simtime_t SDNControllerApp::serveShardBatch(int numCommands)
+{
+    Enter_Method("serveShardBatch");
+    simtime_t completionTime = serve(numCommands);
+    emit(commandLatencySignal, completionTime - simTime());
+    return completionTime;
+}
 
-            // Parse dstIP
-            size_t dstPos = cmdJson.find("\"dstIP\":");
-            if (dstPos != std::string::npos) {
-                size_t start = cmdJson.find("\"", dstPos + 8) + 1;
-                size_t end = cmdJson.find("\"", start);
-                newFlow.dstIP = cmdJson.substr(start, end - start);
-            }
+void SDNControllerApp::applyShardBatch(const std::vector<Command> &parsed, std::vector<CommandResult> &results)
+{
+    Enter_Method("applyShardBatch");
+
+    // Validation guarantees that every command applies; flush the journal once
+    journal.beginBatch();
+    for (size_t i = 0; i < parsed.size(); i++) {
+        results[i].id = applyCommand(parsed[i]);
+        if (parsed[i].type == "ADD_FLOW")
+            results[i].message = describeFlowAnomalies(results[i].id);  // applied, but maybe never matching
+    }
+    journal.endBatch();
+}
 
-            // Parse action
-            size_t actionPos = cmdJson.find("\"action\":");
-            if (actionPos != std::string::npos) {
-                size_t start = cmdJson.find("\"", actionPos + 9) + 1;
-                size_t end = cmdJson.find("\"", start);
-                newFlow.action = cmdJson.substr(start, end - start);
-            }
+void SDNControllerApp::writeCommandResults(const std::vector<CommandResult> &results)
+{
+    static const char *codeNames[] = {"OK", "INVALID", "NOT_FOUND", "ABORTED", "REJECTED"};
 
-            // Parse priority
-            size_t prioPos = cmdJson.find("\"priority\":");
-            if (prioPos != std::string::npos) {
-                size_t start = prioPos + 11;
-                size_t end = cmdJson.find_first_of(",}", start);
-                newFlow.priority = std::stoi(cmdJson.substr(start, end - start));
-            } else {
-                newFlow.priority = 100; // Default
-            }
+    std::string tmpFileName = commandResultFile + ".tmp";
+    std::ofstream out(tmpFileName, std::ios::trunc);
+    if (!out.is_open()) {
+        EV << "ERROR: Cannot write command results " << commandResultFile << endl;
+        return;
+    }
 
-            // Parse sliceId
-            size_t slicePos = cmdJson.find("\"sliceId\":");
-            if (slicePos != std::string::npos) {
-                size_t start = slicePos + 10;
-                size_t end = cmdJson.find_first_of(",}", start);
-                newFlow.sliceId = std::stoi(cmdJson.substr(start, end - start));
-            }
+    bool applied = std::all_of(results.begin(), results.end(), [](const CommandResult& r) { return r.code == CMD_OK; });
+    out << "{\"timestamp\":" << simTime().dbl()
+        << ",\"seq\":" << journal.getSeq()
+        << ",\"applied\":" << (applied ? "true" : "false")
+        << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); i++) {
+        const CommandResult& result = results[i];
+        if (i > 0) out << ",";
+        out << "\n  {\"index\":" << i
+            << ",\"type\":" << StateJournal::quote(result.type)
+            << ",\"code\":" << result.code
+            << ",\"status\":\"" << codeNames[result.code] << "\"";
+        if (result.id >= 0)
+            out << ",\"id\":" << result.id;
+        if (!result.message.empty())
+            out << ",\"message\":" << StateJournal::quote(result.message);
+        out << "}";
+    }
+    out << "\n]}\n";
+    out.close();
 
-            // Initialize other fields
-            newFlow.srcPort = 0;
-            newFlow.dstPort = 0;
-            newFlow.outputPort = 0;
-
-            // Install the flow if we have valid data
-            if (!newFlow.srcIP.empty() && !newFlow.action.empty()) {
-                installFlowRule(newFlow);
-                EV << "Added flow: " << newFlow.srcIP << " -> " << newFlow.dstIP
-                   << " (action: " << newFlow.action << ")" << endl;
-            } else {
-                EV << "ERROR: Invalid flow data in command" << endl;
-            }
-        }
-        else if (cmdJson.find("DELETE_FLOW") != std::string::npos) {
-            EV << "Executing DELETE_FLOW command" << endl;
+    if (out.fail() || std::rename(tmpFileName.c_str(), commandResultFile.c_str()) != 0)
+        EV << "ERROR: Cannot write command results " << commandResultFile << endl;
+}
+
+simtime_t SDNControllerApp::parseAndExecuteCommand(const std::string &cmdJson)
+{
+    JsonReader reader;
+    try {
+        reader.parse(cmdJson);
+    }
+    catch (const std::exception& e) {
+        EV << "ERROR parsing command: " << e.what() << endl;
+        CommandResult result;
+        result.code = CMD_INVALID;
+        result.message = e.what();
+        writeCommandResults({result});
+        return simTime();
+    }
 
-            // Extract flow ID
-            size_t idPos = cmdJson.find("\"id\":");
-            if (idPos != std::string::npos) {
-                size_t start = idPos + 5;
-                size_t end = cmdJson.find_first_of(",}", start);
-                int flowId = std::stoi(cmdJson.substr(start, end - start));
+    simtime_t completionTime;
+    writeCommandResults(routeCommandBatch(getBatchCommands(reader.getRoot()), completionTime));
+    return completionTime;
+}
 
-                removeFlowRule(flowId);
-                EV << "Deleted flow ID: " << flowId << endl;
+bool SDNControllerApp::parseCommand(const JsonReader::Value &json, Command &cmd, std::string &error)
+{
+    try {
+        if (!json.isObject()) {
+            error = "command must be a JSON object";
+            return false;
+        }
+        cmd.type = json.getString("type", "");
+
+        // Command arguments are normally under "data", but may also be inline
+        JsonReader::Value data = json.get("data");
+        if (!data.isObject())
+            data = json;
+
+        if (cmd.type == "CREATE_SLICE")
+            parseSlice(data, cmd.slice);
+        else if (cmd.type == "DELETE_SLICE" || cmd.type == "UPDATE_SLICE" || cmd.type == "DELETE_FLOW") {
+            if (!data.has("id")) {
+                error = "missing id";
+                return false;
+            }
+            cmd.id = data.get("id").asInt();
+            if (cmd.type == "UPDATE_SLICE" && data.has("bandwidth")) {
+                cmd.slice.bandwidthMbps = data.get("bandwidth").asDouble();
+                cmd.hasBandwidth = true;
             }
         }
+        else if (cmd.type == "ADD_FLOW")
+            parseFlow(data, cmd.flow);
         else {
-            EV << "Unknown command type in JSON" << endl;
+            error = cmd.type.empty() ? "missing command type" : "unknown command type " + cmd.type;
+            return false;
         }
     }
     catch (const std::exception& e) {
-        EV << "ERROR parsing command: " << e.what() << endl;
+        error = std::string("parse error: ") + e.what();
+        return false;
+    }
+    return true;
+}
+
+void SDNControllerApp::parseSlice(const JsonReader::Value &data, NetworkSlice &slice)
+{
+    slice.name = data.getString("name", "");
+    slice.vlanId = data.getInt("vlanId", 0);
+    slice.bandwidthMbps = data.getDouble("bandwidth", 0);
+    slice.isolated = data.getBool("isolated", false);
+    JsonReader::Value hosts = data.get("hosts");
+    for (JsonReader::Value host = hosts.getFirstChild(); host; host = host.getNextSibling())
+        slice.hostIPs.push_back(host.asString());
+}
+
+void SDNControllerApp::parseFlow(const JsonReader::Value &data, FlowRule &flow) const
+{
+    flow.srcIP = data.getString("srcIP", "");
+    flow.dstIP = data.getString("dstIP", "");
+    flow.action = data.getString("action", "");
+    flow.priority = data.getInt("priority", 100);
+    flow.sliceId = data.getInt("sliceId", 0);
+    flow.srcPort = data.getInt("srcPort", 0);
+    flow.dstPort = data.getInt("dstPort", 0);
+    flow.protocol = data.getInt("protocol", 0);
+    flow.outputPort = data.getInt("outputPort", FlowRule::ROUTED_PORT);
+    flow.idleTimeout = data.getDouble("idleTimeout", defaultIdleTimeout);
+    flow.hardTimeout = data.getDouble("hardTimeout", defaultHardTimeout);
+}
+
+bool SDNControllerApp::checkSlice(const NetworkSlice &slice, std::string &error)
+{
+    if (slice.name.empty() || slice.vlanId <= 0 || slice.hostIPs.empty()) {
+        error = "slice needs a name, a positive vlanId and at least one host";
+        return false;
+    }
+    FlowMatch match;
+    for (const auto& hostIP : slice.hostIPs) {
+        if (!FlowClassifier::makeMatch(hostIP, "", 0, 0, 0, match)) {
+            error = "invalid host address " + hostIP;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SDNControllerApp::checkFlow(const FlowRule &flow, std::string &error)
+{
+    FlowMatch match;
+    if (flow.srcIP.empty() || flow.action.empty()) {
+        error = "flow needs srcIP and action";
+        return false;
+    }
+    if (!FlowClassifier::makeMatch(flow.srcIP, flow.dstIP, flow.srcPort, flow.dstPort, flow.protocol, match)) {
+        error = "invalid match " + flow.srcIP + " -> " + flow.dstIP;
+        return false;
+    }
+    if (flow.idleTimeout < 0 || flow.hardTimeout < 0) {
+        error = "flow timeouts must not be negative";
+        return false;
+    }
+    return true;
+}
+
+SDNControllerApp::CommandCode SDNControllerApp::validateCommand(const Command &cmd, BatchContext &context, std::string &error)
+{
+    auto flowExists = [&](int flowId) {
+        if (context.removedFlows.count(flowId))
+            return false;
+        return flowTable.count(flowId) > 0 || context.addedFlowSlices.count(flowId) > 0;
+    };
+    auto sliceExists = [&](int sliceId) {
+        if (context.removedSlices.count(sliceId))
+            return false;
+        return slices.count(sliceId) > 0 || (sliceId >= nextSliceId && sliceId < context.nextSliceId && getShardOfId(sliceId) == shardIndex);
+    };
+
+    if (cmd.type == "CREATE_SLICE") {
+        const NetworkSlice& slice = cmd.slice;
+        if (!checkSlice(slice, error))
+            return CMD_INVALID;
+        for (size_t i = 0; i < slice.hostIPs.size(); i++) {
+            context.addedFlowSlices[context.nextFlowId] = context.nextSliceId;
+            context.nextFlowId = nextOwnedId(context.nextFlowId + 1);
+        }
+        context.nextSliceId = nextOwnedId(context.nextSliceId + 1);
+    }
+    else if (cmd.type == "DELETE_SLICE" || cmd.type == "UPDATE_SLICE") {
+        if (!sliceExists(cmd.id)) {
+            error = "no slice with id " + std::to_string(cmd.id);
+            return CMD_NOT_FOUND;
+        }
+        if (cmd.type == "DELETE_SLICE") {
+            context.removedSlices.insert(cmd.id);
+            auto sliceIt = slices.find(cmd.id);
+            if (sliceIt != slices.end())
+                context.removedFlows.insert(sliceIt->second.flowRuleIds.begin(), sliceIt->second.flowRuleIds.end());
+            for (const auto& entry : context.addedFlowSlices)
+                if (entry.second == cmd.id)
+                    context.removedFlows.insert(entry.first);
+        }
+    }
+    else if (cmd.type == "ADD_FLOW") {
+        const FlowRule& flow = cmd.flow;
+        if (!checkFlow(flow, error))
+            return CMD_INVALID;
+        if (flow.sliceId != 0 && !sliceExists(flow.sliceId)) {
+            error = "no slice with id " + std::to_string(flow.sliceId);
+            return CMD_NOT_FOUND;
+        }
+        context.addedFlowSlices[context.nextFlowId] = flow.sliceId;
+        context.nextFlowId = nextOwnedId(context.nextFlowId + 1);
+    }
+    else if (cmd.type == "DELETE_FLOW") {
+        if (!flowExists(cmd.id)) {
+            error = "no flow with id " + std::to_string(cmd.id);
+            return CMD_NOT_FOUND;
+        }
+        context.removedFlows.insert(cmd.id);
+    }
+    return CMD_OK;
+}
+
+int SDNControllerApp::applyCommand(const Command &cmd)
+{
+    if (cmd.type == "CREATE_SLICE") {
+        int sliceId = nextSliceId;
+        createSlice(cmd.slice);
+        EV << "Created slice: " << cmd.slice.name << " with " << cmd.slice.hostIPs.size() << " hosts" << endl;
+        return sliceId;
+    }
+    else if (cmd.type == "DELETE_SLICE") {
+        deleteSlice(cmd.id);
+        EV << "Deleted slice ID: " << cmd.id << endl;
+        return cmd.id;
+    }
+    else if (cmd.type == "UPDATE_SLICE") {
+        NetworkSlice updatedSlice = slices[cmd.id];
+        if (cmd.hasBandwidth)
+            updatedSlice.bandwidthMbps = cmd.slice.bandwidthMbps;
+        updateSlice(updatedSlice);
+        EV << "Updated slice ID: " << cmd.id << endl;
+        return cmd.id;
+    }
+    else if (cmd.type == "ADD_FLOW") {
+        int flowId = nextFlowId;
+        installFlowRule(cmd.flow);
+        EV << "Added flow: " << cmd.flow.srcIP << " -> " << cmd.flow.dstIP
+           << " (action: " << cmd.flow.action << ")" << endl;
+        return flowId;
+    }
+    else if (cmd.type == "DELETE_FLOW") {
+        removeFlowRule(cmd.id);
+        EV << "Deleted flow ID: " << cmd.id << endl;
+        return cmd.id;
     }
+    return -1;
 }
 
 } // namespace sdn_dashboard
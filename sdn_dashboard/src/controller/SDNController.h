@@ -5,12 +5,32 @@
 #include <inet/common/INETDefs.h>
 #include <inet/applications/base/ApplicationBase.h>
 #include <inet/transportlayer/contract/udp/UdpSocket.h>
+#include <common/jsonreader.h>
+#include "CommandQueue.h"
+#include "CommandRTScheduler.h"
+#include "FlowConflictIndex.h"
+#include "FlowClassifier.h"
+#include "FlowCounters.h"
+#include "MicroflowCache.h"
+#include "OpenFlowMessages_m.h"
+#include "RoutingService.h"
+#include "ShardMap.h"
+#include "StateCheckpoint.h"
+#include "StateJournal.h"
+#include "TelemetryServer.h"
+#include "TimingWheel.h"
+#include <chrono>
+#include <deque>
 #include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
 using namespace omnetpp;
 using namespace inet;
+using omnetpp::common::JsonReader;
 
 namespace sdn_dashboard {
 
@@ -21,13 +41,20 @@ struct FlowRule {
     std::string dstIP;
     int srcPort;
     int dstPort;
+    int protocol;        // IP protocol number, 0 = any
     std::string action;  // "forward", "drop", "modify"
-    int outputPort;
+    int outputPort;      // switch port, or ROUTED_PORT: next hop from the controller's routing
     int priority;
     int sliceId;
     simtime_t installedTime;
-    long packetsMatched;
+    simtime_t lastMatchedTime;
+    double idleTimeout = 0;  // s without matching packets until the rule expires, 0 = never
+    double hardTimeout = 0;  // s after installation until the rule expires, 0 = never
+    long packetsMatched;     // PACKET_INs, plus the packets counted by the switches
     long bytesMatched;
+    int counterSlot = -1;    // of the rule in the switches' FlowCounterTables
+
+    static const int ROUTED_PORT = -1;
 };
 
 struct NetworkSlice {
@@ -37,12 +64,54 @@ struct NetworkSlice {
     std::vector<std::string> hostIPs;
     double bandwidthMbps;
     bool isolated;
-    std::vector<int> flowRuleIds;
+    std::vector<int> flowRuleIds;   // maintained by the controller
     simtime_t createdTime;
 };
 
-class SDNControllerApp : public ApplicationBase
+class SDNControllerApp : public ApplicationBase, public cListener
 {
+  public:
+    // Per-command result codes reported back in the command result file
+    enum CommandCode {
+        CMD_OK = 0,
+        CMD_INVALID = 1,     // malformed or invalid command
+        CMD_NOT_FOUND = 2,   // target slice or flow does not exist
+        CMD_ABORTED = 3,     // valid, but not applied because the batch failed
+        CMD_REJECTED = 4     // not queued, the tenant has too many commands waiting
+    };
+
+    // Kinds of records served by the telemetry socket
+    enum TelemetryRecordKind {
+        TELEMETRY_SLICE = 1,
+        TELEMETRY_FLOW = 2
+    };
+
+  protected:
+    // Parsed dashboard command
+    struct Command {
+        std::string type;
+        NetworkSlice slice;         // CREATE_SLICE, UPDATE_SLICE
+        FlowRule flow;              // ADD_FLOW
+        int id = -1;                // DELETE_SLICE, UPDATE_SLICE, DELETE_FLOW
+        bool hasBandwidth = false;  // UPDATE_SLICE
+    };
+
+    struct CommandResult {
+        std::string type;
+        CommandCode code = CMD_OK;
+        int id = -1;                // slice or flow the command created or affected
+        std::string message;
+    };
+
+    // State as seen by the next command while validating a batch
+    struct BatchContext {
+        int nextFlowId;
+        int nextSliceId;
+        std::map<int, int> addedFlowSlices;  // flowId -> sliceId of flows added by the batch
+        std::set<int> removedFlows;
+        std::set<int> removedSlices;
+    };
+
   protected:
     // Configuration
     int localPort;
@@ -52,30 +121,135 @@ class SDNControllerApp : public ApplicationBase
     // State
     std::map<int, FlowRule> flowTable;
     std::map<int, NetworkSlice> slices;
+    FlowClassifier classifier;  // per-packet lookup index over flowTable
+    MicroflowCache flowCache;   // exact-match results of classifier, invalidated on flow table changes
+    FlowConflictIndex conflictIndex;  // shadowed and conflicting rules of flowTable, if analyzeFlowConflicts
+    bool analyzeFlowConflicts;
+    // Secondary indexes over slices (slice -> flows is NetworkSlice::flowRuleIds);
+    // a host or VLAN may belong to several slices
+    std::unordered_map<std::string, std::vector<int>> slicesByHost;
+    std::unordered_map<int, std::vector<int>> slicesByVlan;
+    // Shortest paths over the switch fabric, following link and switch failures
+    RoutingService routing;
+    std::unordered_map<int, int> routingNodeOfModule;      // network node module ID -> routing node
+    std::unordered_map<uint32_t, int> routingNodeOfHost;   // IPv4 address -> routing node
+    std::unordered_map<const cGate *, int> routingLinkOfGate;  // output gates of both ends -> routing link
+    // Flood domains of the VLANs, computed on demand: vlanId -> switch routing node -> ports
+    mutable std::unordered_map<int, std::unordered_map<int, std::vector<int>>> floodPortsByVlan;
+    mutable uint64_t floodPortsVersion;  // getFloodDomainVersion() of floodPortsByVlan
+    uint64_t floodDomainVersion;   // changes whenever a flood domain of this shard may change
     int nextFlowId;
     int nextSliceId;
 
+    // Sharding: the controller instances divide the slices, flows and
+    // switches among themselves. Shard i allocates the slice and flow IDs
+    // i+1, i+1+N, i+1+2N, ..., so that commands are routed by ID; new
+    // slices go to the shard of their name on the hash ring, flows to that
+    // of their slice, flows without a slice to that of their source address
+    int numShards;
+    int shardIndex;
+    ShardMap shardMap;
+    std::vector<SDNControllerApp *> shards;  // by shard index, including this one
+
+    // Service time: PACKET_INs and commands are served one at a time, for a
+    // processingDelay each. Their changes apply on arrival; FlowMod replies
+    // are sent when served (in order, as the service is first come, first served)
+    struct PendingFlowMod {
+        simtime_t sendTime;
+        Packet *packet;
+        L3Address switchAddress;
+        int switchPort;
+    };
+    cPar *processingDelay;
+    simtime_t busyUntil;
+    std::deque<PendingFlowMod> pendingFlowMods;
+    cMessage *flowModTimer;
+
     // Socket
     UdpSocket socket;
 
     // Signals
     simsignal_t flowInstalledSignal;
     simsignal_t sliceCreatedSignal;
+    simsignal_t sliceChangedSignal;
     simsignal_t flowRemovedSignal;
+    simsignal_t flowCacheHitSignal;
+    simsignal_t flowCacheMissSignal;
+    simsignal_t flowIdleExpiredSignal;
+    simsignal_t flowHardExpiredSignal;
+    simsignal_t packetInLatencySignal;
+    simsignal_t commandLatencySignal;
+    simsignal_t commandQueueLengthSignal;
+    simsignal_t flowShadowedSignal;
+    simsignal_t flowConflictSignal;
+    simsignal_t commandWaitTimeSignal;
+
+    // State export: compacted snapshot plus append-only change journal
+    std::string stateFileName;
+    std::string journalFileName;
+    StateJournal journal;
+    simtime_t snapshotInterval;
+    int snapshotMinJournalEntries;
+    cMessage *snapshotTimer;
+
+    // Binary checkpoint of the state, from which a restarted controller recovers
+    std::string checkpointFileName;
+    simtime_t checkpointInterval;
+    uint64_t checkpointSeq;   // journal seq of the state last checkpointed or restored
+    cMessage *checkpointTimer;
+
+    // Flow expiry: the timer of each flow with a timeout runs until its
+    // earliest possible deadline; all timers are advanced together per tick
+    double defaultIdleTimeout;
+    double defaultHardTimeout;
+    simtime_t flowExpiryTick;
+    TimingWheel flowExpiryWheel;
+    cMessage *flowExpiryTimer;
+    std::vector<int> expiredFlowIds;
+    long numIdleExpiries;
+    long numHardExpiries;
 
-    // File descriptors for external communication
-    std::ofstream *stateFile;
+    // Data plane counters: switch ports count the packets of each rule in
+    // tables of their own, which are collected into the rules periodically
+    simtime_t flowStatsInterval;
+    std::vector<std::unique_ptr<FlowCounterTable>> flowCounterTables;
+    std::vector<int> flowOfCounterSlot;   // counter slot -> flow ID, -1 if free
+    std::vector<int> freeCounterSlots;
+    uint64_t flowCounterVersion;          // changes whenever the slot of a packet may change, in any shard
+    cMessage *flowStatsTimer;
+    std::vector<int> countedFlowIds;
+    // Same changes, pushed to subscribers of the telemetry socket
+    std::string telemetrySocketPath;
+    TelemetryServer telemetry;
 
     // Command processing
     std::string commandFile;
+    std::string commandResultFile;
     simtime_t lastCommandCheck;
     cMessage *checkCommandTimer;
+    CommandRTScheduler *commandScheduler;  // event-driven ingestion, or nullptr when polling
+    cMessage *commandArrivedMsg;
+    // Commands from the file and the socket wait in a queue, fair between
+    // tenants, and are executed by dispatch events of bounded work
+    CommandQueue commandQueue;
+    int maxCommandsPerEvent;
+    cMessage *dispatchTimer;
+
+    // Performance measurements for scaling benchmarks (see recordPerformance)
+    double handlerTime;              // wall-clock seconds spent handling events and submitted commands
+    long numHandledEvents;
+    uint64_t snapshotBytes;          // written to state snapshots
+    std::chrono::steady_clock::time_point runStartTime;
+    eventnumber_t runStartEventNumber;
 
   protected:
     virtual int numInitStages() const override { return NUM_INIT_STAGES; }
     virtual void initialize(int stage) override;
+    virtual void handleMessage(cMessage *msg) override;
     virtual void handleMessageWhenUp(cMessage *msg) override;
+    virtual void handleMessageWhenDown(cMessage *msg) override;
     virtual void finish() override;
+    virtual void recordPerformance();
 
     // Lifecycle
     virtual void handleStartOperation(LifecycleOperation *operation) override;
@@ -84,28 +258,162 @@ class SDNControllerApp : public ApplicationBase
 
     // Core functionality
     virtual void processPacket(Packet *packet);
+    static bool isPacketIn(const Packet *packet);
+    virtual int classifyPacket(const PacketKey &key);
+    const FlowRule *matchPacketIn(const PacketKey &key, int64_t bytes);
+    const FlowRule *selectShardRule(const PacketKey &key, const FlowRule *localMatch, int &ownerShard) const;
+    virtual int getOutputPort(const FlowRule &rule, const PacketKey &key, int switchId) const;
+    virtual void sendFlowMod(const FlowRule &rule, int outputPort, const PacketInHeader &packetIn, const L3Address &switchAddress, int switchPort, simtime_t sendTime);
+    virtual void sendPendingFlowMods();
+    simtime_t serve(int numItems);
     virtual void installFlowRule(const FlowRule &rule);
-    virtual void removeFlowRule(int flowId);
+    bool insertFlowRule(FlowRule &&rule);
+    std::string describeFlowAnomalies(int flowId) const;
+    static FlowRule makeSliceFlowRule(const std::string &hostIP, int sliceId);
+    virtual void removeFlowRule(int flowId, const char *reason = nullptr);
     virtual void createSlice(const NetworkSlice &slice);
     virtual void deleteSlice(int sliceId);
     virtual void updateSlice(const NetworkSlice &slice);
+    void indexSlice(const NetworkSlice &slice);
+    void unindexSlice(const NetworkSlice &slice);
+    void invalidateFloodDomains();
+    void computeFloodDomain(int vlanId) const;
+
+    // Flow expiry
+    simtime_t getExpiryDeadline(const FlowRule &rule) const;
+    uint64_t getExpiryTick(simtime_t t) const;
+    virtual void scheduleFlowExpiry(const FlowRule &rule);
+    virtual void expireFlows();
+
+    // Flow counters
+    int allocateCounterSlot(int flowId);
+    void releaseCounterSlot(int slot);
+    void invalidateCounterSlots();
+    virtual void collectFlowCounters();
+
+    // Routing
+    static bool isSwitchNode(cModule *node) { return node->getSubmodule("macTable") != nullptr; }
+    static bool isLinkEnabled(cGate *outputGate);
+    virtual void buildRoutingService();
+    virtual void updateRoutingLink(int linkId, bool up);
+    virtual void updateRoutingSwitch(cModule *node, bool up);
+
+    // Sharding
+    virtual void resolveShards();
+    int nextOwnedId(int id) const;
+    std::string getShardFileName(const std::string &fileName) const;
+    int getCommandShard(const JsonReader::Value &json) const;
 
     // External interface
     virtual void loadConfiguration();
+    static bool readConfigFile(const std::string &fileName, std::string &text, JsonReader &reader);
+    static JsonReader::Value getConfigList(const JsonReader::Value &root, const char *key);
+    virtual void loadSlice(NetworkSlice &&slice);
+    virtual void loadFlowRule(FlowRule &&rule);
     virtual void saveState();
+    virtual void compactStateIfNeeded();
+    virtual void writeCheckpoint();
+    virtual bool restoreCheckpoint();
+    virtual void clearState();
+    virtual void journalChange(const char *op, const std::string &body);
+    static std::string flowToJson(const FlowRule &flow);
+    static std::string sliceToJson(const NetworkSlice &slice);
+    virtual void startTelemetry(const std::string &socketPath);
+    virtual void publishChange(TelemetryRecordKind kind, int id, const std::string &record);
+    static std::string flowToBinary(const FlowRule &flow);
+    static std::string sliceToBinary(const NetworkSlice &slice);
     virtual void exportTopology();
 
     // Command processing
     virtual void processCommands();
-    virtual void parseAndExecuteCommand(const std::string &cmdJson);
+    virtual void processArrivedCommands();
+    virtual void enqueueCommands(const std::string &content);
+    virtual void enqueueCommand(const std::string &cmdJson);
+    virtual void dispatchCommands();
+    void scheduleDispatch();
+    virtual simtime_t parseAndExecuteCommand(const std::string &cmdJson);
+    static std::vector<JsonReader::Value> getBatchCommands(const JsonReader::Value &root);
+    virtual std::vector<CommandResult> routeCommandBatch(const std::vector<JsonReader::Value> &commands, simtime_t &completionTime);
+    virtual bool validateShardBatch(const std::vector<JsonReader::Value> &commands, std::vector<Command> &parsed, std::vector<CommandResult> &results);
+    virtual simtime_t serveShardBatch(int numCommands);
+    virtual void applyShardBatch(const std::vector<Command> &parsed, std::vector<CommandResult> &results);
+    virtual void writeCommandResults(const std::vector<CommandResult> &results);
+    virtual bool parseCommand(const JsonReader::Value &json, Command &cmd, std::string &error);
+    static void parseSlice(const JsonReader::Value &data, NetworkSlice &slice);
+    void parseFlow(const JsonReader::Value &data, FlowRule &flow) const;
+    static bool checkSlice(const NetworkSlice &slice, std::string &error);
+    static bool checkFlow(const FlowRule &flow, std::string &error);
+    virtual CommandCode validateCommand(const Command &cmd, BatchContext &context, std::string &error);
+    virtual int applyCommand(const Command &cmd);
 
   public:
     SDNControllerApp();
     virtual ~SDNControllerApp();
 
+    // Link and switch failures: model changes and INET node lifecycle
+    using cListener::receiveSignal;
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details) override;
+
     // API for external access
     const std::map<int, FlowRule>& getFlowTable() const { return flowTable; }
     const std::map<int, NetworkSlice>& getSlices() const { return slices; }
+    const FlowRule *lookupFlow(const PacketKey &key) const;
+    const RoutingService& getRoutingService() const { return routing; }
+    const std::vector<int>& getSlicesOfHost(const std::string &hostIP) const;
+    const std::vector<int>& getSlicesOfVlan(int vlanId) const;
+    bool isHostInSlice(const std::string &hostIP, int sliceId) const;
+
+    // Sharding. The accessors above cover this shard only; findSlice() and
+    // isSliceVlan() cover all of them. getShardOfId() is the shard that
+    // allocated a slice or flow ID, getShardOfKey() the one a slice name,
+    // host address or switch path hashes to on the ring.
+    int getNumShards() const { return numShards; }
+    int getShardIndex() const { return shardIndex; }
+    SDNControllerApp *getShard(int index) const { return shards.at(index); }
+    int getShardOfId(int id) const { return id > 0 ? (id - 1) % numShards : 0; }
+    int getShardOfKey(const std::string &key) const { return shardMap.getShard(ShardMap::hashKey(key)); }
+    int getShardOfSwitch(cModule *switchNode) const { return getShardOfKey(switchNode->getFullPath()); }
+    const NetworkSlice *findSlice(int sliceId) const;
+    bool isSliceVlan(int vlanId) const;
+    long getNumIdleExpiries() const { return numIdleExpiries; }
+    long getNumHardExpiries() const { return numHardExpiries; }
+
+    // Data plane counting. A switch port counts a packet under the rule it
+    // matches if the packet's source host is attached to its switch, so
+    // that every packet is counted once, at its first switch. A switch has
+    // a FlowCounterTable of every shard, shared by its ports so that a
+    // flooded packet is counted once too; createFlowCounterTable() returns
+    // the existing one for further ports, and nullptr if the shard does
+    // not collect counters. getCounterSlot() looks up the rule in all
+    // shards, and returns its slot (-1: not counted) and the shard whose
+    // table it is counted in. Results may be cached by the port as long as
+    // getFlowCounterVersion() (of any shard) does not change.
+    FlowCounterTable *createFlowCounterTable(cModule *switchNode);
+    uint64_t getFlowCounterVersion() const { return flowCounterVersion; }
+    int getCounterSlot(const PacketKey &key, int switchId, int &ownerShard) const;
+
+    // Accounts a PACKET_IN received by any shard to a rule of this shard
+    void countPacketIn(int flowId, int64_t bytes);
+
+    // Slice-aware bridging. The frames of a VLAN are flooded only along a
+    // tree connecting the hosts of the slices with that VLAN ID and the
+    // hosts in no slice (VLAN 0: all hosts). getFloodPorts() returns the
+    // ports (ethg indices) of the switch on that tree; results may be
+    // cached by the switch as long as getFloodDomainVersion() does not change.
+    uint64_t getFloodDomainVersion() const;
+    const std::vector<int>& getFloodPorts(cModule *switchNode, int vlanId) const;
+
+    // Parses and applies a command or command batch as if read from the
+    // command file (see processCommands), but at once instead of through
+    // the command queue, routing its commands to their shards; returns
+    // false if the controller is down. completionTime is set to when the
+    // commands are served (see processingDelay).
+    bool submitCommand(const std::string &cmdJson, simtime_t *completionTime = nullptr);
+
+    // Handles a PACKET_IN of the switch as if received from it, without
+    // sending the FlowMod; returns false if the controller is down
+    bool submitPacketIn(int switchId, const PacketKey &key, int64_t bytes, simtime_t *completionTime = nullptr);
+
     int addFlow(const FlowRule &rule);
     bool removeFlow(int flowId);
     int addSlice(const NetworkSlice &slice);
@@ -0,0 +1,49 @@
+#include "ShardMap.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace sdn_dashboard {
+
+void ShardMap::build(int numShards, int virtualNodes)
+{
+    if (numShards < 1 || virtualNodes < 1)
+        throw std::runtime_error("ShardMap needs at least one shard and one virtual node per shard");
+    this->numShards = numShards;
+    ring.clear();
+    ring.reserve((size_t)numShards * virtualNodes);
+    // the points of a shard do not depend on the number of shards, so that
+    // the existing shards keep theirs when one is added
+    for (int shard = 0; shard < numShards; shard++)
+        for (int i = 0; i < virtualNodes; i++)
+            ring.push_back(std::make_pair(hashKey(((uint64_t)shard << 32) | (uint32_t)i), shard));
+    std::sort(ring.begin(), ring.end());
+}
+
+int ShardMap::getShard(uint64_t hash) const
+{
+    if (ring.empty())
+        return 0;
+    auto it = std::lower_bound(ring.begin(), ring.end(), std::make_pair(hash, 0));
+    return it != ring.end() ? it->second : ring.front().second;  // the ring wraps around
+}
+
+uint64_t ShardMap::hashKey(uint64_t key)
+{
+    // splitmix64 finalizer: every input bit affects every output bit
+    key += 0x9e3779b97f4a7c15ULL;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+    return key ^ (key >> 31);
+}
+
+uint64_t ShardMap::hashKey(const std::string &key)
+{
+    // FNV-1a, mixed so that similar strings (host addresses, module paths)
+    // land far apart on the ring
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : key)
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    return hashKey(hash);
+}
+
+} // namespace sdn_dashboard
@@ -0,0 +1,41 @@
+#ifndef __SDN_DASHBOARD_SHARDMAP_H
+#define __SDN_DASHBOARD_SHARDMAP_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sdn_dashboard {
+
+/**
+ * Consistent hashing of keys onto a number of shards. Each shard owns
+ * virtualNodes points on a 64-bit hash ring; a key belongs to the shard of
+ * the first point at or after its hash. With enough points per shard the
+ * keys spread evenly, and adding a shard moves only the keys that the new
+ * one takes over (about 1/(N+1) of them) instead of almost all, as hashing
+ * modulo N would.
+ */
+class ShardMap
+{
+  protected:
+    std::vector<std::pair<uint64_t, int>> ring;  // point, shard; sorted by point
+    int numShards = 0;
+
+  public:
+    ShardMap() {}
+    ShardMap(int numShards, int virtualNodes) { build(numShards, virtualNodes); }
+
+    void build(int numShards, int virtualNodes);
+    int getNumShards() const { return numShards; }
+
+    // Shard of a key hashed with hashKey(); 0 if there are no shards
+    int getShard(uint64_t hash) const;
+
+    static uint64_t hashKey(uint64_t key);
+    static uint64_t hashKey(const std::string &key);
+};
+
+} // namespace sdn_dashboard
+
+#endif
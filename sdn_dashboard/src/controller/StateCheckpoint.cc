@@ -0,0 +1,178 @@
+#include "StateCheckpoint.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sdn_dashboard {
+
+static_assert(sizeof(CheckpointHeader) == 64, "checkpoint layout changed");
+static_assert(sizeof(CheckpointSliceRecord) == 48, "checkpoint layout changed");
+static_assert(sizeof(CheckpointFlowRecord) == 104, "checkpoint layout changed");
+
+static const char CHECKPOINT_MAGIC[8] = "SDNCKPT";
+
+CheckpointWriter::CheckpointWriter(uint64_t seq, int64_t timeRaw, int simtimeScale, int nextFlowId, int nextSliceId)
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CheckpointReader::VERSION;
+    header.headerSize = sizeof(CheckpointHeader);
+    header.seq = seq;
+    header.timeRaw = timeRaw;
+    header.simtimeScale = simtimeScale;
+    header.nextFlowId = nextFlowId;
+    header.nextSliceId = nextSliceId;
+}
+
+CheckpointStringRef CheckpointWriter::addString(const std::string &s)
+{
+    auto it = stringRefs.find(s);
+    if (it != stringRefs.end())
+        return it->second;
+    if (strings.size() + s.size() > UINT32_MAX)
+        throw std::runtime_error("Checkpoint string section exceeds 4 GiB");
+    CheckpointStringRef ref;
+    ref.offset = strings.size();
+    ref.length = s.size();
+    strings += s;
+    stringRefs[s] = ref;
+    return ref;
+}
+
+void CheckpointWriter::addSlice(CheckpointSliceRecord record, const std::string &name, const std::vector<std::string> &hosts)
+{
+    record.name = addString(name);
+    record.firstHost = hostRefs.size();
+    record.numHosts = hosts.size();
+    memset(record.reserved, 0, sizeof(record.reserved));
+    for (const std::string &host : hosts)
+        hostRefs.push_back(addString(host));
+    sliceRecords.push_back(record);
+}
+
+void CheckpointWriter::addFlow(CheckpointFlowRecord record, const std::string &srcIP, const std::string &dstIP, const std::string &action)
+{
+    record.srcIP = addString(srcIP);
+    record.dstIP = addString(dstIP);
+    record.action = addString(action);
+    record.reserved = 0;
+    flowRecords.push_back(record);
+}
+
+void CheckpointWriter::write(const std::string &fileName)
+{
+    header.numSlices = sliceRecords.size();
+    header.numHosts = hostRefs.size();
+    header.numFlows = flowRecords.size();
+    header.stringsSize = strings.size();
+
+    std::string tmpFileName = fileName + ".tmp";
+    FILE *f = fopen(tmpFileName.c_str(), "wb");
+    if (!f)
+        throw std::runtime_error("Cannot write checkpoint '" + tmpFileName + "': " + strerror(errno));
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+        && fwrite(sliceRecords.data(), sizeof(CheckpointSliceRecord), sliceRecords.size(), f) == sliceRecords.size()
+        && fwrite(hostRefs.data(), sizeof(CheckpointStringRef), hostRefs.size(), f) == hostRefs.size()
+        && fwrite(flowRecords.data(), sizeof(CheckpointFlowRecord), flowRecords.size(), f) == flowRecords.size()
+        && fwrite(strings.data(), 1, strings.size(), f) == strings.size();
+    if (fclose(f) != 0)
+        ok = false;
+    if (!ok || rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+        int err = errno;
+        remove(tmpFileName.c_str());
+        throw std::runtime_error("Cannot write checkpoint '" + fileName + "': " + strerror(err));
+    }
+}
+
+bool CheckpointReader::open(const std::string &fileName)
+{
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return false;
+        throw std::runtime_error("Cannot open checkpoint '" + fileName + "': " + strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot open checkpoint '" + fileName + "': " + strerror(err));
+    }
+    if ((size_t)st.st_size < sizeof(CheckpointHeader)) {
+        ::close(fd);
+        throw std::runtime_error("'" + fileName + "' is not a controller checkpoint");
+    }
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    ::close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("Cannot map checkpoint '" + fileName + "': " + strerror(err));
+    data = p;
+    size = st.st_size;
+
+    // Validate everything the accessors rely on, so that a damaged file
+    // is rejected here instead of being read out of bounds later
+    const char *base = (const char *)data;
+    header = (const CheckpointHeader *)base;
+    if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0) {
+        close();
+        throw std::runtime_error("'" + fileName + "' is not a controller checkpoint");
+    }
+    if (header->version != VERSION || header->headerSize != sizeof(CheckpointHeader)) {
+        uint32_t version = header->version;
+        close();
+        throw std::runtime_error("Checkpoint '" + fileName + "' has format version " + std::to_string(version)
+                                 + ", expected " + std::to_string(VERSION));
+    }
+    uint64_t expectedSize = sizeof(CheckpointHeader) + (uint64_t)header->numSlices * sizeof(CheckpointSliceRecord)
+        + (uint64_t)header->numHosts * sizeof(CheckpointStringRef) + (uint64_t)header->numFlows * sizeof(CheckpointFlowRecord)
+        + header->stringsSize;
+    if (expectedSize != size) {
+        close();
+        throw std::runtime_error("Checkpoint '" + fileName + "' is truncated or damaged");
+    }
+    sliceRecords = (const CheckpointSliceRecord *)(base + sizeof(CheckpointHeader));
+    hostRefs = (const CheckpointStringRef *)(sliceRecords + header->numSlices);
+    flowRecords = (const CheckpointFlowRecord *)(hostRefs + header->numHosts);
+    strings = (const char *)(flowRecords + header->numFlows);
+
+    uint64_t stringsSize = header->stringsSize;
+    auto isValid = [stringsSize](const CheckpointStringRef &ref) { return (uint64_t)ref.offset + ref.length <= stringsSize; };
+    bool valid = true;
+    for (uint32_t i = 0; i < header->numSlices && valid; i++) {
+        const CheckpointSliceRecord &slice = sliceRecords[i];
+        valid = isValid(slice.name) && (uint64_t)slice.firstHost + slice.numHosts <= header->numHosts;
+    }
+    for (uint32_t i = 0; i < header->numHosts && valid; i++)
+        valid = isValid(hostRefs[i]);
+    for (uint32_t i = 0; i < header->numFlows && valid; i++) {
+        const CheckpointFlowRecord &flow = flowRecords[i];
+        valid = isValid(flow.srcIP) && isValid(flow.dstIP) && isValid(flow.action);
+    }
+    if (!valid) {
+        close();
+        throw std::runtime_error("Checkpoint '" + fileName + "' is truncated or damaged");
+    }
+    return true;
+}
+
+void CheckpointReader::close()
+{
+    if (data)
+        munmap(data, size);
+    data = nullptr;
+    size = 0;
+    header = nullptr;
+    sliceRecords = nullptr;
+    hostRefs = nullptr;
+    flowRecords = nullptr;
+    strings = nullptr;
+}
+
+} // namespace sdn_dashboard
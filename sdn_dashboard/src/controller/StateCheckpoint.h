@@ -0,0 +1,149 @@
+#ifndef __SDN_DASHBOARD_STATECHECKPOINT_H
+#define __SDN_DASHBOARD_STATECHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sdn_dashboard {
+
+/**
+ * Binary checkpoint of the controller state (slices, flow rules and ID
+ * counters), from which a restarted controller warm-restarts instead of
+ * starting over from its configuration.
+ *
+ * The file consists of fixed-size records, so that it can be mapped into
+ * memory and read in place, without parsing:
+ *
+ *   CheckpointHeader | numSlices * SliceRecord | numHosts * StringRef
+ *   | numFlows * FlowRecord | stringsSize bytes of strings
+ *
+ * Strings are referenced by offset and length into the string section,
+ * where each distinct string is stored once. The hosts of a slice are the
+ * numHosts StringRefs from firstHost on. Records are in the machine's byte
+ * order (little-endian on all supported platforms). Times are raw simtime
+ * values with the header's scale exponent.
+ *
+ * The header carries a format version; a reader rejects any version other
+ * than its own, and the layout of a version never changes once released.
+ * Files are written to a temporary file and renamed into place, so a crash
+ * while writing leaves the previous checkpoint intact.
+ */
+struct CheckpointHeader {
+    char magic[8];            // "SDNCKPT", NUL-terminated
+    uint32_t version;
+    uint32_t headerSize;      // sizeof(CheckpointHeader)
+    uint64_t seq;             // journal seq of the state
+    int64_t timeRaw;          // simulation time of the checkpoint
+    int32_t simtimeScale;     // scale exponent of the raw times
+    int32_t nextFlowId;
+    int32_t nextSliceId;
+    uint32_t numSlices;
+    uint32_t numHosts;
+    uint32_t numFlows;
+    uint64_t stringsSize;
+};
+
+struct CheckpointStringRef {
+    uint32_t offset = 0;
+    uint32_t length = 0;
+};
+
+struct CheckpointSliceRecord {
+    int32_t id;
+    int32_t vlanId;
+    double bandwidthMbps;
+    int64_t createdTimeRaw;
+    CheckpointStringRef name;
+    uint32_t firstHost;
+    uint32_t numHosts;
+    uint8_t isolated;
+    uint8_t reserved[7];
+};
+
+struct CheckpointFlowRecord {
+    int32_t id;
+    int32_t srcPort;
+    int32_t dstPort;
+    int32_t protocol;
+    int32_t outputPort;
+    int32_t priority;
+    int32_t sliceId;
+    int32_t reserved;
+    int64_t installedTimeRaw;
+    int64_t lastMatchedTimeRaw;
+    double idleTimeout;
+    double hardTimeout;
+    int64_t packetsMatched;
+    int64_t bytesMatched;
+    CheckpointStringRef srcIP;
+    CheckpointStringRef dstIP;
+    CheckpointStringRef action;
+};
+
+/**
+ * Collects the records of a checkpoint and writes them to a file.
+ */
+class CheckpointWriter
+{
+  private:
+    CheckpointHeader header;
+    std::vector<CheckpointSliceRecord> sliceRecords;
+    std::vector<CheckpointStringRef> hostRefs;
+    std::vector<CheckpointFlowRecord> flowRecords;
+    std::string strings;
+    std::unordered_map<std::string, CheckpointStringRef> stringRefs;
+
+  public:
+    CheckpointWriter(uint64_t seq, int64_t timeRaw, int simtimeScale, int nextFlowId, int nextSliceId);
+
+    CheckpointStringRef addString(const std::string &s);
+    // record.name, firstHost and numHosts are filled in
+    void addSlice(CheckpointSliceRecord record, const std::string &name, const std::vector<std::string> &hosts);
+    // record.srcIP, dstIP and action are filled in
+    void addFlow(CheckpointFlowRecord record, const std::string &srcIP, const std::string &dstIP, const std::string &action);
+    void reserveFlows(size_t n) { flowRecords.reserve(n); }
+
+    // Throws std::runtime_error on failure
+    void write(const std::string &fileName);
+};
+
+/**
+ * Maps a checkpoint file into memory and gives access to its records.
+ */
+class CheckpointReader
+{
+  private:
+    void *data = nullptr;
+    size_t size = 0;
+    const CheckpointHeader *header = nullptr;
+    const CheckpointSliceRecord *sliceRecords = nullptr;
+    const CheckpointStringRef *hostRefs = nullptr;
+    const CheckpointFlowRecord *flowRecords = nullptr;
+    const char *strings = nullptr;
+
+  public:
+    static const uint32_t VERSION = 1;
+
+    CheckpointReader() {}
+    ~CheckpointReader() { close(); }
+    CheckpointReader(const CheckpointReader&) = delete;
+    CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+    // Returns false if the file does not exist; throws std::runtime_error
+    // if it is not a checkpoint of this version or is truncated
+    bool open(const std::string &fileName);
+    void close();
+
+    const CheckpointHeader& getHeader() const { return *header; }
+    const CheckpointSliceRecord& getSlice(size_t i) const { return sliceRecords[i]; }
+    const CheckpointStringRef& getHost(const CheckpointSliceRecord &slice, size_t i) const { return hostRefs[slice.firstHost + i]; }
+    const CheckpointFlowRecord& getFlow(size_t i) const { return flowRecords[i]; }
+    std::string getString(const CheckpointStringRef &ref) const { return std::string(strings + ref.offset, ref.length); }
+};
+
+} // namespace sdn_dashboard
+
+#endif
@@ -0,0 +1,101 @@
+#include "StateJournal.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace sdn_dashboard {
+
+void StateJournal::open(const std::string& fileName, uint64_t baseSeq)
+{
+    close();
+    this->fileName = fileName;
+    seq = snapshotSeq = baseSeq;
+    restart();
+}
+
+void StateJournal::close()
+{
+    if (out.is_open()) {
+        out.flush();
+        bytesWritten += std::max<std::streamoff>(out.tellp(), 0);
+        out.close();
+    }
+    dirty = false;
+    batchDepth = 0;
+}
+
+uint64_t StateJournal::append(double timestamp, const char *op, const std::string& body)
+{
+    if (!out.is_open())
+        return seq;
+
+    ++seq;
+    out << "{\"seq\":" << seq << ",\"timestamp\":" << timestamp << ",\"op\":\"" << op << "\"";
+    if (!body.empty())
+        out << "," << body;
+    out << "}\n";
+    dirty = true;
+
+    if (batchDepth == 0)
+        flush();
+    return seq;
+}
+
+void StateJournal::restart()
+{
+    if (out.is_open()) {
+        bytesWritten += std::max<std::streamoff>(out.tellp(), 0);
+        out.close();
+    }
+    out.open(fileName, std::ios::out | std::ios::trunc);
+    if (!out.is_open())
+        throw std::runtime_error("Cannot open journal file '" + fileName + "'");
+    snapshotSeq = seq;
+    out << "{\"seq\":" << seq << ",\"op\":\"SNAPSHOT\"}\n";
+    out.flush();
+    dirty = false;
+}
+
+uint64_t StateJournal::getBytesWritten()
+{
+    return bytesWritten + (out.is_open() ? std::max<std::streamoff>(out.tellp(), 0) : 0);
+}
+
+void StateJournal::endBatch()
+{
+    if (batchDepth > 0 && --batchDepth == 0)
+        flush();
+}
+
+void StateJournal::flush()
+{
+    if (dirty && out.is_open()) {
+        out.flush();
+        dirty = false;
+    }
+}
+
+std::string StateJournal::quote(const std::string& s)
+{
+    std::string result = "\"";
+    for (char c : s) {
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    result += buf;
+                }
+                else
+                    result += c;
+        }
+    }
+    return result + "\"";
+}
+
+} // namespace sdn_dashboard
@@ -0,0 +1,70 @@
+#ifndef __SDN_DASHBOARD_STATEJOURNAL_H
+#define __SDN_DASHBOARD_STATEJOURNAL_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace sdn_dashboard {
+
+/**
+ * Append-only change journal for the controller state export.
+ *
+ * Every mutation is written as one JSON line carrying a strictly increasing
+ * sequence number, so a mutation costs one small append instead of a full
+ * rewrite of the state file. The controller periodically writes a compacted
+ * snapshot (tagged with the sequence number it reflects) and then restarts
+ * the journal with a SNAPSHOT marker line. Readers load the snapshot once and
+ * afterwards only apply journal lines with seq greater than the last one seen;
+ * a marker newer than their last seq tells them to reload the snapshot.
+ *
+ * Writes inside a beginBatch()/endBatch() pair are flushed once at the end.
+ */
+class StateJournal
+{
+  private:
+    std::string fileName;
+    std::ofstream out;
+    uint64_t seq = 0;
+    uint64_t snapshotSeq = 0;
+    int batchDepth = 0;
+    bool dirty = false;       // unflushed entries
+    uint64_t bytesWritten = 0;  // to the journal before its last restart
+
+  public:
+    StateJournal() {}
+    ~StateJournal() { close(); }
+
+    void open(const std::string& fileName, uint64_t baseSeq = 0);
+    void close();
+    bool isOpen() const { return out.is_open(); }
+
+    // Appends one entry; body is a comma-separated list of JSON members
+    // (e.g. "\"id\":3") or empty. Returns the sequence number assigned.
+    uint64_t append(double timestamp, const char *op, const std::string& body);
+
+    // Truncates the journal after a snapshot reflecting all entries up to getSeq()
+    void restart();
+
+    // Consumes a sequence number without an entry. After the state was reset
+    // or rolled back, the next snapshot then gets a seq newer than any reader
+    // has seen, so that all of them reload it.
+    void skip() { ++seq; }
+
+    void beginBatch() { batchDepth++; }
+    void endBatch();
+    void flush();
+
+    uint64_t getSeq() const { return seq; }
+    uint64_t getSnapshotSeq() const { return snapshotSeq; }
+    uint64_t getEntriesSinceSnapshot() const { return seq - snapshotSeq; }
+    // Since the journal was first opened, across restarts
+    uint64_t getBytesWritten();
+
+    // Escapes a string for inclusion in a JSON string literal
+    static std::string quote(const std::string& s);
+};
+
+} // namespace sdn_dashboard
+
+#endif
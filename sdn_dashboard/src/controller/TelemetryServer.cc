@@ -0,0 +1,387 @@
+#include "TelemetryServer.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace sdn_dashboard {
+
+void TelemetryServer::putU16(std::string &buf, uint16_t v)
+{
+    buf.push_back((char)v);
+    buf.push_back((char)(v >> 8));
+}
+
+void TelemetryServer::putU32(std::string &buf, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        buf.push_back((char)(v >> (8 * i)));
+}
+
+void TelemetryServer::putU64(std::string &buf, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        buf.push_back((char)(v >> (8 * i)));
+}
+
+void TelemetryServer::putF64(std::string &buf, double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    putU64(buf, bits);
+}
+
+void TelemetryServer::putString(std::string &buf, const std::string &s)
+{
+    size_t length = std::min(s.size(), (size_t)UINT16_MAX);
+    putU16(buf, (uint16_t)length);
+    buf.append(s, 0, length);
+}
+
+uint32_t TelemetryServer::getU32(const char *p)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++)
+        v |= (uint32_t)(uint8_t)p[i] << (8 * i);
+    return v;
+}
+
+uint64_t TelemetryServer::getU64(const char *p)
+{
+    return getU32(p) | (uint64_t)getU32(p + 4) << 32;
+}
+
+void TelemetryServer::beginFrame(std::string &buf, MessageType type)
+{
+    putU32(buf, 0);  // length, patched by endFrame()
+    putU8(buf, type);
+}
+
+void TelemetryServer::endFrame(std::string &buf, size_t frameStart)
+{
+    uint32_t length = buf.size() - frameStart - 4;
+    for (int i = 0; i < 4; i++)
+        buf[frameStart + i] = (char)(length >> (8 * i));
+}
+
+void TelemetryServer::start(const std::string &path, uint64_t startSeq)
+{
+    stop();
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("Telemetry socket path '" + path + "' is too long");
+    strcpy(addr.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error(std::string("Cannot create telemetry socket: ") + strerror(errno));
+    // a socket file left behind by a previous run would make bind() fail
+    unlink(path.c_str());
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0 || pipe(wakeupFds) < 0) {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error("Cannot listen on telemetry socket '" + path + "': " + strerror(err));
+    }
+    for (int f : {fd, wakeupFds[0], wakeupFds[1]})
+        fcntl(f, F_SETFL, fcntl(f, F_GETFL) | O_NONBLOCK);
+
+    socketPath = path;
+    listenFd = fd;
+    seq = bufferedFromSeq = startSeq;
+    recentDeltas.clear();
+    stopping = false;
+    wakeupPending = false;
+    ioThread = std::thread(&TelemetryServer::run, this);
+}
+
+void TelemetryServer::stop()
+{
+    if (ioThread.joinable()) {
+        stopping = true;
+        ssize_t n = write(wakeupFds[1], "x", 1);
+        (void)n;
+        ioThread.join();
+    }
+    for (Client &client : clients)
+        close(client.fd);
+    clients.clear();
+    numClients = 0;
+    if (listenFd >= 0) {
+        close(listenFd);
+        listenFd = -1;
+        unlink(socketPath.c_str());
+    }
+    for (int &fd : wakeupFds) {
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+    }
+}
+
+void TelemetryServer::putRecord(uint8_t kind, int32_t id, const std::string &record)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t key = (uint64_t)kind << 32 | (uint32_t)id;
+    if (record.empty())
+        records.erase(key);
+    else
+        records[key] = record;
+}
+
+void TelemetryServer::clearRecords()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    records.clear();
+}
+
+void TelemetryServer::publish(uint64_t deltaSeq, double timestamp, uint8_t kind, int32_t id, const std::string &record)
+{
+    if (!isRunning())
+        return;
+
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(30 + record.size());
+    beginFrame(*frame, DELTA);
+    putU64(*frame, deltaSeq);
+    putF64(*frame, timestamp);
+    putU8(*frame, kind);
+    putI32(*frame, id);
+    putU32(*frame, record.size());
+    *frame += record;
+    endFrame(*frame, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t key = (uint64_t)kind << 32 | (uint32_t)id;
+        if (record.empty())
+            records.erase(key);
+        else
+            records[key] = record;
+        seq = deltaSeq;
+        recentDeltas.emplace_back(deltaSeq, std::move(frame));
+        if (recentDeltas.size() > maxRecentDeltas) {
+            bufferedFromSeq = recentDeltas.front().first;
+            recentDeltas.pop_front();
+        }
+        deltasPublished++;
+    }
+
+    // one wakeup for any number of deltas published before the I/O thread runs
+    if (!wakeupPending.exchange(true)) {
+        ssize_t n = write(wakeupFds[1], "x", 1);
+        (void)n;
+    }
+}
+
+TelemetryServer::Stats TelemetryServer::getStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.deltasPublished = deltasPublished;
+    stats.snapshotsSent = snapshotsSent;
+    stats.bytesSent = bytesSent;
+    stats.numClients = numClients;
+    return stats;
+}
+
+void TelemetryServer::run()
+{
+    std::vector<pollfd> fds;
+    while (!stopping) {
+        fds.clear();
+        fds.push_back({listenFd, POLLIN, 0});
+        fds.push_back({wakeupFds[0], POLLIN, 0});
+        for (const Client &client : clients)
+            fds.push_back({client.fd, (short)(POLLIN | (client.backlog > 0 ? POLLOUT : 0)), 0});
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (stopping)
+            break;
+
+        if (fds[1].revents != 0) {
+            // let a burst of deltas accumulate, so that it costs one wakeup
+            // and one write per client instead of one per delta
+            std::this_thread::sleep_for(std::chrono::microseconds(coalesceMicros));
+            char buf[256];
+            while (read(wakeupFds[0], buf, sizeof(buf)) > 0)
+                ;
+            wakeupPending = false;
+        }
+
+        // in reverse, so closing one does not shift the rest
+        for (size_t i = clients.size(); i-- > 0; ) {
+            short revents = fds[2 + i].revents;
+            bool ok = true;
+            if (revents & (POLLIN | POLLHUP | POLLERR))
+                ok = readClient(clients[i]);
+            if (ok && (revents & POLLOUT))
+                ok = writeClient(clients[i]);
+            if (!ok) {
+                close(clients[i].fd);
+                clients.erase(clients.begin() + i);
+            }
+        }
+        if (fds[0].revents != 0)
+            acceptClients();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Client &client : clients)
+                if (client.subscribed)
+                    queueUpdates(client);
+        }
+        for (size_t i = clients.size(); i-- > 0; ) {
+            if (clients[i].backlog > 0 && !writeClient(clients[i])) {
+                close(clients[i].fd);
+                clients.erase(clients.begin() + i);
+            }
+        }
+        numClients = clients.size();
+    }
+}
+
+void TelemetryServer::acceptClients()
+{
+    int fd;
+    while ((fd = accept(listenFd, nullptr, nullptr)) >= 0) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        Client client;
+        client.fd = fd;
+        clients.push_back(std::move(client));
+    }
+}
+
+bool TelemetryServer::readClient(Client &client)
+{
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(client.fd, buf, sizeof(buf))) > 0)
+        client.in.append(buf, n);
+    if (n == 0 || (errno != EAGAIN && errno != EINTR))
+        return false;
+
+    size_t pos = 0;
+    while (client.in.size() - pos >= 4) {
+        uint32_t length = getU32(client.in.data() + pos);
+        if (length == 0 || length > 4096)
+            return false;  // clients only send small requests
+        if (client.in.size() - pos - 4 < length)
+            break;
+        if (!handleFrame(client, client.in[pos + 4], client.in.data() + pos + 5, length - 1))
+            return false;
+        pos += 4 + length;
+    }
+    client.in.erase(0, pos);
+    return true;
+}
+
+bool TelemetryServer::handleFrame(Client &client, uint8_t type, const char *body, size_t length)
+{
+    if (type != SUBSCRIBE || length != 8)
+        return false;
+
+    // a client that knows the state up to a seq whose successors are still
+    // buffered only needs those; anyone else starts from a snapshot
+    uint64_t sinceSeq = getU64(body);
+    std::lock_guard<std::mutex> lock(mutex);
+    client.subscribed = true;
+    if (sinceSeq == 0 || sinceSeq < bufferedFromSeq || sinceSeq > seq)
+        queueSnapshot(client);
+    else
+        client.seq = sinceSeq;
+    return true;
+}
+
+void TelemetryServer::queueFrame(Client &client, const Frame &frame)
+{
+    client.out.push_back(frame);
+    client.backlog += frame->size();
+}
+
+void TelemetryServer::queueSnapshot(Client &client)
+{
+    auto frame = std::make_shared<std::string>();
+    beginFrame(*frame, SNAPSHOT);
+    putU64(*frame, seq);
+    putU32(*frame, records.size());
+    for (const auto &entry : records) {
+        putU8(*frame, (uint8_t)(entry.first >> 32));
+        putI32(*frame, (int32_t)(uint32_t)entry.first);
+        putU32(*frame, entry.second.size());
+        *frame += entry.second;
+    }
+    endFrame(*frame, 0);
+    queueFrame(client, frame);
+    client.seq = seq;
+    snapshotsSent++;
+}
+
+void TelemetryServer::queueUpdates(Client &client)
+{
+    if (client.seq == seq || client.backlog >= maxClientBacklog)
+        return;
+    if (client.seq < bufferedFromSeq) {
+        // fell behind while its backlog drained
+        queueSnapshot(client);
+        return;
+    }
+    auto it = std::upper_bound(recentDeltas.begin(), recentDeltas.end(), client.seq,
+                               [](uint64_t s, const std::pair<uint64_t, Frame> &delta) { return s < delta.first; });
+    for (; it != recentDeltas.end() && client.backlog < maxClientBacklog; ++it) {
+        queueFrame(client, it->second);
+        client.seq = it->first;
+    }
+}
+
+bool TelemetryServer::writeClient(Client &client)
+{
+    // gather many small delta frames into one system call
+    const int maxFrames = 256;
+    iovec iov[maxFrames];
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    while (client.backlog > 0) {
+        int count = 0;
+        for (auto it = client.out.begin(); it != client.out.end() && count < maxFrames; ++it, ++count) {
+            size_t offset = count == 0 ? client.outPos : 0;
+            iov[count].iov_base = const_cast<char *>((*it)->data() + offset);
+            iov[count].iov_len = (*it)->size() - offset;
+        }
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(client.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                break;
+            return false;
+        }
+        bytesSent += n;
+        client.backlog -= n;
+        for (size_t left = n; left > 0; ) {
+            size_t rest = client.out.front()->size() - client.outPos;
+            if (left < rest) {
+                client.outPos += left;
+                break;
+            }
+            left -= rest;
+            client.out.pop_front();
+            client.outPos = 0;
+        }
+    }
+    return true;
+}
+
+} // namespace sdn_dashboard
@@ -0,0 +1,147 @@
+#ifndef __SDN_DASHBOARD_TELEMETRYSERVER_H
+#define __SDN_DASHBOARD_TELEMETRYSERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sdn_dashboard {
+
+/**
+ * Serves the controller state on a local UNIX-domain stream socket, as a
+ * snapshot followed by a stream of deltas, so that the dashboard does not
+ * have to watch and reparse the exported state files.
+ *
+ * The protocol is binary and length-prefixed; all integers are little-endian.
+ * Every message is a frame of
+ *
+ *   u32 length (of type and body) | u8 type | body
+ *
+ * The client sends SUBSCRIBE with u64 sinceSeq, the last state sequence
+ * number it knows (0 for none). If the deltas after sinceSeq are still
+ * buffered, the server replies with just those; otherwise it first sends a
+ * SNAPSHOT. Either way, every later change follows as a DELTA.
+ *
+ *   SNAPSHOT: u64 seq | u32 count | count * (u8 kind | i32 id | u32 len | record)
+ *   DELTA:    u64 seq | f64 timestamp | u8 kind | i32 id | u32 len | record
+ *
+ * A DELTA with an empty record removes the entry; otherwise it replaces or
+ * adds it. Records are opaque to the server (see the controller for the
+ * encoding of slices and flows), which keeps the latest record of every
+ * entry to build snapshots from.
+ *
+ * Socket I/O runs on a thread of its own. publish() only encodes the delta
+ * and wakes that thread, so slow clients never stall the simulation. A client
+ * whose unsent backlog exceeds maxClientBacklog gets no further deltas until
+ * it catches up; if it falls behind the buffered deltas meanwhile, it is
+ * sent a new snapshot.
+ */
+class TelemetryServer
+{
+  public:
+    enum MessageType : uint8_t { SUBSCRIBE = 1, SNAPSHOT = 2, DELTA = 3 };
+
+    struct Stats {
+        uint64_t deltasPublished = 0;
+        uint64_t snapshotsSent = 0;
+        uint64_t bytesSent = 0;
+        size_t numClients = 0;
+    };
+
+  private:
+    typedef std::shared_ptr<const std::string> Frame;  // shared by all clients it is queued to
+
+    struct Client {
+        int fd;
+        std::string in;          // received bytes of an incomplete frame
+        std::deque<Frame> out;   // frames not yet written
+        size_t outPos = 0;       // written part of out.front()
+        size_t backlog = 0;      // unwritten bytes in out
+        bool subscribed = false;
+        uint64_t seq = 0;        // last state seq queued to the client
+    };
+
+    // config
+    std::string socketPath;
+    size_t maxRecentDeltas = 100000;
+    size_t maxClientBacklog = 4 << 20;
+    int coalesceMicros = 1000;
+
+    // shared between publish() and the I/O thread
+    std::mutex mutex;
+    uint64_t seq = 0;
+    uint64_t bufferedFromSeq = 0;              // all deltas after this seq are in recentDeltas
+    std::map<uint64_t, std::string> records;   // (kind << 32 | id) -> latest record
+    std::deque<std::pair<uint64_t, Frame>> recentDeltas;  // seq -> encoded DELTA frame
+    uint64_t deltasPublished = 0;
+    uint64_t snapshotsSent = 0;
+
+    // I/O thread
+    std::thread ioThread;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> wakeupPending{false};
+    int listenFd = -1;
+    int wakeupFds[2] = {-1, -1};
+    std::vector<Client> clients;
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<size_t> numClients{0};
+
+  protected:
+    void run();
+    void acceptClients();
+    bool readClient(Client &client);
+    bool writeClient(Client &client);
+    bool handleFrame(Client &client, uint8_t type, const char *body, size_t length);
+    void queueUpdates(Client &client);
+    void queueSnapshot(Client &client);
+    static void queueFrame(Client &client, const Frame &frame);
+    static void beginFrame(std::string &buf, MessageType type);
+    static void endFrame(std::string &buf, size_t frameStart);
+
+  public:
+    TelemetryServer() {}
+    ~TelemetryServer() { stop(); }
+
+    void setMaxRecentDeltas(size_t n) { maxRecentDeltas = n; }
+    void setMaxClientBacklog(size_t bytes) { maxClientBacklog = bytes; }
+    void setCoalesceMicros(int us) { coalesceMicros = us; }
+
+    // Listens on socketPath and starts the I/O thread; seq is the sequence
+    // number of the current state. Throws std::runtime_error on failure.
+    void start(const std::string &socketPath, uint64_t seq = 0);
+    void stop();
+    bool isRunning() const { return listenFd >= 0; }
+
+    // Sets an entry without publishing a delta, for the state before start()
+    void putRecord(uint8_t kind, int32_t id, const std::string &record);
+    // Drops all entries, for a state that is replaced as a whole before start()
+    void clearRecords();
+
+    // Records a change of one entry as state seq; an empty record removes it.
+    // Sequence numbers must increase. Does nothing unless started.
+    void publish(uint64_t seq, double timestamp, uint8_t kind, int32_t id, const std::string &record);
+
+    Stats getStats();
+
+    // Little-endian encoding helpers for frames and records
+    static void putU8(std::string &buf, uint8_t v) { buf.push_back((char)v); }
+    static void putU16(std::string &buf, uint16_t v);
+    static void putU32(std::string &buf, uint32_t v);
+    static void putU64(std::string &buf, uint64_t v);
+    static void putI32(std::string &buf, int32_t v) { putU32(buf, (uint32_t)v); }
+    static void putI64(std::string &buf, int64_t v) { putU64(buf, (uint64_t)v); }
+    static void putF64(std::string &buf, double v);
+    static void putString(std::string &buf, const std::string &s);  // u16 length, then the bytes
+    static uint32_t getU32(const char *p);
+    static uint64_t getU64(const char *p);
+};
+
+} // namespace sdn_dashboard
+
+#endif
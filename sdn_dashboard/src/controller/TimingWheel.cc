@@ -0,0 +1,129 @@
+#include "TimingWheel.h"
+#include <algorithm>
+
+namespace sdn_dashboard {
+
+void TimingWheel::place(int t, uint64_t earliestTick)
+{
+    Timer &timer = timers[t];
+    uint64_t tick = std::max(timer.expiry, earliestTick);
+    const uint64_t range = (uint64_t)1 << (SLOT_BITS * LEVELS);
+    if (tick - currentTick >= range)
+        tick = currentTick + range - 1;  // placed again when its slot comes up
+    uint64_t delta = tick - currentTick;
+    int level = 0;
+    while (level < LEVELS - 1 && (delta >> (SLOT_BITS * (level + 1))) != 0)
+        level++;
+    int slot = level * SLOTS + (int)((tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+
+    timer.slot = slot;
+    timer.prev = -1;
+    timer.next = slotHeads[slot];
+    if (timer.next != -1)
+        timers[timer.next].prev = t;
+    slotHeads[slot] = t;
+}
+
+void TimingWheel::unlink(int t)
+{
+    Timer &timer = timers[t];
+    if (timer.prev != -1)
+        timers[timer.prev].next = timer.next;
+    else
+        slotHeads[timer.slot] = timer.next;
+    if (timer.next != -1)
+        timers[timer.next].prev = timer.prev;
+    timer.slot = timer.prev = timer.next = -1;
+}
+
+void TimingWheel::cascade(int slot)
+{
+    int t = slotHeads[slot];
+    slotHeads[slot] = -1;
+    while (t != -1) {
+        int next = timers[t].next;
+        place(t, currentTick);
+        t = next;
+    }
+}
+
+void TimingWheel::schedule(int id, uint64_t expiryTick)
+{
+    int t;
+    auto it = timerOfId.find(id);
+    if (it != timerOfId.end()) {
+        t = it->second;
+        unlink(t);
+    }
+    else {
+        if (freeTimers.empty()) {
+            t = timers.size();
+            timers.emplace_back();
+        }
+        else {
+            t = freeTimers.back();
+            freeTimers.pop_back();
+        }
+        timerOfId[id] = t;
+        timers[t].id = id;
+    }
+    timers[t].expiry = expiryTick;
+    place(t, currentTick + 1);
+}
+
+bool TimingWheel::cancel(int id)
+{
+    auto it = timerOfId.find(id);
+    if (it == timerOfId.end())
+        return false;
+    unlink(it->second);
+    freeTimers.push_back(it->second);
+    timerOfId.erase(it);
+    return true;
+}
+
+void TimingWheel::advance(uint64_t toTick, std::vector<int> &expired)
+{
+    while (currentTick < toTick) {
+        if (timerOfId.empty()) {
+            currentTick = toTick;
+            break;
+        }
+        currentTick++;
+
+        // entering the range of a higher-level slot moves its timers down
+        for (int level = 1; level < LEVELS; level++) {
+            if ((currentTick & (((uint64_t)1 << (SLOT_BITS * level)) - 1)) != 0)
+                break;
+            cascade(level * SLOTS + (int)((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1)));
+        }
+
+        int slot = (int)(currentTick & (SLOTS - 1));
+        int t = slotHeads[slot];
+        slotHeads[slot] = -1;
+        while (t != -1) {
+            Timer &timer = timers[t];
+            int next = timer.next;
+            if (timer.expiry <= currentTick) {
+                expired.push_back(timer.id);
+                timerOfId.erase(timer.id);
+                timer.slot = timer.prev = timer.next = -1;
+                freeTimers.push_back(t);
+            }
+            else {
+                place(t, currentTick);  // was beyond the range of the top level
+            }
+            t = next;
+        }
+    }
+}
+
+void TimingWheel::clear()
+{
+    timers.clear();
+    freeTimers.clear();
+    timerOfId.clear();
+    std::fill(slotHeads.begin(), slotHeads.end(), -1);
+}
+
+} // namespace sdn_dashboard
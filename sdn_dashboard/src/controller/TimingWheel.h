@@ -0,0 +1,69 @@
+#ifndef __SDN_DASHBOARD_TIMINGWHEEL_H
+#define __SDN_DASHBOARD_TIMINGWHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace sdn_dashboard {
+
+/**
+ * Hierarchical timing wheel: timers identified by an integer ID, each
+ * expiring at an integer tick. Scheduling and cancelling are O(1), and so is
+ * advancing by one tick apart from the timers that expire or move.
+ *
+ * Level 0 has a slot for each of the next SLOTS ticks; a slot of level l
+ * covers SLOTS^l ticks. A timer goes to the lowest level whose range reaches
+ * its expiry, and is moved one level down ("cascaded") when the clock enters
+ * the range of its slot, so that every timer is handled at most LEVELS times.
+ * Timers beyond the range of the top level wait in its farthest slot and are
+ * placed again from there.
+ */
+class TimingWheel
+{
+  public:
+    enum { SLOT_BITS = 6, SLOTS = 1 << SLOT_BITS, LEVELS = 4 };
+
+  private:
+    struct Timer {
+        int id;
+        uint64_t expiry;
+        int slot = -1;   // level * SLOTS + index, -1 if free
+        int prev = -1;
+        int next = -1;
+    };
+
+    std::vector<Timer> timers;           // pool, linked into the slots' lists
+    std::vector<int> freeTimers;
+    std::unordered_map<int, int> timerOfId;
+    std::vector<int> slotHeads;          // first timer of each slot, or -1
+    uint64_t currentTick = 0;
+
+  protected:
+    void place(int t, uint64_t earliestTick);
+    void unlink(int t);
+    void cascade(int slot);
+
+  public:
+    TimingWheel() : slotHeads(LEVELS * SLOTS, -1) {}
+
+    // Starts (or restarts) the timer of id to expire at the given tick; a
+    // tick not after the current one expires at the next advance
+    void schedule(int id, uint64_t expiryTick);
+    bool cancel(int id);
+    bool isScheduled(int id) const { return timerOfId.count(id) > 0; }
+
+    // Moves the clock to toTick and appends the IDs of the timers expired
+    // up to and including it to expired, in order of expiry tick
+    void advance(uint64_t toTick, std::vector<int> &expired);
+
+    uint64_t getCurrentTick() const { return currentTick; }
+    size_t size() const { return timerOfId.size(); }
+    bool empty() const { return timerOfId.empty(); }
+    void clear();
+};
+
+} // namespace sdn_dashboard
+
+#endif
@@ -0,0 +1,157 @@
+#include "SliceRelayUnit.h"
+#include <algorithm>
+#include <inet/common/ModuleAccess.h>
+#include <inet/common/Protocol.h>
+#include <inet/common/ProtocolTag_m.h>
+#include <inet/common/Simsignals.h>
+#include <inet/linklayer/common/VlanTag_m.h>
+#include <inet/networklayer/arp/ipv4/ArpPacket_m.h>
+#include <inet/networklayer/common/InterfaceTag_m.h>
+#include <inet/networklayer/ipv4/Ipv4Header_m.h>
+#include "controller/SDNController.h"
+
+namespace sdn_dashboard {
+
+Define_Module(SliceRelayUnit);
+
+void SliceRelayUnit::initialize(int stage)
+{
+    MacRelayUnit::initialize(stage);
+
+    if (stage == INITSTAGE_LOCAL) {
+        controller = getModuleFromPar<SDNControllerApp>(par("controllerModule"), this);
+        switchNode = getContainingNode(this);
+        tagFrames = par("tagFrames");
+    }
+}
+
+void SliceRelayUnit::handleLowerPacket(Packet *packet)
+{
+    updateFloodDomains();
+    int vlanId = classifyFrame(packet);
+    const std::vector<int>& interfaces = getFloodInterfaces(vlanId);
+    int incomingInterfaceId = packet->getTag<InterfaceInd>()->getInterfaceId();
+    if (std::find(interfaces.begin(), interfaces.end(), incomingInterfaceId) == interfaces.end()) {
+        EV_WARN << "Frame of VLAN " << vlanId << " arrived on interface " << incomingInterfaceId
+                << " outside its flood domain, dropping " << packet->getName() << endl;
+        PacketDropDetails details;
+        details.setReason(FORWARDING_DISABLED);
+        emit(packetDroppedSignal, packet, &details);
+        numFilteredFrames++;
+        delete packet;
+        return;
+    }
+
+    // the base class learns and looks up addresses per VlanInd
+    packet->addTagIfAbsent<VlanInd>()->setVlanId(vlanId);
+    currentFloodInterfaces = &interfaces;
+    MacRelayUnit::handleLowerPacket(packet);
+    currentFloodInterfaces = nullptr;
+}
+
+void SliceRelayUnit::broadcastPacket(Packet *packet, const MacAddress& destinationAddress, NetworkInterface *incomingInterface)
+{
+    for (int interfaceId : *currentFloodInterfaces) {
+        NetworkInterface *outgoingInterface = interfaceTable->getInterfaceById(interfaceId);
+        if (outgoingInterface != incomingInterface && isForwardingInterface(outgoingInterface))
+            sendPacket(packet->dup(), destinationAddress, outgoingInterface);
+    }
+    delete packet;
+}
+
+void SliceRelayUnit::sendPacket(Packet *packet, const MacAddress& destinationAddress, NetworkInterface *outgoingInterface)
+{
+    auto vlanReq = packet->findTag<VlanReq>();
+    if (vlanReq != nullptr && (!tagFrames || vlanReq->getVlanId() == 0))
+        packet->removeTag<VlanReq>();
+    MacRelayUnit::sendPacket(packet, destinationAddress, outgoingInterface);
+}
+
+int SliceRelayUnit::classifyFrame(Packet *packet) const
+{
+    if (auto vlanInd = packet->findTag<VlanInd>())
+        if (controller->isSliceVlan(vlanInd->getVlanId()))
+            return vlanInd->getVlanId();
+
+    uint32_t addresses[2];
+    const Protocol *protocol = packet->getTag<PacketProtocolTag>()->getProtocol();
+    if (protocol == &Protocol::ipv4) {
+        const auto& ipv4Header = packet->peekAtFront<Ipv4Header>();
+        addresses[0] = ipv4Header->getSrcAddress().getInt();
+        addresses[1] = ipv4Header->getDestAddress().getInt();
+    }
+    else if (protocol == &Protocol::arp) {
+        const auto& arpPacket = packet->peekAtFront<ArpPacket>();
+        addresses[0] = arpPacket->getSrcIpAddress().getInt();
+        addresses[1] = arpPacket->getDestIpAddress().getInt();
+    }
+    else
+        return 0;
+    for (uint32_t address : addresses) {
+        auto it = vlanOfHost.find(address);
+        if (it != vlanOfHost.end())
+            return it->second;
+    }
+    return 0;
+}
+
+void SliceRelayUnit::updateFloodDomains()
+{
+    uint64_t version = controller->getFloodDomainVersion();
+    if (version == floodDomainVersion)
+        return;
+    floodDomainVersion = version;
+
+    if (interfaceOfPort.empty()) {
+        // the controller numbers the ports by ethg index
+        for (int i = 0; i < interfaceTable->getNumInterfaces(); i++) {
+            NetworkInterface *networkInterface = interfaceTable->getInterface(i);
+            if (networkInterface->getNodeOutputGateId() != -1)
+                interfaceOfPort[switchNode->gate(networkInterface->getNodeOutputGateId())->getIndex()] = networkInterface->getInterfaceId();
+        }
+    }
+
+    floodInterfaces.clear();
+    vlanOfHost.clear();
+    std::unordered_map<uint32_t, int> sliceOfHost;
+    for (int i = 0; i < controller->getNumShards(); i++) {
+        for (const auto& entry : controller->getShard(i)->getSlices()) {
+            // a host in several slices is classified by the one with the lowest ID
+            uint32_t address;
+            for (const auto& hostIP : entry.second.hostIPs) {
+                if (!FlowClassifier::parseIpv4(hostIP, address))
+                    continue;
+                auto it = sliceOfHost.emplace(address, entry.first).first;
+                if (it->second >= entry.first) {
+                    it->second = entry.first;
+                    vlanOfHost[address] = entry.second.vlanId;
+                }
+            }
+        }
+    }
+    macForwardingTable->clearTable();
+    EV_INFO << "Flood domains changed, " << vlanOfHost.size() << " hosts in slices" << endl;
+}
+
+const std::vector<int>& SliceRelayUnit::getFloodInterfaces(int vlanId)
+{
+    auto it = floodInterfaces.find(vlanId);
+    if (it != floodInterfaces.end())
+        return it->second;
+
+    std::vector<int>& interfaces = floodInterfaces[vlanId];
+    for (int port : controller->getFloodPorts(switchNode, vlanId)) {
+        auto portIt = interfaceOfPort.find(port);
+        if (portIt != interfaceOfPort.end())
+            interfaces.push_back(portIt->second);
+    }
+    return interfaces;
+}
+
+void SliceRelayUnit::finish()
+{
+    MacRelayUnit::finish();
+    recordScalar("framesOutsideFloodDomain", numFilteredFrames);
+}
+
+} // namespace sdn_dashboard
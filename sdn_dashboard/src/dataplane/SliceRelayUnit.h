@@ -0,0 +1,73 @@
+#ifndef __SDN_DASHBOARD_SLICERELAYUNIT_H
+#define __SDN_DASHBOARD_SLICERELAYUNIT_H
+
+#include <omnetpp.h>
+#include <inet/common/INETDefs.h>
+#include <inet/linklayer/ethernet/common/MacRelayUnit.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using namespace omnetpp;
+using namespace inet;
+
+namespace sdn_dashboard {
+
+class SDNControllerApp;
+
+/**
+ * MAC relay of an SDN switch with a forwarding table and a flood domain per
+ * network slice, programmed from the controller's slice table.
+ *
+ * Every frame is assigned to a VLAN: the one it was received with if that
+ * is a slice VLAN, otherwise the VLAN ID of the slice of its source IPv4
+ * address (IPv4 or ARP), otherwise that of its destination address, and
+ * VLAN 0 if neither is in a slice. Addresses are learned and looked up per
+ * VLAN, so the slices have separate forwarding tables.
+ *
+ * Broadcasts and frames to unknown destinations are flooded only to the
+ * ports of the VLAN's flood domain (see SDNControllerApp::getFloodPorts()):
+ * a tree over the fabric that reaches each host of the VLAN's slices, and
+ * each host in no slice, exactly once. Flooding thus costs in proportion to
+ * the size of the slice instead of the network, and stays loop-free in
+ * meshed topologies without a spanning tree protocol. Frames arriving on a
+ * port outside the domain of their VLAN are dropped.
+ *
+ * The flood ports and the host to VLAN map are cached until the
+ * controller's flood domain version changes, which also flushes the
+ * learned addresses, as paths along the new trees may differ.
+ */
+class SliceRelayUnit : public MacRelayUnit
+{
+  protected:
+    // config
+    SDNControllerApp *controller = nullptr;
+    cModule *switchNode = nullptr;
+    bool tagFrames = false;
+
+    // cached from the controller, valid for floodDomainVersion
+    uint64_t floodDomainVersion = UINT64_MAX;
+    std::unordered_map<uint32_t, int> vlanOfHost;  // IPv4 address -> VLAN ID of its (first) slice
+    std::unordered_map<int, std::vector<int>> floodInterfaces;  // vlanId -> interface IDs of its flood domain
+    std::unordered_map<int, int> interfaceOfPort;  // ethg index -> interface ID
+
+    // state
+    const std::vector<int> *currentFloodInterfaces = nullptr;  // of the frame being relayed
+    long numFilteredFrames = 0;
+
+  protected:
+    virtual void initialize(int stage) override;
+    virtual void finish() override;
+
+    virtual void handleLowerPacket(Packet *packet) override;
+    virtual void broadcastPacket(Packet *packet, const MacAddress& destinationAddress, NetworkInterface *incomingInterface) override;
+    virtual void sendPacket(Packet *packet, const MacAddress& destinationAddress, NetworkInterface *outgoingInterface) override;
+
+    virtual int classifyFrame(Packet *packet) const;
+    virtual void updateFloodDomains();
+    const std::vector<int>& getFloodInterfaces(int vlanId);
+};
+
+} // namespace sdn_dashboard
+
+#endif
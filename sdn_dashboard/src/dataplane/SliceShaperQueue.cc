@@ -0,0 +1,361 @@
+#include "SliceShaperQueue.h"
+#include <algorithm>
+#include <string>
+#include <inet/common/ModuleAccess.h>
+#include <inet/common/Protocol.h>
+#include <inet/common/ProtocolTag_m.h>
+#include <inet/linklayer/common/EtherType_m.h>
+#include <inet/linklayer/ethernet/common/EthernetMacHeader_m.h>
+#include <inet/linklayer/ieee8021q/Ieee8021qTagHeader_m.h>
+#include <inet/networklayer/ipv4/Ipv4Header_m.h>
+#include <inet/transportlayer/tcp_common/TcpHeader_m.h>
+#include <inet/transportlayer/udp/UdpHeader_m.h>
+#include "controller/SDNController.h"
+
+namespace sdn_dashboard {
+
+Define_Module(SliceShaperQueue);
+
+SliceShaperQueue::~SliceShaperQueue()
+{
+    cancelAndDelete(wakeupTimer);
+}
+
+void SliceShaperQueue::initialize(int stage)
+{
+    queueing::PacketQueue::initialize(stage);
+
+    if (stage == INITSTAGE_LOCAL) {
+        slicePacketCapacity = par("slicePacketCapacity");
+        burstSize = par("burstSize").doubleValue();
+        wakeupTimer = new cMessage("wakeup");
+
+        controller = getModuleFromPar<SDNControllerApp>(par("controllerModule"), this);
+        counterSlotCache.setCapacity(par("counterCacheSize").intValue());
+    }
+    else if (stage == INITSTAGE_LINK_LAYER) {
+        // The controller shards are known from their local stage on, and
+        // create their slices in a later stage; those arrive through
+        // sliceChanged like any later change
+        for (int i = 0; i < controller->getNumShards(); i++)
+            controller->getShard(i)->subscribe("sliceChanged", this);
+        // each shard collects the counts of its own rules
+        if (par("countFlows")) {
+            cModule *switchNode = getContainingNode(this);
+            counterSwitchId = switchNode->getId();
+            bool counting = false;
+            for (int i = 0; i < controller->getNumShards(); i++) {
+                flowCounters.push_back(controller->getShard(i)->createFlowCounterTable(switchNode));
+                counting = counting || flowCounters.back() != nullptr;
+            }
+            if (!counting)
+                flowCounters.clear();
+        }
+    }
+}
+
+void SliceShaperQueue::handleMessage(cMessage *message)
+{
+    if (message == wakeupTimer) {
+        if (collector != nullptr && canPullSomePacket(outputGate->getPathEndGate()))
+            collector->handleCanPullPacketChanged(outputGate->getPathEndGate());
+        scheduleWakeup();
+    }
+    else
+        queueing::PacketQueue::handleMessage(message);
+}
+
+void SliceShaperQueue::receiveSignal(cComponent *source, simsignal_t signal, intval_t value, cObject *details)
+{
+    Enter_Method("%s", cComponent::getSignalName(signal));
+
+    updateSlice((int)value);
+    // both below scan all slices; with nothing queued (as while the
+    // controller loads its configuration) there is nothing to let go
+    if (queue.isEmpty())
+        return;
+    scheduleWakeup();
+    // a higher rate may let waiting packets go right away
+    if (collector != nullptr && canPullSomePacket(outputGate->getPathEndGate()))
+        collector->handleCanPullPacketChanged(outputGate->getPathEndGate());
+}
+
+Ptr<const Ipv4Header> SliceShaperQueue::peekIpv4Header(const Packet *packet, b& offset) const
+{
+    const auto& protocolTag = packet->findTag<PacketProtocolTag>();
+    if (protocolTag == nullptr)
+        return nullptr;
+
+    offset = b(0);
+    if (protocolTag->getProtocol() == &Protocol::ethernetMac) {
+        const auto& macHeader = packet->peekAtFront<EthernetMacHeader>();
+        int typeOrLength = macHeader->getTypeOrLength();
+        offset = macHeader->getChunkLength();
+        // frames of SliceRelayUnit with tagFrames carry 802.1Q (or stacked
+        // 802.1ad) tags, which hold the EtherType of the payload
+        while (typeOrLength == ETHERTYPE_8021Q_TAG || typeOrLength == ETHERTYPE_8021ad_TAG) {
+            const auto& vlanTag = packet->peekDataAt<Ieee8021qTagEpdHeader>(offset);
+            typeOrLength = vlanTag->getTypeOrLength();
+            offset += vlanTag->getChunkLength();
+        }
+        if (typeOrLength != ETHERTYPE_IPv4)
+            return nullptr;
+    }
+    else if (protocolTag->getProtocol() != &Protocol::ipv4)
+        return nullptr;
+
+    return packet->peekDataAt<Ipv4Header>(offset);
+}
+
+int SliceShaperQueue::classifyPacket(const Ipv4Header *ipv4Header) const
+{
+    if (ipv4Header == nullptr)
+        return -1;
+    auto it = hostSlices.find(ipv4Header->getSrcAddress().getInt());
+    return it != hostSlices.end() ? it->second : -1;
+}
+
+void SliceShaperQueue::countPacket(const Packet *packet, const Ipv4Header& ipv4Header, b offset)
+{
+    PacketKey key;
+    key.srcIp = ipv4Header.getSrcAddress().getInt();
+    key.dstIp = ipv4Header.getDestAddress().getInt();
+    key.protocol = ipv4Header.getProtocolId();
+    if (ipv4Header.getFragmentOffset() == 0) {
+        b transportOffset = offset + ipv4Header.getChunkLength();
+        if (key.protocol == IP_PROT_UDP) {
+            const auto& udpHeader = packet->peekDataAt<UdpHeader>(transportOffset);
+            key.srcPort = udpHeader->getSrcPort();
+            key.dstPort = udpHeader->getDestPort();
+        }
+        else if (key.protocol == IP_PROT_TCP) {
+            const auto& tcpHeader = packet->peekDataAt<tcp::TcpHeader>(transportOffset);
+            key.srcPort = tcpHeader->getSrcPort();
+            key.dstPort = tcpHeader->getDestPort();
+        }
+    }
+
+    uint64_t version = controller->getFlowCounterVersion();
+    if (version != counterSlotCacheVersion) {
+        counterSlotCache.invalidate();
+        counterSlotCacheVersion = version;
+    }
+    // cached as slot * numShards + ownerShard
+    int numShards = flowCounters.size();
+    int entry;
+    if (!counterSlotCache.lookup(key, entry)) {
+        int ownerShard = 0;
+        int slot = controller->getCounterSlot(key, counterSwitchId, ownerShard);
+        entry = slot == -1 ? -1 : slot * numShards + ownerShard;
+        counterSlotCache.insert(key, entry);
+    }
+    if (entry != -1) {
+        FlowCounterTable *table = flowCounters[entry % numShards];
+        if (table != nullptr)
+            table->count(entry / numShards, packet->getTreeId(), ipv4Header.getTotalLengthField().get());
+    }
+}
+
+SliceShaperQueue::SliceState& SliceShaperQueue::getSliceState(int sliceId)
+{
+    auto it = sliceStates.find(sliceId);
+    if (it != sliceStates.end())
+        return it->second;
+
+    SliceState& state = sliceStates[sliceId];
+    if (sliceId != -1) {
+        // per-slice statistics, e.g. slice2Throughput and slice2Drops
+        std::string prefix = "slice" + std::to_string(sliceId);
+        state.sentSignal = registerSignal((prefix + "Sent").c_str());
+        state.droppedSignal = registerSignal((prefix + "Dropped").c_str());
+        getEnvir()->addResultRecorders(this, state.sentSignal, (prefix + "Throughput").c_str(), getProperties()->get("statisticTemplate", "sliceThroughput"));
+        getEnvir()->addResultRecorders(this, state.droppedSignal, (prefix + "Drops").c_str(), getProperties()->get("statisticTemplate", "sliceDrops"));
+    }
+    return state;
+}
+
+void SliceShaperQueue::updateSlice(int sliceId)
+{
+    SliceState& state = getSliceState(sliceId);
+    for (uint32_t addr : state.hosts)
+        hostSlices.erase(addr);
+    state.hosts.clear();
+    state.tokens = getTokens(state);
+    state.lastUpdate = simTime();
+
+    const NetworkSlice *found = controller->findSlice(sliceId);
+    if (found == nullptr) {
+        // deleted: let its queued packets drain unshaped
+        state.shaped = false;
+        return;
+    }
+
+    const NetworkSlice& slice = *found;
+    for (const auto& hostIP : slice.hostIPs) {
+        // a host in several slices is shaped with the one that claimed it first
+        uint32_t addr;
+        if (FlowClassifier::parseIpv4(hostIP, addr) && hostSlices.emplace(addr, sliceId).second)
+            state.hosts.push_back(addr);
+    }
+
+    bool wasShaped = state.shaped;
+    state.shaped = slice.bandwidthMbps > 0;
+    state.rate = slice.bandwidthMbps * 1e6;
+    state.depth = burstSize;
+    state.tokens = wasShaped ? std::min(state.tokens, state.depth) : state.depth;
+    EV_INFO << "Slice " << sliceId << " shaped at " << slice.bandwidthMbps << " Mbps" << endl;
+}
+
+double SliceShaperQueue::getTokens(const SliceState& state) const
+{
+    if (!state.shaped)
+        return state.tokens;
+    return std::min(state.depth, state.tokens + state.rate * (simTime() - state.lastUpdate).dbl());
+}
+
+simtime_t SliceShaperQueue::getConformTime(const SliceState& state) const
+{
+    if (!state.shaped)
+        return simTime();
+    // a packet larger than the bucket may go once the bucket is full
+    double needed = std::min((double)state.packets.front().packet->getTotalLength().get(), state.depth);
+    double missing = needed - getTokens(state);
+    if (missing <= 0)
+        return simTime();
+    // round up, so that the bucket is surely filled by then
+    return simTime() + SimTime(missing / state.rate) + SimTime::fromRaw(1);
+}
+
+bool SliceShaperQueue::findSendingSlice(int& sliceId) const
+{
+    const QueuedPacket *first = nullptr;
+    for (const auto& entry : sliceStates) {
+        const SliceState& state = entry.second;
+        if (state.packets.empty() || getConformTime(state) > simTime())
+            continue;
+        if (first == nullptr || state.packets.front().seq < first->seq) {
+            first = &state.packets.front();
+            sliceId = entry.first;
+        }
+    }
+    return first != nullptr;
+}
+
+void SliceShaperQueue::scheduleWakeup()
+{
+    // The collector asks again only when notified, so if packets are queued
+    // but none of them may leave now, notify it when the first one may
+    simtime_t wakeupTime = SimTime::getMaxTime();
+    for (const auto& entry : sliceStates) {
+        const SliceState& state = entry.second;
+        if (state.packets.empty())
+            continue;
+        simtime_t conformTime = getConformTime(state);
+        if (conformTime <= simTime()) {
+            wakeupTime = SimTime::getMaxTime();
+            break;
+        }
+        wakeupTime = std::min(wakeupTime, conformTime);
+    }
+
+    if (wakeupTime == SimTime::getMaxTime())
+        cancelEvent(wakeupTimer);
+    else if (!wakeupTimer->isScheduled() || wakeupTimer->getArrivalTime() != wakeupTime)
+        rescheduleAt(wakeupTime, wakeupTimer);
+}
+
+void SliceShaperQueue::pushPacket(Packet *packet, cGate *gate)
+{
+    Enter_Method("pushPacket");
+    take(packet);
+
+    b ipv4Offset;
+    const auto& ipv4Header = peekIpv4Header(packet, ipv4Offset);
+    if (ipv4Header != nullptr && !flowCounters.empty())
+        countPacket(packet, *ipv4Header, ipv4Offset);
+
+    int sliceId = classifyPacket(ipv4Header.get());
+    SliceState& state = getSliceState(sliceId);
+    if (slicePacketCapacity != -1 && (int)state.packets.size() >= slicePacketCapacity) {
+        EV_INFO << "Buffer of slice " << sliceId << " is full, dropping packet " << packet->getName() << endl;
+        if (state.droppedSignal != SIMSIGNAL_NULL)
+            emit(state.droppedSignal, packet);
+        dropPacket(packet, QUEUE_OVERFLOW);
+        return;
+    }
+
+    state.packets.push_back(QueuedPacket{nextSeq++, packet});
+    queueing::PacketQueue::pushPacket(packet, gate);
+    scheduleWakeup();
+}
+
+bool SliceShaperQueue::canPullSomePacket(cGate *gate) const
+{
+    int sliceId;
+    return findSendingSlice(sliceId);
+}
+
+Packet *SliceShaperQueue::canPullPacket(cGate *gate) const
+{
+    int sliceId;
+    return findSendingSlice(sliceId) ? sliceStates.at(sliceId).packets.front().packet : nullptr;
+}
+
+Packet *SliceShaperQueue::pullPacket(cGate *gate)
+{
+    Enter_Method("pullPacket");
+
+    int sliceId;
+    if (!findSendingSlice(sliceId))
+        throw cRuntimeError("Cannot pull packet: all queued slices are over their rate");
+
+    SliceState& state = sliceStates[sliceId];
+    Packet *packet = state.packets.front().packet;
+    state.packets.pop_front();
+    if (state.shaped) {
+        state.tokens = getTokens(state) - packet->getTotalLength().get();
+        state.lastUpdate = simTime();
+    }
+
+    // let the base class take it as the head of the queue, so queueing
+    // time, signals and animation are handled as for any pulled packet
+    if (packet != queue.front()) {
+        queue.remove(packet);
+        queue.insertBefore(queue.front(), packet);
+    }
+    queueing::PacketQueue::pullPacket(gate);
+
+    if (state.sentSignal != SIMSIGNAL_NULL)
+        emit(state.sentSignal, packet);
+    scheduleWakeup();
+    return packet;
+}
+
+void SliceShaperQueue::removePacket(Packet *packet)
+{
+    Enter_Method("removePacket");
+
+    // the slice table may have changed since the packet was queued
+    for (auto& entry : sliceStates) {
+        auto& packets = entry.second.packets;
+        auto it = std::find_if(packets.begin(), packets.end(), [&](const QueuedPacket& p) { return p.packet == packet; });
+        if (it != packets.end()) {
+            packets.erase(it);
+            break;
+        }
+    }
+    queueing::PacketQueue::removePacket(packet);
+    scheduleWakeup();
+}
+
+void SliceShaperQueue::removeAllPackets()
+{
+    Enter_Method("removeAllPackets");
+
+    for (auto& entry : sliceStates)
+        entry.second.packets.clear();
+    queueing::PacketQueue::removeAllPackets();
+    cancelEvent(wakeupTimer);
+}
+
+} // namespace sdn_dashboard
@@ -0,0 +1,116 @@
+#ifndef __SDN_DASHBOARD_SLICESHAPERQUEUE_H
+#define __SDN_DASHBOARD_SLICESHAPERQUEUE_H
+
+#include <omnetpp.h>
+#include <inet/common/INETDefs.h>
+#include <inet/queueing/queue/PacketQueue.h>
+#include <inet/networklayer/ipv4/Ipv4Header_m.h>
+#include "controller/FlowCounters.h"
+#include "controller/MicroflowCache.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+using namespace omnetpp;
+using namespace inet;
+
+namespace sdn_dashboard {
+
+class SDNControllerApp;
+
+/**
+ * Egress queue of an SDN switch port that limits each network slice to the
+ * bandwidth configured for it on the controller.
+ *
+ * Packets are assigned to slices by their IPv4 source address, using the
+ * host lists of the controller's slice table; Ethernet frames may be
+ * 802.1Q-tagged, as SliceRelayUnit sends them with tagFrames. Each slice has a token bucket
+ * filled at its bandwidthMbps with a depth of burstSize; a packet may leave
+ * the queue only when its slice has enough tokens. Among the slices that
+ * may send, the packet that arrived first is sent, so slices within their
+ * budget see plain FIFO service. Packets of no slice are not shaped.
+ *
+ * Each slice also has its own buffer of slicePacketCapacity packets, so a
+ * tenant exceeding its rate only fills its own buffer and loses its own
+ * packets. The slice table is followed live: the controller's sliceChanged
+ * signal updates the rate of the affected slice, keeping its tokens.
+ *
+ * The queue also counts the packets and bytes of each flow rule of the
+ * controller in a FlowCounterTable of each controller shard; every shard
+ * periodically collects the counts of the rules it owns (see
+ * SDNControllerApp::createFlowCounterTable()). Packets are counted on
+ * arrival, before any drop, and only at the switch their source host is
+ * attached to; the queues of a switch share their tables, so a packet
+ * flooded to several ports is counted once. The counter slot of a packet's
+ * 5-tuple is cached until the controller's flow table or topology changes.
+ */
+class SliceShaperQueue : public queueing::PacketQueue
+{
+  protected:
+    struct QueuedPacket {
+        uint64_t seq;     // insertion order, to keep FIFO order across slices
+        Packet *packet;
+    };
+
+    struct SliceState {
+        bool shaped = false;
+        double rate = 0;          // bits per second
+        double depth = 0;         // bits
+        double tokens = 0;        // bits, as of lastUpdate
+        simtime_t lastUpdate;
+        std::deque<QueuedPacket> packets;
+        std::vector<uint32_t> hosts;  // the addresses it holds in hostSlices
+        simsignal_t sentSignal = SIMSIGNAL_NULL;
+        simsignal_t droppedSignal = SIMSIGNAL_NULL;
+    };
+
+    // config
+    SDNControllerApp *controller = nullptr;
+    int slicePacketCapacity = -1;
+    double burstSize = 0;  // bits
+
+    // state
+    std::map<int, SliceState> sliceStates;        // sliceId -> state; -1 = packets of no slice
+    std::unordered_map<uint32_t, int> hostSlices;  // IPv4 source address -> sliceId
+    uint64_t nextSeq = 0;
+    cMessage *wakeupTimer = nullptr;
+
+    // flow counting
+    std::vector<FlowCounterTable *> flowCounters;  // by shard index, of the switch, owned by the shards; empty if not counting
+    int counterSwitchId = -1;                      // module ID of the switch node
+    MicroflowCache counterSlotCache;               // 5-tuple -> counter slot and shard, or -1 if not counted here
+    uint64_t counterSlotCacheVersion = 0;
+
+  protected:
+    virtual void initialize(int stage) override;
+    virtual void handleMessage(cMessage *message) override;
+
+    virtual Ptr<const Ipv4Header> peekIpv4Header(const Packet *packet, b& offset) const;
+    virtual int classifyPacket(const Ipv4Header *ipv4Header) const;
+    virtual void countPacket(const Packet *packet, const Ipv4Header& ipv4Header, b offset);
+    virtual SliceState& getSliceState(int sliceId);
+    virtual void updateSlice(int sliceId);
+    double getTokens(const SliceState& state) const;
+    simtime_t getConformTime(const SliceState& state) const;
+    bool findSendingSlice(int& sliceId) const;
+    void scheduleWakeup();
+
+  public:
+    virtual ~SliceShaperQueue();
+
+    virtual void pushPacket(Packet *packet, cGate *gate) override;
+    virtual bool canPullSomePacket(cGate *gate) const override;
+    virtual Packet *canPullPacket(cGate *gate) const override;
+    virtual Packet *pullPacket(cGate *gate) override;
+    virtual void removePacket(Packet *packet) override;
+    virtual void removeAllPackets() override;
+
+    using queueing::PacketQueue::receiveSignal;
+    virtual void receiveSignal(cComponent *source, simsignal_t signal, intval_t value, cObject *details) override;
+};
+
+} // namespace sdn_dashboard
+
+#endif
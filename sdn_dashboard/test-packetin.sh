@@ -0,0 +1,44 @@
+#!/bin/bash
+
+# PACKET_IN handling of the controller (simulations/packetin.ini). A
+# datagram that is not a PACKET_IN and a truncated PACKET_IN must be dropped
+# without stopping the simulation, and every PACKET_IN after them must be
+# answered with a FLOW_MOD, with (General) or without (PacketInNoPayload) a
+# UDP payload after the headers of the packet it carries.
+#
+# Needs the built controller library (src/) and INET in $INET_ROOT.
+
+cd "$(dirname "$0")/simulations"
+
+INET_ROOT=${INET_ROOT:-../../../inet}
+
+run_config() {
+    opp_run -l ../src/sdn_controller -l "$INET_ROOT/src/INET" -n .:../src:"$INET_ROOT/src" \
+        -u Cmdenv -f packetin.ini -c "$1" --output-scalar-file="results/PacketIn-$1.sca" \
+        > "results/PacketIn-$1.log" 2>&1 || {
+        echo "FAIL: $1 did not run, see simulations/results/PacketIn-$1.log"
+        exit 1
+    }
+}
+
+scalar() {
+    grep "host\[0\]\.app\[0\] $2 " "results/PacketIn-$1.sca" | awk '{ print $4 }'
+}
+
+check_config() {
+    run_config "$1"
+    sent=$(scalar "$1" packetInsSent)
+    answered=$(scalar "$1" flowModsReceived)
+    echo "$1: PACKET_INs sent: $sent, FLOW_MODs received: $answered"
+    if [ -z "$sent" ] || [ "$sent" -eq 0 ] || [ "$answered" != "$sent" ]; then
+        echo "FAIL: not every PACKET_IN of $1 was answered with a FLOW_MOD"
+        exit 1
+    fi
+}
+
+mkdir -p results
+rm -f results/PacketIn-*
+
+check_config General
+check_config PacketInNoPayload
+echo "PASS"
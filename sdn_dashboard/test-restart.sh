@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# Crash/restart scenario of the controller (simulations/restart.ini). The
+# state exported after the restart from the checkpoint must carry a seq newer
+# than the last one exported before the crash.
+#
+# Needs the built controller library (src/) and INET in $INET_ROOT.
+
+cd "$(dirname "$0")/simulations"
+
+INET_ROOT=${INET_ROOT:-../../../inet}
+
+run_config() {
+    opp_run -l ../src/sdn_controller -l "$INET_ROOT/src/INET" -n .:../src:"$INET_ROOT/src" \
+        -u Cmdenv -f restart.ini -c "$1" > "results/$1.log" 2>&1 || {
+        echo "FAIL: $1 did not run, see simulations/results/$1.log"
+        exit 1
+    }
+}
+
+state_seq() {
+    grep -o '"seq": [0-9]*' "results/$1-state.json" | grep -o '[0-9]*$'
+}
+
+mkdir -p results
+rm -f results/BeforeCrash-* results/CrashRestart-*
+
+run_config BeforeCrash
+run_config CrashRestart
+
+before=$(state_seq BeforeCrash)
+after=$(state_seq CrashRestart)
+echo "Exported seq before the crash: $before, after the restart: $after"
+
+if [ -z "$before" ] || [ -z "$after" ] || [ "$after" -le "$before" ]; then
+    echo "FAIL: the restarted controller did not export its state under a newer seq"
+    exit 1
+fi
+echo "PASS"
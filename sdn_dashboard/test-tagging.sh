@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# Slice shaping of 802.1Q-tagged frames (SliceTagged in
+# simulations/slicing.ini). Tenant A offers far more than its slice, so the
+# bytes its sink on the server receives show whether the shapers held it at
+# its rate; with tagged frames that must be the same as with untagged ones
+# (SliceFloodDomains), not the excess an unshaped tenant gets through.
+#
+# Needs the built controller library (src/) and INET in $INET_ROOT.
+
+cd "$(dirname "$0")/simulations"
+
+INET_ROOT=${INET_ROOT:-../../../inet}
+
+run_config() {
+    opp_run -l ../src/sdn_controller -l "$INET_ROOT/src/INET" -n .:../src:"$INET_ROOT/src" \
+        -u Cmdenv -f slicing.ini -c "$1" --output-scalar-file="results/Tagging-$1.sca" \
+        > "results/Tagging-$1.log" 2>&1 || {
+        echo "FAIL: $1 did not run, see simulations/results/Tagging-$1.log"
+        exit 1
+    }
+}
+
+tenant_a_bytes() {
+    grep "server\.app\[0\] packetReceived:sum(packetBytes) " "results/Tagging-$1.sca" | awk '{ print $4 }'
+}
+
+mkdir -p results
+rm -f results/Tagging-*
+
+run_config SliceFloodDomains
+run_config SliceTagged
+untagged=$(tenant_a_bytes SliceFloodDomains)
+tagged=$(tenant_a_bytes SliceTagged)
+echo "Tenant A bytes received: untagged $untagged, tagged $tagged"
+if [ -z "$untagged" ] || [ -z "$tagged" ] || [ "$tagged" -eq 0 ]; then
+    echo "FAIL: Tenant A received nothing"
+    exit 1
+fi
+# the tags add 4 bytes per frame, allow 10%
+if [ $((tagged * 10)) -gt $((untagged * 11)) ] || [ $((tagged * 11)) -lt $((untagged * 10)) ]; then
+    echo "FAIL: tagged frames of Tenant A were not shaped to its slice"
+    exit 1
+fi
+echo "PASS"
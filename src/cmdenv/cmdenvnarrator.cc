@@ -14,10 +14,13 @@
   `license' for details on this and other legal matters.
 *--------------------------------------------------------------*/
 
+#include "common/stringutil.h"
 #include "cmdenvnarrator.h"
 #include "omnetpp/checkandcast.h"
 #include "omnetpp/ccomponenttype.h"
 
+using namespace omnetpp::common;
+
 namespace omnetpp {
 namespace cmdenv {
 
@@ -56,6 +59,16 @@ void CmdenvNarrator::summary(int numRuns, int runsTried, int numErrors)
     }
 }
 
+void CmdenvNarrator::threadUtilization(int threadIndex, int numRuns, double busySecs, double elapsedSecs)
+{
+    if (verbose) {
+        if (threadIndex == 0)
+            out << "\nThread utilization (batch took " << opp_stringf("%.3gs", elapsedSecs) << "):\n";
+        double percent = elapsedSecs > 0 ? 100 * busySecs / elapsedSecs : 0;
+        out << "  thread #" << threadIndex << ": " << numRuns << " runs, busy " << opp_stringf("%.3gs (%.1f%%)", busySecs, percent) << endl;
+    }
+}
+
 inline const char *opp_nulltodefault(const char *s, const char *defaultString)  {return s == nullptr ? defaultString : s;}
 
 void CmdenvNarrator::beforeRedirecting(cConfiguration *cfg)
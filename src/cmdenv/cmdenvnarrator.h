@@ -54,6 +54,7 @@ class ICmdenvNarrator
     virtual void usingThreads(int numThreads) = 0;
     virtual void preparing(const char *configName, int runNumber) = 0;
     virtual void summary(int numRuns, int runsTried, int numErrors) = 0;
+    virtual void threadUtilization(int threadIndex, int numRuns, double busySecs, double elapsedSecs) = 0;
     virtual void beforeRedirecting(cConfiguration *cfg) = 0;
     virtual void redirectingTo(cConfiguration *cfg, const char *redirectFileName) = 0;
     virtual void onRedirectionFileOpen(std::ostream& fout, cConfiguration *cfg, const char *redirectFileName) = 0; // non-narrating
@@ -71,6 +72,7 @@ class CmdenvNarrator : public ICmdenvNarrator
     virtual void usingThreads(int numThreads) override;
     virtual void preparing(const char *configName, int runNumber) override;
     virtual void summary(int numRuns, int runsTried, int numErrors) override;
+    virtual void threadUtilization(int threadIndex, int numRuns, double busySecs, double elapsedSecs) override;
     virtual void beforeRedirecting(cConfiguration *cfg) override;
     virtual void redirectingTo(cConfiguration *cfg, const char *redirectFileName) override;
     virtual void onRedirectionFileOpen(std::ostream& fout, cConfiguration *cfg, const char *redirectFileName) override;
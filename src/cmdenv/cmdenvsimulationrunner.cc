@@ -15,10 +15,13 @@
 *--------------------------------------------------------------*/
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <fstream>
 #include <sstream>
 #include <thread>
@@ -36,6 +39,7 @@
 #include "omnetpp/cconfigoption.h"
 #include "omnetpp/checkandcast.h"
 #include "omnetpp/ceventlooprunner.h"
+#include "omnetpp/platdep/platmisc.h"
 #include "sim/netbuilder/cnedloader.h"
 #include "cmdenvsimulationrunner.h"
 #include "cmdenvnarrator.h"
@@ -52,12 +56,19 @@ using namespace omnetpp::internal;
 #endif
 
 namespace omnetpp {
+
+namespace envir {
+extern cConfigOption *CFGID_OUTPUT_SCALAR_FILE;
+extern cConfigOption *CFGID_OUTPUT_SCALAR_FILE_APPEND;
+}  // namespace envir
+
 namespace cmdenv {
 
 Register_GlobalConfigOption(CFGID_CMDENV_CONFIG_NAME, "cmdenv-config-name", CFG_STRING, nullptr, "Specifies the name of the configuration to be run (for a value `Foo`, section `[Config Foo]` will be used from the ini file). See also `cmdenv-runs-to-execute`. The `-c` command line option overrides this setting.")
 Register_GlobalConfigOption(CFGID_CMDENV_RUNS_TO_EXECUTE, "cmdenv-runs-to-execute", CFG_STRING, nullptr, "Specifies which runs to execute from the selected configuration (see `cmdenv-config-name` option). It accepts a filter expression of iteration variables such as `$numHosts>10 && $iatime==1s`, or a comma-separated list of run numbers or run number ranges, e.g. `1,3..4,7..9`. If the value is missing, CmdenvCore executes all runs in the selected configuration. The `-r` command line option overrides this setting.")
 Register_GlobalConfigOption(CFGID_CMDENV_STOP_BATCH_ON_ERROR, "cmdenv-stop-batch-on-error", CFG_BOOL, "true", "Decides whether CmdenvCore should skip the rest of the runs when an error occurs during the execution of one run.")
 Register_GlobalConfigOption(CFGID_CMDENV_NUM_THREADS, "cmdenv-num-threads", CFG_INT, "1", "Specifies the number of threads to use when running multiple simulations is requested. (Each simulation will still run sequentially in its thread.) When -1 is given, the number of concurrent threads supported by the hardware will be used.");
+Register_GlobalConfigOption(CFGID_CMDENV_LONGEST_RUNS_FIRST, "cmdenv-longest-runs-first", CFG_BOOL, "false", "When running simulations on multiple threads (see `cmdenv-num-threads`), start the runs that are expected to take the longest first, so that the batch finishes sooner. The duration of a run is estimated from the output scalar file left over from its previous execution (start time recorded in the file vs. the time of its last modification); runs with no such file are started before all others.");
 
 Register_GlobalConfigOption(CFGID_CMDENV_OUTPUT_FILE, "cmdenv-output-file", CFG_FILENAME, "${resultdir}/${configname}-${iterationvarsf}#${repetition}.out", "When `cmdenv-record-output=true`: file name to redirect standard output to. See also `fname-append-host`.")
 Register_GlobalConfigOption(CFGID_CMDENV_REDIRECT_OUTPUT, "cmdenv-redirect-output", CFG_BOOL, "false", "Causes Cmdenv to redirect standard output of simulation runs to a file or separate files per run. This option can be useful with running simulation campaigns (e.g. using opp_runall), and also with parallel simulation. See also: `cmdenv-output-file`, `fname-append-host`.");
@@ -170,26 +181,30 @@ CmdenvSimulationRunner::BatchResult CmdenvSimulationRunner::runSimulationsInThre
 
     cConfiguration *firstCfg = ini->extractConfig(configName, runNumbers[0]);
     ensureNedLoader(firstCfg);
+    bool longestRunsFirst = firstCfg->getAsBool(CFGID_CMDENV_LONGEST_RUNS_FIRST);
     delete firstCfg;
 
-    // statically assign jobs to threads
-    std::vector<std::vector<int>> runListPerThread(numThreads);
-    for (int i = 0; i < runNumbers.size(); i++)
-        runListPerThread[i % numThreads].push_back(runNumbers[i]);
+    // runs are taken from a shared queue by the threads as they become free, so that
+    // a few long runs do not hold up the batch while other threads sit idle
+    std::vector<int> runQueue = longestRunsFirst ? orderRunsLongestFirst(ini, configName, runNumbers) : runNumbers;
+    std::atomic_int nextRunIndex{0};
 
     narrator->usingThreads(numThreads);
 
     BatchState state;
+    state.numRuns = (int)runQueue.size();
+    std::vector<ThreadUtilization> utilizations(numThreads);
+    auto startTime = std::chrono::steady_clock::now();
 
     Py_BEGIN_ALLOW_THREADS
 
     // create and launch threads
     std::vector<std::thread> threads;
     for (int i = 0; i < numThreads; i++) {
-        auto fn = [this](BatchState *state, InifileContents *ini, std::string configName, std::vector<int> runNumbers) {
-            doRunSimulations(*state, ini, configName.c_str(), runNumbers);
+        auto fn = [this,&runQueue,&nextRunIndex](BatchState *state, InifileContents *ini, std::string configName, ThreadUtilization *utilization) {
+            doRunQueuedSimulations(*state, ini, configName.c_str(), runQueue, nextRunIndex, *utilization);
         };
-        threads.push_back(std::thread(fn, &state, ini, configName, runListPerThread[i]));
+        threads.push_back(std::thread(fn, &state, ini, configName, &utilizations[i]));
     }
 
     // wait for them to finish
@@ -198,9 +213,86 @@ CmdenvSimulationRunner::BatchResult CmdenvSimulationRunner::runSimulationsInThre
 
     Py_END_ALLOW_THREADS
 
+    double elapsedSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    for (int i = 0; i < numThreads; i++)
+        narrator->threadUtilization(i, utilizations[i].numRuns, utilizations[i].busySecs, elapsedSecs);
+
     return extractResult(state);
 }
 
+void CmdenvSimulationRunner::doRunQueuedSimulations(BatchState& state, InifileContents *ini, const char *configName, const std::vector<int>& runQueue, std::atomic_int& nextRunIndex, ThreadUtilization& utilization)
+{
+    while (!state.batchStopped && !sigintReceived) {
+        int index = nextRunIndex++;
+        if (index >= (int)runQueue.size())
+            break;
+
+        auto startTime = std::chrono::steady_clock::now();
+        try {
+            state.runsTried++;
+            doRunSimulation(state, ini, configName, runQueue[index]);
+            state.numCompleted++;
+        }
+        catch (std::exception& e) {
+            narrator->displayException(e);  // note: must take care not to print again if it was already printed
+            state.numErrors++;
+            if (state.stopBatchOnError)
+                state.batchStopped = true;
+        }
+        utilization.numRuns++;
+        utilization.busySecs += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+}
+
+std::vector<int> CmdenvSimulationRunner::orderRunsLongestFirst(InifileContents *ini, const char *configName, const std::vector<int>& runNumbers)
+{
+    // runs with unknown duration come first (in their original order), then the rest by decreasing duration
+    std::vector<std::pair<double,int>> durationsAndRuns;
+    for (int runNumber : runNumbers) {
+        double duration = estimateRunDuration(ini, configName, runNumber);
+        durationsAndRuns.push_back(std::make_pair(duration < 0 ? INFINITY : duration, runNumber));
+    }
+    std::stable_sort(durationsAndRuns.begin(), durationsAndRuns.end(), [](const std::pair<double,int>& a, const std::pair<double,int>& b) {return a.first > b.first;});
+
+    std::vector<int> result;
+    for (auto& pair : durationsAndRuns)
+        result.push_back(pair.second);
+    return result;
+}
+
+double CmdenvSimulationRunner::estimateRunDuration(InifileContents *ini, const char *configName, int runNumber)
+{
+    // The scalar file is written at the end of the run, and it records the start
+    // time of the run in the "datetime" run attribute (local time, in 1s resolution).
+    std::unique_ptr<cConfiguration> cfg(ini->extractConfig(configName, runNumber));
+    if (cfg->getAsBool(envir::CFGID_OUTPUT_SCALAR_FILE_APPEND))
+        return -1;  // file may contain several runs
+    std::string fname = ResultFileUtils(cfg.get()).augmentFileName(cfg->getAsFilename(envir::CFGID_OUTPUT_SCALAR_FILE));
+
+    struct opp_stat_t s;
+    if (opp_stat(fname.c_str(), &s) != 0)
+        return -1;
+
+    std::ifstream in(fname);
+    std::string line;
+    for (int i = 0; i < 100 && std::getline(in, line); i++) {
+        if (opp_stringbeginswith(line.c_str(), "attr datetime ")) {
+            struct tm tm = {};
+            const char *value = line.c_str() + strlen("attr datetime ");
+            if (*value == '"')
+                value++;
+            if (sscanf(value, "%4d%2d%2d-%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6)
+                return -1;
+            tm.tm_year -= 1900;
+            tm.tm_mon -= 1;
+            tm.tm_isdst = -1;
+            time_t startTime = mktime(&tm);
+            return std::max(0.0, difftime(s.st_mtime, startTime));
+        }
+    }
+    return -1;
+}
+
 CmdenvSimulationRunner::BatchResult CmdenvSimulationRunner::runSimulations(InifileContents *ini, const char *configName, const std::vector<int>& runNumbers)
 {
     BatchState state;
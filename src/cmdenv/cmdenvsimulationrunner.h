@@ -59,6 +59,13 @@ class CMDENV_API CmdenvSimulationRunner
           std::atomic_int numInterrupted{0};
           std::atomic_int numErrors{0};
           std::atomic_bool stopBatchOnError{0};
+          std::atomic_bool batchStopped{0}; // set on error if stopBatchOnError is set, so that other threads start no more runs
+     };
+
+     // statistics of one worker thread in runSimulationsInThreads()
+     struct ThreadUtilization {
+          int numRuns = 0;
+          double busySecs = 0; // wall-clock time spent running simulations
      };
 
    protected:
@@ -70,6 +77,9 @@ class CMDENV_API CmdenvSimulationRunner
      // internal
      virtual void ensureNedLoader(cConfiguration *cfg);
      virtual void doRunSimulations(BatchState& state, InifileContents *ini, const char *configName, const std::vector<int>& runNumbers);
+     virtual void doRunQueuedSimulations(BatchState& state, InifileContents *ini, const char *configName, const std::vector<int>& runQueue, std::atomic_int& nextRunIndex, ThreadUtilization& utilization);
+     virtual std::vector<int> orderRunsLongestFirst(InifileContents *ini, const char *configName, const std::vector<int>& runNumbers);
+     virtual double estimateRunDuration(InifileContents *ini, const char *configName, int runNumber); // returns -1 if unknown
      virtual void doRunSimulation(BatchState& state, InifileContents *ini, const char *configName, int runNumber); // note: throws on error
      virtual BatchResult extractResult(const BatchState& state);
      virtual cTerminationException *setupAndRunSimulation(BatchState& state, cConfiguration *cfg);
@@ -0,0 +1,461 @@
+//=========================================================================
+//  JSONREADER.CC - part of
+//                  OMNeT++/OMNEST
+//           Discrete System Simulation in C++
+//
+//=========================================================================
+
+/*--------------------------------------------------------------*
+  Copyright (C) 2006-2015 OpenSim Ltd.
+
+  This file is distributed WITHOUT ANY WARRANTY. See the file
+  `license' for details on this and other legal matters.
+*--------------------------------------------------------------*/
+
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include "exception.h"
+#include "jsonreader.h"
+
+namespace omnetpp {
+namespace common {
+
+void JsonReader::parse(const char *text, size_t length)
+{
+    if (length >= UINT32_MAX)
+        throw opp_runtime_error("JSON parse error: document too large");
+    this->text = text;
+    this->end = text + length;
+    nodes.clear();
+    nodes.reserve(length / 16 + 1);  // rough guess, avoids most reallocations
+
+    const char *p = text;
+    skipWhitespace(p);
+    p = parseValue(p, 0);
+    skipWhitespace(p);
+    if (p != end)
+        error(p, "unexpected text after the top-level value");
+}
+
+void JsonReader::error(const char *p, const char *what) const
+{
+    // report the position as line:column, which is what editors show
+    int line = 1, column = 1;
+    for (const char *s = text; s < p && s < end; s++) {
+        if (*s == '\n') {
+            line++;
+            column = 1;
+        }
+        else
+            column++;
+    }
+    throw opp_runtime_error("JSON parse error at line %d, column %d: %s", line, column, what);
+}
+
+// characters that end the fast scan over string contents: quote, backslash, control characters
+static const struct StringCharTable {
+    bool table[256];
+    StringCharTable() {
+        for (int i = 0; i < 256; i++)
+            table[i] = i < 0x20 || i == '"' || i == '\\';
+    }
+    bool operator[](unsigned char c) const {return table[c];}
+} isSpecialInString;
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline void JsonReader::skipWhitespace(const char *& p) const
+{
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+        p++;
+}
+
+const char *JsonReader::scanString(const char *p, bool& hasEscapes) const
+{
+    // p points after the opening quote; returns pointer to the closing quote
+    hasEscapes = false;
+    while (p < end) {
+        // fast path over ordinary characters
+        while (p < end && !isSpecialInString[(unsigned char)*p])
+            p++;
+        if (p >= end)
+            break;
+        char c = *p;
+        if (c == '"')
+            return p;
+        if (c == '\\') {
+            hasEscapes = true;
+            if (p + 1 >= end)
+                break;
+            char e = p[1];
+            if (e == 'u') {
+                for (int i = 2; i < 6; i++)
+                    if (p + i >= end || !isxdigit((unsigned char)p[i]))
+                        error(p, "invalid \\u escape in string");
+                p += 6;
+                continue;
+            }
+            if (!strchr("\"\\/bfnrt", e) || e == '\0')
+                error(p, "invalid escape sequence in string");
+            p += 2;
+            continue;
+        }
+        if ((unsigned char)c < 0x20)
+            error(p, "control character in string");
+        p++;
+    }
+    error(p, "unterminated string");
+}
+
+const char *JsonReader::parseValue(const char *p, int depth)
+{
+    if (depth > MAX_DEPTH)
+        error(p, "nesting too deep");
+    if (p >= end)
+        error(p, "value expected");
+
+    int index = nodes.size();
+    nodes.push_back(Node());
+    Node *node = &nodes[index];
+    node->hasEscapes = node->keyHasEscapes = false;
+    node->start = p - text;
+    node->length = 0;
+    node->keyStart = node->keyLength = 0;
+    node->nextSibling = 0;
+
+    char c = *p;
+    if (c == '{' || c == '[') {
+        bool isObject = c == '{';
+        char closer = isObject ? '}' : ']';
+        node->type = isObject ? OBJECT : ARRAY;
+        p++;
+        skipWhitespace(p);
+        if (p < end && *p == closer)
+            return p + 1;
+
+        int count = 0;
+        int prevChild = -1;
+        while (true) {
+            uint32_t keyStart = 0, keyLength = 0;
+            bool keyHasEscapes = false;
+            if (isObject) {
+                if (p >= end || *p != '"')
+                    error(p, "member name expected");
+                const char *closingQuote = scanString(p + 1, keyHasEscapes);
+                keyStart = p + 1 - text;
+                keyLength = closingQuote - (p + 1);
+                p = closingQuote + 1;
+                skipWhitespace(p);
+                if (p >= end || *p != ':')
+                    error(p, "':' expected after member name");
+                p++;
+                skipWhitespace(p);
+            }
+
+            int child = nodes.size();
+            p = parseValue(p, depth + 1);
+            if (isObject) {
+                nodes[child].keyStart = keyStart;
+                nodes[child].keyLength = keyLength;
+                nodes[child].keyHasEscapes = keyHasEscapes;
+            }
+            if (prevChild != -1)
+                nodes[prevChild].nextSibling = child;
+            prevChild = child;
+            count++;
+
+            skipWhitespace(p);
+            if (p < end && *p == ',') {
+                p++;
+                skipWhitespace(p);
+                continue;
+            }
+            if (p < end && *p == closer)
+                break;
+            error(p, isObject ? "',' or '}' expected" : "',' or ']' expected");
+        }
+        nodes[index].length = count;
+        return p + 1;
+    }
+    else if (c == '"') {
+        bool hasEscapes;
+        const char *closingQuote = scanString(p + 1, hasEscapes);
+        node->type = STRING;
+        node->hasEscapes = hasEscapes;
+        node->start = p + 1 - text;
+        node->length = closingQuote - (p + 1);
+        return closingQuote + 1;
+    }
+    else if (c == '-' || (c >= '0' && c <= '9')) {
+        // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+        const char *s = p;
+        if (*s == '-')
+            s++;
+        if (s >= end || !isDigit(*s))
+            error(s, "digit expected");
+        if (*s == '0')
+            s++;
+        else
+            while (s < end && isDigit(*s))
+                s++;
+        if (s < end && *s == '.') {
+            s++;
+            if (s >= end || !isDigit(*s))
+                error(s, "digit expected after decimal point");
+            while (s < end && isDigit(*s))
+                s++;
+        }
+        if (s < end && (*s == 'e' || *s == 'E')) {
+            s++;
+            if (s < end && (*s == '+' || *s == '-'))
+                s++;
+            if (s >= end || !isDigit(*s))
+                error(s, "digit expected in exponent");
+            while (s < end && isDigit(*s))
+                s++;
+        }
+        node->type = NUMBER;
+        node->length = s - p;
+        return s;
+    }
+    else {
+        struct { const char *word; Type type; } literals[] = {
+            {"true", BOOLEAN}, {"false", BOOLEAN}, {"null", NULLVALUE}
+        };
+        for (const auto& literal : literals) {
+            size_t len = strlen(literal.word);
+            if ((size_t)(end - p) >= len && strncmp(p, literal.word, len) == 0) {
+                node->type = literal.type;
+                node->length = len;
+                return p + len;
+            }
+        }
+        error(p, "value expected");
+    }
+}
+
+static void appendUtf8(std::string& out, uint32_t codePoint)
+{
+    if (codePoint < 0x80)
+        out += (char)codePoint;
+    else if (codePoint < 0x800) {
+        out += (char)(0xC0 | (codePoint >> 6));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000) {
+        out += (char)(0xE0 | (codePoint >> 12));
+        out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else {
+        out += (char)(0xF0 | (codePoint >> 18));
+        out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+        out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+}
+
+std::string JsonReader::unescape(const char *s, size_t length)
+{
+    // escapes were validated during parsing
+    std::string result;
+    result.reserve(length);
+    const char *end = s + length;
+    while (s < end) {
+        if (*s != '\\') {
+            result += *s++;
+            continue;
+        }
+        char e = s[1];
+        s += 2;
+        switch (e) {
+            case 'b': result += '\b'; break;
+            case 'f': result += '\f'; break;
+            case 'n': result += '\n'; break;
+            case 'r': result += '\r'; break;
+            case 't': result += '\t'; break;
+            case 'u': {
+                uint32_t codePoint = strtoul(std::string(s, 4).c_str(), nullptr, 16);
+                s += 4;
+                // combine UTF-16 surrogate pairs
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 && end - s >= 6 && s[0] == '\\' && s[1] == 'u') {
+                    uint32_t low = strtoul(std::string(s + 2, 4).c_str(), nullptr, 16);
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        s += 6;
+                    }
+                }
+                appendUtf8(result, codePoint);
+                break;
+            }
+            default: result += e; break;  // '"', '\\', '/'
+        }
+    }
+    return result;
+}
+
+bool JsonReader::equalsUnescaped(const char *s, size_t length, bool hasEscapes, const char *other)
+{
+    if (!hasEscapes)
+        return strlen(other) == length && memcmp(s, other, length) == 0;
+    return unescape(s, length) == other;
+}
+
+//----
+
+const char *JsonReader::Value::typeName() const
+{
+    switch (getType()) {
+        case NONE: return "nonexistent value";
+        case NULLVALUE: return "null";
+        case BOOLEAN: return "boolean";
+        case NUMBER: return "number";
+        case STRING: return "string";
+        case ARRAY: return "array";
+        case OBJECT: return "object";
+    }
+    return "?";
+}
+
+void JsonReader::Value::typeMismatch(const char *expected) const
+{
+    if (index >= 0 && reader->nodes[index].keyLength > 0)
+        throw opp_runtime_error("JSON value '%s': %s expected, got %s", getKey().c_str(), expected, typeName());
+    throw opp_runtime_error("JSON value: %s expected, got %s", expected, typeName());
+}
+
+bool JsonReader::Value::asBool() const
+{
+    if (getType() != BOOLEAN)
+        typeMismatch("boolean");
+    return reader->text[reader->nodes[index].start] == 't';
+}
+
+double JsonReader::Value::asDouble() const
+{
+    if (getType() != NUMBER)
+        typeMismatch("number");
+    const Node& node = reader->nodes[index];
+    // the input is not necessarily null-terminated, so copy the number out
+    char buf[64];
+    if (node.length < sizeof(buf)) {
+        memcpy(buf, reader->text + node.start, node.length);
+        buf[node.length] = '\0';
+        return strtod(buf, nullptr);
+    }
+    return strtod(std::string(reader->text + node.start, node.length).c_str(), nullptr);
+}
+
+int64_t JsonReader::Value::asInt() const
+{
+    if (getType() != NUMBER)
+        typeMismatch("number");
+    const Node& node = reader->nodes[index];
+    const char *s = reader->text + node.start;
+    const char *end = s + node.length;
+    bool negative = *s == '-';
+    if (negative)
+        s++;
+
+    // fast path for plain integers
+    uint64_t value = 0;
+    const char *digits = s;
+    while (s < end && *s >= '0' && *s <= '9' && s - digits < 18)
+        value = value * 10 + (*s++ - '0');
+    if (s == end)
+        return negative ? -(int64_t)value : (int64_t)value;
+
+    double d = asDouble();
+    if (d != std::floor(d) || d < -9.2233720368547758e18 || d >= 9.2233720368547758e18)
+        throw opp_runtime_error("JSON value %s is not an integer", std::string(reader->text + node.start, node.length).c_str());
+    return (int64_t)d;
+}
+
+std::string JsonReader::Value::asString() const
+{
+    if (getType() != STRING)
+        typeMismatch("string");
+    const Node& node = reader->nodes[index];
+    if (!node.hasEscapes)
+        return std::string(reader->text + node.start, node.length);
+    return unescape(reader->text + node.start, node.length);
+}
+
+bool JsonReader::Value::equals(const char *s) const
+{
+    if (getType() != STRING)
+        return false;
+    const Node& node = reader->nodes[index];
+    return equalsUnescaped(reader->text + node.start, node.length, node.hasEscapes, s);
+}
+
+JsonReader::Value JsonReader::Value::operator[](int i) const
+{
+    if (i < 0)
+        return Value();
+    Value child = getFirstChild();
+    while (child && i-- > 0)
+        child = child.getNextSibling();
+    return child;
+}
+
+JsonReader::Value JsonReader::Value::get(const char *key) const
+{
+    if (getType() != OBJECT)
+        return Value();
+    for (Value child = getFirstChild(); child; child = child.getNextSibling())
+        if (child.keyEquals(key))
+            return child;
+    return Value();
+}
+
+std::string JsonReader::Value::getKey() const
+{
+    if (index < 0)
+        return "";
+    const Node& node = reader->nodes[index];
+    if (!node.keyHasEscapes)
+        return std::string(reader->text + node.keyStart, node.keyLength);
+    return unescape(reader->text + node.keyStart, node.keyLength);
+}
+
+bool JsonReader::Value::keyEquals(const char *key) const
+{
+    if (index < 0)
+        return false;
+    const Node& node = reader->nodes[index];
+    return equalsUnescaped(reader->text + node.keyStart, node.keyLength, node.keyHasEscapes, key);
+}
+
+bool JsonReader::Value::getBool(const char *key, bool defaultValue) const
+{
+    Value value = get(key);
+    return value && !value.isNull() ? value.asBool() : defaultValue;
+}
+
+double JsonReader::Value::getDouble(const char *key, double defaultValue) const
+{
+    Value value = get(key);
+    return value && !value.isNull() ? value.asDouble() : defaultValue;
+}
+
+int64_t JsonReader::Value::getInt(const char *key, int64_t defaultValue) const
+{
+    Value value = get(key);
+    return value && !value.isNull() ? value.asInt() : defaultValue;
+}
+
+std::string JsonReader::Value::getString(const char *key, const std::string& defaultValue) const
+{
+    Value value = get(key);
+    return value && !value.isNull() ? value.asString() : defaultValue;
+}
+
+}  // namespace common
+}  // namespace omnetpp
+
@@ -0,0 +1,148 @@
+//=========================================================================
+//  JSONREADER.H - part of
+//                  OMNeT++/OMNEST
+//           Discrete System Simulation in C++
+//
+//=========================================================================
+
+/*--------------------------------------------------------------*
+  Copyright (C) 2006-2015 OpenSim Ltd.
+
+  This file is distributed WITHOUT ANY WARRANTY. See the file
+  `license' for details on this and other legal matters.
+*--------------------------------------------------------------*/
+
+#ifndef __OMNETPP_COMMON_JSONREADER_H
+#define __OMNETPP_COMMON_JSONREADER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "commondefs.h"
+
+namespace omnetpp {
+namespace common {
+
+/**
+ * Utility class for reading JSON documents; the counterpart of JsonWriter.
+ *
+ * The document is parsed in a single pass into a flat array of nodes that
+ * refer back into the input text, so parsing allocates only that array.
+ * String values are unescaped only when they are asked for, and keys can
+ * be compared without allocation. The input text must outlive the reader
+ * and the Values obtained from it.
+ *
+ * Syntax errors are reported with opp_runtime_error.
+ */
+class COMMON_API JsonReader
+{
+  public:
+    enum Type {NONE, NULLVALUE, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT};
+
+    /**
+     * Lightweight handle to a value in the parsed document. A default-constructed
+     * Value, or one returned for a nonexistent member or index, has type NONE
+     * and is false in a boolean context.
+     */
+    class COMMON_API Value
+    {
+        friend class JsonReader;
+      private:
+        const JsonReader *reader = nullptr;
+        int index = -1;
+        Value(const JsonReader *reader, int index) : reader(reader), index(index) {}
+        const char *typeName() const;
+        [[noreturn]] void typeMismatch(const char *expected) const;
+
+      public:
+        Value() {}
+        Type getType() const {return index < 0 ? NONE : reader->nodes[index].type;}
+        bool isValid() const {return index >= 0;}
+        explicit operator bool() const {return isValid();}
+        bool isNull() const {return getType() == NULLVALUE;}
+        bool isBool() const {return getType() == BOOLEAN;}
+        bool isNumber() const {return getType() == NUMBER;}
+        bool isString() const {return getType() == STRING;}
+        bool isArray() const {return getType() == ARRAY;}
+        bool isObject() const {return getType() == OBJECT;}
+
+        // scalar access; these throw if the value has a different type
+        bool asBool() const;
+        double asDouble() const;
+        int64_t asInt() const;  // throws if the number is not an integer
+        std::string asString() const;
+        bool equals(const char *s) const;  // string comparison without allocation; false if not a string
+
+        // arrays and objects
+        int size() const {Type type = getType(); return (type == ARRAY || type == OBJECT) ? reader->nodes[index].length : 0;}  // number of elements/members; 0 for scalars
+        Value operator[](int i) const;  // i-th element or member value; linear in i
+        Value get(const char *key) const;  // member value, or an invalid Value
+        bool has(const char *key) const {return get(key).isValid();}
+
+        // iteration over elements/members in document order
+        Value getFirstChild() const {return size() > 0 ? Value(reader, index + 1) : Value();}
+        Value getNextSibling() const {return index >= 0 && reader->nodes[index].nextSibling != 0 ? Value(reader, reader->nodes[index].nextSibling) : Value();}
+        std::string getKey() const;  // member name, for values inside an object
+        bool keyEquals(const char *key) const;
+
+        // member access with defaults, for optional fields
+        bool getBool(const char *key, bool defaultValue) const;
+        double getDouble(const char *key, double defaultValue) const;
+        int64_t getInt(const char *key, int64_t defaultValue) const;
+        std::string getString(const char *key, const std::string& defaultValue) const;
+    };
+
+  private:
+    struct Node {
+        Type type;
+        bool hasEscapes;      // value is a string containing escape sequences
+        bool keyHasEscapes;   // member name contains escape sequences
+        uint32_t start;       // offset of the value text (strings: without the quotes)
+        uint32_t length;      // length of the value text; for arrays and objects, the number of children
+        uint32_t keyStart;    // offset of the member name (without the quotes), for object members
+        uint32_t keyLength;
+        uint32_t nextSibling; // index of the next element/member, or 0 if this is the last one
+    };
+
+    enum { MAX_DEPTH = 512 };
+
+    const char *text = nullptr;
+    const char *end = nullptr;
+    std::vector<Node> nodes;
+
+  private:
+    void skipWhitespace(const char *& p) const;
+    const char *scanString(const char *p, bool& hasEscapes) const;
+    const char *parseValue(const char *p, int depth);
+    [[noreturn]] void error(const char *p, const char *what) const;
+    static std::string unescape(const char *s, size_t length);
+    static bool equalsUnescaped(const char *s, size_t length, bool hasEscapes, const char *other);
+
+  public:
+    JsonReader() {}
+    JsonReader(const char *text, size_t length) {parse(text, length);}
+    JsonReader(const std::string& text) {parse(text);}
+
+    /**
+     * Parses the given text, replacing any previously parsed document.
+     * The text is not copied.
+     */
+    void parse(const char *text, size_t length);
+    void parse(const std::string& text) {parse(text.data(), text.size());}
+
+    /**
+     * Returns the top-level value of the document.
+     */
+    Value getRoot() const {return nodes.empty() ? Value() : Value(this, 0);}
+
+    /**
+     * Returns the number of values in the document, for diagnostics.
+     */
+    size_t getNumValues() const {return nodes.size();}
+};
+
+}  // namespace common
+}  // namespace omnetpp
+
+
+#endif
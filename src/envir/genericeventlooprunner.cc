@@ -262,6 +262,11 @@ void GenericEventLoopRunner::printStatusUpdate()
         out << "     Messages:  created: " << cMessage::getTotalMessageCount()
             << "   present: " << cMessage::getLiveMessageCount()
             << "   in FES: " << simulation->getFES()->getLength() << std::endl;
+
+        if (cMessage::getPooledMessageCount() != 0)
+            out << "     Pooled:    allocated: " << cMessage::getPooledMessageCount()
+                << "   reused: " << cMessage::getReusedMessageCount()
+                << "   free: " << cMessage::getFreePooledMessageCount() << std::endl;
     }
     else {
         char buf[64];
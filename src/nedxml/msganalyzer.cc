@@ -360,6 +360,11 @@ void MsgAnalyzer::analyzeClassOrStruct(ClassInfo& classInfo, const std::string&
         }
     }
 
+    // pooled allocation
+    classInfo.isPooled = getPropertyAsBool(classInfo.props, PROP_POOLED, false);
+    if (classInfo.isPooled && !hasSuperclass(classInfo, "omnetpp::cMessage"))
+        errors->addError(classInfo.astNode, "'%s': @pooled is only allowed for message classes (must be derived from omnetpp::cMessage)", classInfo.name.c_str());
+
     // isPolymorphic
     bool isPolymorphic = getPropertyAsBool(classInfo.props, PROP_POLYMORPHIC, classInfo.isClass);
     if (baseClassInfo && baseClassInfo->isPolymorphic)
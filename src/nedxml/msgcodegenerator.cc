@@ -382,6 +382,9 @@ void MsgCodeGenerator::generateClassDecl(const ClassInfo& classInfo, const std::
         baseclassSepar = ", ";
     }
 
+    if (classInfo.isPooled)
+        H << baseclassSepar << "public ::omnetpp::cPooledMessage<" << classInfo.className << ">";
+
     H << "\n{\n";
     H << "  protected:\n";
     for (const FieldInfo& field : classInfo.fieldList) {
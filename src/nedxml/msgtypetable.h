@@ -197,6 +197,7 @@ class NEDXML_API MsgTypeTable
 
         std::vector<std::string> rootClasses; // root(s) of its C++ class hierarchy
         StringVector implementsQNames;       // qnames of additional base classes, from @implements property
+        bool isPooled = false;         // @pooled; objects are allocated via cPooledMessage
         std::string beforeChange;      // @beforeChange; method to be called before mutator methods
         std::string str;               // @str; expression to be returned from str() method
 
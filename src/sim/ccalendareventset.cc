@@ -0,0 +1,452 @@
+//=========================================================================
+//  CCALENDAREVENTSET.CC - part of
+//
+//                  OMNeT++/OMNEST
+//           Discrete System Simulation in C++
+//
+//   Member functions of
+//    cCalendarEventSet : future event set, implemented as calendar queue
+//
+//=========================================================================
+
+/*--------------------------------------------------------------*
+  Copyright (C) 1992-2017 Andras Varga
+  Copyright (C) 2006-2017 OpenSim Ltd.
+
+  This file is distributed WITHOUT ANY WARRANTY. See the file
+  `license' for details on this and other legal matters.
+*--------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include "omnetpp/globals.h"
+#include "omnetpp/cevent.h"
+#include "omnetpp/ccalendareventset.h"
+
+namespace omnetpp {
+
+Register_Class(cCalendarEventSet);
+
+#define MIN_BUCKETS      16   // power of 2
+#define SAMPLE_SIZE      64   // number of earliest events used for estimating the day width
+#define MAX_DAYS_STEPPED  4   // per operation on average, before the day width is re-estimated
+#define MAX_CROWDING      8   // bucket size at insertion on average, before the day width is re-estimated
+#define MAX_ADAPT_INTERVAL 64  // in units of numBuckets operations
+
+cCalendarEventSet::cCalendarEventSet(const char *name) : cFutureEventSet(name),
+    buckets(MIN_BUCKETS), numBuckets(MIN_BUCKETS)
+{
+}
+
+cCalendarEventSet::cCalendarEventSet(const cCalendarEventSet& other) : cFutureEventSet(other)
+{
+    copy(other);
+}
+
+cCalendarEventSet::~cCalendarEventSet()
+{
+    clear();
+}
+
+std::string cCalendarEventSet::str() const
+{
+    if (isEmpty())
+        return std::string("empty");
+    std::stringstream out;
+    out << "length=" << getLength() << ", buckets=" << numBuckets;
+    return out.str();
+}
+
+void cCalendarEventSet::forEachChild(cVisitor *v)
+{
+    sort();
+
+    for (cEvent *event : array)
+        if (!v->visit(event))
+            return;
+}
+
+void cCalendarEventSet::clear()
+{
+    for (Bucket& bucket : buckets)
+        for (cEvent *event : bucket)
+            dropAndDelete(event);
+    buckets.assign(MIN_BUCKETS, Bucket());
+    numBuckets = MIN_BUCKETS;
+    length = 0;
+    currentDay = 0;
+    firstBucket = -1;
+    numDaysStepped = numBucketEntries = numOps = 0;
+    adaptInterval = 1;
+    array.clear();
+    arrayValid = false;
+}
+
+void cCalendarEventSet::copy(const cCalendarEventSet& other)
+{
+    buckets = other.buckets;
+    numBuckets = other.numBuckets;
+    dayWidth = other.dayWidth;
+    length = other.length;
+    insertCount = other.insertCount;
+    currentDay = other.currentDay;
+    firstBucket = other.firstBucket;
+    numDaysStepped = numBucketEntries = numOps = 0;
+    adaptInterval = other.adaptInterval;
+    array.clear();
+    arrayValid = false;
+
+    for (Bucket& bucket : buckets) {
+        for (int i = 0; i < (int)bucket.size(); i++) {
+            cEvent *event = bucket[i]->dup();
+            event->insertOrder = bucket[i]->insertOrder;
+            event->heapIndex = i;
+            take(bucket[i] = event);
+        }
+    }
+}
+
+cCalendarEventSet& cCalendarEventSet::operator=(const cCalendarEventSet& other)
+{
+    if (this == &other)
+        return *this;
+    cFutureEventSet::operator=(other);
+    clear();
+    copy(other);
+    return *this;
+}
+
+inline int64_t cCalendarEventSet::dayOf(const cEvent *event) const
+{
+    return event->getArrivalTime().raw() / dayWidth;
+}
+
+void cCalendarEventSet::siftUp(Bucket& bucket, int index)
+{
+    cEvent *event = bucket[index];
+    while (index > 0) {
+        int parent = (index-1) >> 1;
+        if (!event->shouldPrecede(bucket[parent]))
+            break;
+        (bucket[index] = bucket[parent])->heapIndex = index;
+        index = parent;
+    }
+    (bucket[index] = event)->heapIndex = index;
+}
+
+void cCalendarEventSet::siftDown(Bucket& bucket, int index)
+{
+    int size = bucket.size();
+    cEvent *event = bucket[index];
+    int child;
+    while ((child = 2*index+1) < size) {
+        if (child+1 < size && bucket[child+1]->shouldPrecede(bucket[child]))
+            child++;
+        if (!bucket[child]->shouldPrecede(event))
+            break;
+        (bucket[index] = bucket[child])->heapIndex = index;
+        index = child;
+    }
+    (bucket[index] = event)->heapIndex = index;
+}
+
+void cCalendarEventSet::bucketInsert(Bucket& bucket, cEvent *event)
+{
+    bucket.push_back(event);
+    siftUp(bucket, bucket.size()-1);
+}
+
+void cCalendarEventSet::bucketRemove(Bucket& bucket, int index)
+{
+    cEvent *last = bucket.back();
+    bucket.pop_back();
+    if (index < (int)bucket.size()) {
+        bucket[index] = last;
+        siftUp(bucket, index);
+        if (last->heapIndex == index)
+            siftDown(bucket, index);
+    }
+}
+
+int cCalendarEventSet::findFirst() const
+{
+    if (length == 0)
+        return -1;
+    if (firstBucket != -1)
+        return firstBucket;
+
+    // step through the days of a year; the first event found on its own day is the first one
+    for (int i = 0; i < numBuckets; i++) {
+        int64_t day = currentDay + i;
+        int b = (int)(day & (numBuckets-1));
+        const Bucket& bucket = buckets[b];
+        if (!bucket.empty() && dayOf(bucket[0]) == day) {
+            numDaysStepped += i;
+            currentDay = day;
+            return firstBucket = b;
+        }
+    }
+
+    // no event within a year: direct search among the first events of the buckets
+    numDaysStepped += numBuckets;
+    int best = -1;
+    for (int b = 0; b < numBuckets; b++)
+        if (!buckets[b].empty() && (best == -1 || buckets[b][0]->shouldPrecede(buckets[best][0])))
+            best = b;
+    currentDay = dayOf(buckets[best][0]);
+    return firstBucket = best;
+}
+
+void cCalendarEventSet::insert(cEvent *event)
+{
+    take(event);
+
+    event->insertOrder = insertCount++;
+
+    int64_t day = dayOf(event);
+    int b = (int)(day & (numBuckets-1));
+    bool isFirst = day < currentDay || (firstBucket != -1 && event->shouldPrecede(buckets[firstBucket][0]));
+    if (buckets[b].empty() || buckets[b][0]->getArrivalTime() != event->getArrivalTime())
+        numBucketEntries += buckets[b].size();  // crowding by simultaneous events is not helped by narrower days
+    bucketInsert(buckets[b], event);
+    length++;
+    if (isFirst) {
+        currentDay = day;
+        firstBucket = b;
+    }
+    arrayValid = false;
+
+    if (length > 2*numBuckets)
+        rebuild(2*numBuckets);
+    else if (++numOps >= numBuckets * adaptInterval)
+        adapt();
+}
+
+cEvent *cCalendarEventSet::peekFirst() const
+{
+    int b = findFirst();
+    return b == -1 ? nullptr : buckets[b][0];
+}
+
+cEvent *cCalendarEventSet::removeFirst()
+{
+    int b = findFirst();
+    if (b == -1)
+        return nullptr;
+
+    cEvent *event = buckets[b][0];
+    bucketRemove(buckets[b], 0);
+    length--;
+    firstBucket = -1;
+    arrayValid = false;
+
+    if (length < numBuckets/2 && numBuckets > MIN_BUCKETS)
+        rebuild(numBuckets/2);
+    else if (++numOps >= numBuckets * adaptInterval)
+        adapt();
+
+    drop(event);
+    event->heapIndex = -1;
+    return event;
+}
+
+cEvent *cCalendarEventSet::remove(cEvent *event)
+{
+    // make sure it is really in the FES
+    if (event->heapIndex == -1)
+        return nullptr;
+
+    int b = bucketOf(event);
+    int index = event->heapIndex;
+    ASSERT(index < (int)buckets[b].size() && buckets[b][index] == event);  // sanity check
+
+    if (b == firstBucket && index == 0)
+        firstBucket = -1;
+    bucketRemove(buckets[b], index);
+    length--;
+    arrayValid = false;
+
+    if (length < numBuckets/2 && numBuckets > MIN_BUCKETS)
+        rebuild(numBuckets/2);
+
+    drop(event);
+    event->heapIndex = -1;
+    return event;
+}
+
+void cCalendarEventSet::putBackFirst(cEvent *event)
+{
+    take(event);
+
+    // keeps its insertion order, and it precedes all other events
+    int64_t day = dayOf(event);
+    int b = (int)(day & (numBuckets-1));
+    bucketInsert(buckets[b], event);
+    length++;
+    currentDay = day;
+    firstBucket = b;
+    arrayValid = false;
+}
+
+void cCalendarEventSet::adapt()
+{
+    // re-estimate the day width if the days turned out too short (many
+    // empty days stepped over) or too long (crowded buckets)
+    if (numDaysStepped > MAX_DAYS_STEPPED * (int64_t)numOps || numBucketEntries > MAX_CROWDING * (int64_t)numOps) {
+        std::vector<cEvent *> events;
+        collectEvents(events);
+        int64_t newDayWidth = estimateDayWidth(events);
+        if (newDayWidth > 2*dayWidth || dayWidth > 2*newDayWidth) {
+            adaptInterval = 1;
+            redistribute(events, numBuckets, newDayWidth);
+            return;
+        }
+        // no better width (e.g. because most events are simultaneous): check less often
+        adaptInterval = std::min(2*adaptInterval, MAX_ADAPT_INTERVAL);
+    }
+    numDaysStepped = numBucketEntries = numOps = 0;
+}
+
+void cCalendarEventSet::rebuild(int newNumBuckets)
+{
+    std::vector<cEvent *> events;
+    collectEvents(events);
+    redistribute(events, newNumBuckets, estimateDayWidth(events));
+}
+
+void cCalendarEventSet::collectEvents(std::vector<cEvent *>& events) const
+{
+    events.reserve(length);
+    for (const Bucket& bucket : buckets)
+        events.insert(events.end(), bucket.begin(), bucket.end());
+}
+
+void cCalendarEventSet::redistribute(const std::vector<cEvent *>& events, int newNumBuckets, int64_t newDayWidth)
+{
+    for (Bucket& bucket : buckets)
+        bucket.clear();
+    numBuckets = newNumBuckets;
+    buckets.resize(numBuckets);
+    dayWidth = newDayWidth;
+
+    currentDay = INT64_MAX;
+    for (cEvent *event : events) {
+        int64_t day = dayOf(event);
+        bucketInsert(buckets[day & (numBuckets-1)], event);
+        currentDay = std::min(currentDay, day);
+    }
+    if (events.empty())
+        currentDay = 0;
+    firstBucket = -1;
+    numDaysStepped = numBucketEntries = numOps = 0;
+}
+
+int64_t cCalendarEventSet::estimateDayWidth(std::vector<cEvent *>& events) const
+{
+    // Brown's heuristic: three times the average separation of the earliest
+    // events, ignoring separations more than twice the average
+    int n = events.size();
+    if (n < 2)
+        return dayWidth;
+    int m = std::min(n, SAMPLE_SIZE);
+    auto byTime = [](const cEvent *a, const cEvent *b) { return a->getArrivalTime() < b->getArrivalTime(); };
+    std::nth_element(events.begin(), events.begin()+m-1, events.end(), byTime);
+    std::sort(events.begin(), events.begin()+m, byTime);
+
+    double sum = 0;
+    int count = 0;
+    for (int i = 1; i < m; i++) {
+        int64_t gap = events[i]->getArrivalTime().raw() - events[i-1]->getArrivalTime().raw();
+        if (gap > 0) {
+            sum += gap;
+            count++;
+        }
+    }
+
+    double width;
+    if (count == 0) {
+        // the earliest events are simultaneous: use the average spacing of all events
+        int64_t last = events[0]->getArrivalTime().raw();
+        for (cEvent *event : events)
+            last = std::max(last, event->getArrivalTime().raw());
+        if (last == events[0]->getArrivalTime().raw())
+            return dayWidth;
+        width = 3.0 * (last - events[0]->getArrivalTime().raw()) / n;
+    }
+    else {
+        double average = sum / count;
+        double sum2 = 0;
+        int count2 = 0;
+        for (int i = 1; i < m; i++) {
+            int64_t gap = events[i]->getArrivalTime().raw() - events[i-1]->getArrivalTime().raw();
+            if (gap > 0 && gap <= 2 * average) {
+                sum2 += gap;
+                count2++;
+            }
+        }
+        width = 3.0 * sum2 / count2;
+    }
+    return (int64_t)std::max(1.0, std::min(width, (double)(INT64_MAX/4)));
+}
+
+void cCalendarEventSet::fillArray()
+{
+    array.clear();
+    for (const Bucket& bucket : buckets)
+        array.insert(array.end(), bucket.begin(), bucket.end());
+    arrayValid = true;
+}
+
+cEvent *cCalendarEventSet::get(int k)
+{
+    if (k < 0 || k >= length)
+        return nullptr;
+    if (!arrayValid)
+        fillArray();
+    return array[k];
+}
+
+void cCalendarEventSet::sort()
+{
+    fillArray();
+    std::sort(array.begin(), array.end(), [](const cEvent *a, const cEvent *b) { return a->shouldPrecede(b); });
+}
+
+// like ASSERT(), but active in release mode as well
+#define ENSURE(expr) \
+  ((void) ((expr) ? 0 : (throw omnetpp::cRuntimeError("ENSURE(): Condition '%s' does not hold in function '%s' at %s:%d", \
+                                   #expr, __FUNCTION__, __FILE__, __LINE__), 0)))
+
+void cCalendarEventSet::checkCalendar()
+{
+    ENSURE((numBuckets & (numBuckets-1)) == 0); // numBuckets must be power of 2
+    ENSURE((int)buckets.size() == numBuckets);
+    ENSURE(dayWidth >= 1);
+
+    int count = 0;
+    for (int b = 0; b < numBuckets; b++) {
+        const Bucket& bucket = buckets[b];
+        for (int i = 0; i < (int)bucket.size(); i++) {
+            cEvent *event = bucket[i];
+            ENSURE(event->getOwner() == this);
+            ENSURE(event->heapIndex == i);
+            ENSURE(bucketOf(event) == b);
+            ENSURE(dayOf(event) >= currentDay);
+            if (i > 0)
+                ENSURE(!event->shouldPrecede(bucket[(i-1)>>1])); // heap order property
+            count++;
+        }
+    }
+    ENSURE(count == length);
+
+    if (firstBucket != -1) {
+        ENSURE(!buckets[firstBucket].empty());
+        for (const Bucket& bucket : buckets)
+            if (!bucket.empty())
+                ENSURE(!bucket[0]->shouldPrecede(buckets[firstBucket][0]));
+    }
+}
+
+}  // namespace omnetpp
+
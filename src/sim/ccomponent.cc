@@ -57,6 +57,8 @@ OPP_THREAD_LOCAL int cComponent::notificationSP = 0;
 
 OPP_THREAD_LOCAL bool cComponent::checkSignals;
 
+OPP_THREAD_LOCAL uint64_t cComponent::listenerCacheGeneration = 0;
+
 simsignal_t PRE_MODEL_CHANGE = cComponent::registerSignal("PRE_MODEL_CHANGE");
 simsignal_t POST_MODEL_CHANGE = cComponent::registerSignal("POST_MODEL_CHANGE");
 
@@ -98,6 +100,7 @@ cComponent::~cComponent()
 
     ASSERT_DTOR(signalTable == nullptr);  // note: releaseLocalListeners() gets called in subclasses, ~cModule and ~cChannel
 
+    deleteListenerCache();
     delete[] rngMap;
     delete[] parArray;
     delete displayString;
@@ -635,59 +638,102 @@ bool cComponent::mayHaveListeners(simsignal_t signalID) const
     return signals_->listenerCounts[signalID] > 0;
 }
 
-bool cComponent::hasListeners(simsignal_t signalID) const
+inline const cComponent::ListenerCacheEntry *cComponent::getListenerCacheEntry(simsignal_t signalID) const
 {
-    // check local listeners
-    if (signalTable) {
-        int n = signalTable->size();
-        for (int i = 0; i < n; i++)
-            if ((*signalTable)[i].signalID == signalID)
-                return true;
+    // note: linear search, for the same reason as in findListenerList()
+    if (listenerCache && listenerCache->generation == listenerCacheGeneration)
+        for (ListenerCacheEntry *entry : listenerCache->entries)
+            if (entry->signalID == signalID)
+                return entry;
+    return createListenerCacheEntry(signalID);
+}
+
+const cComponent::ListenerCacheEntry *cComponent::createListenerCacheEntry(simsignal_t signalID) const
+{
+    {
+        std::lock_guard<std::recursive_mutex> lock(signalRegistrationsMutex);
+        if (signalID < 0 || signalID > signals_->lastId)
+            throwInvalidSignalID(signalID);
     }
 
-    // if not found, check ancestors
-    cModule *parent = getParentModule();
-    return parent ? parent->hasListeners(signalID) : false;
+    // discard entries computed before the last change in listener lists or the module tree
+    if (!listenerCache)
+        listenerCache = new ListenerCache;
+    else if (listenerCache->generation != listenerCacheGeneration) {
+        for (ListenerCacheEntry *entry : listenerCache->entries)
+            delete entry;
+        listenerCache->entries.clear();
+    }
+    listenerCache->generation = listenerCacheGeneration;
+
+    // collect the listener lists of this component and its ancestors
+    ListenerCacheEntry *entry = new ListenerCacheEntry;
+    entry->signalID = signalID;
+    for (const cComponent *component = this; component; component = component->getParentModule())
+        if (SignalListenerList *listenerList = component->findListenerList(signalID))
+            entry->levels.push_back(ListenerLevel { const_cast<cComponent *>(component), listenerList->listeners });
+    listenerCache->entries.push_back(entry);
+    return entry;
+}
+
+void cComponent::deleteListenerCache() const
+{
+    if (listenerCache) {
+        for (ListenerCacheEntry *entry : listenerCache->entries)
+            delete entry;
+        delete listenerCache;
+        listenerCache = nullptr;
+    }
+}
+
+bool cComponent::hasListeners(simsignal_t signalID) const
+{
+    return !getListenerCacheEntry(signalID)->levels.empty();
 }
 
 void cComponent::emit(simsignal_t signalID, bool b, cObject *details)
 {
     if (checkSignals)
         getComponentType()->checkSignal(signalID, SIMSIGNAL_BOOL);
-    if (mayHaveListeners(signalID))
-        fire(this, signalID, b, details);
+    const ListenerCacheEntry *entry = getListenerCacheEntry(signalID);
+    if (!entry->levels.empty())
+        fireCached(entry, signalID, b, details);
 }
 
 void cComponent::doEmit(simsignal_t signalID, intval_t i, cObject *details)
 {
     if (checkSignals)
         getComponentType()->checkSignal(signalID, SIMSIGNAL_INT);
-    if (mayHaveListeners(signalID))
-        fire(this, signalID, i, details);
+    const ListenerCacheEntry *entry = getListenerCacheEntry(signalID);
+    if (!entry->levels.empty())
+        fireCached(entry, signalID, i, details);
 }
 
 void cComponent::doEmit(simsignal_t signalID, uintval_t i, cObject *details)
 {
     if (checkSignals)
         getComponentType()->checkSignal(signalID, SIMSIGNAL_UINT);
-    if (mayHaveListeners(signalID))
-        fire(this, signalID, i, details);
+    const ListenerCacheEntry *entry = getListenerCacheEntry(signalID);
+    if (!entry->levels.empty())
+        fireCached(entry, signalID, i, details);
 }
 
 void cComponent::emit(simsignal_t signalID, double d, cObject *details)
 {
     if (checkSignals)
         getComponentType()->checkSignal(signalID, SIMSIGNAL_DOUBLE);
-    if (mayHaveListeners(signalID))
-        fire(this, signalID, d, details);
+    const ListenerCacheEntry *entry = getListenerCacheEntry(signalID);
+    if (!entry->levels.empty())
+        fireCached(entry, signalID, d, details);
 }
 
 void cComponent::emit(simsignal_t signalID, const SimTime& t, cObject *details)
 {
     if (checkSignals)
         getComponentType()->checkSignal(signalID, SIMSIGNAL_SIMTIME);
-    if (mayHaveListeners(signalID))
-        fire(this, signalID, t, details);
+    const ListenerCacheEntry *entry = getListenerCacheEntry(signalID);
+    if (!entry->levels.empty())
+        fireCached(entry, signalID, t, details);
 }
 
 void cComponent::emit(simsignal_t signalID, const char *s, cObject *details)
@@ -696,16 +742,38 @@ void cComponent::emit(simsignal_t signalID, const char *s, cObject *details)
         throw cRuntimeError(this, "emit(): Emitting nullptr as string (const char *) signal value is not allowed, signalID=%d", signalID);
     if (checkSignals)
         getComponentType()->checkSignal(signalID, SIMSIGNAL_STRING);
-    if (mayHaveListeners(signalID))
-        fire(this, signalID, s, details);
+    const ListenerCacheEntry *entry = getListenerCacheEntry(signalID);
+    if (!entry->levels.empty())
+        fireCached(entry, signalID, s, details);
 }
 
 void cComponent::emit(simsignal_t signalID, cObject *obj, cObject *details)
 {
     if (checkSignals)
         getComponentType()->checkSignal(signalID, SIMSIGNAL_OBJECT, obj);
-    if (mayHaveListeners(signalID))
-        fire(this, signalID, obj, details);
+    const ListenerCacheEntry *entry = getListenerCacheEntry(signalID);
+    if (!entry->levels.empty())
+        fireCached(entry, signalID, obj, details);
+}
+
+template<typename T>
+void cComponent::fireCached(const ListenerCacheEntry *entry, simsignal_t signalID, T x, cObject *details)
+{
+    uint64_t generation = listenerCacheGeneration;
+    int n = entry->levels.size();
+    for (int i = 0; i < n; i++) {
+        ListenerLevel level = entry->levels[i];  // copy, as entry may be deleted by listeners
+        level.component->notifyListeners(level.listeners, this, signalID, x, details);
+
+        // if listeners changed listener lists or the module tree, the rest of the
+        // cached levels may be stale: continue the slow way, like fire() does
+        if (generation != listenerCacheGeneration) {
+            cModule *parent = level.component->getParentModule();
+            if (parent)
+                parent->fire(this, signalID, x, details);
+            return;
+        }
+    }
 }
 
 template<typename T>
@@ -713,23 +781,8 @@ void cComponent::fire(cComponent *source, simsignal_t signalID, T x, cObject *de
 {
     // notify local listeners if there are any
     SignalListenerList *listenerList = findListenerList(signalID);
-    if (listenerList) {
-        cIListener **listeners = listenerList->listeners;
-        if (notificationSP >= NOTIFICATION_STACK_SIZE)
-            throw cRuntimeError(this, "emit(): Recursive notification stack overflow, signalID=%d", signalID);
-
-        int oldNotificationSP = notificationSP;
-        try {
-            notificationStack[notificationSP++] = listeners;  // lock against modification
-            for (int i = 0; listeners[i]; i++)
-                listeners[i]->receiveSignal(source, signalID, x, details);  // will crash if listener is already deleted
-            notificationSP--;
-        }
-        catch (std::exception& e) {
-            notificationSP = oldNotificationSP;
-            throw;
-        }
-    }
+    if (listenerList)
+        notifyListeners(listenerList->listeners, source, signalID, x, details);
 
     // notify ancestors recursively
     cModule *parent = getParentModule();
@@ -737,6 +790,25 @@ void cComponent::fire(cComponent *source, simsignal_t signalID, T x, cObject *de
         parent->fire(source, signalID, x, details);
 }
 
+template<typename T>
+void cComponent::notifyListeners(cIListener **listeners, cComponent *source, simsignal_t signalID, T x, cObject *details)
+{
+    if (notificationSP >= NOTIFICATION_STACK_SIZE)
+        throw cRuntimeError(this, "emit(): Recursive notification stack overflow, signalID=%d", signalID);
+
+    int oldNotificationSP = notificationSP;
+    try {
+        notificationStack[notificationSP++] = listeners;  // lock against modification
+        for (int i = 0; listeners[i]; i++)
+            listeners[i]->receiveSignal(source, signalID, x, details);  // will crash if listener is already deleted
+        notificationSP--;
+    }
+    catch (std::exception& e) {
+        notificationSP = oldNotificationSP;
+        throw;
+    }
+}
+
 void cComponent::fireFinish()
 {
     if (signalTable) {
@@ -761,6 +833,7 @@ void cComponent::subscribe(simsignal_t signalID, cIListener *listener)
     if (!listenerList->addListener(listener))
         throw cRuntimeError(this, "subscribe(): Listener already subscribed at this component to signal '%s' (id=%d)", getSignalName(signalID), signalID);
     signals_->listenerCounts[signalID]++;
+    invalidateListenerCaches();  // addListener() may have reallocated the listener array
     listener->subscriptions.push_back(std::pair<cComponent*,simsignal_t>(this,signalID));
     listener->subscribedTo(this, signalID);
 }
@@ -785,6 +858,7 @@ void cComponent::unsubscribe(simsignal_t signalID, cIListener *listener)
         removeListenerList(signalID);
 
     signals_->listenerCounts[signalID]--;
+    invalidateListenerCaches();
     ASSERT(signals_->listenerCounts[signalID] >= 0);
     auto subscription = std::pair<cComponent*,simsignal_t>(this,signalID);
     ASSERT(contains(listener->subscriptions, subscription));
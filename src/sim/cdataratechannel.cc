@@ -163,13 +163,13 @@ cChannel::Result cDatarateChannel::processMessage(cMessage *msg, const SendOptio
     result.delay = delay;
 
     if (!result.discard) {
-        if (mayHaveListeners(messageSentSignal)) {
+        if (hasListeners(messageSentSignal)) {
             MessageSentSignalValue tmp(t, msg, &result);
             emit(messageSentSignal, &tmp);
         }
     }
     else {
-        if (mayHaveListeners(messageDiscardedSignal)) {
+        if (hasListeners(messageDiscardedSignal)) {
             cTimestampedValue tmp(t, msg);
             emit(messageDiscardedSignal, &tmp);
         }
@@ -341,7 +341,7 @@ void cDatarateChannel::processPacket(cPacket *pkt, const SendOptions& options, s
     }
 
     // emit busySignal
-    if (mode != UNCHECKED && mayHaveListeners(channelBusySignal)) {
+    if (mode != UNCHECKED && hasListeners(channelBusySignal)) {
         if (oldFinishTime < t) {
             cTimestampedValue tmp(oldFinishTime, (intval_t)0);
             emit(channelBusySignal, &tmp);
@@ -355,7 +355,7 @@ void cDatarateChannel::processPacket(cPacket *pkt, const SendOptions& options, s
 
 void cDatarateChannel::finish()
 {
-    if (mode != UNCHECKED && mayHaveListeners(channelBusySignal)) {
+    if (mode != UNCHECKED && hasListeners(channelBusySignal)) {
         cTimestampedValue tmp(std::min(channelFinishTime, simTime()), (intval_t)0);
         emit(channelBusySignal, &tmp);
     }
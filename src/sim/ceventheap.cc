@@ -22,7 +22,8 @@
 
 #include <cstdio>           // sprintf
 #include <cstring>          // strlen
-#include <cstdlib>          // qsort
+#include <cstdint>          // uintptr_t
+#include <algorithm>        // std::sort
 #include <sstream>
 #include "omnetpp/globals.h"
 #include "omnetpp/cmessage.h"
@@ -36,6 +37,13 @@ Register_Class(cEventHeap);
 #define CBINC(i)          ((i) = ((i)+1)&(cbsize-1))
 #define CBDEC(i)          ((i) = ((i)-1)&(cbsize-1))
 
+// 4-ary heap with the root at heap[3]: the children of heap[i] are
+// heap[4*i-8]..heap[4*i-5], so sibling groups start at multiples of 4
+#define HEAPROOT          3
+#define HEAPCHILD(i)      (4*(i)-8)
+#define HEAPPARENT(i)     ((i)/4+2)
+#define HEAPALIGN         128  // 4 entries
+
 inline bool operator>(cEvent& a, cEvent& b)
 {
     return b.shouldPrecede(&a);
@@ -46,19 +54,16 @@ inline bool operator<=(cEvent& a, cEvent& b)
     return !(a > b);
 }
 
-static int qsort_cmp_msgs(const void *p1, const void *p2)
-{
-    cEvent *m1 = *(cEvent **)p1;
-    cEvent *m2 = *(cEvent **)p2;
-    return cEvent::compareBySchedulingOrder(m1, m2);
-}
+// same as cEvent::shouldPrecede(), on the keys stored in the heap
+#define ENTRYLESS(a, b) \
+    ((a).arrivalTime < (b).arrivalTime || ((a).arrivalTime == (b).arrivalTime && \
+     ((a).priority < (b).priority || ((a).priority == (b).priority && (a).insertOrder < (b).insertOrder))))
 
 //----
 
-cEventHeap::cEventHeap(const char *name, int intialCapacity) : cFutureEventSet(name),
-    heapCapacity(intialCapacity)
+cEventHeap::cEventHeap(const char *name, int intialCapacity) : cFutureEventSet(name)
 {
-    heap = new cEvent *[heapCapacity+1];  // +1 is necessary because h[0] is not used
+    allocateHeap(intialCapacity);
     cb = new cEvent *[cbsize];
 }
 
@@ -70,10 +75,18 @@ cEventHeap::cEventHeap(const cEventHeap& other) : cFutureEventSet(other)
 cEventHeap::~cEventHeap()
 {
     clear();
-    delete[] heap;
+    delete[] heapBuffer;
     delete[] cb;
 }
 
+void cEventHeap::allocateHeap(int capacity)
+{
+    static_assert(sizeof(Entry) == 32, "heap entries should be 32 bytes");
+    heapCapacity = capacity;
+    heapBuffer = new char[(HEAPROOT+capacity) * sizeof(Entry) + HEAPALIGN];
+    heap = (Entry *)(((uintptr_t)heapBuffer + HEAPALIGN - 1) & ~(uintptr_t)(HEAPALIGN - 1));
+}
+
 std::string cEventHeap::str() const
 {
     if (isEmpty())
@@ -90,10 +103,9 @@ void cEventHeap::forEachChild(cVisitor *v)
     for (int i = cbhead; i != cbtail; CBINC(i))
         v->visit(cb[i]);
 
-    for (int i = 1; i <= heapLength; i++)
-        if (heap[i])
-            if (!v->visit(heap[i]))
-                return;
+    for (int i = HEAPROOT; i < HEAPROOT+heapLength; i++)
+        if (!v->visit(heap[i].event))
+            return;
 }
 
 void cEventHeap::clear()
@@ -102,8 +114,8 @@ void cEventHeap::clear()
         dropAndDelete(cb[i]);
     cbhead = cbtail = 0;
 
-    for (int i = 1; i <= heapLength; i++)
-        dropAndDelete(heap[i]);
+    for (int i = HEAPROOT; i < HEAPROOT+heapLength; i++)
+        dropAndDelete(heap[i].event);
     heapLength = 0;
 }
 
@@ -111,11 +123,15 @@ void cEventHeap::copy(const cEventHeap& other)
 {
     // copy heap
     heapLength = other.heapLength;
-    heapCapacity = other.heapCapacity;
-    delete[] heap;
-    heap = new cEvent *[heapCapacity+1];
-    for (int i = 1; i <= heapLength; i++)
-        take(heap[i] = other.heap[i]->dup());
+    delete[] heapBuffer;
+    allocateHeap(other.heapCapacity);
+    for (int i = HEAPROOT; i < HEAPROOT+heapLength; i++) {
+        heap[i] = other.heap[i];
+        cEvent *event = heap[i].event = other.heap[i].event->dup();
+        event->insertOrder = heap[i].insertOrder;
+        event->heapIndex = i;
+        take(event);
+    }
 
     // copy circular buffer
     cbhead = other.cbhead;
@@ -149,17 +165,17 @@ cEvent *cEventHeap::get(int k)
         return cbget(k);
     k -= cblen;
 
-    // map the rest to h[1]..h[n] (h[] is 1-based)
+    // map the rest to the heap (a sorted array is also a heap)
     if (k >= heapLength)
         return nullptr;
-    return heap[k+1];
+    return heap[HEAPROOT+k].event;
 }
 
 void cEventHeap::sort()
 {
-    qsort(heap+1, heapLength, sizeof(cEvent *), qsort_cmp_msgs);
-    for (int i = 1; i <= heapLength; i++)
-        heap[i]->heapIndex = i;
+    std::sort(heap+HEAPROOT, heap+HEAPROOT+heapLength, [](const Entry& a, const Entry& b) { return ENTRYLESS(a, b); });
+    for (int i = HEAPROOT; i < HEAPROOT+heapLength; i++)
+        heap[i].event->heapIndex = i;
 }
 
 void cEventHeap::insert(cEvent *event)
@@ -179,7 +195,7 @@ void cEventHeap::insert(cEvent *event)
     if (event->getArrivalTime() == now) {
         ASSERT(cbhead == cbtail || cb[cbhead]->getArrivalTime() == now); // causality violation
         if (event->getSchedulingPriority() == 0) {
-            if (heapLength == 0 || heap[1]->getArrivalTime() > now)
+            if (heapLength == 0 || heap[HEAPROOT].arrivalTime > now.raw())
                 eligible = true;
         }
         else if (event->getSchedulingPriority() < 0)
@@ -203,23 +219,28 @@ void cEventHeap::cbInsert(cEvent *event)
 
 void cEventHeap::heapInsert(cEvent *event)
 {
-    if (++heapLength > heapCapacity) {
-        heapCapacity *= 2;
-        cEvent **newHeap = new cEvent *[heapCapacity+1];
-        for (int i = 1; i <= heapLength-1; i++)
-            newHeap[i] = heap[i];
-        delete[] heap;
-        heap = newHeap;
+    if (heapLength == heapCapacity) {
+        char *oldBuffer = heapBuffer;
+        Entry *oldHeap = heap;
+        allocateHeap(std::max(2*heapCapacity, 16));
+        memcpy(heap+HEAPROOT, oldHeap+HEAPROOT, heapLength * sizeof(Entry));
+        delete[] oldBuffer;
     }
 
+    Entry entry;
+    entry.arrivalTime = event->getArrivalTime().raw();
+    entry.insertOrder = event->insertOrder;
+    entry.event = event;
+    entry.priority = event->getSchedulingPriority();
+
     int i, j;
-    for (j = heapLength; j > 1; j = i) {
-        i = j>>1;
-        if (*heap[i] <= *event)  // direction
+    for (j = HEAPROOT + heapLength++; j > HEAPROOT; j = i) {
+        i = HEAPPARENT(j);
+        if (!ENTRYLESS(entry, heap[i]))  // direction
             break;
-        (heap[j] = heap[i])->heapIndex = j;
+        (heap[j] = heap[i]).event->heapIndex = j;
     }
-    (heap[j] = event)->heapIndex = j;
+    (heap[j] = entry).event->heapIndex = j;
 }
 
 void cEventHeap::cbgrow()
@@ -246,27 +267,26 @@ void cEventHeap::flushCb()
 void cEventHeap::shiftup(int from)
 {
     // restores heap structure (in a sub-heap)
-    int i, j;
-    cEvent *temp;
-
-    i = from;
-    while ((j = i<<1) <= heapLength) {
-        if (j < heapLength && (*heap[j] > *heap[j+1]))  // direction
-            j++;
-        if (*heap[i] > *heap[j]) {  // is change necessary?
-            temp = heap[j];
-            (heap[j] = heap[i])->heapIndex = j;
-            (heap[i] = temp)->heapIndex = i;
-            i = j;
-        }
-        else
+    int last = HEAPROOT + heapLength - 1;
+    Entry entry = heap[from];
+    int i = from, j;
+    while ((j = HEAPCHILD(i)) <= last) {
+        // find the smallest child
+        int end = std::min(j+3, last);
+        for (int k = j+1; k <= end; k++)
+            if (ENTRYLESS(heap[k], heap[j]))  // direction
+                j = k;
+        if (!ENTRYLESS(heap[j], entry))  // is change necessary?
             break;
+        (heap[i] = heap[j]).event->heapIndex = i;
+        i = j;
     }
+    (heap[i] = entry).event->heapIndex = i;
 }
 
 cEvent *cEventHeap::peekFirst() const
 {
-    return cbhead != cbtail ? cb[cbhead] : heapLength != 0 ? heap[1] : nullptr;
+    return cbhead != cbtail ? cb[cbhead] : heapLength != 0 ? heap[HEAPROOT].event : nullptr;
 }
 
 cEvent *cEventHeap::removeFirst()
@@ -281,9 +301,11 @@ cEvent *cEventHeap::removeFirst()
     }
     else if (heapLength > 0) {
         // heap: first is taken out and replaced by the last one
-        cEvent *event = heap[1];
-        (heap[1] = heap[heapLength--])->heapIndex = 1;
-        shiftup();
+        cEvent *event = heap[HEAPROOT].event;
+        if (--heapLength > 0) {
+            heap[HEAPROOT] = heap[HEAPROOT+heapLength];
+            shiftup(HEAPROOT);
+        }
         drop(event);
         event->heapIndex = -1;
         return event;
@@ -313,17 +335,19 @@ cEvent *cEventHeap::remove(cEvent *event)
         // event is on the heap
 
         // sanity check:
-        // ASSERT(h[event->heapindex]==event);
+        // ASSERT(heap[event->heapIndex].event==event);
 
         // last element will be used to fill the hole
         int father, out = event->heapIndex;
-        cEvent *fill = heap[heapLength--];
-        while ((father = out>>1) != 0 && *heap[father] > *fill) {
-            (heap[out] = heap[father])->heapIndex = out;  // father is moved down
-            out = father;
+        Entry fill = heap[HEAPROOT + --heapLength];
+        if (out != HEAPROOT + heapLength) {
+            while (out > HEAPROOT && ENTRYLESS(fill, heap[father = HEAPPARENT(out)])) {
+                (heap[out] = heap[father]).event->heapIndex = out;  // father is moved down
+                out = father;
+            }
+            (heap[out] = fill).event->heapIndex = out;
+            shiftup(out);
         }
-        (heap[out] = fill)->heapIndex = out;
-        shiftup(out);
     }
 
     drop(event);
@@ -361,19 +385,22 @@ void cEventHeap::checkHeap()
         ENSURE(event->getSchedulingPriority() == 0);
     }
 
-    for (int i = 1; i <= heapLength; i++) {
-        cEvent *event = heap[i];
+    for (int i = HEAPROOT; i < HEAPROOT+heapLength; i++) {
+        cEvent *event = heap[i].event;
         ENSURE(event->getOwner() == this);
         ENSURE(event->heapIndex == i);
         ENSURE(event->getArrivalTime() >= now);
-        if (i > 1) {
-            cEvent *parent = heap[i>>1];
+        ENSURE(heap[i].arrivalTime == event->getArrivalTime().raw());  // key is up to date
+        ENSURE(heap[i].priority == event->getSchedulingPriority());
+        ENSURE(heap[i].insertOrder == event->getInsertOrder());
+        if (i > HEAPROOT) {
+            cEvent *parent = heap[HEAPPARENT(i)].event;
             ENSURE(*parent <= *event); // heap order property
         }
     }
 
     if (heapLength >= 1 && cbhead != cbtail)
-        ENSURE(*cb[cbhead] <= *heap[1]);
+        ENSURE(*cb[cbhead] <= *heap[HEAPROOT].event);
 
 }
 
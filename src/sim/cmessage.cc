@@ -18,6 +18,7 @@
 #include "omnetpp/cmodule.h"
 #include "omnetpp/csimplemodule.h"
 #include "omnetpp/cmessage.h"
+#include "omnetpp/cmessagepool.h"
 #include "omnetpp/cexception.h"
 #include "omnetpp/cenvir.h"
 
@@ -240,6 +241,37 @@ cMessage *cMessage::privateDup() const
     return ret;
 }
 
+uint64_t cMessage::getPooledMessageCount()
+{
+    uint64_t count = 0;
+    for (cMessagePool *pool = cMessagePool::getFirstPool(); pool; pool = pool->getNextPool())
+        count += pool->getNumAllocated();
+    return count;
+}
+
+uint64_t cMessage::getReusedMessageCount()
+{
+    uint64_t count = 0;
+    for (cMessagePool *pool = cMessagePool::getFirstPool(); pool; pool = pool->getNextPool())
+        count += pool->getNumReused();
+    return count;
+}
+
+uint64_t cMessage::getFreePooledMessageCount()
+{
+    uint64_t count = 0;
+    for (cMessagePool *pool = cMessagePool::getFirstPool(); pool; pool = pool->getNextPool())
+        count += pool->getNumFree();
+    return count;
+}
+
+void cMessage::resetMessageCounters()
+{
+    totalMsgCount = liveMsgCount = 0;
+    for (cMessagePool *pool = cMessagePool::getFirstPool(); pool; pool = pool->getNextPool())
+        pool->resetCounters();
+}
+
 void cMessage::setControlInfo(cObject *p)
 {
     if (!p)
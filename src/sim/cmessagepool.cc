@@ -0,0 +1,75 @@
+//=========================================================================
+//  CMESSAGEPOOL.CC - part of
+//
+//                  OMNeT++/OMNEST
+//           Discrete System Simulation in C++
+//
+//   Member functions of
+//    cMessagePool : free list for the storage of message objects
+//
+//=========================================================================
+
+/*--------------------------------------------------------------*
+  Copyright (C) 1992-2017 Andras Varga
+  Copyright (C) 2006-2017 OpenSim Ltd.
+
+  This file is distributed WITHOUT ANY WARRANTY. See the file
+  `license' for details on this and other legal matters.
+*--------------------------------------------------------------*/
+
+#include "omnetpp/cmessagepool.h"
+#include "omnetpp/simutil.h"
+
+namespace omnetpp {
+
+OPP_THREAD_LOCAL cMessagePool *cMessagePool::firstPool = nullptr;
+
+cMessagePool::cMessagePool(const std::type_info& type, size_t objectSize) : type(type), objectSize(objectSize)
+{
+    nextPool = firstPool;
+    firstPool = this;
+}
+
+cMessagePool::~cMessagePool()
+{
+    purge();
+
+    // unlink; pools are usually destroyed in reverse order of creation
+    for (cMessagePool **pp = &firstPool; *pp; pp = &(*pp)->nextPool) {
+        if (*pp == this) {
+            *pp = nextPool;
+            break;
+        }
+    }
+}
+
+void *cMessagePool::allocateNew(size_t size)
+{
+    if (size == objectSize)
+        numAllocated++;
+    return ::operator new(size);
+}
+
+void cMessagePool::purge()
+{
+    while (freeList) {
+        FreeObject *object = freeList;
+        freeList = object->next;
+        ::operator delete(object);
+    }
+    numFree = 0;
+}
+
+const char *cMessagePool::getClassName() const
+{
+    return opp_typename(type);
+}
+
+void cMessagePool::purgeAll()
+{
+    for (cMessagePool *pool = firstPool; pool; pool = pool->nextPool)
+        pool->purge();
+}
+
+}  // namespace omnetpp
+
@@ -276,12 +276,14 @@ void cModule::insertSubmodule(cModule *mod)
     take(mod);
 
     mod->invalidateFullPathRec();
+    invalidateListenerCaches();  // listeners of the new ancestors apply to the module
 }
 
 void cModule::removeSubmodule(cModule *mod)
 {
     mod->parentModule = nullptr;
     mod->invalidateFullPathRec();
+    invalidateListenerCaches();
 
     // NOTE: no drop(mod): anyone can take ownership anyway (because we're soft owners)
     // and otherwise it'd cause trouble if mod itself is in context (it'd get inserted
@@ -313,6 +315,7 @@ void cModule::insertChannel(cChannel *channel)
         subcomponentData = new SubcomponentData;
 
     subcomponentData->channels.push_back(channel);
+    invalidateListenerCaches();
 }
 
 void cModule::removeChannel(cChannel *channel)
@@ -321,6 +324,7 @@ void cModule::removeChannel(cChannel *channel)
     auto it = find(subcomponentData->channels, channel);
     ASSERT(it != subcomponentData->channels.end());
     subcomponentData->channels.erase(it);
+    invalidateListenerCaches();
 }
 
 void cModule::setName(const char *name)
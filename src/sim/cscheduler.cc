@@ -101,7 +101,7 @@ void cRealTimeScheduler::configure(cSimulation *simulation, cConfiguration *cfg)
 {
     cScheduler::configure(simulation, cfg);
 
-    factor = getEnvir()->getConfig()->getAsDouble(CFGID_REALTIMESCHEDULER_SCALING);
+    factor = cfg->getAsDouble(CFGID_REALTIMESCHEDULER_SCALING);
     if (factor != 0)
         factor = 1 / factor;
     doScaling = (factor != 0);
@@ -0,0 +1,111 @@
+#include <vector>
+#include <algorithm>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+namespace testlib {
+
+class FesStressTester : public cSimpleModule
+{
+  protected:
+    cFutureEventSet *fes; // the real FES
+    std::vector<cMessage*> shadowFes;
+    simtime_t lastEventTime = -1;
+    int targetLength = 1;
+    double spacing = 1;
+  public:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void scheduleAt(simtime_t t, cMessage *msg) override;
+    virtual cMessage *cancelEvent(cMessage *msg) override;
+    void compareFes();
+};
+
+Define_Module(FesStressTester);
+
+void FesStressTester::initialize()
+{
+    fes = getSimulation()->getFES();
+    scheduleAt(simTime(), new cMessage());
+}
+
+void FesStressTester::handleMessage(cMessage *msg)
+{
+    eventnumber_t eventNumber = getSimulation()->getEventNumber();
+    if (eventNumber > par("numEvents").intValue())
+        endSimulation();
+
+    if (shadowFes.empty() || shadowFes.front() != msg)
+        throw cRuntimeError("Wrong message delivered");
+
+    if (msg->getArrivalTime() < lastEventTime)
+        throw cRuntimeError("Out-of-order message delivered");
+    lastEventTime = msg->getArrivalTime();
+
+    delete msg;
+    shadowFes.erase(shadowFes.begin());
+
+    // change the target FES size and the spacing of timestamps now and then
+    if (eventNumber % par("phaseLength").intValue() == 0) {
+        targetLength = targetLength == 1 ? 3000 : targetLength == 3000 ? 50 : 1;
+        spacing = spacing == 1 ? 1e-6 : spacing == 1e-6 ? 0.01 : 1;
+    }
+
+    if (eventNumber % par("checkInterval").intValue() == 0)
+        compareFes();
+
+    // cancel a random msg
+    if (!fes->isEmpty() && dblrand() < 0.1) {
+        int k = intrand(fes->getLength());
+        delete cancelEvent(check_and_cast<cMessage*>(fes->get(k)));
+    }
+
+    // schedule a random number of messages
+    int n = fes->getLength() < targetLength ? intuniform(1,3) : intuniform(0,1);
+    for (int i = 0; i < n; i++) {
+        double r = dblrand();
+        simtime_t t = r < 0.4 ? simTime() : r < 0.5 ? simTime() + intuniform(1,3) * spacing : simTime() + exponential(spacing * targetLength);
+        int prio = dblrand() < 0.7 ? 0 : intuniform(-2,2);
+
+        cMessage *msg = new cMessage();
+        msg->setSchedulingPriority(prio);
+        scheduleAt(t, msg);
+    }
+}
+
+void FesStressTester::scheduleAt(simtime_t t, cMessage *msg)
+{
+    cSimpleModule::scheduleAt(t, msg);
+
+    auto it = std::upper_bound(shadowFes.begin(), shadowFes.end(), msg,
+        [] (const cMessage *a, const cMessage *b) {return a->shouldPrecede(b);});
+    shadowFes.insert(it, msg);
+}
+
+cMessage *FesStressTester::cancelEvent(cMessage *msg)
+{
+    cSimpleModule::cancelEvent(msg);
+
+    auto it = std::find(shadowFes.begin(), shadowFes.end(), msg);
+    if (it != shadowFes.end())
+        shadowFes.erase(it);
+
+    return msg;
+}
+
+void FesStressTester::compareFes()
+{
+    if (cEventHeap *heap = dynamic_cast<cEventHeap*>(fes))
+        heap->checkHeap();
+    else if (cCalendarEventSet *calendar = dynamic_cast<cCalendarEventSet*>(fes))
+        calendar->checkCalendar();
+    fes->sort();
+    int n = fes->getLength();
+    ASSERT((int)shadowFes.size() == n);
+    for (int i = 0; i < n; i++)
+        if (fes->get(i) != shadowFes[i])
+            throw cRuntimeError("Inconsistency at position %d!", i);
+}
+
+}; //namespace
@@ -0,0 +1,76 @@
+//-------------------------------------------------------------
+// File: fesbench.cc
+// Purpose: comparing the performance of the FES implementations
+//-------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+class FesBenchmark : public cSimpleModule
+{
+  protected:
+    std::vector<simtime_t> increments;  // pregenerated, so that all FES classes get the same ones
+    size_t next = 0;
+
+  protected:
+    virtual void initialize() override;
+    simtime_t nextIncrement() {return increments[next++ & (increments.size()-1)];}
+    double hold(cFutureEventSet *fes, int size, long numOps, uint64_t& checksum);
+};
+
+Define_Module(FesBenchmark);
+
+void FesBenchmark::initialize()
+{
+    cPar& increment = par("increment");
+    long numOps = par("numOps");
+    increments.resize(1 << 20);
+    for (simtime_t& t : increments)
+        t = increment.doubleValue();
+
+    EV << "increment: " << increment.str() << "\n";
+    EV << "      size   cEventHeap  cCalendarEventSet  speedup  (ns per hold operation)\n";
+    cStringTokenizer tokenizer(par("sizes"));
+    while (tokenizer.hasMoreTokens()) {
+        int size = atoi(tokenizer.nextToken());
+        cEventHeap heap;
+        cCalendarEventSet calendar;
+        uint64_t heapChecksum = 0, calendarChecksum = 0;
+        long ops = std::max(numOps, 10L * size);  // so that the initial distribution does not dominate
+        double heapNs = hold(&heap, size, ops, heapChecksum);
+        double calendarNs = hold(&calendar, size, ops, calendarChecksum);
+        if (heapChecksum != calendarChecksum)
+            throw cRuntimeError("MISMATCH: cCalendarEventSet returned the events in a different order than cEventHeap at size %d", size);
+        EV << opp_stringf("%10d %12.1f %18.1f %8.2f\n", size, heapNs, calendarNs, heapNs / calendarNs);
+    }
+}
+
+// The classic hold model: remove the first event, and insert it again with
+// a random increment to its timestamp. The checksum covers the order in
+// which events come out.
+double FesBenchmark::hold(cFutureEventSet *fes, int size, long numOps, uint64_t& checksum)
+{
+    next = 0;
+    for (int i = 0; i < size; i++) {
+        cMessage *msg = new cMessage();
+        msg->setArrivalTime(nextIncrement());
+        fes->insert(msg);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < numOps; i++) {
+        cEvent *event = fes->removeFirst();
+        checksum = checksum * 1000003 ^ event->getInsertOrder();
+        event->setArrivalTime(event->getArrivalTime() + nextIncrement());
+        fes->insert(event);
+    }
+    double ns = 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / numOps;
+
+    fes->clear();
+    return ns;
+}
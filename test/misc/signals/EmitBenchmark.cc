@@ -0,0 +1,110 @@
+#include <chrono>
+#include <string>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+class EmitBenchmark : public cSimpleModule
+{
+  protected:
+    // counts notifications, so that we can check that all listeners got all signals
+    class CountingListener : public cListener
+    {
+      public:
+        long count = 0;
+        virtual void receiveSignal(cComponent *source, simsignal_t signalID, intval_t i, cObject *details) override {count++;}
+    };
+
+    std::vector<CountingListener *> listeners;
+
+  protected:
+    virtual void initialize() override;
+    virtual void finish() override;
+    CountingListener *subscribe(cComponent *component, simsignal_t signalID);
+    double measure(cComponent *emitter, simsignal_t signalID, long numEmits);
+};
+
+Define_Module(EmitBenchmark);
+
+void EmitBenchmark::initialize()
+{
+    int depth = par("depth");
+    int numSignals = par("numSignals");
+    int numOtherSignals = par("numOtherSignals");
+    long numEmits = par("numEmits").intValue();
+
+    std::vector<simsignal_t> signals;
+    for (int i = 0; i < numSignals; i++)
+        signals.push_back(registerSignal(("bench" + std::to_string(i)).c_str()));
+
+    // build the module tree: network.level1.level2...level<depth>, and a sibling branch
+    cModule *network = getParentModule();
+    cModuleType *levelType = cModuleType::get("EmitBenchmarkLevel");
+    cModule *emitter = network;
+    for (int i = 1; i <= depth; i++)
+        emitter = levelType->createScheduleInit(("level" + std::to_string(i)).c_str(), emitter);
+    cModule *sibling = levelType->createScheduleInit("sibling", network);
+
+    // each level listens to some other signals
+    for (cModule *mod = emitter; mod; mod = mod->getParentModule())
+        for (int i = 0; i < numOtherSignals; i++)
+            subscribe(mod, signals[4 + intrand(numSignals - 4)]);
+
+    // signals[0]: no listeners; signals[1]: listener on the sibling only;
+    // signals[2]: listener at the network; signals[3]: local listener and one at the network
+    subscribe(sibling, signals[1]);
+    CountingListener *networkListener = subscribe(network, signals[2]);
+    CountingListener *localListener = subscribe(emitter, signals[3]);
+    CountingListener *networkListener2 = subscribe(network, signals[3]);
+
+    EV << "depth: " << depth << ", registered signals: " << numSignals << ", other signals listened to per level: " << numOtherSignals << "\n";
+    EV << "                               ns per emit()\n";
+    EV << opp_stringf("no listeners             %10.1f\n", measure(emitter, signals[0], numEmits));
+    EV << opp_stringf("listener elsewhere       %10.1f\n", measure(emitter, signals[1], numEmits));
+    EV << opp_stringf("listener at network      %10.1f\n", measure(emitter, signals[2], numEmits));
+    EV << opp_stringf("local + network listener %10.1f\n", measure(emitter, signals[3], numEmits));
+
+    if (networkListener->count != numEmits || localListener->count != numEmits || networkListener2->count != numEmits)
+        throw cRuntimeError("MISMATCH: listeners were not notified about all emitted signals");
+
+    // signal emitted right after subscribing to it somewhere up the tree
+    long numSubscribes = numEmits / 1000;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < numSubscribes; i++) {
+        cModule *mod = emitter;
+        for (int k = intrand(depth); k > 0; k--)
+            mod = mod->getParentModule();
+        CountingListener listener;
+        mod->subscribe(signals[0], &listener);
+        emitter->emit(signals[0], (intval_t)i);
+        mod->unsubscribe(signals[0], &listener);
+        if (listener.count != 1)
+            throw cRuntimeError("MISMATCH: listener subscribed on %s was not notified", mod->getFullPath().c_str());
+    }
+    double ns = 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / numSubscribes;
+    EV << opp_stringf("subscribe+emit+unsubscribe %8.1f\n", ns);
+}
+
+EmitBenchmark::CountingListener *EmitBenchmark::subscribe(cComponent *component, simsignal_t signalID)
+{
+    CountingListener *listener = new CountingListener();
+    listeners.push_back(listener);
+    component->subscribe(signalID, listener);
+    return listener;
+}
+
+double EmitBenchmark::measure(cComponent *emitter, simsignal_t signalID, long numEmits)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < numEmits; i++)
+        emitter->emit(signalID, (intval_t)i);
+    return 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / numEmits;
+}
+
+void EmitBenchmark::finish()
+{
+    // note: listeners unsubscribe themselves in their destructor
+    for (CountingListener *listener : listeners)
+        delete listener;
+    listeners.clear();
+}
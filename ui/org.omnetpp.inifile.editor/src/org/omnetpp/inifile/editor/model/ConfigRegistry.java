@@ -521,7 +521,9 @@ public class ConfigRegistry {
         "futureeventset-class", CFG_STRING, "omnetpp::cEventHeap",
         "Part of the Envir plugin mechanism: selects the class for storing the " +
         "future events in the simulation. The class has to implement the " +
-        "`cFutureEventSet` interface.");
+        "`cFutureEventSet` interface. Built-in implementations are " +
+        "`omnetpp::cEventHeap` (4-ary heap) and `omnetpp::cCalendarEventSet` " +
+        "(calendar queue, faster for large event sets).");
     public static final ConfigOption CFGID_IMAGE_PATH = addGlobalOption(
         "image-path", CFG_PATH, "./images",
         "A semicolon-separated list of directories that contain module icons and " +